@@ -56,6 +56,8 @@ list(APPEND LIBRARY_SOURCES
         src/cpi/CpiV1.cpp
         src/cpi/CpiV2.cpp
         src/sim/BsplineSE3.cpp
+        src/sim/LandmarkGrid.cpp
+        src/track/HammingMatcher.cpp
         src/track/TrackBase.cpp
         src/track/TrackAruco.cpp
         src/track/TrackDescriptor.cpp
@@ -66,6 +68,7 @@ list(APPEND LIBRARY_SOURCES
         src/feat/FeatureDatabase.cpp
         src/feat/FeatureInitializer.cpp
         src/utils/print.cpp
+        src/utils/trace.cpp
 )
 file(GLOB_RECURSE LIBRARY_HEADERS "src/*.h")
 add_library(ov_core_lib SHARED ${LIBRARY_SOURCES} ${LIBRARY_HEADERS})
@@ -113,4 +116,12 @@ add_executable(test_profile src/test_profile.cpp)
             LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
             RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
     )
+
+    add_executable(test_cpi src/test_cpi.cpp)
+    target_link_libraries(test_cpi ov_core_lib ${thirdparty_libraries})
+    install(TARGETS test_cpi
+            ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+    )
 endif()
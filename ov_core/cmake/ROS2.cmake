@@ -42,6 +42,8 @@ list(APPEND LIBRARY_SOURCES
         src/cpi/CpiV1.cpp
         src/cpi/CpiV2.cpp
         src/sim/BsplineSE3.cpp
+        src/sim/LandmarkGrid.cpp
+        src/track/HammingMatcher.cpp
         src/track/TrackBase.cpp
         src/track/TrackAruco.cpp
         src/track/TrackDescriptor.cpp
@@ -52,6 +54,7 @@ list(APPEND LIBRARY_SOURCES
         src/feat/FeatureDatabase.cpp
         src/feat/FeatureInitializer.cpp
         src/utils/print.cpp
+        src/utils/trace.cpp
 )
 file(GLOB_RECURSE LIBRARY_HEADERS "src/*.h")
 add_library(ov_core_lib SHARED ${LIBRARY_SOURCES} ${LIBRARY_HEADERS})
@@ -90,5 +93,10 @@ ament_target_dependencies(test_profile rclcpp cv_bridge)
 target_link_libraries(test_profile ov_core_lib ${thirdparty_libraries})
 install(TARGETS test_profile DESTINATION lib/${PROJECT_NAME})
 
+add_executable(test_cpi src/test_cpi.cpp)
+ament_target_dependencies(test_cpi rclcpp cv_bridge)
+target_link_libraries(test_cpi ov_core_lib ${thirdparty_libraries})
+install(TARGETS test_cpi DESTINATION lib/${PROJECT_NAME})
+
 # finally define this as the package
 ament_package()
@@ -149,6 +149,22 @@ public:
     return pt_out;
   }
 
+  /**
+   * @brief Given a set of normalized uv coordinates this will distort all of them to the raw image plane
+   *
+   * The camera models override this with an implementation which works on all points at once (no per-point virtual call or copy of
+   * the camera values), this default just distorts each point in turn.
+   *
+   * @param uv_norm Normalized coordinates we wish to distort (2xN)
+   * @param uv_dist Raw uv coordinates (2xN)
+   */
+  virtual void distort_batch(const Eigen::Matrix2Xf &uv_norm, Eigen::Matrix2Xf &uv_dist) {
+    uv_dist.resize(2, uv_norm.cols());
+    for (Eigen::Index i = 0; i < uv_norm.cols(); i++) {
+      uv_dist.col(i) = distort_f(uv_norm.col(i));
+    }
+  }
+
   /**
    * @brief Computes the derivative of raw distorted to normalized coordinate.
    * @param uv_norm Normalized coordinates we wish to distort
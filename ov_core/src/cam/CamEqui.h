@@ -157,6 +157,33 @@ public:
     return uv_dist;
   }
 
+  /**
+   * @brief Given a set of normalized uv coordinates this will distort all of them to the raw image plane
+   * @param uv_norm Normalized coordinates we wish to distort (2xN)
+   * @param uv_dist Raw uv coordinates (2xN)
+   */
+  void distort_batch(const Eigen::Matrix2Xf &uv_norm, Eigen::Matrix2Xf &uv_dist) override {
+
+    // Get our camera parameters
+    const Eigen::MatrixXd &cam_d = camera_values;
+
+    // Calculate distorted coordinates for fisheye
+    Eigen::ArrayXd x = uv_norm.row(0).transpose().cast<double>().array();
+    Eigen::ArrayXd y = uv_norm.row(1).transpose().cast<double>().array();
+    Eigen::ArrayXd r = (x * x + y * y).sqrt();
+    Eigen::ArrayXd theta = r.atan();
+    Eigen::ArrayXd theta_2 = theta * theta;
+    Eigen::ArrayXd theta_d = theta * (1 + theta_2 * (cam_d(4) + theta_2 * (cam_d(5) + theta_2 * (cam_d(6) + theta_2 * cam_d(7)))));
+
+    // Handle when r is small (meaning our xy is near the camera center)
+    Eigen::ArrayXd cdist = (r > 1e-8).select(theta_d / r, 1.0);
+
+    // Return the distorted points
+    uv_dist.resize(2, uv_norm.cols());
+    uv_dist.row(0) = (cam_d(0) * x * cdist + cam_d(2)).cast<float>().transpose();
+    uv_dist.row(1) = (cam_d(1) * y * cdist + cam_d(3)).cast<float>().transpose();
+  }
+
   /**
    * @brief Computes the derivative of raw distorted to normalized coordinate.
    * @param uv_norm Normalized coordinates we wish to distort
@@ -145,6 +145,30 @@ public:
     return uv_dist;
   }
 
+  /**
+   * @brief Given a set of normalized uv coordinates this will distort all of them to the raw image plane
+   * @param uv_norm Normalized coordinates we wish to distort (2xN)
+   * @param uv_dist Raw uv coordinates (2xN)
+   */
+  void distort_batch(const Eigen::Matrix2Xf &uv_norm, Eigen::Matrix2Xf &uv_dist) override {
+
+    // Get our camera parameters
+    const Eigen::MatrixXd &cam_d = camera_values;
+
+    // Calculate distorted coordinates for radial
+    Eigen::ArrayXd x = uv_norm.row(0).transpose().cast<double>().array();
+    Eigen::ArrayXd y = uv_norm.row(1).transpose().cast<double>().array();
+    Eigen::ArrayXd r_2 = x * x + y * y;
+    Eigen::ArrayXd radial = 1 + cam_d(4) * r_2 + cam_d(5) * r_2 * r_2;
+    Eigen::ArrayXd x1 = x * radial + 2 * cam_d(6) * x * y + cam_d(7) * (r_2 + 2 * x * x);
+    Eigen::ArrayXd y1 = y * radial + cam_d(6) * (r_2 + 2 * y * y) + 2 * cam_d(7) * x * y;
+
+    // Return the distorted points
+    uv_dist.resize(2, uv_norm.cols());
+    uv_dist.row(0) = (cam_d(0) * x1 + cam_d(2)).cast<float>().transpose();
+    uv_dist.row(1) = (cam_d(1) * y1 + cam_d(3)).cast<float>().transpose();
+  }
+
   /**
    * @brief Computes the derivative of raw distorted to normalized coordinate.
    * @param uv_norm Normalized coordinates we wish to distort
@@ -27,7 +27,9 @@
  */
 
 #include "utils/quat_ops.h"
+#include "utils/sensor_data.h"
 #include <Eigen/Dense>
+#include <vector>
 
 namespace ov_core {
 
@@ -45,6 +47,9 @@ namespace ov_core {
  * 1. call setLinearizationPoints() to set the bias/orientation linearization point
  * 2. call feed_IMU() will all IMU measurements you want to precompound over
  * 3. access public varibles, to get means, Jacobians, and measurement covariance
+ *
+ * If the bias estimates later move away from the linearization point, bias_corrected_means() gives the first-order
+ * corrected means, so an existing preintegration can be reused instead of integrating all of the readings again.
  */
 class CpiBase {
 
@@ -63,6 +68,10 @@ public:
     Q_c.block(3, 3, 3, 3) = std::pow(sigma_wb, 2) * eye3;
     Q_c.block(6, 6, 3, 3) = std::pow(sigma_a, 2) * eye3;
     Q_c.block(9, 9, 3, 3) = std::pow(sigma_ab, 2) * eye3;
+    GQGt_diag.block(0, 0, 3, 1).setConstant(std::pow(sigma_w, 2));
+    GQGt_diag.block(3, 0, 3, 1).setConstant(std::pow(sigma_wb, 2));
+    GQGt_diag.block(6, 0, 3, 1).setConstant(std::pow(sigma_a, 2));
+    GQGt_diag.block(9, 0, 3, 1).setConstant(std::pow(sigma_ab, 2));
     imu_avg = imu_avg_;
     // Calculate our unit vectors, and their skews (used in bias jacobian calcs)
     e_1 << 1, 0, 0;
@@ -85,13 +94,14 @@ public:
    * This function sets the linearization points we are to preintegrate about.
    * For model 2 we will also pass the q_GtoK and current gravity estimate.
    */
-  void setLinearizationPoints(Eigen::Matrix<double, 3, 1> b_w_lin_, Eigen::Matrix<double, 3, 1> b_a_lin_,
-                              Eigen::Matrix<double, 4, 1> q_k_lin_ = Eigen::Matrix<double, 4, 1>::Zero(),
-                              Eigen::Matrix<double, 3, 1> grav_ = Eigen::Matrix<double, 3, 1>::Zero()) {
+  void setLinearizationPoints(const Eigen::Matrix<double, 3, 1> &b_w_lin_, const Eigen::Matrix<double, 3, 1> &b_a_lin_,
+                              const Eigen::Matrix<double, 4, 1> &q_k_lin_ = Eigen::Matrix<double, 4, 1>::Zero(),
+                              const Eigen::Matrix<double, 3, 1> &grav_ = Eigen::Matrix<double, 3, 1>::Zero()) {
     b_w_lin = b_w_lin_;
     b_a_lin = b_a_lin_;
     q_k_lin = q_k_lin_;
     grav = grav_;
+    grav_k_lin = quat_2_Rot(q_k_lin) * grav;
   }
 
   /**
@@ -106,9 +116,42 @@ public:
    * This new IMU messages and will precompound our measurements, jacobians, and measurement covariance.
    * Please see both CpiV1 and CpiV2 classes for implementation details on how this works.
    */
-  virtual void feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0, Eigen::Matrix<double, 3, 1> a_m_0,
-                        Eigen::Matrix<double, 3, 1> w_m_1 = Eigen::Matrix<double, 3, 1>::Zero(),
-                        Eigen::Matrix<double, 3, 1> a_m_1 = Eigen::Matrix<double, 3, 1>::Zero()) = 0;
+  virtual void feed_IMU(double t_0, double t_1, const Eigen::Matrix<double, 3, 1> &w_m_0, const Eigen::Matrix<double, 3, 1> &a_m_0,
+                        const Eigen::Matrix<double, 3, 1> &w_m_1 = Eigen::Matrix<double, 3, 1>::Zero(),
+                        const Eigen::Matrix<double, 3, 1> &a_m_1 = Eigen::Matrix<double, 3, 1>::Zero()) = 0;
+
+  /**
+   * @brief Will preintegrate a contiguous span of IMU readings.
+   * @param[in] imu_data IMU readings in increasing time, each consecutive pair is fed to feed_IMU()
+   */
+  void feed_IMU_batch(const std::vector<ImuData> &imu_data) {
+    for (size_t k = 0; k + 1 < imu_data.size(); k++) {
+      const ImuData &imu0 = imu_data[k];
+      const ImuData &imu1 = imu_data[k + 1];
+      feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
+    }
+  }
+
+  /**
+   * @brief Gets the measurement means corrected to new biases using the first-order bias Jacobians.
+   * @param[in] b_w new gyroscope bias
+   * @param[in] b_a new accelerometer bias
+   * @param[out] q_k2tau_corr corrected orientation measurement mean
+   * @param[out] alpha_tau_corr corrected alpha measurement mean
+   * @param[out] beta_tau_corr corrected beta measurement mean
+   *
+   * This matches the bias correction done in the preintegration factors, and is only accurate for small changes in the bias.
+   * The preintegration should be recomputed about the new biases if they have moved far from the linearization point.
+   */
+  void bias_corrected_means(const Eigen::Matrix<double, 3, 1> &b_w, const Eigen::Matrix<double, 3, 1> &b_a,
+                            Eigen::Matrix<double, 4, 1> &q_k2tau_corr, Eigen::Matrix<double, 3, 1> &alpha_tau_corr,
+                            Eigen::Matrix<double, 3, 1> &beta_tau_corr) const {
+    Eigen::Matrix<double, 3, 1> dbw = b_w - b_w_lin;
+    Eigen::Matrix<double, 3, 1> dba = b_a - b_a_lin;
+    q_k2tau_corr = rot_2_quat(exp_so3(J_q * dbw) * R_k2tau);
+    alpha_tau_corr = alpha_tau + J_a * dbw + H_a * dba;
+    beta_tau_corr = beta_tau + J_b * dbw + H_b * dba;
+  }
 
   // Flag if we should perform IMU averaging or not
   // For version 1 we should average the measurement
@@ -137,9 +180,15 @@ public:
   /// Global gravity
   Eigen::Matrix<double, 3, 1> grav = Eigen::Matrix<double, 3, 1>::Zero();
 
+  /// Global gravity in the q_k linearization frame (only model 2 uses)
+  Eigen::Matrix<double, 3, 1> grav_k_lin = Eigen::Matrix<double, 3, 1>::Zero();
+
   /// Our continous-time measurement noise matrix (computed from contructor noise values)
   Eigen::Matrix<double, 12, 12> Q_c = Eigen::Matrix<double, 12, 12>::Zero();
 
+  /// Diagonal of G*Q_c*G^T, constant since the noise is isotropic and G only rotates the accelerometer noise
+  Eigen::Matrix<double, 15, 1> GQGt_diag = Eigen::Matrix<double, 15, 1>::Zero();
+
   /// Our final measurement covariance
   Eigen::Matrix<double, 15, 15> P_meas = Eigen::Matrix<double, 15, 15>::Zero();
 
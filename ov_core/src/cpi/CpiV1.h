@@ -76,10 +76,11 @@ public:
    *
    * We will first analytically integrate our meansurements and Jacobians.
    * Then we perform numerical integration for our measurement covariance.
+   * All intermediate matrices are fixed-size, so no memory is allocated for each reading.
    */
-  void feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0, Eigen::Matrix<double, 3, 1> a_m_0,
-                Eigen::Matrix<double, 3, 1> w_m_1 = Eigen::Matrix<double, 3, 1>::Zero(),
-                Eigen::Matrix<double, 3, 1> a_m_1 = Eigen::Matrix<double, 3, 1>::Zero());
+  void feed_IMU(double t_0, double t_1, const Eigen::Matrix<double, 3, 1> &w_m_0, const Eigen::Matrix<double, 3, 1> &a_m_0,
+                const Eigen::Matrix<double, 3, 1> &w_m_1 = Eigen::Matrix<double, 3, 1>::Zero(),
+                const Eigen::Matrix<double, 3, 1> &a_m_1 = Eigen::Matrix<double, 3, 1>::Zero()) override;
 };
 
 } // namespace ov_core
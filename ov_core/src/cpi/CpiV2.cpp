@@ -30,8 +30,32 @@
 
 using namespace ov_core;
 
-void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0, Eigen::Matrix<double, 3, 1> a_m_0,
-                     Eigen::Matrix<double, 3, 1> w_m_1, Eigen::Matrix<double, 3, 1> a_m_1) {
+namespace {
+
+/**
+ * @brief Computes F*X for the 21x21 state Jacobian of the preintegration (with the cloned orientation states).
+ *
+ * The state Jacobian only has non-zero blocks in the orientation, beta, and alpha rows.
+ * We thus only multiply those rows out instead of the full 21x21 product.
+ */
+void multiply_state_jacobian(const Eigen::Matrix<double, 3, 3> &w_x, const Eigen::Matrix<double, 3, 3> &F_b_th,
+                             const Eigen::Matrix<double, 3, 3> &F_b_ba, const Eigen::Matrix<double, 3, 3> &F_b_th0,
+                             const Eigen::Matrix<double, 3, 3> &F_b_thlin, const Eigen::Matrix<double, 21, 21> &X,
+                             Eigen::Matrix<double, 21, 21> &FX) {
+  FX.setZero();
+  FX.block<3, 21>(0, 0).noalias() = -w_x * X.block<3, 21>(0, 0);
+  FX.block<3, 21>(0, 0) -= X.block<3, 21>(3, 0);
+  FX.block<3, 21>(6, 0).noalias() = F_b_th * X.block<3, 21>(0, 0);
+  FX.block<3, 21>(6, 0).noalias() += F_b_ba * X.block<3, 21>(9, 0);
+  FX.block<3, 21>(6, 0).noalias() += F_b_th0 * X.block<3, 21>(15, 0);
+  FX.block<3, 21>(6, 0).noalias() += F_b_thlin * X.block<3, 21>(18, 0);
+  FX.block<3, 21>(12, 0) = X.block<3, 21>(6, 0);
+}
+
+} // namespace
+
+void CpiV2::feed_IMU(double t_0, double t_1, const Eigen::Matrix<double, 3, 1> &w_m_0, const Eigen::Matrix<double, 3, 1> &a_m_0,
+                     const Eigen::Matrix<double, 3, 1> &w_m_1, const Eigen::Matrix<double, 3, 1> &a_m_1) {
 
   // Get time difference
   double delta_t = t_1 - t_0;
@@ -42,9 +66,12 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
     return;
   }
 
+  // Gravity rotated into the "tau'th" frame (i.e. start of the measurement interval)
+  Eigen::Matrix<double, 3, 1> g_tau = R_k2tau * grav_k_lin;
+
   // Get estimated imu readings
   Eigen::Matrix<double, 3, 1> w_hat = w_m_0 - b_w_lin;
-  Eigen::Matrix<double, 3, 1> a_hat = a_m_0 - b_a_lin - R_k2tau * quat_2_Rot(q_k_lin) * grav;
+  Eigen::Matrix<double, 3, 1> a_hat = a_m_0 - b_a_lin - g_tau;
 
   // If averaging, average
   // Note: we will average the LOCAL acceleration after getting the relative rotation
@@ -56,11 +83,6 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   // Get angle change w*dt
   Eigen::Matrix<double, 3, 1> w_hatdt = w_hat * delta_t;
 
-  // Get entries of w_hat
-  double w_1 = w_hat(0, 0);
-  double w_2 = w_hat(1, 0);
-  double w_3 = w_hat(2, 0);
-
   // Get magnitude of w and wdt
   double mag_w = w_hat.norm();
   double w_dt = mag_w * delta_t;
@@ -68,8 +90,16 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   // Threshold to determine if equations will be unstable
   bool small_w = (mag_w < 0.008726646);
 
-  // Get some of the variables used in the preintegration equations
-  double dt_2 = pow(delta_t, 2);
+  // Powers of the time step and rotation rate that are used in the preintegration equations
+  // We compute them once here instead of calling pow() for each term
+  double dt_2 = delta_t * delta_t;
+  double dt_3 = dt_2 * delta_t;
+  double dt_4 = dt_3 * delta_t;
+  double w_dt_2 = w_dt * w_dt;
+  double mag_w_2 = mag_w * mag_w;
+  double mag_w_3 = mag_w_2 * mag_w;
+  double mag_w_4 = mag_w_3 * mag_w;
+  double mag_w_5 = mag_w_4 * mag_w;
   double cos_wt = cos(w_dt);
   double sin_wt = sin(w_dt);
 
@@ -82,8 +112,8 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   //==========================================================================
 
   // Get relative rotation
-  Eigen::Matrix<double, 3, 3> R_tau2tau1 = small_w ? eye3 - delta_t * w_x + (pow(delta_t, 2) / 2) * w_x_2
-                                                   : eye3 - (sin_wt / mag_w) * w_x + ((1.0 - cos_wt) / (pow(mag_w, 2.0))) * w_x_2;
+  Eigen::Matrix<double, 3, 3> R_tau2tau1 =
+      small_w ? eye3 - delta_t * w_x + (dt_2 / 2) * w_x_2 : eye3 - (sin_wt / mag_w) * w_x + ((1.0 - cos_wt) / mag_w_2) * w_x_2;
 
   // Updated roation and its transpose
   Eigen::Matrix<double, 3, 3> R_k2tau1 = R_tau2tau1 * R_k2tau;
@@ -91,7 +121,7 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
 
   // If averaging, average the LOCAL acceleration
   if (imu_avg) {
-    a_hat += a_m_1 - b_a_lin - R_k2tau1 * quat_2_Rot(q_k_lin) * grav;
+    a_hat += a_m_1 - b_a_lin - R_k2tau1 * grav_k_lin;
     a_hat = 0.5 * a_hat;
   }
   Eigen::Matrix<double, 3, 3> a_x = skew_x(a_hat);
@@ -103,15 +133,15 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   double f_4;
 
   if (small_w) {
-    f_1 = -(pow(delta_t, 3) / 3);
-    f_2 = (pow(delta_t, 4) / 8);
-    f_3 = -(pow(delta_t, 2) / 2);
-    f_4 = (pow(delta_t, 3) / 6);
+    f_1 = -(dt_3 / 3);
+    f_2 = (dt_4 / 8);
+    f_3 = -(dt_2 / 2);
+    f_4 = (dt_3 / 6);
   } else {
-    f_1 = (w_dt * cos_wt - sin_wt) / (pow(mag_w, 3));
-    f_2 = (pow(w_dt, 2) - 2 * cos_wt - 2 * w_dt * sin_wt + 2) / (2 * pow(mag_w, 4));
-    f_3 = -(1 - cos_wt) / pow(mag_w, 2);
-    f_4 = (w_dt - sin_wt) / pow(mag_w, 3);
+    f_1 = (w_dt * cos_wt - sin_wt) / mag_w_3;
+    f_2 = (w_dt_2 - 2 * cos_wt - 2 * w_dt * sin_wt + 2) / (2 * mag_w_4);
+    f_3 = -(1 - cos_wt) / mag_w_2;
+    f_4 = (w_dt - sin_wt) / mag_w_3;
   }
 
   // Compute the main part of our analytical means
@@ -130,217 +160,115 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   // BIAS JACOBIANS (ANALYTICAL)
   //==========================================================================
 
-  // Get right Jacobian
-  Eigen::Matrix<double, 3, 3> J_r_tau1 =
-      small_w ? eye3 - .5 * w_tx + (1.0 / 6.0) * w_tx * w_tx
-              : eye3 - ((1 - cos_wt) / (pow((w_dt), 2.0))) * w_tx + ((w_dt - sin_wt) / (pow(w_dt, 3.0))) * w_tx * w_tx;
-
-  // Update orientation in respect to gyro bias Jacobians
-  Eigen::Matrix<double, 3, 3> J_save = J_q;
-  J_q = R_tau2tau1 * J_q + J_r_tau1 * delta_t;
-
-  // Update alpha and beta in respect to accel bias Jacobian
-  H_a -= H_al;
-  H_a += delta_t * H_b;
-  H_b -= H_be;
-
-  // Update alpha and beta in respect to q_GtoLIN Jacobian
-  Eigen::Matrix<double, 3, 1> g_k = quat_2_Rot(q_k_lin) * grav;
-  O_a += delta_t * O_b;
-  O_a += -H_al * R_k2tau * skew_x(g_k);
-  O_b += -H_be * R_k2tau * skew_x(g_k);
-
-  // Derivatives of R_tau12k wrt bias_w entries
-  Eigen::MatrixXd d_R_bw_1 = -R_tau12k * skew_x(J_q * e_1);
-  Eigen::MatrixXd d_R_bw_2 = -R_tau12k * skew_x(J_q * e_2);
-  Eigen::MatrixXd d_R_bw_3 = -R_tau12k * skew_x(J_q * e_3);
-
-  // Now compute the gyro bias Jacobian terms
-  double df_1_dbw_1;
-  double df_1_dbw_2;
-  double df_1_dbw_3;
-
-  double df_2_dbw_1;
-  double df_2_dbw_2;
-  double df_2_dbw_3;
-
-  double df_3_dbw_1;
-  double df_3_dbw_2;
-  double df_3_dbw_3;
-
-  double df_4_dbw_1;
-  double df_4_dbw_2;
-  double df_4_dbw_3;
-
-  if (small_w) {
-    double df_1_dw_mag = -(pow(delta_t, 5) / 15);
-    df_1_dbw_1 = w_1 * df_1_dw_mag;
-    df_1_dbw_2 = w_2 * df_1_dw_mag;
-    df_1_dbw_3 = w_3 * df_1_dw_mag;
-
-    double df_2_dw_mag = (pow(delta_t, 6) / 72);
-    df_2_dbw_1 = w_1 * df_2_dw_mag;
-    df_2_dbw_2 = w_2 * df_2_dw_mag;
-    df_2_dbw_3 = w_3 * df_2_dw_mag;
-
-    double df_3_dw_mag = -(pow(delta_t, 4) / 12);
-    df_3_dbw_1 = w_1 * df_3_dw_mag;
-    df_3_dbw_2 = w_2 * df_3_dw_mag;
-    df_3_dbw_3 = w_3 * df_3_dw_mag;
-
-    double df_4_dw_mag = (pow(delta_t, 5) / 60);
-    df_4_dbw_1 = w_1 * df_4_dw_mag;
-    df_4_dbw_2 = w_2 * df_4_dw_mag;
-    df_4_dbw_3 = w_3 * df_4_dw_mag;
-  } else {
-    double df_1_dw_mag = (pow(w_dt, 2) * sin_wt - 3 * sin_wt + 3 * w_dt * cos_wt) / pow(mag_w, 5);
-    df_1_dbw_1 = w_1 * df_1_dw_mag;
-    df_1_dbw_2 = w_2 * df_1_dw_mag;
-    df_1_dbw_3 = w_3 * df_1_dw_mag;
-
-    double df_2_dw_mag = (pow(w_dt, 2) - 4 * cos_wt - 4 * w_dt * sin_wt + pow(w_dt, 2) * cos_wt + 4) / (pow(mag_w, 6));
-    df_2_dbw_1 = w_1 * df_2_dw_mag;
-    df_2_dbw_2 = w_2 * df_2_dw_mag;
-    df_2_dbw_3 = w_3 * df_2_dw_mag;
-
-    double df_3_dw_mag = (2 * (cos_wt - 1) + w_dt * sin_wt) / (pow(mag_w, 4));
-    df_3_dbw_1 = w_1 * df_3_dw_mag;
-    df_3_dbw_2 = w_2 * df_3_dw_mag;
-    df_3_dbw_3 = w_3 * df_3_dw_mag;
-
-    double df_4_dw_mag = (2 * w_dt + w_dt * cos_wt - 3 * sin_wt) / (pow(mag_w, 5));
-    df_4_dbw_1 = w_1 * df_4_dw_mag;
-    df_4_dbw_2 = w_2 * df_4_dw_mag;
-    df_4_dbw_3 = w_3 * df_4_dw_mag;
+  // These are overwritten by the state transition Jacobians below, so only compute them if needed
+  if (!state_transition_jacobians) {
+
+    // Get right Jacobian
+    Eigen::Matrix<double, 3, 3> J_r_tau1 =
+        small_w ? eye3 - .5 * w_tx + (1.0 / 6.0) * w_tx * w_tx
+                : eye3 - ((1 - cos_wt) / w_dt_2) * w_tx + ((w_dt - sin_wt) / (w_dt_2 * w_dt)) * w_tx * w_tx;
+
+    // Update orientation in respect to gyro bias Jacobians
+    Eigen::Matrix<double, 3, 3> J_save = J_q;
+    J_q = R_tau2tau1 * J_q + J_r_tau1 * delta_t;
+
+    // Update alpha and beta in respect to accel bias Jacobian
+    H_a -= H_al;
+    H_a += delta_t * H_b;
+    H_b -= H_be;
+
+    // Update alpha and beta in respect to q_GtoLIN Jacobian
+    Eigen::Matrix<double, 3, 3> R_tau2k_gk_x = R_k2tau * skew_x(grav_k_lin);
+    O_a += delta_t * O_b;
+    O_a += -H_al * R_tau2k_gk_x;
+    O_b += -H_be * R_tau2k_gk_x;
+
+    // Derivatives of f_1..f_4 wrt the magnitude of w (divided by it)
+    // The derivative wrt each gyro bias entry is this scaled by the corresponding entry of w_hat
+    double df_1_dw_mag;
+    double df_2_dw_mag;
+    double df_3_dw_mag;
+    double df_4_dw_mag;
+
+    if (small_w) {
+      df_1_dw_mag = -(dt_4 * delta_t / 15);
+      df_2_dw_mag = (dt_4 * dt_2 / 72);
+      df_3_dw_mag = -(dt_4 / 12);
+      df_4_dw_mag = (dt_4 * delta_t / 60);
+    } else {
+      df_1_dw_mag = (w_dt_2 * sin_wt - 3 * sin_wt + 3 * w_dt * cos_wt) / mag_w_5;
+      df_2_dw_mag = (w_dt_2 - 4 * cos_wt - 4 * w_dt * sin_wt + w_dt_2 * cos_wt + 4) / (mag_w_5 * mag_w);
+      df_3_dw_mag = (2 * (cos_wt - 1) + w_dt * sin_wt) / mag_w_4;
+      df_4_dw_mag = (2 * w_dt + w_dt * cos_wt - 3 * sin_wt) / mag_w_5;
+    }
+
+    // Update gyro bias Jacobians
+    // Each column is the derivative of H_al*a_hat and H_be*a_hat wrt a gyro bias entry, where the derivative of R_tau12k
+    // is -R_tau12k*skew_x(J_q*e_i). We apply everything directly to a_hat so only matrix-vector products are needed.
+    Eigen::Matrix<double, 3, 1> wx_a = w_x * a_hat;
+    Eigen::Matrix<double, 3, 1> wx2_a = w_x_2 * a_hat;
+    Eigen::Matrix<double, 3, 1> alpha_arg_a = alpha_arg * a_hat;
+    Eigen::Matrix<double, 3, 1> Beta_arg_a = Beta_arg * a_hat;
+    J_a += J_b * delta_t;
+    for (int i = 0; i < 3; i++) {
+      Eigen::Matrix<double, 3, 1> e_i = Eigen::Matrix<double, 3, 1>::Unit(i);
+      Eigen::Matrix<double, 3, 1> J_q_i = J_q.col(i);
+      Eigen::Matrix<double, 3, 1> ex_a = e_i.cross(a_hat);
+      Eigen::Matrix<double, 3, 1> ex_wx_a = e_i.cross(wx_a) + w_x * ex_a;
+      Eigen::Matrix<double, 3, 1> Jsave_x_g = J_save.col(i).cross(g_tau);
+      J_a.col(i) += R_tau12k * (-J_q_i.cross(alpha_arg_a) + w_hat(i) * df_1_dw_mag * wx_a - f_1 * ex_a + w_hat(i) * df_2_dw_mag * wx2_a -
+                                f_2 * ex_wx_a) -
+                    H_al * Jsave_x_g;
+      J_b.col(i) += R_tau12k * (-J_q_i.cross(Beta_arg_a) + w_hat(i) * df_3_dw_mag * wx_a - f_3 * ex_a + w_hat(i) * df_4_dw_mag * wx2_a -
+                                f_4 * ex_wx_a) -
+                    H_be * Jsave_x_g;
+    }
   }
 
-  // Gravity rotated into the "tau'th" frame (i.e. start of the measurement interval)
-  Eigen::Matrix<double, 3, 1> g_tau = R_k2tau * quat_2_Rot(q_k_lin) * grav;
-
-  // Update gyro bias Jacobians
-  J_a += J_b * delta_t;
-  J_a.block(0, 0, 3, 1) +=
-      (d_R_bw_1 * alpha_arg + R_tau12k * (df_1_dbw_1 * w_x - f_1 * e_1x + df_2_dbw_1 * w_x_2 - f_2 * (e_1x * w_x + w_x * e_1x))) * a_hat -
-      H_al * skew_x((J_save * e_1)) * g_tau;
-  J_a.block(0, 1, 3, 1) +=
-      (d_R_bw_2 * alpha_arg + R_tau12k * (df_1_dbw_2 * w_x - f_1 * e_2x + df_2_dbw_2 * w_x_2 - f_2 * (e_2x * w_x + w_x * e_2x))) * a_hat -
-      H_al * skew_x((J_save * e_2)) * g_tau;
-  J_a.block(0, 2, 3, 1) +=
-      (d_R_bw_3 * alpha_arg + R_tau12k * (df_1_dbw_3 * w_x - f_1 * e_3x + df_2_dbw_3 * w_x_2 - f_2 * (e_3x * w_x + w_x * e_3x))) * a_hat -
-      H_al * skew_x((J_save * e_3)) * g_tau;
-  J_b.block(0, 0, 3, 1) +=
-      (d_R_bw_1 * Beta_arg + R_tau12k * (df_3_dbw_1 * w_x - f_3 * e_1x + df_4_dbw_1 * w_x_2 - f_4 * (e_1x * w_x + w_x * e_1x))) * a_hat -
-      -H_be * skew_x((J_save * e_1)) * g_tau;
-  J_b.block(0, 1, 3, 1) +=
-      (d_R_bw_2 * Beta_arg + R_tau12k * (df_3_dbw_2 * w_x - f_3 * e_2x + df_4_dbw_2 * w_x_2 - f_4 * (e_2x * w_x + w_x * e_2x))) * a_hat -
-      H_be * skew_x((J_save * e_2)) * g_tau;
-  J_b.block(0, 2, 3, 1) +=
-      (d_R_bw_3 * Beta_arg + R_tau12k * (df_3_dbw_3 * w_x - f_3 * e_3x + df_4_dbw_3 * w_x_2 - f_4 * (e_3x * w_x + w_x * e_3x))) * a_hat -
-      H_be * skew_x((J_save * e_3)) * g_tau;
-
   //==========================================================================
   // MEASUREMENT COVARIANCE
   //==========================================================================
 
   // Going to need orientation at intermediate time i.e. at .5*dt;
-  Eigen::Matrix<double, 3, 3> R_G_to_k = quat_2_Rot(q_k_lin);
   double dt_mid = delta_t / 2.0;
   double w_dt_mid = mag_w * dt_mid;
   Eigen::Matrix<double, 3, 3> R_mid;
 
   // The middle of this interval (i.e., rotation from k to mid)
-  R_mid = small_w ? eye3 - dt_mid * w_x + (pow(dt_mid, 2) / 2) * w_x_2
-                  : eye3 - (sin(w_dt_mid) / mag_w) * w_x + ((1.0 - cos(w_dt_mid)) / (pow(mag_w, 2.0))) * w_x_2;
+  R_mid = small_w ? eye3 - dt_mid * w_x + (dt_mid * dt_mid / 2) * w_x_2
+                  : eye3 - (sin(w_dt_mid) / mag_w) * w_x + ((1.0 - cos(w_dt_mid)) / mag_w_2) * w_x_2;
   R_mid = R_mid * R_k2tau;
 
   // Compute covariance (in this implementation, we use RK4)
-  // k1-------------------------------------------------------------------------------------------------
-
-  // Build state Jacobian
-  Eigen::Matrix<double, 21, 21> F_k1 = Eigen::Matrix<double, 21, 21>::Zero();
-  F_k1.block(0, 0, 3, 3) = -w_x;
-  F_k1.block(0, 3, 3, 3) = -eye3;
-  F_k1.block(6, 0, 3, 3) = -R_k2tau.transpose() * a_x;
-  F_k1.block(6, 9, 3, 3) = -R_k2tau.transpose();
-  F_k1.block(6, 15, 3, 3) = -R_k2tau.transpose() * skew_x(R_k2tau * R_G_to_k * grav);
-  F_k1.block(6, 18, 3, 3) = -R_k2tau.transpose() * R_k2tau * skew_x(R_G_to_k * grav);
-  F_k1.block(12, 6, 3, 3) = eye3;
-
-  // Build noise Jacobian
-  Eigen::Matrix<double, 21, 12> G_k1 = Eigen::Matrix<double, 21, 12>::Zero();
-  G_k1.block(0, 0, 3, 3) = -eye3;
-  G_k1.block(3, 3, 3, 3) = eye3;
-  G_k1.block(6, 6, 3, 3) = -R_k2tau.transpose();
-  G_k1.block(9, 9, 3, 3) = eye3;
-
-  // Get state transition and covariance derivative
-  Eigen::Matrix<double, 21, 21> Phi_dot_k1 = F_k1;
-  Eigen::Matrix<double, 21, 21> P_dot_k1 = F_k1 * P_big + P_big * F_k1.transpose() + G_k1 * Q_c * G_k1.transpose();
-
-  // k2-------------------------------------------------------------------------------------------------
-
-  // Build state Jacobian
-  Eigen::Matrix<double, 21, 21> F_k2 = Eigen::Matrix<double, 21, 21>::Zero();
-  F_k2.block(0, 0, 3, 3) = -w_x;
-  F_k2.block(0, 3, 3, 3) = -eye3;
-  F_k2.block(6, 0, 3, 3) = -R_mid.transpose() * a_x;
-  F_k2.block(6, 9, 3, 3) = -R_mid.transpose();
-  F_k2.block(6, 15, 3, 3) = -R_mid.transpose() * skew_x(R_k2tau * R_G_to_k * grav);
-  F_k2.block(6, 18, 3, 3) = -R_mid.transpose() * R_k2tau * skew_x(R_G_to_k * grav);
-  F_k2.block(12, 6, 3, 3) = eye3;
-
-  // Build noise Jacobian
-  Eigen::Matrix<double, 21, 12> G_k2 = Eigen::Matrix<double, 21, 12>::Zero();
-  G_k2.block(0, 0, 3, 3) = -eye3;
-  G_k2.block(3, 3, 3, 3) = eye3;
-  G_k2.block(6, 6, 3, 3) = -R_mid.transpose();
-  G_k2.block(9, 9, 3, 3) = eye3;
-
-  // Get state transition and covariance derivative
-  Eigen::Matrix<double, 21, 21> Phi_k2 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k1 * dt_mid;
-  Eigen::Matrix<double, 21, 21> P_k2 = P_big + P_dot_k1 * dt_mid;
-  Eigen::Matrix<double, 21, 21> Phi_dot_k2 = F_k2 * Phi_k2;
-  Eigen::Matrix<double, 21, 21> P_dot_k2 = F_k2 * P_k2 + P_k2 * F_k2.transpose() + G_k2 * Q_c * G_k2.transpose();
-
-  // k3-------------------------------------------------------------------------------------------------
-
-  // Our state and noise Jacobians are the same as k2
-  // Since k2 and k3 correspond to the same estimates for the midpoint
-  Eigen::Matrix<double, 21, 21> F_k3 = F_k2;
-  Eigen::Matrix<double, 21, 12> G_k3 = G_k2;
-
-  // Get state transition and covariance derivative
-  Eigen::Matrix<double, 21, 21> Phi_k3 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k2 * dt_mid;
-  Eigen::Matrix<double, 21, 21> P_k3 = P_big + P_dot_k2 * dt_mid;
-  Eigen::Matrix<double, 21, 21> Phi_dot_k3 = F_k3 * Phi_k3;
-  Eigen::Matrix<double, 21, 21> P_dot_k3 = F_k3 * P_k3 + P_k3 * F_k3.transpose() + G_k3 * Q_c * G_k3.transpose();
-
-  // k4-------------------------------------------------------------------------------------------------
-
-  // Build state Jacobian
-  Eigen::Matrix<double, 21, 21> F_k4 = Eigen::Matrix<double, 21, 21>::Zero();
-  F_k4.block(0, 0, 3, 3) = -w_x;
-  F_k4.block(0, 3, 3, 3) = -eye3;
-  F_k4.block(6, 0, 3, 3) = -R_k2tau1.transpose() * a_x;
-  F_k4.block(6, 9, 3, 3) = -R_k2tau1.transpose();
-  F_k4.block(6, 15, 3, 3) = -R_k2tau1.transpose() * skew_x(R_k2tau * R_G_to_k * grav);
-  F_k4.block(6, 18, 3, 3) = -R_k2tau1.transpose() * R_k2tau * skew_x(R_G_to_k * grav);
-  F_k4.block(12, 6, 3, 3) = eye3;
-
-  // Build noise Jacobian
-  Eigen::Matrix<double, 21, 12> G_k4 = Eigen::Matrix<double, 21, 12>::Zero();
-  G_k4.block(0, 0, 3, 3) = -eye3;
-  G_k4.block(3, 3, 3, 3) = eye3;
-  G_k4.block(6, 6, 3, 3) = -R_k2tau1.transpose();
-  G_k4.block(9, 9, 3, 3) = eye3;
-
-  // Get state transition and covariance derivative
-  Eigen::Matrix<double, 21, 21> Phi_k4 = Eigen::Matrix<double, 21, 21>::Identity() + Phi_dot_k3 * delta_t;
-  Eigen::Matrix<double, 21, 21> P_k4 = P_big + P_dot_k3 * delta_t;
-  Eigen::Matrix<double, 21, 21> Phi_dot_k4 = F_k4 * Phi_k4;
-  Eigen::Matrix<double, 21, 21> P_dot_k4 = F_k4 * P_k4 + P_k4 * F_k4.transpose() + G_k4 * Q_c * G_k4.transpose();
-
-  // done-------------------------------------------------------------------------------------------------
+  // The state Jacobian only changes in the rotation of the beta row between the steps
+  // k2 and k3 correspond to the same estimates for the midpoint so share the same Jacobian
+  Eigen::Matrix<double, 3, 3> g_tau_x = skew_x(g_tau);
+  Eigen::Matrix<double, 3, 3> R_tau2k_gk_x = R_k2tau * skew_x(grav_k_lin);
+  Eigen::Matrix<double, 3, 3> R_t[3] = {R_k2tau.transpose(), R_mid.transpose(), R_tau12k};
+  Eigen::Matrix<double, 3, 3> F_b_th[3], F_b_ba[3], F_b_th0[3], F_b_thlin[3];
+  for (int i = 0; i < 3; i++) {
+    F_b_th[i] = -R_t[i] * a_x;
+    F_b_ba[i] = -R_t[i];
+    F_b_th0[i] = -R_t[i] * g_tau_x;
+    F_b_thlin[i] = -R_t[i] * R_tau2k_gk_x;
+  }
+
+  // Get state transition and covariance derivatives
+  // The covariance derivative is F*P + (F*P)^T + G*Q_c*G^T, where the noise term is a constant diagonal
+  const Eigen::Matrix<double, 21, 21> I_21 = Eigen::Matrix<double, 21, 21>::Identity();
+  Eigen::Matrix<double, 21, 21> Phi_dot_k1, Phi_dot_k2, Phi_dot_k3, Phi_dot_k4;
+  Eigen::Matrix<double, 21, 21> P_dot_k1, P_dot_k2, P_dot_k3, P_dot_k4, FX;
+  auto derivatives = [&](int i, const Eigen::Matrix<double, 21, 21> &Phi_k, const Eigen::Matrix<double, 21, 21> &P_k,
+                         Eigen::Matrix<double, 21, 21> &Phi_dot, Eigen::Matrix<double, 21, 21> &P_dot) {
+    multiply_state_jacobian(w_x, F_b_th[i], F_b_ba[i], F_b_th0[i], F_b_thlin[i], Phi_k, Phi_dot);
+    multiply_state_jacobian(w_x, F_b_th[i], F_b_ba[i], F_b_th0[i], F_b_thlin[i], P_k, FX);
+    P_dot = FX + FX.transpose();
+    P_dot.diagonal().head<15>() += GQGt_diag;
+  };
+  derivatives(0, I_21, P_big, Phi_dot_k1, P_dot_k1);
+  derivatives(1, I_21 + Phi_dot_k1 * dt_mid, P_big + P_dot_k1 * dt_mid, Phi_dot_k2, P_dot_k2);
+  derivatives(1, I_21 + Phi_dot_k2 * dt_mid, P_big + P_dot_k2 * dt_mid, Phi_dot_k3, P_dot_k3);
+  derivatives(2, I_21 + Phi_dot_k3 * delta_t, P_big + P_dot_k3 * delta_t, Phi_dot_k4, P_dot_k4);
 
   // Collect covariance solution
   // Ensure it is positive definite
@@ -348,22 +276,19 @@ void CpiV2::feed_IMU(double t_0, double t_1, Eigen::Matrix<double, 3, 1> w_m_0,
   P_big = 0.5 * (P_big + P_big.transpose());
 
   // Calculate the state transition from time k to tau
-  Eigen::Matrix<double, 21, 21> Phi =
-      Eigen::Matrix<double, 21, 21>::Identity() + (delta_t / 6.0) * (Phi_dot_k1 + 2.0 * Phi_dot_k2 + 2.0 * Phi_dot_k3 + Phi_dot_k4);
+  Eigen::Matrix<double, 21, 21> Phi = I_21 + (delta_t / 6.0) * (Phi_dot_k1 + 2.0 * Phi_dot_k2 + 2.0 * Phi_dot_k3 + Phi_dot_k4);
 
   //==========================================================================
   // CLONE TO NEW SAMPLE TIME AND MARGINALIZE OLD SAMPLE TIME
   //==========================================================================
 
-  // Matrix that performs the clone and mariginalization
-  Eigen::Matrix<double, 21, 21> B_k = Eigen::Matrix<double, 21, 21>::Identity();
-  B_k.block(15, 15, 3, 3).setZero();
-  B_k.block(15, 0, 3, 3) = Eigen::Matrix<double, 3, 3>::Identity();
-
-  // Change our measurement covariance and state transition
-  P_big = B_k * P_big * B_k.transpose();
-  P_big = 0.5 * (P_big + P_big.transpose());
-  Discrete_J_b = B_k * Phi * Discrete_J_b;
+  // The clone and mariginalization replaces the old sample orientation (15:18) with the current one (0:3)
+  // This is B_k*P_big*B_k^T and B_k*Phi*Discrete_J_b, applied by just copying the rows and columns
+  P_big.block<3, 21>(15, 0) = P_big.block<3, 21>(0, 0);
+  P_big.block<21, 3>(0, 15) = P_big.block<21, 3>(0, 0);
+  FX.noalias() = Phi * Discrete_J_b;
+  FX.block<3, 21>(15, 0) = FX.block<3, 21>(0, 0);
+  Discrete_J_b = FX;
 
   // Our measurement covariance is the top 15x15 of our large covariance
   P_meas = P_big.block(0, 0, 15, 15);
@@ -59,6 +59,8 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
   PRINT_DEBUG("[B-SPLINE]: trajectory end time = %.6f\n", timestamp_max);
 
   // then create spline control points
+  control_times.clear();
+  control_poses.clear();
   double timestamp_curr = timestamp_min;
   while (true) {
 
@@ -77,13 +79,22 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
     // Linear interpolation and append to our control points
     double lambda = (timestamp_curr - t0) / (t1 - t0);
     Eigen::Matrix4d pose_interp = exp_se3(lambda * log_se3(pose1 * Inv_se3(pose0))) * pose0;
-    control_points.insert({timestamp_curr, pose_interp});
+    control_times.push_back(timestamp_curr);
+    control_poses.push_back(pose_interp);
     timestamp_curr += dt;
     // std::stringstream ss;
     // ss << pose_interp(0,3) << "," << pose_interp(1,3) << "," << pose_interp(2,3) << std::endl;
     // PRINT_DEBUG(ss.str().c_str());
   }
 
+  // The relative twist between neighbouring control points does not change, so compute them once here
+  control_omegas.clear();
+  control_omegas_hat.clear();
+  for (size_t i = 0; i + 1 < control_poses.size(); i++) {
+    control_omegas.push_back(log_se3(Inv_se3(control_poses.at(i)) * control_poses.at(i + 1)));
+    control_omegas_hat.push_back(hat_se3(control_omegas.back()));
+  }
+
   // The start time of the system is two dt in since we need at least two older control points
   timestamp_start = timestamp_min + 2 * dt;
   PRINT_DEBUG("[B-SPLINE]: start trajectory time of %.6f\n", timestamp_start);
@@ -91,158 +102,151 @@ void BsplineSE3::feed_trajectory(std::vector<Eigen::VectorXd> traj_points) {
 
 bool BsplineSE3::get_pose(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG) {
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-  // PRINT_DEBUG("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success =
-  // %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
-
   // Return failure if we can't get bounding poses
-  if (!success) {
+  Sample sample;
+  if (!evaluate(timestamp, 0, sample)) {
     R_GtoI.setIdentity();
     p_IinG.setZero();
     return false;
   }
-
-  // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
-  double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
-  double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
-  double b2 = 1.0 / 6.0 * (u * u * u);
-
-  // Calculate interpolated poses
-  Eigen::Matrix4d A0 = exp_se3(b0 * log_se3(Inv_se3(pose0) * pose1));
-  Eigen::Matrix4d A1 = exp_se3(b1 * log_se3(Inv_se3(pose1) * pose2));
-  Eigen::Matrix4d A2 = exp_se3(b2 * log_se3(Inv_se3(pose2) * pose3));
-
-  // Finally get the interpolated pose
-  Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
-  R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
-  p_IinG = pose_interp.block(0, 3, 3, 1);
+  R_GtoI = sample.R_GtoI;
+  p_IinG = sample.p_IinG;
   return true;
 }
 
 bool BsplineSE3::get_velocity(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                               Eigen::Vector3d &v_IinG) {
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-  // PRINT_DEBUG("[SIM]: time curr = %.6f | dt1 = %.3f | dt2 = %.3f | dt3 = %.3f | dt4 = %.3f | success =
-  // %d\n",timestamp,t0-timestamp,t1-timestamp,t2-timestamp,t3-timestamp,(int)success);
-
   // Return failure if we can't get bounding poses
-  if (!success) {
+  Sample sample;
+  if (!evaluate(timestamp, 1, sample)) {
     w_IinI.setZero();
     v_IinG.setZero();
     return false;
   }
-
-  // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
-  double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
-  double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
-  double b2 = 1.0 / 6.0 * (u * u * u);
-  double b0dot = 1.0 / (6.0 * DT) * (3 - 6 * u + 3 * u * u);
-  double b1dot = 1.0 / (6.0 * DT) * (3 + 6 * u - 6 * u * u);
-  double b2dot = 1.0 / (6.0 * DT) * (3 * u * u);
-
-  // Cache some values we use alot
-  Eigen::Matrix<double, 6, 1> omega_10 = log_se3(Inv_se3(pose0) * pose1);
-  Eigen::Matrix<double, 6, 1> omega_21 = log_se3(Inv_se3(pose1) * pose2);
-  Eigen::Matrix<double, 6, 1> omega_32 = log_se3(Inv_se3(pose2) * pose3);
-
-  // Calculate interpolated poses
-  Eigen::Matrix4d A0 = exp_se3(b0 * omega_10);
-  Eigen::Matrix4d A1 = exp_se3(b1 * omega_21);
-  Eigen::Matrix4d A2 = exp_se3(b2 * omega_32);
-  Eigen::Matrix4d A0dot = b0dot * hat_se3(omega_10) * A0;
-  Eigen::Matrix4d A1dot = b1dot * hat_se3(omega_21) * A1;
-  Eigen::Matrix4d A2dot = b2dot * hat_se3(omega_32) * A2;
-
-  // Get the interpolated pose
-  Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
-  R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
-  p_IinG = pose_interp.block(0, 3, 3, 1);
-
-  // Finally get the interpolated velocities
-  // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
-  Eigen::Matrix4d vel_interp = pose0 * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
-  w_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3));
-  v_IinG = vel_interp.block(0, 3, 3, 1);
+  R_GtoI = sample.R_GtoI;
+  p_IinG = sample.p_IinG;
+  w_IinI = sample.w_IinI;
+  v_IinG = sample.v_IinG;
   return true;
 }
 
 bool BsplineSE3::get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                                   Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG) {
 
-  // Get the bounding poses for the desired timestamp
-  double t0, t1, t2, t3;
-  Eigen::Matrix4d pose0, pose1, pose2, pose3;
-  bool success = find_bounding_control_points(timestamp, control_points, t0, pose0, t1, pose1, t2, pose2, t3, pose3);
-
   // Return failure if we can't get bounding poses
-  if (!success) {
+  Sample sample;
+  if (!evaluate(timestamp, 2, sample)) {
     alpha_IinI.setZero();
     a_IinG.setZero();
     return false;
   }
+  R_GtoI = sample.R_GtoI;
+  p_IinG = sample.p_IinG;
+  w_IinI = sample.w_IinI;
+  v_IinG = sample.v_IinG;
+  alpha_IinI = sample.alpha_IinI;
+  a_IinG = sample.a_IinG;
+  return true;
+}
+
+size_t BsplineSE3::get_samples(const std::vector<double> &timestamps, std::vector<Sample> &samples, int order) const {
+  samples.resize(timestamps.size());
+  size_t num_valid = 0;
+  for (size_t i = 0; i < timestamps.size(); i++) {
+    samples.at(i) = Sample();
+    samples.at(i).timestamp = timestamps.at(i);
+    samples.at(i).valid = evaluate(timestamps.at(i), order, samples.at(i));
+    num_valid += (samples.at(i).valid) ? 1 : 0;
+  }
+  return num_valid;
+}
+
+bool BsplineSE3::find_segment(double timestamp, size_t &idx) const {
+
+  // Return false if we are before the first control point (this also catches nan)
+  if (control_times.empty() || !(timestamp >= control_times.front()))
+    return false;
+
+  // Our control points are uniform so we can directly compute the index
+  // The control point times are accumulated so we need to correct for any rounding (at most a single index off)
+  double idx_guess = std::floor((timestamp - control_times.front()) / dt);
+  if (idx_guess >= (double)control_times.size())
+    return false;
+  idx = (size_t)idx_guess;
+  while (idx > 0 && control_times.at(idx) > timestamp)
+    idx--;
+  while (idx + 1 < control_times.size() && control_times.at(idx + 1) <= timestamp)
+    idx++;
+
+  // We need one older control point and two newer ones
+  return (idx >= 1 && idx + 2 < control_times.size());
+}
+
+bool BsplineSE3::evaluate(double timestamp, int order, Sample &sample) const {
+
+  // Get the bounding poses for the desired timestamp
+  size_t idx;
+  if (!find_segment(timestamp, idx))
+    return false;
+  const Eigen::Matrix4d &pose0 = control_poses.at(idx - 1);
+
+  // Cached relative twists between the control points
+  const Eigen::Matrix<double, 6, 1> &omega_10 = control_omegas.at(idx - 1);
+  const Eigen::Matrix<double, 6, 1> &omega_21 = control_omegas.at(idx);
+  const Eigen::Matrix<double, 6, 1> &omega_32 = control_omegas.at(idx + 1);
+  const Eigen::Matrix4d &omega_10_hat = control_omegas_hat.at(idx - 1);
+  const Eigen::Matrix4d &omega_21_hat = control_omegas_hat.at(idx);
+  const Eigen::Matrix4d &omega_32_hat = control_omegas_hat.at(idx + 1);
 
   // Our De Boor-Cox matrix scalars
-  double DT = (t2 - t1);
-  double u = (timestamp - t1) / DT;
+  double DT = (control_times.at(idx + 1) - control_times.at(idx));
+  double u = (timestamp - control_times.at(idx)) / DT;
   double b0 = 1.0 / 6.0 * (5 + 3 * u - 3 * u * u + u * u * u);
   double b1 = 1.0 / 6.0 * (1 + 3 * u + 3 * u * u - 2 * u * u * u);
   double b2 = 1.0 / 6.0 * (u * u * u);
-  double b0dot = 1.0 / (6.0 * DT) * (3 - 6 * u + 3 * u * u);
-  double b1dot = 1.0 / (6.0 * DT) * (3 + 6 * u - 6 * u * u);
-  double b2dot = 1.0 / (6.0 * DT) * (3 * u * u);
-  double b0dotdot = 1.0 / (6.0 * DT * DT) * (-6 + 6 * u);
-  double b1dotdot = 1.0 / (6.0 * DT * DT) * (6 - 12 * u);
-  double b2dotdot = 1.0 / (6.0 * DT * DT) * (6 * u);
-
-  // Cache some values we use alot
-  Eigen::Matrix<double, 6, 1> omega_10 = log_se3(Inv_se3(pose0) * pose1);
-  Eigen::Matrix<double, 6, 1> omega_21 = log_se3(Inv_se3(pose1) * pose2);
-  Eigen::Matrix<double, 6, 1> omega_32 = log_se3(Inv_se3(pose2) * pose3);
-  Eigen::Matrix4d omega_10_hat = hat_se3(omega_10);
-  Eigen::Matrix4d omega_21_hat = hat_se3(omega_21);
-  Eigen::Matrix4d omega_32_hat = hat_se3(omega_32);
 
   // Calculate interpolated poses
   Eigen::Matrix4d A0 = exp_se3(b0 * omega_10);
   Eigen::Matrix4d A1 = exp_se3(b1 * omega_21);
   Eigen::Matrix4d A2 = exp_se3(b2 * omega_32);
-  Eigen::Matrix4d A0dot = b0dot * omega_10_hat * A0;
-  Eigen::Matrix4d A1dot = b1dot * omega_21_hat * A1;
-  Eigen::Matrix4d A2dot = b2dot * omega_32_hat * A2;
-  Eigen::Matrix4d A0dotdot = b0dot * omega_10_hat * A0dot + b0dotdot * omega_10_hat * A0;
-  Eigen::Matrix4d A1dotdot = b1dot * omega_21_hat * A1dot + b1dotdot * omega_21_hat * A1;
-  Eigen::Matrix4d A2dotdot = b2dot * omega_32_hat * A2dot + b2dotdot * omega_32_hat * A2;
 
   // Get the interpolated pose
   Eigen::Matrix4d pose_interp = pose0 * A0 * A1 * A2;
-  R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
-  p_IinG = pose_interp.block(0, 3, 3, 1);
+  sample.R_GtoI = pose_interp.block(0, 0, 3, 3).transpose();
+  sample.p_IinG = pose_interp.block(0, 3, 3, 1);
+  if (order < 1)
+    return true;
 
   // Get the interpolated velocities
   // NOTE: Rdot = R*skew(omega) => R^T*Rdot = skew(omega)
+  double b0dot = 1.0 / (6.0 * DT) * (3 - 6 * u + 3 * u * u);
+  double b1dot = 1.0 / (6.0 * DT) * (3 + 6 * u - 6 * u * u);
+  double b2dot = 1.0 / (6.0 * DT) * (3 * u * u);
+  Eigen::Matrix4d A0dot = b0dot * omega_10_hat * A0;
+  Eigen::Matrix4d A1dot = b1dot * omega_21_hat * A1;
+  Eigen::Matrix4d A2dot = b2dot * omega_32_hat * A2;
   Eigen::Matrix4d vel_interp = pose0 * (A0dot * A1 * A2 + A0 * A1dot * A2 + A0 * A1 * A2dot);
-  w_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3));
-  v_IinG = vel_interp.block(0, 3, 3, 1);
+  Eigen::Matrix3d omegaskew = pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3);
+  sample.w_IinI = vee(omegaskew);
+  sample.v_IinG = vel_interp.block(0, 3, 3, 1);
+  if (order < 2)
+    return true;
 
-  // Finally get the interpolated velocities
+  // Finally get the interpolated accelerations
   // NOTE: Rdot = R*skew(omega)
   // NOTE: Rdotdot = Rdot*skew(omega) + R*skew(alpha) => R^T*(Rdotdot-Rdot*skew(omega))=skew(alpha)
+  double b0dotdot = 1.0 / (6.0 * DT * DT) * (-6 + 6 * u);
+  double b1dotdot = 1.0 / (6.0 * DT * DT) * (6 - 12 * u);
+  double b2dotdot = 1.0 / (6.0 * DT * DT) * (6 * u);
+  Eigen::Matrix4d A0dotdot = b0dot * omega_10_hat * A0dot + b0dotdot * omega_10_hat * A0;
+  Eigen::Matrix4d A1dotdot = b1dot * omega_21_hat * A1dot + b1dotdot * omega_21_hat * A1;
+  Eigen::Matrix4d A2dotdot = b2dot * omega_32_hat * A2dot + b2dotdot * omega_32_hat * A2;
   Eigen::Matrix4d acc_interp = pose0 * (A0dotdot * A1 * A2 + A0 * A1dotdot * A2 + A0 * A1 * A2dotdot + 2 * A0dot * A1dot * A2 +
                                         2 * A0 * A1dot * A2dot + 2 * A0dot * A1 * A2dot);
-  Eigen::Matrix3d omegaskew = pose_interp.block(0, 0, 3, 3).transpose() * vel_interp.block(0, 0, 3, 3);
-  alpha_IinI = vee(pose_interp.block(0, 0, 3, 3).transpose() * (acc_interp.block(0, 0, 3, 3) - vel_interp.block(0, 0, 3, 3) * omegaskew));
-  a_IinG = acc_interp.block(0, 3, 3, 1);
+  sample.alpha_IinI =
+      vee(pose_interp.block(0, 0, 3, 3).transpose() * (acc_interp.block(0, 0, 3, 3) - vel_interp.block(0, 0, 3, 3) * omegaskew));
+  sample.a_IinG = acc_interp.block(0, 3, 3, 1);
   return true;
 }
 
@@ -297,62 +301,3 @@ bool BsplineSE3::find_bounding_poses(const double timestamp, const AlignedEigenM
   // Return true if we found both bounds
   return (found_older && found_newer);
 }
-
-bool BsplineSE3::find_bounding_control_points(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0,
-                                              double &t1, Eigen::Matrix4d &pose1, double &t2, Eigen::Matrix4d &pose2, double &t3,
-                                              Eigen::Matrix4d &pose3) {
-
-  // Set the default values
-  t0 = -1;
-  t1 = -1;
-  t2 = -1;
-  t3 = -1;
-  pose0 = Eigen::Matrix4d::Identity();
-  pose1 = Eigen::Matrix4d::Identity();
-  pose2 = Eigen::Matrix4d::Identity();
-  pose3 = Eigen::Matrix4d::Identity();
-
-  // Get the two bounding poses
-  bool success = find_bounding_poses(timestamp, poses, t1, pose1, t2, pose2);
-
-  // Return false if this was a failure
-  if (!success)
-    return false;
-
-  // Now find the poses that are below and above
-  auto iter_t1 = poses.find(t1);
-  auto iter_t2 = poses.find(t2);
-
-  // Check that t1 is not the first timestamp
-  if (iter_t1 == poses.begin()) {
-    return false;
-  }
-
-  // Move the older pose backwards in time
-  // Move the newer one forwards in time
-  auto iter_t0 = --iter_t1;
-  auto iter_t3 = ++iter_t2;
-
-  // Check that it is valid
-  if (iter_t3 == poses.end()) {
-    return false;
-  }
-
-  // Set the oldest one
-  t0 = iter_t0->first;
-  pose0 = iter_t0->second;
-
-  // Set the newest one
-  t3 = iter_t3->first;
-  pose3 = iter_t3->second;
-
-  // Assert the timestamps
-  if (success) {
-    assert(t0 < t1);
-    assert(t1 < t2);
-    assert(t2 < t3);
-  }
-
-  // Return true if we found all four bounding poses
-  return success;
-}
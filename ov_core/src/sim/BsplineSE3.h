@@ -153,6 +153,31 @@ public:
   bool get_acceleration(double timestamp, Eigen::Matrix3d &R_GtoI, Eigen::Vector3d &p_IinG, Eigen::Vector3d &w_IinI,
                         Eigen::Vector3d &v_IinG, Eigen::Vector3d &alpha_IinI, Eigen::Vector3d &a_IinG);
 
+  /// Pose and its derivatives at a given time (see get_acceleration() for the definitions)
+  struct Sample {
+    double timestamp = -1;
+    bool valid = false;
+    Eigen::Matrix3d R_GtoI = Eigen::Matrix3d::Identity();
+    Eigen::Vector3d p_IinG = Eigen::Vector3d::Zero();
+    Eigen::Vector3d w_IinI = Eigen::Vector3d::Zero();
+    Eigen::Vector3d v_IinG = Eigen::Vector3d::Zero();
+    Eigen::Vector3d alpha_IinI = Eigen::Vector3d::Zero();
+    Eigen::Vector3d a_IinG = Eigen::Vector3d::Zero();
+  };
+
+  /**
+   * @brief Evaluates the spline at a set of timestamps
+   *
+   * This is the same as calling get_pose(), get_velocity() or get_acceleration() for each timestamp, but the output is allocated once.
+   * Timestamps outside of the spline give samples which are not valid.
+   *
+   * @param timestamps Times we want to evaluate the spline at
+   * @param[out] samples Pose and derivatives at each timestamp
+   * @param order What to compute (0 = pose, 1 = pose and velocity, 2 = pose, velocity and acceleration)
+   * @return Number of valid samples
+   */
+  size_t get_samples(const std::vector<double> &timestamps, std::vector<Sample> &samples, int order = 2) const;
+
   /// Returns the simulation start time that we should start simulating from
   double get_start_time() { return timestamp_start; }
 
@@ -167,8 +192,36 @@ protected:
   typedef std::map<double, Eigen::Matrix4d, std::less<double>, Eigen::aligned_allocator<std::pair<const double, Eigen::Matrix4d>>>
       AlignedEigenMat4d;
 
+  /// Timestamps of our control points (uniformly spaced by dt)
+  std::vector<double> control_times;
+
   /// Our control SE3 control poses (R_ItoG, p_IinG)
-  AlignedEigenMat4d control_points;
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> control_poses;
+
+  /// Relative twist between each control point and the next, log(Inv(pose_i) * pose_i+1), and its hat
+  std::vector<Eigen::Matrix<double, 6, 1>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 1>>> control_omegas;
+  std::vector<Eigen::Matrix4d, Eigen::aligned_allocator<Eigen::Matrix4d>> control_omegas_hat;
+
+  /**
+   * @brief Finds the spline segment for the given timestamp
+   *
+   * Since our control points are uniformly spaced we can directly compute the index.
+   * The segment is the control point at or before the timestamp, and we need one older and two newer control points to interpolate.
+   *
+   * @param timestamp Desired timestamp
+   * @param idx Index of the control point at or before the timestamp
+   * @return False if we do not have all four control points
+   */
+  bool find_segment(double timestamp, size_t &idx) const;
+
+  /**
+   * @brief Evaluates the spline at a given timestamp
+   * @param timestamp Desired timestamp
+   * @param order What to compute (0 = pose, 1 = pose and velocity, 2 = pose, velocity and acceleration)
+   * @param sample Pose and derivatives, only the ones of the requested order are set
+   * @return False if we can't find the control points
+   */
+  bool evaluate(double timestamp, int order, Sample &sample) const;
 
   /**
    * @brief Will find the two bounding poses for a given timestamp.
@@ -186,25 +239,6 @@ protected:
    */
   static bool find_bounding_poses(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0, double &t1,
                                   Eigen::Matrix4d &pose1);
-
-  /**
-   * @brief Will find two older poses and two newer poses for the current timestamp
-   *
-   * @param timestamp Desired timestamp we want to get four bounding poses of
-   * @param poses Map of poses and timestamps
-   * @param t0 Timestamp of the first pose
-   * @param pose0 SE(3) pose of the first pose
-   * @param t1 Timestamp of the second pose
-   * @param pose1 SE(3) pose of the second pose
-   * @param t2 Timestamp of the third pose
-   * @param pose2 SE(3) pose of the third pose
-   * @param t3 Timestamp of the fourth pose
-   * @param pose3 SE(3) pose of the fourth pose
-   * @return False if we are unable to find bounding poses
-   */
-  static bool find_bounding_control_points(const double timestamp, const AlignedEigenMat4d &poses, double &t0, Eigen::Matrix4d &pose0,
-                                           double &t1, Eigen::Matrix4d &pose1, double &t2, Eigen::Matrix4d &pose2, double &t3,
-                                           Eigen::Matrix4d &pose3);
 };
 
 } // namespace ov_core
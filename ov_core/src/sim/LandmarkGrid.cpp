@@ -0,0 +1,171 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LandmarkGrid.h"
+
+#include "cam/CamBase.h"
+
+using namespace ov_core;
+
+void LandmarkGrid::insert(size_t id, const Eigen::Vector3d &p_FinG) {
+  Eigen::Vector3i coord = get_coord(p_FinG);
+  Voxel &voxel = voxels[get_key(coord)];
+  if (voxel.ids.empty()) {
+    voxel.coord = coord;
+    coord_min = (num_landmarks == 0) ? coord : coord_min.cwiseMin(coord);
+    coord_max = (num_landmarks == 0) ? coord : coord_max.cwiseMax(coord);
+  }
+  voxel.ids.push_back(id);
+  voxel.points.push_back(p_FinG);
+  num_landmarks++;
+}
+
+Eigen::Vector4d LandmarkGrid::compute_fov_bounds(const std::shared_ptr<CamBase> &camera, int num_samples, double padding) {
+
+  // Undistort points along the border of the image
+  double x_min = INFINITY, x_max = -INFINITY, y_min = INFINITY, y_max = -INFINITY;
+  for (int i = 0; i <= num_samples; i++) {
+    double u = (double)i / num_samples * camera->w();
+    double v = (double)i / num_samples * camera->h();
+    std::vector<Eigen::Vector2d> uvs = {{u, 0.0}, {u, (double)camera->h()}, {0.0, v}, {(double)camera->w(), v}};
+    for (const auto &uv : uvs) {
+      Eigen::Vector2d uv_norm = camera->undistort_d(uv);
+      x_min = std::min(x_min, uv_norm(0));
+      x_max = std::max(x_max, uv_norm(0));
+      y_min = std::min(y_min, uv_norm(1));
+      y_max = std::max(y_max, uv_norm(1));
+    }
+  }
+
+  // Grow them a bit since the border samples might miss the extremes of the distortion
+  double pad_x = padding * (x_max - x_min);
+  double pad_y = padding * (y_max - y_min);
+  Eigen::Vector4d bounds(x_min - pad_x, x_max + pad_x, y_min - pad_y, y_max + pad_y);
+
+  // Points just outside of the bounds should not project into the image, otherwise the field of view is too wide (or the distortion
+  // folds back on itself) and we are not able to bound it on the normalized image plane
+  for (double scale : {1.25, 2.0}) {
+    for (int i = 0; i <= num_samples && bounds.allFinite(); i++) {
+      double x = bounds(0) + (double)i / num_samples * (bounds(1) - bounds(0));
+      double y = bounds(2) + (double)i / num_samples * (bounds(3) - bounds(2));
+      std::vector<Eigen::Vector2d> uvs_norm = {{x, bounds(2)}, {x, bounds(3)}, {bounds(0), y}, {bounds(1), y}};
+      for (const auto &uv_norm : uvs_norm) {
+        Eigen::Vector2d uv_dist = camera->distort_d(scale * uv_norm);
+        if (uv_dist(0) >= 0 && uv_dist(0) <= camera->w() && uv_dist(1) >= 0 && uv_dist(1) <= camera->h()) {
+          bounds(0) = INFINITY;
+          break;
+        }
+      }
+    }
+  }
+  if (!bounds.allFinite())
+    bounds << -INFINITY, INFINITY, -INFINITY, INFINITY;
+  return bounds;
+}
+
+void LandmarkGrid::query_frustum(const Eigen::Matrix3d &R_GtoC, const Eigen::Vector3d &p_CinG, const Eigen::Vector4d &bounds,
+                                 double min_depth, double max_depth, std::vector<size_t> &ids, std::vector<Eigen::Vector3d> &points) const {
+
+  // Nothing to do if we don't have any landmarks
+  ids.clear();
+  points.clear();
+  if (voxels.empty())
+    return;
+
+  // Planes of the frustum in the camera frame, a point is inside if a.dot(p_FinC) + b >= 0 for all of them
+  std::vector<std::pair<Eigen::Vector3d, double>> planes_C;
+  planes_C.push_back({Eigen::Vector3d(0, 0, 1), -min_depth});
+  planes_C.push_back({Eigen::Vector3d(0, 0, -1), max_depth});
+  bool have_sides = bounds.allFinite();
+  if (have_sides) {
+    planes_C.push_back({Eigen::Vector3d(1, 0, -bounds(0)), 0.0});
+    planes_C.push_back({Eigen::Vector3d(-1, 0, bounds(1)), 0.0});
+    planes_C.push_back({Eigen::Vector3d(0, 1, -bounds(2)), 0.0});
+    planes_C.push_back({Eigen::Vector3d(0, -1, bounds(3)), 0.0});
+  }
+
+  // Move the planes into the global frame, p_FinC = R_GtoC * (p_FinG - p_CinG)
+  // Also record the absolute normal so we can get the max of the plane over a voxel
+  std::vector<std::pair<Eigen::Vector3d, double>> planes_G;
+  std::vector<Eigen::Vector3d> planes_G_abs;
+  for (const auto &plane : planes_C) {
+    Eigen::Vector3d a_G = R_GtoC.transpose() * plane.first;
+    planes_G.push_back({a_G, plane.second - a_G.dot(p_CinG)});
+    planes_G_abs.push_back(a_G.cwiseAbs());
+  }
+
+  // Bounding box of the frustum in the global frame
+  // Without side planes the frustum is an infinite slab, so we will need to check all voxels
+  Eigen::Vector3d box_min = Eigen::Vector3d::Constant(-1e9 * voxel_size);
+  Eigen::Vector3d box_max = Eigen::Vector3d::Constant(1e9 * voxel_size);
+  if (have_sides) {
+    box_min = Eigen::Vector3d::Constant(INFINITY);
+    box_max = Eigen::Vector3d::Constant(-INFINITY);
+    for (double z : {min_depth, max_depth}) {
+      for (double x : {bounds(0), bounds(1)}) {
+        for (double y : {bounds(2), bounds(3)}) {
+          Eigen::Vector3d p_inG = R_GtoC.transpose() * Eigen::Vector3d(x * z, y * z, z) + p_CinG;
+          box_min = box_min.cwiseMin(p_inG);
+          box_max = box_max.cwiseMax(p_inG);
+        }
+      }
+    }
+  }
+
+  // Check if the voxel is outside of any of the planes, for this we check the corner of the voxel furthest along the plane normal
+  double half_size = 0.5 * voxel_size;
+  auto in_frustum = [&](const Voxel &voxel) {
+    Eigen::Vector3d center = (voxel.coord.cast<double>().array() + 0.5) * voxel_size;
+    for (size_t i = 0; i < planes_G.size(); i++) {
+      if (planes_G.at(i).first.dot(center) + half_size * planes_G_abs.at(i).sum() + planes_G.at(i).second < 0)
+        return false;
+    }
+    return true;
+  };
+  auto append = [&](const Voxel &voxel) {
+    ids.insert(ids.end(), voxel.ids.begin(), voxel.ids.end());
+    points.insert(points.end(), voxel.points.begin(), voxel.points.end());
+  };
+
+  // Range of voxels the frustum covers, if this is more than we have, then just loop through all voxels
+  Eigen::Vector3i range_min = get_coord(box_min).cwiseMax(coord_min);
+  Eigen::Vector3i range_max = get_coord(box_max).cwiseMin(coord_max);
+  if ((range_min.array() > range_max.array()).any())
+    return;
+  Eigen::Vector3d range_size = (range_max - range_min).cast<double>().array() + 1.0;
+  if (range_size.prod() > (double)voxels.size()) {
+    for (const auto &voxel : voxels) {
+      if ((voxel.second.coord.array() >= range_min.array()).all() && (voxel.second.coord.array() <= range_max.array()).all() &&
+          in_frustum(voxel.second))
+        append(voxel.second);
+    }
+    return;
+  }
+  for (int x = range_min(0); x <= range_max(0); x++) {
+    for (int y = range_min(1); y <= range_max(1); y++) {
+      for (int z = range_min(2); z <= range_max(2); z++) {
+        auto it = voxels.find(get_key(Eigen::Vector3i(x, y, z)));
+        if (it != voxels.end() && in_frustum(it->second))
+          append(it->second);
+      }
+    }
+  }
+}
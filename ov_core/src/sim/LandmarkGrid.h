@@ -0,0 +1,129 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_LANDMARK_GRID_H
+#define OV_CORE_LANDMARK_GRID_H
+
+#include <Eigen/Eigen>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ov_core {
+
+class CamBase;
+
+/**
+ * @brief Voxel hash grid of 3d landmarks which can be queried for a camera frustum.
+ *
+ * The simulators keep adding landmarks along the whole trajectory, so projecting the full map into every frame gets slower the longer the
+ * trajectory is. Here we bin the landmarks into cubic voxels, and for a given camera pose only return the landmarks in voxels which
+ * intersect the viewing frustum of the camera. The frustum is described by the near / far depth and the extent of the normalized image
+ * plane (see compute_fov_bounds()). The culling is conservative: every landmark which could project into the image is returned, but the
+ * caller still needs to project them to get the exact set.
+ */
+class LandmarkGrid {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param voxel_size Side length of each voxel (meters)
+   */
+  explicit LandmarkGrid(double voxel_size = 1.0) : voxel_size(voxel_size) {}
+
+  /**
+   * @brief Adds a landmark to the grid
+   * @param id Id of the landmark
+   * @param p_FinG Position of the landmark in the global frame
+   */
+  void insert(size_t id, const Eigen::Vector3d &p_FinG);
+
+  /// Removes all landmarks
+  void clear() {
+    voxels.clear();
+    num_landmarks = 0;
+  }
+
+  /// Number of landmarks in the grid
+  size_t size() const { return num_landmarks; }
+
+  /**
+   * @brief Computes the extent of the normalized image plane which can project into the image
+   *
+   * The border of the image is sampled and undistorted, giving the min / max normalized x and y.
+   * If points outside of these bounds still project into the image (e.g. a fisheye seeing close to 180 degrees) the bounds are returned
+   * as infinite, in which case the frustum query only culls on depth.
+   *
+   * @param camera Camera intrinsics
+   * @param num_samples Number of samples along each border of the image
+   * @param padding Relative amount to grow the bounds by
+   * @return Bounds of the normalized image plane (x_min, x_max, y_min, y_max)
+   */
+  static Eigen::Vector4d compute_fov_bounds(const std::shared_ptr<CamBase> &camera, int num_samples = 20, double padding = 0.05);
+
+  /**
+   * @brief Gets all landmarks in voxels that intersect the camera frustum
+   * @param R_GtoC Rotation from global to camera frame
+   * @param p_CinG Position of the camera in the global frame
+   * @param bounds Extent of the normalized image plane from compute_fov_bounds()
+   * @param min_depth Near plane of the frustum
+   * @param max_depth Far plane of the frustum
+   * @param[out] ids Ids of the candidate landmarks
+   * @param[out] points Global positions of the candidate landmarks
+   */
+  void query_frustum(const Eigen::Matrix3d &R_GtoC, const Eigen::Vector3d &p_CinG, const Eigen::Vector4d &bounds, double min_depth,
+                     double max_depth, std::vector<size_t> &ids, std::vector<Eigen::Vector3d> &points) const;
+
+protected:
+  /// Landmarks in a single voxel, stored contiguously
+  struct Voxel {
+    Eigen::Vector3i coord;
+    std::vector<size_t> ids;
+    std::vector<Eigen::Vector3d> points;
+  };
+
+  /// Integer coordinate of the voxel a point falls into
+  Eigen::Vector3i get_coord(const Eigen::Vector3d &p) const { return (p / voxel_size).array().floor().cast<int>(); }
+
+  /// Packs the voxel coordinate into a single key (21 bits per axis)
+  static uint64_t get_key(const Eigen::Vector3i &coord) {
+    const uint64_t mask = (1ULL << 21) - 1;
+    return ((uint64_t)coord(0) & mask) | (((uint64_t)coord(1) & mask) << 21) | (((uint64_t)coord(2) & mask) << 42);
+  }
+
+  /// Side length of each voxel
+  double voxel_size;
+
+  /// Our voxels and the landmarks in them
+  std::unordered_map<uint64_t, Voxel> voxels;
+
+  /// Bounds of the occupied voxel coordinates
+  Eigen::Vector3i coord_min = Eigen::Vector3i::Zero();
+  Eigen::Vector3i coord_max = Eigen::Vector3i::Zero();
+
+  /// Total number of landmarks
+  size_t num_landmarks = 0;
+};
+
+} // namespace ov_core
+
+#endif /* OV_CORE_LANDMARK_GRID_H */
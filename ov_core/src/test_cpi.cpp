@@ -0,0 +1,205 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "cpi/CpiV1.h"
+#include "cpi/CpiV2.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+#include "utils/sensor_data.h"
+
+using namespace ov_core;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/// Preintegration of one set of readings, and the values we expect from it
+struct CpiCase {
+  int model;
+  bool small_rotation;
+  bool imu_avg;
+  /// alpha, beta, q_k2tau, then the norms of J_q, J_a, J_b, H_a, H_b and P_meas
+  double expected[16];
+};
+
+// Values from the original preintegration (before it was moved to fixed-size kernels)
+// Model 2 uses the state transition bias Jacobians (the default), the analytical ones are checked against them below
+const std::vector<CpiCase> cases = {
+    {1, false, false, {-6.555017226825e-01, -1.113777171403e+00, 4.795099641288e+00,
+                       -1.688557843109e+00, -3.405182613563e+00, 9.094579553225e+00,
+                       3.584684858091e-01, -2.098521236139e-01, 1.780864548867e-01, 8.920468852489e-01,
+                       1.687872506734e+00, 2.352055465374e+00, 7.014050462802e+00,
+                       8.529228430595e-01, 1.687872506734e+00, 2.492365481487e-05}},
+    {1, false, true, {-6.540050980708e-01, -1.117279366896e+00, 4.794710541689e+00,
+                      -1.684027530957e+00, -3.414409215648e+00, 9.091505084996e+00,
+                      3.594200955779e-01, -2.095950812408e-01, 1.780652000545e-01, 8.917285917497e-01,
+                      1.687745907328e+00, 2.352049343339e+00, 7.013537819892e+00,
+                      8.528758372894e-01, 1.687745907328e+00, 2.492308067580e-05}},
+    {1, true, false, {3.498424136180e-02, -1.825678370478e-01, 5.042588552810e+00,
+                      1.486765306006e-01, -2.875564747902e-01, 1.012677554369e+01,
+                      3.744184738598e-04, -2.302132371654e-04, 1.651873168978e-04, 9.999998897629e-01,
+                      1.732050762562e+00, 2.393366832360e+00, 7.193450394975e+00,
+                      8.660253904833e-01, 1.732050762562e+00, 2.517924478068e-05}},
+    {1, true, true, {3.561508907201e-02, -1.821551687368e-01, 5.043131982652e+00,
+                     1.498523878498e-01, -2.864388234599e-01, 1.012733526744e+01,
+                     3.753820997648e-04, -2.300661675216e-04, 1.652053349166e-04, 9.999998894325e-01,
+                     1.732050762431e+00, 2.393508033829e+00, 7.193470170387e+00,
+                     8.660253904351e-01, 1.732050762431e+00, 2.517928887411e-05}},
+    {2, false, false, {8.999939465256e-01, -2.654717671588e+00, 4.059180253558e-01,
+                       1.421880069611e+00, -6.483940933260e+00, 3.149270234059e-01,
+                       3.584684858091e-01, -2.098521236139e-01, 1.780864548867e-01, 8.920468852489e-01,
+                       1.687872506729e+00, 2.337653340977e+00, 6.986526033610e+00,
+                       8.529228430593e-01, 1.687872506734e+00, 2.491773463257e-05}},
+    {2, false, true, {8.949268301860e-01, -2.666237853145e+00, 4.060423078092e-01,
+                      1.413854658897e+00, -6.512291735557e+00, 3.141709523709e-01,
+                      3.594200955779e-01, -2.095950812408e-01, 1.780652000545e-01, 8.917285917497e-01,
+                      1.687745907323e+00, 2.340271253045e+00, 6.997217193027e+00,
+                      8.528758372892e-01, 1.687745907328e+00, 2.491946881573e-05}},
+    {2, true, false, {1.583938133418e+00, -1.731507193114e+00, 6.539038168704e-01,
+                      3.246583929234e+00, -3.385432220710e+00, 1.349404888865e+00,
+                      3.744184738598e-04, -2.302132371654e-04, 1.651873168978e-04, 9.999998897629e-01,
+                      1.732050762562e+00, 2.378141956688e+00, 7.162920799763e+00,
+                      8.660253904833e-01, 1.732050762562e+00, 2.517321174859e-05}},
+    {2, true, true, {1.584562446943e+00, -1.731102553015e+00, 6.544477740156e-01,
+                     3.247747124683e+00, -3.384333560291e+00, 1.349966846425e+00,
+                     3.753820997648e-04, -2.300661675216e-04, 1.652053349166e-04, 9.999998894325e-01,
+                     1.732050762431e+00, 2.378283764473e+00, 7.162942769184e+00,
+                     8.660253904351e-01, 1.732050762431e+00, 2.517325622029e-05}},
+};
+
+// Linearization point of our preintegrations
+const Eigen::Vector3d b_w_lin(0.01, -0.02, 0.005);
+const Eigen::Vector3d b_a_lin(0.1, 0.05, -0.1);
+const Eigen::Vector3d gravity(0.0, 0.0, 9.81);
+
+/**
+ * Smooth one second of 200hz IMU readings.
+ * When small_rotation is set, the bias corrected angular velocity is below the small angle threshold of the preintegration.
+ */
+std::vector<ImuData> create_readings(bool small_rotation) {
+  std::vector<ImuData> readings;
+  double scale = (small_rotation) ? 1e-3 : 1.0;
+  for (int k = 0; k <= 200; k++) {
+    ImuData data;
+    data.timestamp = 0.005 * k;
+    double t = data.timestamp;
+    data.wm = b_w_lin + scale * Eigen::Vector3d(0.8 * std::sin(1.3 * t) + 0.3, -0.5 * std::cos(0.7 * t), 0.4 * std::sin(2.1 * t + 0.5));
+    data.am = Eigen::Vector3d(0.6 * std::sin(0.9 * t), -0.4 * std::cos(1.7 * t), 9.81 + 0.3 * std::sin(2.3 * t));
+    readings.push_back(data);
+  }
+  return readings;
+}
+
+/// Preintegrates the readings for a case about the given biases
+std::shared_ptr<CpiBase> preintegrate(const CpiCase &cpi_case, const Eigen::Vector3d &b_w, const Eigen::Vector3d &b_a,
+                                      bool state_transition_jacobians = true) {
+  std::shared_ptr<CpiBase> cpi;
+  if (cpi_case.model == 1) {
+    cpi = std::make_shared<CpiV1>(1.6968e-04, 1.9393e-05, 2.0000e-3, 3.0000e-3, cpi_case.imu_avg);
+  } else {
+    auto cpi_v2 = std::make_shared<CpiV2>(1.6968e-04, 1.9393e-05, 2.0000e-3, 3.0000e-3, cpi_case.imu_avg);
+    cpi_v2->state_transition_jacobians = state_transition_jacobians;
+    cpi = cpi_v2;
+  }
+  Eigen::Vector4d q_k_lin(0.1, 0.2, 0.3, 0.9);
+  cpi->setLinearizationPoints(b_w, b_a, q_k_lin.normalized(), gravity);
+  cpi->feed_IMU_batch(create_readings(cpi_case.small_rotation));
+  return cpi;
+}
+
+/// Exits with an error if the relative error is too large
+void check_error(const std::string &name, const std::string &what, double error, double max_error) {
+  if (!std::isfinite(error) || error > max_error) {
+    PRINT_ERROR(RED "[CPI]: %s - %s has an error of %.3e (max %.1e)\n" RESET, name.c_str(), what.c_str(), error, max_error);
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+int main(int argc, char **argv) {
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  if (argc > 1) {
+    verbosity = argv[1];
+  }
+  ov_core::Printer::setPrintLevel(verbosity);
+  signal(SIGINT, signal_callback_handler);
+
+  // Bias change used to check the bias Jacobians
+  Eigen::Vector3d d_b_w(2e-3, -1e-3, 1.5e-3);
+  Eigen::Vector3d d_b_a(2e-2, 1e-2, -1e-2);
+
+  for (const CpiCase &cpi_case : cases) {
+    std::string name = "model " + std::to_string(cpi_case.model) + ((cpi_case.small_rotation) ? ", small" : ", large") + " rotation" +
+                       ((cpi_case.imu_avg) ? ", averaged" : "");
+
+    // 1. Means, Jacobians and covariance should match the original implementation
+    std::shared_ptr<CpiBase> cpi = preintegrate(cpi_case, b_w_lin, b_a_lin);
+    double values[16] = {cpi->alpha_tau(0), cpi->alpha_tau(1), cpi->alpha_tau(2), cpi->beta_tau(0), cpi->beta_tau(1), cpi->beta_tau(2),
+                         cpi->q_k2tau(0),   cpi->q_k2tau(1),   cpi->q_k2tau(2),   cpi->q_k2tau(3),  cpi->J_q.norm(),  cpi->J_a.norm(),
+                         cpi->J_b.norm(),   cpi->H_a.norm(),   cpi->H_b.norm(),   cpi->P_meas.norm()};
+    const char *value_names[16] = {"alpha", "alpha", "alpha", "beta", "beta", "beta", "q",   "q",
+                                   "q",     "q",     "J_q",   "J_a",  "J_b",  "H_a",  "H_b", "P_meas"};
+    for (int i = 0; i < 16; i++) {
+      double error = std::abs(values[i] - cpi_case.expected[i]) / std::abs(cpi_case.expected[i]);
+      check_error(name, value_names[i], error, 1e-9);
+    }
+
+    // 2. Model 2 analytical bias Jacobians should agree with the ones from the state transition
+    if (cpi_case.model == 2) {
+      std::shared_ptr<CpiBase> cpi_analytic = preintegrate(cpi_case, b_w_lin, b_a_lin, false);
+      check_error(name, "analytical J_q", (cpi_analytic->J_q - cpi->J_q).norm() / cpi->J_q.norm(), 1e-3);
+      check_error(name, "analytical J_a", (cpi_analytic->J_a - cpi->J_a).norm() / cpi->J_a.norm(), 1e-3);
+      check_error(name, "analytical J_b", (cpi_analytic->J_b - cpi->J_b).norm() / cpi->J_b.norm(), 1e-3);
+      check_error(name, "analytical H_a", (cpi_analytic->H_a - cpi->H_a).norm() / cpi->H_a.norm(), 1e-3);
+      check_error(name, "analytical H_b", (cpi_analytic->H_b - cpi->H_b).norm() / cpi->H_b.norm(), 1e-3);
+    }
+
+    // 3. Bias corrected means should be close to re-integrating the readings about the new biases
+    std::shared_ptr<CpiBase> cpi_new = preintegrate(cpi_case, b_w_lin + d_b_w, b_a_lin + d_b_a);
+    Eigen::Vector4d q_corr;
+    Eigen::Vector3d alpha_corr, beta_corr;
+    cpi->bias_corrected_means(b_w_lin + d_b_w, b_a_lin + d_b_a, q_corr, alpha_corr, beta_corr);
+    double error_q = 2 * quat_multiply(q_corr, Inv(cpi_new->q_k2tau)).block(0, 0, 3, 1).norm();
+    double error_q_lin = 2 * quat_multiply(cpi->q_k2tau, Inv(cpi_new->q_k2tau)).block(0, 0, 3, 1).norm();
+    double error_alpha = (alpha_corr - cpi_new->alpha_tau).norm();
+    double error_alpha_lin = (cpi->alpha_tau - cpi_new->alpha_tau).norm();
+    double error_beta = (beta_corr - cpi_new->beta_tau).norm();
+    double error_beta_lin = (cpi->beta_tau - cpi_new->beta_tau).norm();
+    check_error(name, "bias corrected q", error_q / error_q_lin, 1e-2);
+    check_error(name, "bias corrected alpha", error_alpha / error_alpha_lin, 1e-2);
+    check_error(name, "bias corrected beta", error_beta / error_beta_lin, 1e-2);
+    PRINT_INFO("[CPI]: %s - bias correction error q %.2e, alpha %.2e, beta %.2e (%.2e, %.2e, %.2e without)\n", name.c_str(), error_q,
+               error_alpha, error_beta, error_q_lin, error_alpha_lin, error_beta_lin);
+  }
+
+  PRINT_INFO(GREEN "[CPI]: all preintegration tests passed\n" RESET);
+  return EXIT_SUCCESS;
+}
@@ -31,6 +31,8 @@
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "track/HammingMatcher.h"
+#include "utils/colors.h"
 #include "utils/print.h"
 
 // Define the function to be called when ctrl-c (SIGINT) is sent to process
@@ -170,6 +172,50 @@ int main(int argc, char **argv) {
   }
   print_stats("OPENCV: KLT OPTICAL FLOW", times_ms, "feats", extra_stats);
 
+  // OPENCV: BRUTEFORCE HAMMING KNN MATCH
+  times_ms.clear();
+  cv::Mat desc0(max_features, ov_core::HammingMatcher::DESC_BYTES, CV_8UC1);
+  cv::Mat desc1(max_features, ov_core::HammingMatcher::DESC_BYTES, CV_8UC1);
+  cv::Ptr<cv::DescriptorMatcher> matcher = cv::DescriptorMatcher::create("BruteForce-Hamming");
+  for (int i = 0; i < num_trials; i++) {
+    cv::randu(desc0, cv::Scalar(0), cv::Scalar(255));
+    cv::randu(desc1, cv::Scalar(0), cv::Scalar(255));
+    auto rT1 = boost::posix_time::microsec_clock::local_time();
+    std::vector<std::vector<cv::DMatch>> matches0to1, matches1to0;
+    matcher->knnMatch(desc0, desc1, matches0to1, 2);
+    matcher->knnMatch(desc1, desc0, matches1to0, 2);
+    auto rT2 = boost::posix_time::microsec_clock::local_time();
+    times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+  }
+  print_stats("OPENCV: BRUTEFORCE HAMMING KNN MATCH", times_ms);
+
+  // OV_CORE: HAMMING KNN MATCH
+  // Run every implementation the cpu supports and check its distances against opencv
+  std::string default_implementation = ov_core::HammingMatcher::implementation();
+  for (const std::string &name : ov_core::HammingMatcher::available_implementations()) {
+    ov_core::HammingMatcher::set_implementation(name);
+    times_ms.clear();
+    for (int i = 0; i < num_trials; i++) {
+      cv::randu(desc0, cv::Scalar(0), cv::Scalar(255));
+      cv::randu(desc1, cv::Scalar(0), cv::Scalar(255));
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      std::vector<std::vector<cv::DMatch>> matches0to1, matches1to0;
+      ov_core::HammingMatcher::knn_match_symmetric(desc0, desc1, matches0to1, matches1to0);
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      times_ms.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+      for (int r = 0; r < max_features; r++) {
+        int expected = (int)cv::norm(desc0.row(r), desc1.row(r), cv::NORM_HAMMING);
+        int distance = ov_core::HammingMatcher::distance(desc0.ptr<uint8_t>(r), desc1.ptr<uint8_t>(r));
+        if (distance != expected) {
+          PRINT_ERROR(RED "[HAMMING]: %s distance of row %d is %d but opencv gives %d\n" RESET, name.c_str(), r, distance, expected);
+          std::exit(EXIT_FAILURE);
+        }
+      }
+    }
+    print_stats("OV_CORE: HAMMING KNN MATCH (" + name + ")", times_ms);
+  }
+  ov_core::HammingMatcher::set_implementation(default_implementation);
+
   //=====================================================================================
   //=====================================================================================
   //=====================================================================================
@@ -0,0 +1,222 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "HammingMatcher.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define OV_HAMMING_X86_DISPATCH 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define OV_HAMMING_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace ov_core;
+
+namespace {
+
+/// Portable popcount of the xor (the compiler can use a popcount instruction if we are built for one)
+int distance_scalar(const uint8_t *desc0, const uint8_t *desc1) {
+  uint64_t a[4], b[4];
+  std::memcpy(a, desc0, HammingMatcher::DESC_BYTES);
+  std::memcpy(b, desc1, HammingMatcher::DESC_BYTES);
+  int dist = 0;
+  for (int k = 0; k < 4; k++) {
+#if defined(__GNUC__)
+    dist += __builtin_popcountll(a[k] ^ b[k]);
+#else
+    uint64_t v = a[k] ^ b[k];
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    dist += (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+  }
+  return dist;
+}
+
+#if defined(OV_HAMMING_X86_DISPATCH)
+// These are compiled for their instruction set even if the rest of the library is not
+// They are only called if the cpu we are running on supports them (see implementations())
+
+/// Popcount instruction on each 64 bit word of the xor
+__attribute__((target("popcnt"))) int distance_popcnt(const uint8_t *desc0, const uint8_t *desc1) {
+  uint64_t a[4], b[4];
+  std::memcpy(a, desc0, HammingMatcher::DESC_BYTES);
+  std::memcpy(b, desc1, HammingMatcher::DESC_BYTES);
+  return (int)(_mm_popcnt_u64(a[0] ^ b[0]) + _mm_popcnt_u64(a[1] ^ b[1]) + _mm_popcnt_u64(a[2] ^ b[2]) + _mm_popcnt_u64(a[3] ^ b[3]));
+}
+
+/// Nibble lookup table popcount of the xor, then horizontal sum of the bytes
+__attribute__((target("avx2,popcnt"))) int distance_avx2(const uint8_t *desc0, const uint8_t *desc1) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i mask_low = _mm256_set1_epi8(0x0f);
+  __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)desc0), _mm256_loadu_si256((const __m256i *)desc1));
+  __m256i cnt_low = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask_low));
+  __m256i cnt_high = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask_low));
+  __m256i sum = _mm256_sad_epu8(_mm256_add_epi8(cnt_low, cnt_high), _mm256_setzero_si256());
+  return (int)(_mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3));
+}
+#endif
+
+#if defined(OV_HAMMING_NEON)
+/// Byte popcount of the xor, then horizontal sum (NEON is always available on aarch64)
+int distance_neon(const uint8_t *desc0, const uint8_t *desc1) {
+  uint8x16_t x0 = veorq_u8(vld1q_u8(desc0), vld1q_u8(desc1));
+  uint8x16_t x1 = veorq_u8(vld1q_u8(desc0 + 16), vld1q_u8(desc1 + 16));
+  return (int)vaddlvq_u8(vaddq_u8(vcntq_u8(x0), vcntq_u8(x1)));
+}
+#endif
+
+/// Distance function and name of an implementation
+struct Implementation {
+  std::string name;
+  HammingMatcher::DistanceFunction distance;
+};
+
+/// All implementations the cpu we are running on supports (fastest first)
+const std::vector<Implementation> &supported_implementations() {
+  static const std::vector<Implementation> impls = [] {
+    std::vector<Implementation> list;
+#if defined(OV_HAMMING_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+      list.push_back({"avx2", distance_avx2});
+    if (__builtin_cpu_supports("popcnt"))
+      list.push_back({"popcnt", distance_popcnt});
+#elif defined(OV_HAMMING_NEON)
+    list.push_back({"neon", distance_neon});
+#endif
+    list.push_back({"scalar", distance_scalar});
+    return list;
+  }();
+  return impls;
+}
+
+/// The implementation we are currently using (the fastest supported one unless changed)
+Implementation &current_implementation() {
+  static Implementation impl = supported_implementations().front();
+  return impl;
+}
+
+} // namespace
+
+int HammingMatcher::distance(const uint8_t *desc0, const uint8_t *desc1) { return current_implementation().distance(desc0, desc1); }
+
+void HammingMatcher::knn_match_symmetric(const cv::Mat &desc0, const cv::Mat &desc1, std::vector<std::vector<cv::DMatch>> &matches0to1,
+                                         std::vector<std::vector<cv::DMatch>> &matches1to0) {
+
+  // Assert we can match these
+  assert(supported(desc0));
+  assert(supported(desc1));
+
+  // Pack into continuous buffers
+  cv::Mat packed0, packed1;
+  pack(desc0, packed0);
+  pack(desc1, packed1);
+  int rows0 = packed0.rows;
+  int rows1 = packed1.rows;
+
+  // Best and second best matches of each descriptor in both directions
+  const int dist_init = std::numeric_limits<int>::max();
+  std::vector<int> idx0_a(rows0, -1), idx0_b(rows0, -1), dist0_a(rows0, dist_init), dist0_b(rows0, dist_init);
+  std::vector<int> idx1_a(rows1, -1), idx1_b(rows1, -1), dist1_a(rows1, dist_init), dist1_b(rows1, dist_init);
+
+  // Score every pair once, and record it for both directions
+  const DistanceFunction distance_impl = current_implementation().distance;
+  const uint8_t *data0 = packed0.ptr<uint8_t>();
+  const uint8_t *data1 = packed1.ptr<uint8_t>();
+  for (int i = 0; i < rows0; i++) {
+    const uint8_t *d0 = data0 + (size_t)i * DESC_BYTES;
+    for (int j = 0; j < rows1; j++) {
+      int dist = distance_impl(d0, data1 + (size_t)j * DESC_BYTES);
+      if (dist < dist0_a[i]) {
+        idx0_b[i] = idx0_a[i];
+        dist0_b[i] = dist0_a[i];
+        idx0_a[i] = j;
+        dist0_a[i] = dist;
+      } else if (dist < dist0_b[i]) {
+        idx0_b[i] = j;
+        dist0_b[i] = dist;
+      }
+      if (dist < dist1_a[j]) {
+        idx1_b[j] = idx1_a[j];
+        dist1_b[j] = dist1_a[j];
+        idx1_a[j] = i;
+        dist1_a[j] = dist;
+      } else if (dist < dist1_b[j]) {
+        idx1_b[j] = i;
+        dist1_b[j] = dist;
+      }
+    }
+  }
+
+  // Convert into the knn format (one entry per query descriptor)
+  matches0to1.clear();
+  matches0to1.resize((size_t)rows0);
+  for (int i = 0; i < rows0; i++) {
+    if (idx0_a[i] != -1)
+      matches0to1[i].emplace_back(cv::DMatch(i, idx0_a[i], (float)dist0_a[i]));
+    if (idx0_b[i] != -1)
+      matches0to1[i].emplace_back(cv::DMatch(i, idx0_b[i], (float)dist0_b[i]));
+  }
+  matches1to0.clear();
+  matches1to0.resize((size_t)rows1);
+  for (int j = 0; j < rows1; j++) {
+    if (idx1_a[j] != -1)
+      matches1to0[j].emplace_back(cv::DMatch(j, idx1_a[j], (float)dist1_a[j]));
+    if (idx1_b[j] != -1)
+      matches1to0[j].emplace_back(cv::DMatch(j, idx1_b[j], (float)dist1_b[j]));
+  }
+}
+
+std::string HammingMatcher::implementation() { return current_implementation().name; }
+
+std::vector<std::string> HammingMatcher::available_implementations() {
+  std::vector<std::string> names;
+  for (const auto &impl : supported_implementations())
+    names.push_back(impl.name);
+  return names;
+}
+
+bool HammingMatcher::set_implementation(const std::string &name) {
+  for (const auto &impl : supported_implementations()) {
+    if (impl.name == name) {
+      current_implementation() = impl;
+      return true;
+    }
+  }
+  return false;
+}
+
+void HammingMatcher::pack(const cv::Mat &desc, cv::Mat &packed) {
+  if (desc.empty()) {
+    packed = cv::Mat(0, DESC_BYTES, CV_8UC1);
+  } else if (desc.isContinuous()) {
+    packed = desc;
+  } else {
+    packed = desc.clone();
+  }
+}
@@ -0,0 +1,111 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_HAMMING_MATCHER_H
+#define OV_CORE_HAMMING_MATCHER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace ov_core {
+
+/**
+ * @brief Brute force matcher for 256 bit binary descriptors (e.g. ORB).
+ *
+ * This is a purpose built replacement for the "BruteForce-Hamming" cv::DescriptorMatcher.
+ * Descriptors are packed into a continuous buffer with 32 bytes per row (cv::Mat data is allocated aligned) and the distance between
+ * two descriptors is computed with AVX2, POPCNT, or NEON. On x86-64 the AVX2 and POPCNT versions are always compiled (using function
+ * target attributes, so no special compile flags are needed) and the fastest one the cpu supports is selected at runtime.
+ * If none of them are available we fall back to a scalar popcount.
+ *
+ * The main benefit over calling knnMatch() twice is that each descriptor pair is only scored once.
+ * While we loop over all pairs we keep the best and second best match of both the first and second set.
+ * Thus we get both directions needed for the ratio and symmetry tests in a single pass.
+ */
+class HammingMatcher {
+
+public:
+  /// Number of bytes in each descriptor that we support
+  static const int DESC_BYTES = 32;
+
+  /// Distance function between two descriptors of DESC_BYTES bytes
+  typedef int (*DistanceFunction)(const uint8_t *, const uint8_t *);
+
+  /**
+   * @brief If this descriptor matrix can be matched (32 byte CV_8U rows)
+   * @param desc Descriptor matrix, one descriptor per row
+   * @return True if the descriptors are supported
+   */
+  static bool supported(const cv::Mat &desc) { return desc.empty() || (desc.type() == CV_8UC1 && desc.cols == DESC_BYTES); }
+
+  /**
+   * @brief Hamming distance between two 256 bit descriptors
+   * @param desc0 Pointer to the first 32 bytes
+   * @param desc1 Pointer to the second 32 bytes
+   * @return Number of bits which are different
+   */
+  static int distance(const uint8_t *desc0, const uint8_t *desc1);
+
+  /**
+   * @brief Two nearest neighbours (k=2) in both directions between two descriptor sets.
+   * @param desc0 First set of descriptors
+   * @param desc1 Second set of descriptors
+   * @param matches0to1 Nearest neighbours of each first descriptor (one vector per row of desc0)
+   * @param matches1to0 Nearest neighbours of each second descriptor (one vector per row of desc1)
+   *
+   * The output is in the same format as cv::DescriptorMatcher::knnMatch() with k=2.
+   * If the other set only has a single descriptor then there will only be one neighbour.
+   */
+  static void knn_match_symmetric(const cv::Mat &desc0, const cv::Mat &desc1, std::vector<std::vector<cv::DMatch>> &matches0to1,
+                                  std::vector<std::vector<cv::DMatch>> &matches1to0);
+
+  /// Name of the instruction set the distance function is using (avx2, popcnt, neon, or scalar)
+  static std::string implementation();
+
+  /// Names of all implementations the cpu we are running on supports (fastest first)
+  static std::vector<std::string> available_implementations();
+
+  /**
+   * @brief Changes the implementation used for the distance (e.g. to test or benchmark each of them)
+   *
+   * By default the fastest supported one is used, so this should not be needed normally.
+   * This is not thread safe, so it should not be called while matching on another thread.
+   *
+   * @param name Name of the implementation (see available_implementations())
+   * @return False if the implementation is not supported on this cpu
+   */
+  static bool set_implementation(const std::string &name);
+
+protected:
+  /**
+   * @brief Ensures the descriptors are packed into a continuous buffer we can directly index.
+   * @param desc Descriptor matrix, one descriptor per row
+   * @param packed Continuous descriptor matrix (shares the data if already continuous)
+   */
+  static void pack(const cv::Mat &desc, cv::Mat &packed);
+};
+
+} // namespace ov_core
+
+#endif /* OV_CORE_HAMMING_MATCHER_H */
@@ -77,6 +77,16 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
     img = imgin;
   }
 
+  // Get the tags we saw in the last image which we can try to track
+  std::vector<int> ids_prev;
+  std::vector<std::vector<cv::Point2f>> corners_prev;
+  for (size_t i = 0; i < ids_aruco[cam_id].size(); i++) {
+    if (ids_aruco[cam_id].at(i) > max_tag_id)
+      continue;
+    ids_prev.push_back(ids_aruco[cam_id].at(i));
+    corners_prev.push_back(corners[cam_id].at(i));
+  }
+
   // Clear the old data from the last timestep
   ids_aruco[cam_id].clear();
   corners[cam_id].clear();
@@ -93,12 +103,64 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
   //===================================================================================
   //===================================================================================
 
-  // Perform extraction
-#if CV_MAJOR_VERSION > 4 || ( CV_MAJOR_VERSION == 4 && CV_MINOR_VERSION >= 7)
-  aruco_detector.detectMarkers(img0, corners[cam_id], ids_aruco[cam_id], rejects[cam_id]);
-#else
-  cv::aruco::detectMarkers(img0, aruco_dict, corners[cam_id], ids_aruco[cam_id], aruco_params, rejects[cam_id]);
-#endif
+  // We will scan the full image if we have no tags to track, or it has been too many frames since the last full scan
+  bool do_full_scan = (full_scan_period <= 1 || ids_prev.empty() || frames_since_full_scan[cam_id] + 1 >= full_scan_period);
+
+  // Otherwise only look for tags in a region around where they where in the last image
+  if (!do_full_scan) {
+    double scale = (do_downsizing) ? 0.5 : 1.0;
+    cv::Rect img_bounds(0, 0, img0.cols, img0.rows);
+    for (size_t i = 0; i < corners_prev.size(); i++) {
+      // Skip if we have already re-detected this tag (i.e. in the region of another tag)
+      if (std::find(ids_aruco[cam_id].begin(), ids_aruco[cam_id].end(), ids_prev.at(i)) != ids_aruco[cam_id].end())
+        continue;
+      // Pad the bounding box of the tag by half its size to allow for motion between frames
+      cv::Rect box = cv::boundingRect(corners_prev.at(i));
+      int pad = std::max(roi_min_padding, std::max(box.width, box.height) / 2);
+      cv::Rect roi((int)(scale * (box.x - pad)), (int)(scale * (box.y - pad)), (int)(scale * (box.width + 2 * pad)),
+                   (int)(scale * (box.height + 2 * pad)));
+      roi &= img_bounds;
+      if (roi.area() <= 0)
+        continue;
+      // Detect in this region, and shift back into full image coordinates
+      std::vector<int> ids_roi;
+      std::vector<std::vector<cv::Point2f>> corners_roi, rejects_roi;
+      detect_markers(img0(roi), corners_roi, ids_roi, rejects_roi);
+      cv::Point2f offset((float)roi.x, (float)roi.y);
+      for (size_t j = 0; j < ids_roi.size(); j++) {
+        if (std::find(ids_aruco[cam_id].begin(), ids_aruco[cam_id].end(), ids_roi.at(j)) != ids_aruco[cam_id].end())
+          continue;
+        for (auto &pt : corners_roi.at(j))
+          pt += offset;
+        ids_aruco[cam_id].push_back(ids_roi.at(j));
+        corners[cam_id].push_back(corners_roi.at(j));
+      }
+      for (size_t j = 0; j < rejects_roi.size(); j++) {
+        for (auto &pt : rejects_roi.at(j))
+          pt += offset;
+        rejects[cam_id].push_back(rejects_roi.at(j));
+      }
+    }
+
+    // If we lost any of our tags, then fall back to a full scan to try to recover them
+    for (const int &id : ids_prev) {
+      if (std::find(ids_aruco[cam_id].begin(), ids_aruco[cam_id].end(), id) == ids_aruco[cam_id].end()) {
+        do_full_scan = true;
+        break;
+      }
+    }
+  }
+
+  // Perform extraction on the full image
+  if (do_full_scan) {
+    ids_aruco[cam_id].clear();
+    corners[cam_id].clear();
+    rejects[cam_id].clear();
+    detect_markers(img0, corners[cam_id], ids_aruco[cam_id], rejects[cam_id]);
+    frames_since_full_scan[cam_id] = 0;
+  } else {
+    frames_since_full_scan[cam_id]++;
+  }
   rT2 = boost::posix_time::microsec_clock::local_time();
 
   //===================================================================================
@@ -165,12 +227,22 @@ void TrackAruco::perform_tracking(double timestamp, const cv::Mat &imgin, size_t
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Timing information
-  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for detection\n", (rT2 - rT1).total_microseconds() * 1e-6);
+  PRINT_ALL("[TIME-ARUCO]: %.4f seconds for detection (%s)\n", (rT2 - rT1).total_microseconds() * 1e-6,
+            (do_full_scan) ? "full image" : "tag regions");
   PRINT_ALL("[TIME-ARUCO]: %.4f seconds for feature DB update (%d features)\n", (rT3 - rT2).total_microseconds() * 1e-6,
             (int)ids_new.size());
   PRINT_ALL("[TIME-ARUCO]: %.4f seconds for total\n", (rT3 - rT1).total_microseconds() * 1e-6);
 }
 
+void TrackAruco::detect_markers(const cv::Mat &img, std::vector<std::vector<cv::Point2f>> &corners_out, std::vector<int> &ids_out,
+                                std::vector<std::vector<cv::Point2f>> &rejects_out) {
+#if CV_MAJOR_VERSION > 4 || ( CV_MAJOR_VERSION == 4 && CV_MINOR_VERSION >= 7)
+  aruco_detector.detectMarkers(img, corners_out, ids_out, rejects_out);
+#else
+  cv::aruco::detectMarkers(img, aruco_dict, corners_out, ids_out, aruco_params, rejects_out);
+#endif
+}
+
 void TrackAruco::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::string overlay) {
 
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
@@ -39,6 +39,10 @@ namespace ov_core {
  * You can generate these tags using an online utility: https://chev.me/arucogen/
  * The actual size of the tags do not matter since we do not recover the pose and instead just use this for re-detection and tracking of the
  * four corners of the tag.
+ *
+ * Scanning the full image for tags is expensive, so we can instead only look for tags in a region of interest around where they were
+ * in the last image. A full image scan is then only performed every few frames (to find new tags), or right away if we fail to re-detect
+ * one of the tags we where tracking.
  */
 class TrackAruco : public TrackBase {
 
@@ -50,10 +54,12 @@ public:
    * @param stereo if we should do stereo feature tracking or binocular
    * @param histmethod what type of histogram pre-processing should be done (histogram eq?)
    * @param downsize we can scale the image by 1/2 to increase Aruco tag extraction speed
+   * @param fullscanperiod number of frames between full image scans, in between we only search around the last tags (1 scans every frame)
    */
   explicit TrackAruco(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numaruco, bool stereo, HistogramMethod histmethod,
-                      bool downsize)
-      : TrackBase(cameras, 0, numaruco, stereo, histmethod), max_tag_id(numaruco), do_downsizing(downsize) {
+                      bool downsize, int fullscanperiod = 1)
+      : TrackBase(cameras, 0, numaruco, stereo, histmethod), max_tag_id(numaruco), do_downsizing(downsize),
+        full_scan_period(fullscanperiod) {
 #if ENABLE_ARUCO_TAGS
 #if CV_MAJOR_VERSION > 4 || ( CV_MAJOR_VERSION == 4 && CV_MINOR_VERSION >= 7)
     aruco_dict = cv::aruco::getPredefinedDictionary(cv::aruco::DICT_6X6_1000);
@@ -98,6 +104,16 @@ protected:
    * @param maskin tracking mask for the given input image
    */
   void perform_tracking(double timestamp, const cv::Mat &imgin, size_t cam_id, const cv::Mat &maskin);
+
+  /**
+   * @brief Runs the opencv aruco detector on the given image
+   * @param img image (or region of interest) we will detect tags in
+   * @param corners_out corners of each detected tag
+   * @param ids_out ids of each detected tag
+   * @param rejects_out corners of candidates which where not a valid tag
+   */
+  void detect_markers(const cv::Mat &img, std::vector<std::vector<cv::Point2f>> &corners_out, std::vector<int> &ids_out,
+                      std::vector<std::vector<cv::Point2f>> &rejects_out);
 #endif
 
   // Max tag ID we should extract from (i.e., number of aruco tags starting from zero)
@@ -106,6 +122,12 @@ protected:
   // If we should downsize the image
   bool do_downsizing;
 
+  // Number of frames between full image scans (one or less will scan the full image every frame)
+  int full_scan_period;
+
+  // Minimum number of pixels we pad the last tag bounding box with when searching for it in the next image
+  int roi_min_padding = 10;
+
 #if ENABLE_ARUCO_TAGS
 #if CV_MAJOR_VERSION > 4 || ( CV_MAJOR_VERSION == 4 && CV_MINOR_VERSION >= 7)
   // Our dictionary that we will extract aruco tags with
@@ -125,6 +147,9 @@ protected:
   // Our tag IDs and corner we will get from the extractor
   std::unordered_map<size_t, std::vector<int>> ids_aruco;
   std::unordered_map<size_t, std::vector<std::vector<cv::Point2f>>> corners, rejects;
+
+  // Number of frames since we last scanned the full image of each camera
+  std::unordered_map<size_t, int> frames_since_full_scan;
 #endif
 };
 
@@ -40,6 +40,69 @@ TrackBase::TrackBase(std::unordered_map<size_t, std::shared_ptr<CamBase>> camera
   }
 }
 
+void TrackBase::set_feature_weights(const std::map<size_t, double> &weights) {
+
+  // Normalize so the average weight is one, thus the total number of features stays the same
+  double weight_sum = 0.0;
+  for (const auto &weight : weights) {
+    weight_sum += std::max(0.0, weight.second);
+  }
+  std::lock_guard<std::mutex> lck(mtx_config);
+  feature_weights.clear();
+  if (weights.empty() || weight_sum <= 0.0)
+    return;
+  for (const auto &weight : weights) {
+    feature_weights[weight.first] = std::max(0.0, weight.second) * (double)weights.size() / weight_sum;
+  }
+}
+
+void TrackBase::get_stereo_pairs(const CameraData &message, std::vector<std::pair<size_t, size_t>> &pairs, std::vector<size_t> &monos) {
+
+  // Track everything as monocular if we are not doing stereo
+  pairs.clear();
+  monos.clear();
+  size_t num_images = message.sensor_ids.size();
+  if (!use_stereo) {
+    for (size_t i = 0; i < num_images; i++)
+      monos.push_back(i);
+    return;
+  }
+
+  // If we have not been given any pairs, then just pair consecutive images
+  std::vector<std::pair<size_t, size_t>> pairs_cam;
+  {
+    std::lock_guard<std::mutex> lck(mtx_config);
+    pairs_cam = stereo_pairs;
+  }
+  if (pairs_cam.empty()) {
+    for (size_t i = 0; i + 1 < num_images; i += 2)
+      pairs.emplace_back(i, i + 1);
+    if (num_images % 2 == 1)
+      monos.push_back(num_images - 1);
+    return;
+  }
+
+  // Else find our pairs, the images that are left over are monocular
+  std::vector<bool> used(num_images, false);
+  for (const auto &pair : pairs_cam) {
+    auto it_left = std::find(message.sensor_ids.begin(), message.sensor_ids.end(), (int)pair.first);
+    auto it_right = std::find(message.sensor_ids.begin(), message.sensor_ids.end(), (int)pair.second);
+    if (it_left == message.sensor_ids.end() || it_right == message.sensor_ids.end())
+      continue;
+    size_t id_left = it_left - message.sensor_ids.begin();
+    size_t id_right = it_right - message.sensor_ids.begin();
+    if (used.at(id_left) || used.at(id_right))
+      continue;
+    pairs.emplace_back(id_left, id_right);
+    used.at(id_left) = true;
+    used.at(id_right) = true;
+  }
+  for (size_t i = 0; i < num_images; i++) {
+    if (!used.at(i))
+      monos.push_back(i);
+  }
+}
+
 void TrackBase::display_active(cv::Mat &img_out, int r1, int g1, int b1, int r2, int g2, int b2, std::string overlay) {
 
   // Cache the images to prevent other threads from editing while we viz (which can be slow)
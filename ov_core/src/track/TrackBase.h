@@ -22,8 +22,11 @@
 #ifndef OV_CORE_TRACK_BASE_H
 #define OV_CORE_TRACK_BASE_H
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
@@ -151,6 +154,41 @@ public:
   /// Setter method for number of active features
   void set_num_features(int _num_features) { num_features = _num_features; }
 
+  /**
+   * @brief Number of features we should track in a given camera
+   *
+   * This is the number of features per camera, scaled by the relative weight of this camera (see set_feature_weights()).
+   * Thus the total over all cameras stays the same, but cameras with a larger weight get more of it.
+   *
+   * @param cam_id Camera id we want the number of features for
+   * @return Number of features for this camera
+   */
+  int get_num_features(size_t cam_id) {
+    std::lock_guard<std::mutex> lck(mtx_config);
+    if (feature_weights.find(cam_id) == feature_weights.end())
+      return num_features;
+    return std::max(1, (int)std::round(feature_weights.at(cam_id) * (double)num_features));
+  }
+
+  /**
+   * @brief Sets how the features should be split between cameras
+   * @param weights Relative weight of each camera (e.g. its share of the compute budget), normalized to have a mean of one
+   */
+  void set_feature_weights(const std::map<size_t, double> &weights);
+
+  /**
+   * @brief Sets which cameras should be tracked as stereo pairs
+   *
+   * Any camera which is not part of a pair will be tracked as a monocular camera.
+   * If no pairs are set and we are using stereo, then consecutive images in each message are paired (i.e. 0-1, 2-3).
+   *
+   * @param pairs Pairs of left and right camera ids
+   */
+  void set_stereo_pairs(const std::vector<std::pair<size_t, size_t>> &pairs) {
+    std::lock_guard<std::mutex> lck(mtx_config);
+    stereo_pairs = pairs;
+  }
+
 protected:
   /// Camera object which has all calibration in it
   std::unordered_map<size_t, std::shared_ptr<CamBase>> camera_calib;
@@ -167,6 +205,23 @@ protected:
   /// If we should use binocular tracking or stereo tracking for multi-camera
   bool use_stereo;
 
+  /**
+   * @brief Splits the images of a message into stereo pairs and monocular images
+   * @param message Contains our timestamp, images, and camera ids
+   * @param pairs Message indices of the left and right images of each stereo pair
+   * @param monos Message indices of each monocular image
+   */
+  void get_stereo_pairs(const CameraData &message, std::vector<std::pair<size_t, size_t>> &pairs, std::vector<size_t> &monos);
+
+  /// Mutex for our per-camera configuration (feature weights and stereo pairs)
+  std::mutex mtx_config;
+
+  /// Relative number of features in each camera (normalized to a mean of one)
+  std::map<size_t, double> feature_weights;
+
+  /// Camera ids which we should track as a stereo pair (if empty, consecutive images are paired)
+  std::vector<std::pair<size_t, size_t>> stereo_pairs;
+
   /// What histogram equalization method we should pre-process images with?
   HistogramMethod histogram_method;
 
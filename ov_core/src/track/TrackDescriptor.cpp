@@ -21,9 +21,12 @@
 
 #include "TrackDescriptor.h"
 
+#include <cmath>
+#include <limits>
 #include <opencv2/features2d.hpp>
 
 #include "Grider_FAST.h"
+#include "HammingMatcher.h"
 #include "cam/CamBase.h"
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
@@ -110,8 +113,12 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
   // Our matches temporally
   std::vector<cv::DMatch> matches_ll;
 
-  // Lets match temporally
-  robust_match(pts_last[cam_id], pts_new, desc_last[cam_id], desc_new, cam_id, cam_id, matches_ll);
+  // Lets match temporally (guided by where we predict the old features to be if enabled)
+  std::vector<cv::Point2f> pts_pred;
+  if (search_radius > 0) {
+    predict_keypoints(cam_id, pts_last[cam_id], pts_pred);
+  }
+  robust_match(pts_last[cam_id], pts_new, desc_last[cam_id], desc_new, cam_id, cam_id, matches_ll, pts_pred);
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Get our "good tracks"
@@ -122,18 +129,19 @@ void TrackDescriptor::feed_monocular(const CameraData &message, size_t msg_id) {
   // Count how many we have tracked from the last time
   int num_tracklast = 0;
 
+  // Direct lookup from the new "train" index to the old "query" index of its match
+  std::vector<int> map_ll(pts_new.size(), -1);
+  for (size_t j = 0; j < matches_ll.size(); j++) {
+    map_ll.at(matches_ll[j].trainIdx) = matches_ll[j].queryIdx;
+  }
+
   // Loop through all current left to right points
   // We want to see if any of theses have matches to the previous frame
   // If we have a match new->old then we want to use that ID instead of the new one
   for (size_t i = 0; i < pts_new.size(); i++) {
 
-    // Loop through all left matches, and find the old "train" id
-    int idll = -1;
-    for (size_t j = 0; j < matches_ll.size(); j++) {
-      if (matches_ll[j].trainIdx == (int)i) {
-        idll = matches_ll[j].queryIdx;
-      }
-    }
+    // Find the old "train" id
+    int idll = map_ll.at(i);
 
     // Then lets replace the current ID with the old ID if found
     // Else just append the current feature and its unique ID
@@ -237,6 +245,13 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
                            cam_id_left, cam_id_right, ids_left_new, ids_right_new);
   rT2 = boost::posix_time::microsec_clock::local_time();
 
+  // Predict where our old features will be (if doing guided matching)
+  std::vector<cv::Point2f> pts_left_pred, pts_right_pred;
+  if (search_radius > 0) {
+    predict_keypoints(cam_id_left, pts_last[cam_id_left], pts_left_pred);
+    predict_keypoints(cam_id_right, pts_last[cam_id_right], pts_right_pred);
+  }
+
   // Our matches temporally
   std::vector<cv::DMatch> matches_ll, matches_rr;
   parallel_for_(cv::Range(0, 2), LambdaBody([&](const cv::Range &range) {
@@ -245,7 +260,7 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
                     robust_match(pts_last[is_left ? cam_id_left : cam_id_right], is_left ? pts_left_new : pts_right_new,
                                  desc_last[is_left ? cam_id_left : cam_id_right], is_left ? desc_left_new : desc_right_new,
                                  is_left ? cam_id_left : cam_id_right, is_left ? cam_id_left : cam_id_right,
-                                 is_left ? matches_ll : matches_rr);
+                                 is_left ? matches_ll : matches_rr, is_left ? pts_left_pred : pts_right_pred);
                   }
                 }));
   rT3 = boost::posix_time::microsec_clock::local_time();
@@ -262,26 +277,24 @@ void TrackDescriptor::feed_stereo(const CameraData &message, size_t msg_id_left,
   // Count how many we have tracked from the last time
   int num_tracklast = 0;
 
+  // Direct lookup from the new "train" index to the old "query" index of its match
+  std::vector<int> map_ll(pts_left_new.size(), -1);
+  std::vector<int> map_rr(pts_right_new.size(), -1);
+  for (size_t j = 0; j < matches_ll.size(); j++) {
+    map_ll.at(matches_ll[j].trainIdx) = matches_ll[j].queryIdx;
+  }
+  for (size_t j = 0; j < matches_rr.size(); j++) {
+    map_rr.at(matches_rr[j].trainIdx) = matches_rr[j].queryIdx;
+  }
+
   // Loop through all current left to right points
   // We want to see if any of theses have matches to the previous frame
   // If we have a match new->old then we want to use that ID instead of the new one
   for (size_t i = 0; i < pts_left_new.size(); i++) {
 
-    // Loop through all left matches, and find the old "train" id
-    int idll = -1;
-    for (size_t j = 0; j < matches_ll.size(); j++) {
-      if (matches_ll[j].trainIdx == (int)i) {
-        idll = matches_ll[j].queryIdx;
-      }
-    }
-
-    // Loop through all left matches, and find the old "train" id
-    int idrr = -1;
-    for (size_t j = 0; j < matches_rr.size(); j++) {
-      if (matches_rr[j].trainIdx == (int)i) {
-        idrr = matches_rr[j].queryIdx;
-      }
-    }
+    // Find the old left and right "train" ids
+    int idll = map_ll.at(i);
+    int idrr = map_rr.at(i);
 
     // If we found a good stereo track from left to left, and right to right
     // Then lets replace the current ID with the old ID
@@ -478,14 +491,23 @@ void TrackDescriptor::perform_detection_stereo(const cv::Mat &img0, const cv::Ma
 }
 
 void TrackDescriptor::robust_match(const std::vector<cv::KeyPoint> &pts0, const std::vector<cv::KeyPoint> &pts1, const cv::Mat &desc0,
-                                   const cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches) {
+                                   const cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches,
+                                   const std::vector<cv::Point2f> &pts0_pred) {
 
   // Our 1to2 and 2to1 match vectors
   std::vector<std::vector<cv::DMatch>> matches0to1, matches1to0;
 
   // Match descriptors (return 2 nearest neighbours)
-  matcher->knnMatch(desc0, desc1, matches0to1, 2);
-  matcher->knnMatch(desc1, desc0, matches1to0, 2);
+  // If we know where to look, only compare to descriptors near the predicted location
+  if (search_radius > 0 && !pts0_pred.empty()) {
+    assert(pts0_pred.size() == pts0.size());
+    guided_knn_match(pts0_pred, pts1, desc0, desc1, matches0to1, matches1to0);
+  } else if (HammingMatcher::supported(desc0) && HammingMatcher::supported(desc1)) {
+    HammingMatcher::knn_match_symmetric(desc0, desc1, matches0to1, matches1to0);
+  } else {
+    matcher->knnMatch(desc0, desc1, matches0to1, 2);
+    matcher->knnMatch(desc1, desc0, matches1to0, 2);
+  }
 
   // Do a ratio test for both matches
   robust_ratio_test(matches0to1);
@@ -554,22 +576,176 @@ void TrackDescriptor::robust_ratio_test(std::vector<std::vector<cv::DMatch>> &ma
 void TrackDescriptor::robust_symmetry_test(std::vector<std::vector<cv::DMatch>> &matches1, std::vector<std::vector<cv::DMatch>> &matches2,
                                            std::vector<cv::DMatch> &good_matches) {
   // for all matches image 1 -> image 2
+  // NOTE: the knn matches have one entry per query descriptor, thus the reverse match is found directly at the train index
   for (auto &match1 : matches1) {
     // ignore deleted matches
     if (match1.empty() || match1.size() < 2)
       continue;
-    // for all matches image 2 -> image 1
-    for (auto &match2 : matches2) {
-      // ignore deleted matches
-      if (match2.empty() || match2.size() < 2)
-        continue;
-      // Match symmetry test
-      if (match1[0].queryIdx == match2[0].trainIdx && match2[0].queryIdx == match1[0].trainIdx) {
-        // add symmetrical match
-        good_matches.emplace_back(cv::DMatch(match1[0].queryIdx, match1[0].trainIdx, match1[0].distance));
-        // next match in image 1 -> image 2
-        break;
+    // get the match image 2 -> image 1 of our train descriptor
+    int idx2 = match1[0].trainIdx;
+    if (idx2 < 0 || idx2 >= (int)matches2.size())
+      continue;
+    auto &match2 = matches2.at(idx2);
+    // ignore deleted matches
+    if (match2.empty() || match2.size() < 2)
+      continue;
+    // Match symmetry test
+    if (match1[0].queryIdx == match2[0].trainIdx && match2[0].queryIdx == match1[0].trainIdx) {
+      // add symmetrical match
+      good_matches.emplace_back(cv::DMatch(match1[0].queryIdx, match1[0].trainIdx, match1[0].distance));
+    }
+  }
+}
+
+void TrackDescriptor::guided_knn_match(const std::vector<cv::Point2f> &pts0_pred, const std::vector<cv::KeyPoint> &pts1,
+                                       const cv::Mat &desc0, const cv::Mat &desc1, std::vector<std::vector<cv::DMatch>> &matches0to1,
+                                       std::vector<std::vector<cv::DMatch>> &matches1to0) {
+
+  // Assert we have a descriptor for each keypoint
+  assert((int)pts0_pred.size() == desc0.rows);
+  assert((int)pts1.size() == desc1.rows);
+
+  // Bucket the second keypoints into a grid with cells the size of our search radius
+  // Thus all keypoints within the radius of a location are in its cell or the eight neighbouring cells
+  float cell_size = (float)search_radius;
+  int grid_cols = 1;
+  int grid_rows = 1;
+  for (const auto &kpt : pts1) {
+    grid_cols = std::max(grid_cols, (int)(kpt.pt.x / cell_size) + 1);
+    grid_rows = std::max(grid_rows, (int)(kpt.pt.y / cell_size) + 1);
+  }
+  std::vector<std::vector<int>> grid((size_t)(grid_cols * grid_rows));
+  for (size_t j = 0; j < pts1.size(); j++) {
+    int x_grid = std::max(0, (int)(pts1.at(j).pt.x / cell_size));
+    int y_grid = std::max(0, (int)(pts1.at(j).pt.y / cell_size));
+    grid.at(y_grid * grid_cols + x_grid).push_back((int)j);
+  }
+
+  // Best and second best distances in both directions, and how many candidates were in the radius
+  float dist_max = std::numeric_limits<float>::max();
+  std::vector<int> best0(pts0_pred.size(), -1), best1(pts1.size(), -1);
+  std::vector<int> count0(pts0_pred.size(), 0), count1(pts1.size(), 0);
+  std::vector<float> dist0_a(pts0_pred.size(), dist_max), dist0_b(pts0_pred.size(), dist_max);
+  std::vector<float> dist1_a(pts1.size(), dist_max), dist1_b(pts1.size(), dist_max);
+  bool use_hamming = HammingMatcher::supported(desc0) && HammingMatcher::supported(desc1);
+  auto get_distance = [&](int i, int j) {
+    return use_hamming ? (float)HammingMatcher::distance(desc0.ptr<uint8_t>(i), desc1.ptr<uint8_t>(j))
+                       : (float)cv::norm(desc0.row(i), desc1.row(j), cv::NORM_HAMMING);
+  };
+  auto update_best = [](float dist, int idx, int &best, float &dist_a, float &dist_b) {
+    if (dist < dist_a) {
+      dist_b = dist_a;
+      dist_a = dist;
+      best = idx;
+    } else if (dist < dist_b) {
+      dist_b = dist;
+    }
+  };
+
+  // Score each candidate pair once, and record it for both directions
+  // Predictions which are not finite (e.g. from a bad rotation prior) have no candidates
+  float radius_sq = cell_size * cell_size;
+  for (size_t i = 0; i < pts0_pred.size(); i++) {
+    const cv::Point2f &pt0 = pts0_pred.at(i);
+    if (!std::isfinite(pt0.x) || !std::isfinite(pt0.y))
+      continue;
+    int x_grid = (int)std::floor(std::max(-1.0f, std::min(pt0.x / cell_size, (float)grid_cols)));
+    int y_grid = (int)std::floor(std::max(-1.0f, std::min(pt0.y / cell_size, (float)grid_rows)));
+    for (int y = y_grid - 1; y <= y_grid + 1; y++) {
+      for (int x = x_grid - 1; x <= x_grid + 1; x++) {
+        if (x < 0 || x >= grid_cols || y < 0 || y >= grid_rows)
+          continue;
+        for (const int &j : grid.at(y * grid_cols + x)) {
+          cv::Point2f diff = pts1.at(j).pt - pt0;
+          if (diff.x * diff.x + diff.y * diff.y > radius_sq)
+            continue;
+          float dist = get_distance((int)i, j);
+          update_best(dist, j, best0.at(i), dist0_a.at(i), dist0_b.at(i));
+          update_best(dist, (int)i, best1.at(j), dist1_a.at(j), dist1_b.at(j));
+          count0.at(i)++;
+          count1.at(j)++;
+        }
       }
     }
   }
+
+  // With less than two candidates in the radius we can't do the ratio test, which rejects ambiguous matches
+  // Thus we fall back to matching these against all descriptors (same as the unguided knn match)
+  for (size_t i = 0; i < pts0_pred.size(); i++) {
+    if (count0.at(i) >= 2)
+      continue;
+    best0.at(i) = -1;
+    dist0_a.at(i) = dist_max;
+    dist0_b.at(i) = dist_max;
+    for (size_t j = 0; j < pts1.size(); j++) {
+      update_best(get_distance((int)i, (int)j), (int)j, best0.at(i), dist0_a.at(i), dist0_b.at(i));
+    }
+  }
+  for (size_t j = 0; j < pts1.size(); j++) {
+    if (count1.at(j) >= 2)
+      continue;
+    best1.at(j) = -1;
+    dist1_a.at(j) = dist_max;
+    dist1_b.at(j) = dist_max;
+    for (size_t i = 0; i < pts0_pred.size(); i++) {
+      update_best(get_distance((int)i, (int)j), (int)i, best1.at(j), dist1_a.at(j), dist1_b.at(j));
+    }
+  }
+
+  // Convert into the same format as the knn matcher (one entry per query descriptor)
+  // We only record the index of the best match, the second only needs its distance for the ratio test
+  matches0to1.clear();
+  matches0to1.resize(pts0_pred.size());
+  // If there is only a single descriptor to match against, then there is no second neighbour and the ratio test will remove it
+  for (size_t i = 0; i < pts0_pred.size(); i++) {
+    if (best0.at(i) == -1)
+      continue;
+    matches0to1.at(i).emplace_back(cv::DMatch((int)i, best0.at(i), dist0_a.at(i)));
+    if (dist0_b.at(i) < dist_max)
+      matches0to1.at(i).emplace_back(cv::DMatch((int)i, -1, dist0_b.at(i)));
+  }
+  matches1to0.clear();
+  matches1to0.resize(pts1.size());
+  for (size_t j = 0; j < pts1.size(); j++) {
+    if (best1.at(j) == -1)
+      continue;
+    matches1to0.at(j).emplace_back(cv::DMatch((int)j, best1.at(j), dist1_a.at(j)));
+    if (dist1_b.at(j) < dist_max)
+      matches1to0.at(j).emplace_back(cv::DMatch((int)j, -1, dist1_b.at(j)));
+  }
+}
+
+void TrackDescriptor::predict_keypoints(size_t cam_id, const std::vector<cv::KeyPoint> &pts_last, std::vector<cv::Point2f> &pts_pred) {
+
+  // Get our rotation prior if we have one (it is only valid for this image, so remove it)
+  bool has_prior = false;
+  Eigen::Matrix3d R_lasttocurr = Eigen::Matrix3d::Identity();
+  {
+    std::lock_guard<std::mutex> lck(mtx_rotation_prior);
+    if (rotation_prior.find(cam_id) != rotation_prior.end()) {
+      R_lasttocurr = rotation_prior.at(cam_id);
+      rotation_prior.erase(cam_id);
+      has_prior = true;
+    }
+  }
+
+  // Rotate the bearing of each feature into the new frame and project it back into the image
+  // If the feature ends up behind the camera, we fall back to the last location
+  pts_pred.clear();
+  pts_pred.reserve(pts_last.size());
+  for (const auto &kpt : pts_last) {
+    if (!has_prior) {
+      pts_pred.push_back(kpt.pt);
+      continue;
+    }
+    cv::Point2f pt_n = camera_calib.at(cam_id)->undistort_cv(kpt.pt);
+    Eigen::Vector3d bearing(pt_n.x, pt_n.y, 1.0);
+    bearing = R_lasttocurr * bearing;
+    if (bearing(2) < 1e-3) {
+      pts_pred.push_back(kpt.pt);
+      continue;
+    }
+    cv::Point2f pt_n_pred((float)(bearing(0) / bearing(2)), (float)(bearing(1) / bearing(2)));
+    pts_pred.push_back(camera_calib.at(cam_id)->distort_cv(pt_n_pred));
+  }
 }
@@ -22,6 +22,8 @@
 #ifndef OV_CORE_TRACK_DESC_H
 #define OV_CORE_TRACK_DESC_H
 
+#include <Eigen/Eigen>
+
 #include "TrackBase.h"
 
 namespace ov_core {
@@ -33,6 +35,11 @@ namespace ov_core {
  * We track both temporally, and across stereo pairs to get stereo constraints.
  * Right now we use ORB descriptors as we have found it is the fastest when computing descriptors.
  * Tracks are then rejected based on a ratio test and ransac.
+ *
+ * If a search radius is given, temporal matching is guided by where we expect each feature to be in the new image.
+ * The new keypoints are bucketed into a grid with cells the size of the search radius, and each old feature is only compared to the
+ * new descriptors around its predicted location. The prediction is the last location of the feature, or its location rotated by
+ * the rotation prior if one was given using set_rotation_prior() (e.g. from integrating the gyroscope between the two images).
  */
 class TrackDescriptor : public TrackBase {
 
@@ -49,11 +56,13 @@ public:
    * @param gridy size of grid in the y-direction / v-direction
    * @param minpxdist features need to be at least this number pixels away from each other
    * @param knnratio matching ratio needed (smaller value forces top two descriptors during match to be more different)
+   * @param searchradius pixel radius around the predicted location to search for temporal matches (0 will match against all)
    */
   explicit TrackDescriptor(std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras, int numfeats, int numaruco, bool stereo,
-                           HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist, double knnratio)
+                           HistogramMethod histmethod, int fast_threshold, int gridx, int gridy, int minpxdist, double knnratio,
+                           int searchradius = 0)
       : TrackBase(cameras, numfeats, numaruco, stereo, histmethod), threshold(fast_threshold), grid_x(gridx), grid_y(gridy),
-        min_px_dist(minpxdist), knn_ratio(knnratio) {}
+        min_px_dist(minpxdist), knn_ratio(knnratio), search_radius(searchradius) {}
 
   /**
    * @brief Process a new image
@@ -61,6 +70,19 @@ public:
    */
   void feed_new_camera(const CameraData &message) override;
 
+  /**
+   * @brief Give a rotation prior which will be used to predict where features will be in the next image of this camera.
+   * @param cam_id id of the camera this prior is for
+   * @param R_lasttocurr rotation from the camera frame of the last image to the camera frame of the next image
+   *
+   * This is only used if we have a search radius for guided matching.
+   * The prior is consumed by the next image of this camera, so it should be set before each feed.
+   */
+  void set_rotation_prior(size_t cam_id, const Eigen::Matrix3d &R_lasttocurr) {
+    std::lock_guard<std::mutex> lck(mtx_rotation_prior);
+    rotation_prior[cam_id] = R_lasttocurr;
+  }
+
 protected:
   /**
    * @brief Process a new monocular image
@@ -126,14 +148,46 @@ protected:
    * @param id0 id of the first camera
    * @param id1 id of the second camera
    * @param matches vector of matches that we have found
+   * @param pts0_pred predicted location of the first keypoints in the second image (if empty we will match against all)
    *
    * This will perform a "robust match" between the two sets of points (slow but has great results).
    * First we do a simple KNN match from 1to2 and 2to1, which is followed by a ratio check and symmetry check.
    * Original code is from the "RobustMatcher" in the opencv examples, and seems to give very good results in the matches.
    * https://github.com/opencv/opencv/blob/master/samples/cpp/tutorial_code/calib3d/real_time_pose_estimation/src/RobustMatcher.cpp
+   * If we have a search radius and predicted locations, the KNN match is replaced with guided_knn_match().
+   * Otherwise ORB descriptors are matched with the HammingMatcher which scores each pair once for both directions.
    */
   void robust_match(const std::vector<cv::KeyPoint> &pts0, const std::vector<cv::KeyPoint> &pts1, const cv::Mat &desc0,
-                    const cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches);
+                    const cv::Mat &desc1, size_t id0, size_t id1, std::vector<cv::DMatch> &matches,
+                    const std::vector<cv::Point2f> &pts0_pred = {});
+
+  /**
+   * @brief KNN match (k=2) in both directions, only comparing descriptors which are within the search radius.
+   * @param pts0_pred predicted location of the first keypoints in the second image
+   * @param pts1 second vector of keypoints
+   * @param desc0 first vector of descriptors
+   * @param desc1 second vector of decriptors
+   * @param matches0to1 two nearest neighbours of each first descriptor (one vector per row of desc0)
+   * @param matches1to0 two nearest neighbours of each second descriptor (one vector per row of desc1)
+   *
+   * The second keypoints are bucketed into a grid with cells the size of the search radius.
+   * Each candidate pair is only scored once and used for both directions since the radius check is symmetric.
+   * If less than two candidates are in the radius (or the prediction is not finite), we can't do a ratio test on them.
+   * Thus these features are matched against all descriptors instead, just like the unguided KNN match.
+   */
+  void guided_knn_match(const std::vector<cv::Point2f> &pts0_pred, const std::vector<cv::KeyPoint> &pts1, const cv::Mat &desc0,
+                        const cv::Mat &desc1, std::vector<std::vector<cv::DMatch>> &matches0to1,
+                        std::vector<std::vector<cv::DMatch>> &matches1to0);
+
+  /**
+   * @brief Predicts where the last keypoints of a camera will be in its next image.
+   * @param cam_id id of the camera
+   * @param pts_last keypoints in the last image
+   * @param pts_pred predicted locations in the next image
+   *
+   * If we have a rotation prior for this camera we will rotate the bearing of each keypoint, otherwise we use the last location.
+   */
+  void predict_keypoints(size_t cam_id, const std::vector<cv::KeyPoint> &pts_last, std::vector<cv::Point2f> &pts_pred);
 
   // Helper functions for the robust_match function
   // Original code is from the "RobustMatcher" in the opencv examples
@@ -164,8 +218,15 @@ protected:
   // then the two features are too close, so should be considered ambiguous/bad match
   double knn_ratio;
 
+  // Pixel radius around the predicted location we will search for matches (zero will match against all)
+  int search_radius;
+
   // Descriptor matrices
   std::unordered_map<size_t, cv::Mat> desc_last;
+
+  // Rotation priors for the next image of each camera (R_lasttocurr)
+  std::mutex mtx_rotation_prior;
+  std::unordered_map<size_t, Eigen::Matrix3d> rotation_prior;
 };
 
 } // namespace ov_core
@@ -28,6 +28,7 @@
 #include "feat/FeatureDatabase.h"
 #include "utils/opencv_lambda_body.h"
 #include "utils/print.h"
+#include "utils/trace.h"
 
 using namespace ov_core;
 
@@ -42,54 +43,77 @@ void TrackKLT::feed_new_camera(const CameraData &message) {
     std::exit(EXIT_FAILURE);
   }
 
-  // Preprocessing steps that we do not parallelize
-  // NOTE: DO NOT PARALLELIZE THESE!
-  // NOTE: These seem to be much slower if you parallelize them...
+  // Preprocessing steps that we do not parallelize for mono and stereo
+  // NOTE: DO NOT PARALLELIZE THESE FOR ONE OR TWO IMAGES!
+  // NOTE: These seem to be much slower if you parallelize them (opencv already uses threads inside of them)...
+  // NOTE: With more cameras we process each in parallel, each camera only touches its own images here
   rT1 = boost::posix_time::microsec_clock::local_time();
+  TraceScope trace_pyramid("track", "klt_pyramid");
   size_t num_images = message.images.size();
-  for (size_t msg_id = 0; msg_id < num_images; msg_id++) {
-
-    // Lock this data feed for this camera
-    size_t cam_id = message.sensor_ids.at(msg_id);
-    std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
-
+  std::vector<cv::Mat> imgs(num_images);
+  std::vector<std::vector<cv::Mat>> imgpyrs(num_images);
+  auto preprocess = [&](size_t msg_id) {
     // Histogram equalize
-    cv::Mat img;
     if (histogram_method == HistogramMethod::HISTOGRAM) {
-      cv::equalizeHist(message.images.at(msg_id), img);
+      cv::equalizeHist(message.images.at(msg_id), imgs.at(msg_id));
     } else if (histogram_method == HistogramMethod::CLAHE) {
       double eq_clip_limit = 10.0;
       cv::Size eq_win_size = cv::Size(8, 8);
       cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(eq_clip_limit, eq_win_size);
-      clahe->apply(message.images.at(msg_id), img);
+      clahe->apply(message.images.at(msg_id), imgs.at(msg_id));
     } else {
-      img = message.images.at(msg_id);
+      imgs.at(msg_id) = message.images.at(msg_id);
     }
-
     // Extract image pyramid
-    std::vector<cv::Mat> imgpyr;
-    cv::buildOpticalFlowPyramid(img, imgpyr, win_size, pyr_levels);
+    cv::buildOpticalFlowPyramid(imgs.at(msg_id), imgpyrs.at(msg_id), win_size, pyr_levels);
+  };
+  if (num_images <= 2) {
+    for (size_t msg_id = 0; msg_id < num_images; msg_id++) {
+      preprocess(msg_id);
+    }
+  } else {
+    parallel_for_(cv::Range(0, (int)num_images), LambdaBody([&](const cv::Range &range) {
+                    for (int i = range.start; i < range.end; i++) {
+                      preprocess((size_t)i);
+                    }
+                  }));
+  }
+  trace_pyramid.arg("images", (double)num_images);
+  trace_pyramid.end();
 
-    // Save!
-    img_curr[cam_id] = img;
-    img_pyramid_curr[cam_id] = imgpyr;
+  // Save! (the maps are not thread safe, so we insert into them here before we track in parallel)
+  for (size_t msg_id = 0; msg_id < num_images; msg_id++) {
+    size_t cam_id = message.sensor_ids.at(msg_id);
+    std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
+    img_curr[cam_id] = imgs.at(msg_id);
+    img_pyramid_curr[cam_id] = imgpyrs.at(msg_id);
+    img_pyramid_last[cam_id];
+    std::lock_guard<std::mutex> lckv(mtx_last_vars);
+    pts_last[cam_id];
+    ids_last[cam_id];
   }
 
-  // Either call our stereo or monocular version
-  // If we are doing binocular tracking, then we should parallize our tracking
-  if (num_images == 1) {
-    feed_monocular(message, 0);
-  } else if (num_images == 2 && use_stereo) {
-    feed_stereo(message, 0, 1);
-  } else if (!use_stereo) {
-    parallel_for_(cv::Range(0, (int)num_images), LambdaBody([&](const cv::Range &range) {
+  // Split our images into stereo pairs and monocular images
+  // If we have more than one, then we will track them all in parallel
+  std::vector<std::pair<size_t, size_t>> pairs;
+  std::vector<size_t> monos;
+  get_stereo_pairs(message, pairs, monos);
+  size_t num_tasks = pairs.size() + monos.size();
+  auto track = [&](size_t task_id) {
+    if (task_id < pairs.size()) {
+      feed_stereo(message, pairs.at(task_id).first, pairs.at(task_id).second);
+    } else {
+      feed_monocular(message, monos.at(task_id - pairs.size()));
+    }
+  };
+  if (num_tasks == 1) {
+    track(0);
+  } else {
+    parallel_for_(cv::Range(0, (int)num_tasks), LambdaBody([&](const cv::Range &range) {
                     for (int i = range.start; i < range.end; i++) {
-                      feed_monocular(message, i);
+                      track((size_t)i);
                     }
                   }));
-  } else {
-    PRINT_ERROR(RED "[ERROR]: invalid number of images passed %zu, we only support mono or stereo tracking", num_images)
-    std::exit(EXIT_FAILURE);
   }
 }
 
@@ -98,6 +122,8 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   // Lock this data feed for this camera
   size_t cam_id = message.sensor_ids.at(msg_id);
   std::lock_guard<std::mutex> lck(mtx_feeds.at(cam_id));
+  TraceScope trace_track("track", "klt_mono");
+  trace_track.arg("cam", (double)cam_id);
 
   // Get our image objects for this image
   cv::Mat img = img_curr.at(cam_id);
@@ -111,7 +137,7 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
     // Detect new features
     std::vector<cv::KeyPoint> good_left;
     std::vector<size_t> good_ids_left;
-    perform_detection_monocular(imgpyr, mask, good_left, good_ids_left);
+    perform_detection_monocular(imgpyr, mask, cam_id, good_left, good_ids_left);
     // Save the current image and pyramid
     std::lock_guard<std::mutex> lckv(mtx_last_vars);
     img_last[cam_id] = img;
@@ -127,7 +153,7 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   int pts_before_detect = (int)pts_last[cam_id].size();
   auto pts_left_old = pts_last[cam_id];
   auto ids_left_old = ids_last[cam_id];
-  perform_detection_monocular(img_pyramid_last[cam_id], img_mask_last[cam_id], pts_left_old, ids_left_old);
+  perform_detection_monocular(img_pyramid_last[cam_id], img_mask_last[cam_id], cam_id, pts_left_old, ids_left_old);
   rT3 = boost::posix_time::microsec_clock::local_time();
 
   // Our return success masks, and predicted new features
@@ -173,6 +199,7 @@ void TrackKLT::feed_monocular(const CameraData &message, size_t msg_id) {
   }
 
   // Update our feature database, with theses new observations
+  trace_track.arg("tracked", (double)good_left.size());
   for (size_t i = 0; i < good_left.size(); i++) {
     cv::Point2f npt_l = camera_calib.at(cam_id)->undistort_cv(good_left.at(i).pt);
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x, npt_l.y);
@@ -203,6 +230,9 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   // Lock this data feed for this camera
   size_t cam_id_left = message.sensor_ids.at(msg_id_left);
   size_t cam_id_right = message.sensor_ids.at(msg_id_right);
+  TraceScope trace_track("track", "klt_stereo");
+  trace_track.arg("cam_left", (double)cam_id_left);
+  trace_track.arg("cam_right", (double)cam_id_right);
 
   // Get our image objects for this image
   cv::Mat img_left = img_curr.at(cam_id_left);
@@ -351,6 +381,8 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
   }
 
   // Update our feature database, with theses new observations
+  trace_track.arg("tracked_left", (double)good_left.size());
+  trace_track.arg("tracked_right", (double)good_right.size());
   for (size_t i = 0; i < good_left.size(); i++) {
     cv::Point2f npt_l = camera_calib.at(cam_id_left)->undistort_cv(good_left.at(i).pt);
     database->update_feature(good_ids_left.at(i), message.timestamp, cam_id_left, good_left.at(i).pt.x, good_left.at(i).pt.y, npt_l.x,
@@ -412,8 +444,14 @@ void TrackKLT::feed_stereo(const CameraData &message, size_t msg_id_left, size_t
 
 }
 
-void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0,
-                                           std::vector<size_t> &ids0) {
+void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, size_t cam_id,
+                                           std::vector<cv::KeyPoint> &pts0, std::vector<size_t> &ids0) {
+
+  // Number of features this camera should have
+  int num_features_cam = get_num_features(cam_id);
+  TraceScope trace_detect("track", "klt_detect");
+  trace_detect.arg("cam", (double)cam_id);
+  trace_detect.arg("before", (double)pts0.size());
 
   // Create a 2D occupancy grid for this current image
   // Note that we scale this down, so that each grid point is equal to a set of pixels
@@ -486,8 +524,8 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
   // First compute how many more features we need to extract from this image
   // If we don't need any features, just return
   double min_feat_percent = 0.50;
-  int num_featsneeded = num_features - (int)pts0.size();
-  if (num_featsneeded < std::min(20, (int)(min_feat_percent * num_features)))
+  int num_featsneeded = num_features_cam - (int)pts0.size();
+  if (num_featsneeded < std::min(20, (int)(min_feat_percent * num_features_cam)))
     return;
 
   // This is old extraction code that would extract from the whole image
@@ -500,7 +538,7 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
   cv::resize(mask0, mask0_grid, size_grid, 0.0, 0.0, cv::INTER_NEAREST);
 
   // Create grids we need to extract from and then extract our features (use fast with griding)
-  int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
+  int num_features_grid = (int)((double)num_features_cam / (double)(grid_x * grid_y)) + 1;
   int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
   std::vector<std::pair<int, int>> valid_locs;
   for (int x = 0; x < grid_2d_grid.cols; x++) {
@@ -511,7 +549,7 @@ void TrackKLT::perform_detection_monocular(const std::vector<cv::Mat> &img0pyr,
     }
   }
   std::vector<cv::KeyPoint> pts0_ext;
-  Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features, grid_x, grid_y, threshold, true);
+  Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features_cam, grid_x, grid_y, threshold, true);
 
   // Now, reject features that are close a current feature
   std::vector<cv::KeyPoint> kpts0_new;
@@ -551,6 +589,14 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
                                         const cv::Mat &mask1, size_t cam_id_left, size_t cam_id_right, std::vector<cv::KeyPoint> &pts0,
                                         std::vector<cv::KeyPoint> &pts1, std::vector<size_t> &ids0, std::vector<size_t> &ids1) {
 
+  // Number of features each camera should have
+  int num_features_left = get_num_features(cam_id_left);
+  int num_features_right = get_num_features(cam_id_right);
+  TraceScope trace_detect("track", "klt_detect_stereo");
+  trace_detect.arg("cam_left", (double)cam_id_left);
+  trace_detect.arg("before_left", (double)pts0.size());
+  trace_detect.arg("before_right", (double)pts1.size());
+
   // Create a 2D occupancy grid for this current image
   // Note that we scale this down, so that each grid point is equal to a set of pixels
   // This means that we will reject points that less then grid_px_size points away then existing features
@@ -621,12 +667,12 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
 
   // First compute how many more features we need to extract from this image
   double min_feat_percent = 0.50;
-  int num_featsneeded_0 = num_features - (int)pts0.size();
+  int num_featsneeded_0 = num_features_left - (int)pts0.size();
 
   // LEFT: if we need features we should extract them in the current frame
   // LEFT: we will also try to track them from this frame over to the right frame
   // LEFT: in the case that we have two features that are the same, then we should merge them
-  if (num_featsneeded_0 > std::min(20, (int)(min_feat_percent * num_features))) {
+  if (num_featsneeded_0 > std::min(20, (int)(min_feat_percent * num_features_left))) {
 
     // This is old extraction code that would extract from the whole image
     // This can be slow as this will recompute extractions for grid areas that we have max features already
@@ -638,7 +684,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     cv::resize(mask0, mask0_grid, size_grid0, 0.0, 0.0, cv::INTER_NEAREST);
 
     // Create grids we need to extract from and then extract our features (use fast with griding)
-    int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
+    int num_features_grid = (int)((double)num_features_left / (double)(grid_x * grid_y)) + 1;
     int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
     std::vector<std::pair<int, int>> valid_locs;
     for (int x = 0; x < grid_2d_grid0.cols; x++) {
@@ -649,7 +695,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       }
     }
     std::vector<cv::KeyPoint> pts0_ext;
-    Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features, grid_x, grid_y, threshold, true);
+    Grider_GRID::perform_griding(img0pyr.at(0), mask0_updated, valid_locs, pts0_ext, num_features_left, grid_x, grid_y, threshold, true);
 
     // Now, reject features that are close a current feature
     std::vector<cv::KeyPoint> kpts0_new;
@@ -801,8 +847,8 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
 
   // RIGHT: if we need features we should extract them in the current frame
   // RIGHT: note that we don't track them to the left as we already did left->right tracking above
-  int num_featsneeded_1 = num_features - (int)pts1.size();
-  if (num_featsneeded_1 > std::min(20, (int)(min_feat_percent * num_features))) {
+  int num_featsneeded_1 = num_features_right - (int)pts1.size();
+  if (num_featsneeded_1 > std::min(20, (int)(min_feat_percent * num_features_right))) {
 
     // This is old extraction code that would extract from the whole image
     // This can be slow as this will recompute extractions for grid areas that we have max features already
@@ -814,7 +860,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
     cv::resize(mask1, mask1_grid, size_grid1, 0.0, 0.0, cv::INTER_NEAREST);
 
     // Create grids we need to extract from and then extract our features (use fast with griding)
-    int num_features_grid = (int)((double)num_features / (double)(grid_x * grid_y)) + 1;
+    int num_features_grid = (int)((double)num_features_right / (double)(grid_x * grid_y)) + 1;
     int num_features_grid_req = std::max(1, (int)(min_feat_percent * num_features_grid));
     std::vector<std::pair<int, int>> valid_locs;
     for (int x = 0; x < grid_2d_grid1.cols; x++) {
@@ -825,7 +871,7 @@ void TrackKLT::perform_detection_stereo(const std::vector<cv::Mat> &img0pyr, con
       }
     }
     std::vector<cv::KeyPoint> pts1_ext;
-    Grider_GRID::perform_griding(img1pyr.at(0), mask1_updated, valid_locs, pts1_ext, num_features, grid_x, grid_y, threshold, true);
+    Grider_GRID::perform_griding(img1pyr.at(0), mask1_updated, valid_locs, pts1_ext, num_features_right, grid_x, grid_y, threshold, true);
 
     // Now, reject features that are close a current feature
     for (auto &kpt : pts1_ext) {
@@ -875,7 +921,11 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
   std::vector<uchar> mask_klt;
   std::vector<float> error;
   cv::TermCriteria term_crit = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+  TraceScope trace_klt("track", "klt_flow");
+  trace_klt.arg("cam", (double)id0);
+  trace_klt.arg("points", (double)pts0.size());
   cv::calcOpticalFlowPyrLK(img0pyr, img1pyr, pts0, pts1, mask_klt, error, win_size, pyr_levels, term_crit, cv::OPTFLOW_USE_INITIAL_FLOW);
+  trace_klt.end();
 
   // Normalize these points, so we can then do ransac
   // We don't want to do ransac on distorted image uvs since the mapping is nonlinear
@@ -890,7 +940,10 @@ void TrackKLT::perform_matching(const std::vector<cv::Mat> &img0pyr, const std::
   double max_focallength_img0 = std::max(camera_calib.at(id0)->get_K()(0, 0), camera_calib.at(id0)->get_K()(1, 1));
   double max_focallength_img1 = std::max(camera_calib.at(id1)->get_K()(0, 0), camera_calib.at(id1)->get_K()(1, 1));
   double max_focallength = std::max(max_focallength_img0, max_focallength_img1);
+  TraceScope trace_ransac("track", "klt_ransac");
+  trace_ransac.arg("cam", (double)id0);
   cv::findFundamentalMat(pts0_n, pts1_n, cv::FM_RANSAC, 2.0 / max_focallength, 0.999, mask_rsc);
+  trace_ransac.end();
 
   // Loop through and record only ones that are valid
   for (size_t i = 0; i < mask_klt.size(); i++) {
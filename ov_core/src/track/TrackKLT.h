@@ -82,6 +82,7 @@ protected:
    * @brief Detects new features in the current image
    * @param img0pyr image we will detect features on (first level of pyramid)
    * @param mask0 mask which has what ROI we do not want features in
+   * @param cam_id camera sensor id (used for the number of features this camera should have)
    * @param pts0 vector of currently extracted keypoints in this image
    * @param ids0 vector of feature ids for each currently extracted keypoint
    *
@@ -89,8 +90,8 @@ protected:
    * Will try to always have the "max_features" being tracked through KLT at each timestep.
    * Passed images should already be grayscaled.
    */
-  void perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, std::vector<cv::KeyPoint> &pts0,
-                                   std::vector<size_t> &ids0);
+  void perform_detection_monocular(const std::vector<cv::Mat> &img0pyr, const cv::Mat &mask0, size_t cam_id,
+                                   std::vector<cv::KeyPoint> &pts0, std::vector<size_t> &ids0);
 
   /**
    * @brief Detects new features in the current stereo pair
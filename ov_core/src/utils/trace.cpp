@@ -0,0 +1,126 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+
+#include <cstdio>
+#include <thread>
+
+using namespace ov_core;
+
+// Need to define the static variables for everything to work
+std::atomic<bool> Tracer::is_enabled(false);
+std::atomic<int64_t> Tracer::current_frame(-1);
+std::atomic<int64_t> Tracer::time_start(0);
+std::mutex Tracer::mtx;
+std::ofstream Tracer::file;
+std::string Tracer::buffer;
+
+bool Tracer::start(const std::string &filepath) {
+  stop();
+  std::lock_guard<std::mutex> lck(mtx);
+  file.open(filepath, std::ios::out | std::ios::trunc);
+  if (!file.is_open())
+    return false;
+  file << "[\n";
+  file << R"({"name":"process_name","ph":"M","pid":0,"tid":0,"args":{"name":"open_vins"}})";
+  buffer.clear();
+  time_start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  is_enabled = true;
+  return true;
+}
+
+void Tracer::stop() {
+  std::lock_guard<std::mutex> lck(mtx);
+  if (!file.is_open())
+    return;
+  is_enabled = false;
+  flush();
+  file << "\n]\n";
+  file.close();
+}
+
+void Tracer::set_thread_name(const std::string &name) {
+  if (!enabled())
+    return;
+  char event[256];
+  std::snprintf(event, sizeof(event), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%.64s\"}}",
+                thread_id(), name.c_str());
+  std::lock_guard<std::mutex> lck(mtx);
+  if (file.is_open())
+    buffer += event;
+}
+
+void Tracer::record(const char *category, const char *name, int64_t begin, int64_t end, const std::pair<const char *, double> *args,
+                    int num_args) {
+  if (!enabled())
+    return;
+
+  // Format the event outside of the lock
+  // Complete events ("X") have both the start and duration of the event
+  char event[512];
+  const char *format = ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                       "\"ts\":%lld,\"dur\":%lld,\"args\":{\"frame\":%lld";
+  int length = std::snprintf(event, sizeof(event), format, name, category, thread_id(), (long long)begin, (long long)(end - begin),
+                             (long long)current_frame.load());
+  for (int i = 0; i < num_args && length < (int)sizeof(event); i++) {
+    length += std::snprintf(event + length, sizeof(event) - length, ",\"%s\":%.6g", args[i].first, args[i].second);
+  }
+  if (length + 2 >= (int)sizeof(event))
+    return;
+  event[length++] = '}';
+  event[length++] = '}';
+
+  // Append it, and write to file if we have a lot buffered
+  std::lock_guard<std::mutex> lck(mtx);
+  if (!file.is_open())
+    return;
+  buffer.append(event, length);
+  if (buffer.size() > (1 << 20))
+    flush();
+}
+
+void Tracer::record_stages(const char *category, const char *name_total, const std::vector<const char *> &names,
+                           const std::vector<boost::posix_time::ptime> &times, const std::pair<const char *, double> *args, int num_args) {
+  if (!enabled() || times.empty() || names.size() + 1 != times.size())
+    return;
+  int64_t time_end = now();
+  auto to_trace_time = [&](const boost::posix_time::ptime &time) { return time_end - (times.back() - time).total_microseconds(); };
+  if (name_total != nullptr)
+    record(category, name_total, to_trace_time(times.front()), time_end, args, num_args);
+  for (size_t i = 0; i < names.size(); i++) {
+    record(category, names.at(i), to_trace_time(times.at(i)), to_trace_time(times.at(i + 1)));
+  }
+}
+
+void Tracer::flush() {
+  if (file.is_open() && !buffer.empty()) {
+    file << buffer;
+    file.flush();
+  }
+  buffer.clear();
+}
+
+int Tracer::thread_id() {
+  static std::atomic<int> num_threads(0);
+  thread_local int id = ++num_threads;
+  return id;
+}
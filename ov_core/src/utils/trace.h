@@ -0,0 +1,194 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_CORE_TRACE_H
+#define OV_CORE_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace ov_core {
+
+/**
+ * @brief Records begin and end times of the estimator stages into a trace file
+ *
+ * The trace is written in the [Chrome trace event](https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nEsKw9kv2VI)
+ * JSON format which can be opened in chrome://tracing or [Perfetto](https://ui.perfetto.dev/).
+ * Each event has the thread it was recorded on and the current frame id, so one can see how the tracking, update and initializer threads
+ * overlap and where they stall, instead of just the per-frame averages from the timing file.
+ *
+ * This is a global recorder, so any module can add events without being passed a handle.
+ * If it has not been started then recording an event is a single atomic load.
+ *
+ * @code{.cpp}
+ * ov_core::Tracer::start("/tmp/ov_trace.json");
+ * {
+ *   ov_core::TraceScope trace("track", "klt");
+ *   // ... do work ...
+ *   trace.arg("num_features", 150);
+ * }
+ * ov_core::Tracer::stop();
+ * @endcode
+ */
+class Tracer {
+public:
+  /**
+   * @brief Starts recording events into the given file (stops any previous recording)
+   * @param filepath Path of the json file we will write into
+   * @return False if we could not open the file
+   */
+  static bool start(const std::string &filepath);
+
+  /// Writes all remaining events and closes the file
+  static void stop();
+
+  /// If we are currently recording events
+  static bool enabled() { return is_enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Gives the calling thread a name in the trace viewer
+   * @param name Name of the thread (e.g. "initializer")
+   */
+  static void set_thread_name(const std::string &name);
+
+  /**
+   * @brief Sets the current frame id, all events recorded after this will have this frame id
+   * @param frame_id Id of the current frame
+   */
+  static void set_frame(int64_t frame_id) { current_frame = frame_id; }
+
+  /// Current time in microseconds from the start of the recording
+  static int64_t now() {
+    int64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return (time_ns - time_start) / 1000;
+  }
+
+  /**
+   * @brief Records a single event with a begin and end time
+   * @param category Category of the event (e.g. "track", "update", "init")
+   * @param name Name of the event (should be a string literal)
+   * @param begin Start time of the event (see now())
+   * @param end End time of the event (see now())
+   * @param args Extra values to show with the event (e.g. feature counts)
+   * @param num_args Number of extra values
+   */
+  static void record(const char *category, const char *name, int64_t begin, int64_t end,
+                     const std::pair<const char *, double> *args = nullptr, int num_args = 0);
+
+  /**
+   * @brief Records consecutive stages from the timestamps the estimator already takes for its timing prints
+   *
+   * Stage i goes from times[i] to times[i+1], so there should be one more timestamp than names.
+   * The last timestamp should have just been taken since the times are placed relative to it.
+   *
+   * @param category Category of the events (e.g. "update")
+   * @param name_total Name of an event spanning all the stages which has the args (nullptr to not record it)
+   * @param names Name of each stage (should be string literals)
+   * @param times Timestamps between each stage
+   * @param args Extra values to show with the spanning event (e.g. feature counts)
+   * @param num_args Number of extra values
+   */
+  static void record_stages(const char *category, const char *name_total, const std::vector<const char *> &names,
+                            const std::vector<boost::posix_time::ptime> &times, const std::pair<const char *, double> *args = nullptr,
+                            int num_args = 0);
+
+private:
+  /// Writes the events we have buffered to file (should hold the mutex)
+  static void flush();
+
+  /// Id of the calling thread in the trace
+  static int thread_id();
+
+  /// If we are recording
+  static std::atomic<bool> is_enabled;
+
+  /// Frame id the events will be recorded with
+  static std::atomic<int64_t> current_frame;
+
+  /// Time the recording was started at (nanoseconds of the steady clock)
+  static std::atomic<int64_t> time_start;
+
+  /// Protects the file and buffer
+  static std::mutex mtx;
+
+  /// File we are writing into
+  static std::ofstream file;
+
+  /// Events that have not been written to file yet
+  static std::string buffer;
+};
+
+/**
+ * @brief Records an event from its construction to its destruction
+ *
+ * Nothing is done if the Tracer was not started when this was created.
+ */
+class TraceScope {
+public:
+  /**
+   * @brief Starts the event
+   * @param category Category of the event (should be a string literal)
+   * @param name Name of the event (should be a string literal)
+   */
+  TraceScope(const char *category, const char *name) : category(category), name(name) {
+    if (Tracer::enabled())
+      begin = Tracer::now();
+  }
+
+  /// Records the event
+  ~TraceScope() { end(); }
+
+  /**
+   * @brief Adds a value to show with this event (max of four, the rest are ignored)
+   * @param key Name of the value (should be a string literal)
+   * @param value The value
+   */
+  void arg(const char *key, double value) {
+    if (begin >= 0 && num_args < 4)
+      args[num_args++] = {key, value};
+  }
+
+  /// Ends the event before this goes out of scope
+  void end() {
+    if (begin >= 0)
+      Tracer::record(category, name, begin, Tracer::now(), args, num_args);
+    begin = -1;
+  }
+
+private:
+  const char *category;
+  const char *name;
+  int64_t begin = -1;
+  int num_args = 0;
+  std::pair<const char *, double> args[4];
+};
+
+} // namespace ov_core
+
+#endif // OV_CORE_TRACE_H
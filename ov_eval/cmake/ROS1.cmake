@@ -42,6 +42,7 @@ if (NOT catkin_FOUND OR NOT ENABLE_ROS)
 
     message(STATUS "MANUALLY LINKING TO OV_CORE LIBRARY....")
     file(GLOB_RECURSE OVCORE_LIBRARY_SOURCES "${CMAKE_SOURCE_DIR}/../ov_core/src/*.cpp")
+    list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_cpi\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_profile\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_webcam\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_tracking\\.cpp$")
@@ -63,6 +64,7 @@ list(APPEND LIBRARY_SOURCES
         src/alignment/AlignTrajectory.cpp
         src/alignment/AlignUtils.cpp
         src/calc/ResultTrajectory.cpp
+        src/calc/ResultBatch.cpp
         src/calc/ResultSimulation.cpp
         src/utils/Loader.cpp
 )
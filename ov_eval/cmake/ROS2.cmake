@@ -34,6 +34,7 @@ list(APPEND LIBRARY_SOURCES
         src/alignment/AlignTrajectory.cpp
         src/alignment/AlignUtils.cpp
         src/calc/ResultTrajectory.cpp
+        src/calc/ResultBatch.cpp
         src/calc/ResultSimulation.cpp
         src/utils/Loader.cpp
 )
@@ -0,0 +1,109 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ResultBatch.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "utils/Loader.h"
+#include "utils/print.h"
+
+using namespace ov_eval;
+
+ResultBatch::ResultBatch(std::string alignment_method, int num_threads) : alignment_method(alignment_method), num_threads(num_threads) {
+  if (this->num_threads < 1)
+    this->num_threads = (int)std::max(1U, std::thread::hardware_concurrency());
+}
+
+size_t ResultBatch::add_groundtruth(const std::string &path_gt) {
+
+  // Return the already loaded one if we have it
+  for (size_t i = 0; i < groundtruths.size(); i++) {
+    if (groundtruths.at(i).path == path_gt)
+      return i;
+  }
+
+  // Else load it!
+  Groundtruth gt;
+  gt.path = path_gt;
+  Loader::load_data(path_gt, gt.times, gt.poses, gt.cov_ori, gt.cov_pos);
+  groundtruths.push_back(gt);
+  return groundtruths.size() - 1;
+}
+
+size_t ResultBatch::add_run(size_t id_gt, const std::string &path_est) {
+  assert(id_gt < groundtruths.size());
+  runs.push_back({id_gt, path_est});
+  errors.emplace_back();
+  return runs.size() - 1;
+}
+
+void ResultBatch::evaluate(const std::vector<double> &segments, bool calc_nees) {
+
+  // Nothing to do if we have evaluated everything
+  size_t num_total = runs.size() - num_evaluated;
+  if (num_total == 0)
+    return;
+
+  // Each worker takes the next run which has not been started
+  // The errors are directly saved into the slot of the run, so the order never changes
+  std::atomic<size_t> next_run(num_evaluated);
+  std::atomic<size_t> num_done(0);
+  std::mutex mutex_print;
+  size_t print_every = std::max((size_t)1, num_total / 20);
+  auto evaluate_runs = [&]() {
+    size_t id_run;
+    while ((id_run = next_run++) < runs.size()) {
+
+      // Create our trajectory object with the shared groundtruth
+      // If each run is on its own thread, then the RPE should not spawn more (otherwise it can use all cores)
+      const Groundtruth &gt = groundtruths.at(runs.at(id_run).first);
+      ResultTrajectory traj(runs.at(id_run).second, gt.times, gt.poses, gt.cov_ori, gt.cov_pos, alignment_method);
+      if (num_threads > 1)
+        traj.set_max_threads(1);
+
+      // Calculate all our errors
+      RunErrors &error = errors.at(id_run);
+      traj.calculate_ate(error.ate_ori, error.ate_pos);
+      traj.calculate_ate_2d(error.ate_2d_ori, error.ate_2d_pos);
+      traj.calculate_rpe(segments, error.rpe);
+      if (calc_nees)
+        traj.calculate_nees(error.nees_ori, error.nees_pos);
+
+      // Report our progress
+      size_t done = ++num_done;
+      if (done % print_every == 0 || done == num_total) {
+        std::lock_guard<std::mutex> lck(mutex_print);
+        PRINT_INFO("[BATCH]: evaluated %d of %d runs (%.0f%%)\n", (int)done, (int)num_total, 100.0 * (double)done / (double)num_total);
+      }
+    }
+  };
+  size_t num_workers = std::min(num_total, (size_t)num_threads);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_workers; i++)
+    threads.emplace_back(evaluate_runs);
+  evaluate_runs();
+  for (auto &thread : threads)
+    thread.join();
+  num_evaluated = runs.size();
+}
@@ -0,0 +1,133 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_EVAL_BATCH_H
+#define OV_EVAL_BATCH_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "calc/ResultTrajectory.h"
+#include "utils/Statistics.h"
+
+namespace ov_eval {
+
+/**
+ * @brief Evaluates many runs of many algorithms / datasets in parallel.
+ *
+ * Each groundtruth file is only loaded once and then shared between all the runs on that dataset.
+ * Every run is then aligned and evaluated with its own ResultTrajectory on a pool of worker threads.
+ * The errors are stored in the same order the runs were added in, so the output does not depend on the number of threads.
+ */
+class ResultBatch {
+
+public:
+  /// Errors of a single run
+  struct RunErrors {
+
+    /// Absolute trajectory error (ATE)
+    Statistics ate_ori, ate_pos;
+
+    /// 2D absolute trajectory error (ATE)
+    Statistics ate_2d_ori, ate_2d_pos;
+
+    /// Normalized estimation error squared (NEES), only computed if requested
+    Statistics nees_ori, nees_pos;
+
+    /// Relative pose error (RPE) for each segment length
+    std::map<double, std::pair<Statistics, Statistics>> rpe;
+  };
+
+  /**
+   * @brief Default constructor
+   * @param alignment_method The alignment method to use [sim3, se3, posyaw, none]
+   * @param num_threads Number of worker threads (-1 to use all cores)
+   */
+  ResultBatch(std::string alignment_method, int num_threads = -1);
+
+  /**
+   * @brief Loads a groundtruth file, if it was already added then the loaded one is returned
+   * @param path_gt Path to the groundtruth text file
+   * @return Id of this groundtruth
+   */
+  size_t add_groundtruth(const std::string &path_gt);
+
+  /**
+   * @brief Adds a run that should be evaluated against a loaded groundtruth
+   * @param id_gt Id of the groundtruth (see add_groundtruth())
+   * @param path_est Path to the estimate text file
+   * @return Id of this run
+   */
+  size_t add_run(size_t id_gt, const std::string &path_est);
+
+  /**
+   * @brief Will evaluate all runs which have not been evaluated yet
+   * @param segments Segment lengths to compute the RPE for
+   * @param calc_nees If we should also compute the NEES of each run
+   */
+  void evaluate(const std::vector<double> &segments, bool calc_nees = false);
+
+  /// Groundtruth timestamps for a given groundtruth id
+  const std::vector<double> &get_groundtruth_times(size_t id_gt) const { return groundtruths.at(id_gt).times; }
+
+  /// Groundtruth poses for a given groundtruth id
+  const std::vector<Eigen::Matrix<double, 7, 1>> &get_groundtruth_poses(size_t id_gt) const { return groundtruths.at(id_gt).poses; }
+
+  /// Errors of a given run id (only valid after evaluate())
+  const RunErrors &get_errors(size_t id_run) const { return errors.at(id_run); }
+
+  /// Number of worker threads we will use
+  int get_num_threads() const { return num_threads; }
+
+protected:
+  /// Loaded groundtruth trajectory
+  struct Groundtruth {
+    std::string path;
+    std::vector<double> times;
+    std::vector<Eigen::Matrix<double, 7, 1>> poses;
+    std::vector<Eigen::Matrix3d> cov_ori, cov_pos;
+  };
+
+  /// Alignment method to use
+  std::string alignment_method;
+
+  /// Number of worker threads
+  int num_threads;
+
+  /// All loaded groundtruths
+  std::vector<Groundtruth> groundtruths;
+
+  /// Groundtruth id and estimate path of each run
+  std::vector<std::pair<size_t, std::string>> runs;
+
+  /// Errors of each run (same order as the runs)
+  std::vector<RunErrors> errors;
+
+  /// Number of runs which have already been evaluated
+  size_t num_evaluated = 0;
+};
+
+} // namespace ov_eval
+
+#endif // OV_EVAL_BATCH_H
@@ -21,6 +21,9 @@
 
 #include "ResultTrajectory.h"
 
+#include <atomic>
+#include <thread>
+
 using namespace ov_eval;
 
 ResultTrajectory::ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method) {
@@ -29,6 +32,24 @@ ResultTrajectory::ResultTrajectory(std::string path_est, std::string path_gt, st
   Loader::load_data(path_est, est_times, est_poses, est_covori, est_covpos);
   Loader::load_data(path_gt, gt_times, gt_poses, gt_covori, gt_covpos);
 
+  // Intersect and align them
+  associate_and_align(path_est, alignment_method);
+}
+
+ResultTrajectory::ResultTrajectory(std::string path_est, const std::vector<double> &times,
+                                   const std::vector<Eigen::Matrix<double, 7, 1>> &poses, const std::vector<Eigen::Matrix3d> &cov_ori,
+                                   const std::vector<Eigen::Matrix3d> &cov_pos, std::string alignment_method)
+    : gt_times(times), gt_poses(poses), gt_covori(cov_ori), gt_covpos(cov_pos) {
+
+  // Load the estimate from file, the groundtruth is copied since it will be intersected
+  Loader::load_data(path_est, est_times, est_poses, est_covori, est_covpos);
+
+  // Intersect and align them
+  associate_and_align(path_est, alignment_method);
+}
+
+void ResultTrajectory::associate_and_align(const std::string &path_est, const std::string &alignment_method) {
+
   // Debug print amount
   // std::string base_filename1 = path_est.substr(path_est.find_last_of("/\\") + 1);
   // std::string base_filename2 = path_gt.substr(path_gt.find_last_of("/\\") + 1);
@@ -161,83 +182,103 @@ void ResultTrajectory::calculate_rpe(const std::vector<double> &segment_lengths,
                   "[COMP]: the recommendation is to use a higher frequency groundtruth, or relax this trajectory segment logic...\n" RESET);
   }
 
-  // Loop through each segment length
-  for (const double &distance : segment_lengths) {
-
-    // Our stats for this length
-    Statistics error_ori, error_pos;
-
-    // Get end of subtrajectories for each possible starting point
-    // NOTE: is there a better way to select which end pos is a valid segments that are of the correct lenght?
-    // NOTE: right now this allows for longer segments to have bigger error in their start-end distance vs the desired segment length
-    // std::vector<int> comparisons = compute_comparison_indices_length(accum_distances, distance, 0.1*distance);
-    std::vector<int> comparisons = compute_comparison_indices_length(accum_distances, distance, max_dist_diff);
-    assert(comparisons.size() == gt_poses.size());
-
-    // Loop through each relative comparison
-    for (size_t id_start = 0; id_start < comparisons.size(); id_start++) {
-
-      // Get the end id (skip if we couldn't find an end)
-      int id_end = comparisons[id_start];
-      if (id_end == -1)
-        continue;
-
-      //===============================================================================
-      // Get T I1 to world EST at beginning of subtrajectory (at state idx)
-      Eigen::Matrix4d T_c1 = Eigen::Matrix4d::Identity();
-      T_c1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_start).block(3, 0, 4, 1)).transpose();
-      T_c1.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_start).block(0, 0, 3, 1);
-
-      // Get T I2 to world EST at end of subtrajectory starting (at state comparisons[idx])
-      Eigen::Matrix4d T_c2 = Eigen::Matrix4d::Identity();
-      T_c2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_end).block(3, 0, 4, 1)).transpose();
-      T_c2.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_end).block(0, 0, 3, 1);
-
-      // Get T I2 to I1 EST
-      Eigen::Matrix4d T_c1_c2 = ov_core::Inv_se3(T_c1) * T_c2;
-
-      //===============================================================================
-      // Get T I1 to world GT at beginning of subtrajectory (at state idx)
-      Eigen::Matrix4d T_m1 = Eigen::Matrix4d::Identity();
-      T_m1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_start).block(3, 0, 4, 1)).transpose();
-      T_m1.block(0, 3, 3, 1) = gt_poses.at(id_start).block(0, 0, 3, 1);
-
-      // Get T I2 to world GT at end of subtrajectory starting (at state comparisons[idx])
-      Eigen::Matrix4d T_m2 = Eigen::Matrix4d::Identity();
-      T_m2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_end).block(3, 0, 4, 1)).transpose();
-      T_m2.block(0, 3, 3, 1) = gt_poses.at(id_end).block(0, 0, 3, 1);
-
-      // Get T I2 to I1 GT
-      Eigen::Matrix4d T_m1_m2 = ov_core::Inv_se3(T_m1) * T_m2;
-
-      //===============================================================================
-      // Compute error transform between EST and GT start-end transform
-      Eigen::Matrix4d T_error_in_c2 = ov_core::Inv_se3(T_m1_m2) * T_c1_c2;
-
-      Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
-      T_c2_rot.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3);
-
-      Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
-      T_c2_rot_inv.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3).transpose();
-
-      // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
-      Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
-
-      //===============================================================================
-      // Compute error for position
-      error_pos.timestamps.push_back(est_times.at(id_start));
-      error_pos.values.push_back(T_error_in_w.block(0, 3, 3, 1).norm());
-
-      // Calculate orientation error
-      double ori_err = 180.0 / M_PI * ov_core::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
-      error_ori.timestamps.push_back(est_times.at(id_start));
-      error_ori.values.push_back(ori_err);
-    }
+  // Each segment length is independent, so we compute them in parallel
+  // Each thread takes the next segment length which has not been started
+  std::vector<std::pair<Statistics, Statistics>> errors(segment_lengths.size());
+  std::atomic<size_t> next_length(0);
+  auto compute_lengths = [&]() {
+    size_t idx_length;
+    while ((idx_length = next_length++) < segment_lengths.size()) {
+      const double distance = segment_lengths.at(idx_length);
+
+      // Our stats for this length
+      Statistics error_ori, error_pos;
+
+      // Get end of subtrajectories for each possible starting point
+      // NOTE: is there a better way to select which end pos is a valid segments that are of the correct lenght?
+      // NOTE: right now this allows for longer segments to have bigger error in their start-end distance vs the desired segment length
+      // std::vector<int> comparisons = compute_comparison_indices_length(accum_distances, distance, 0.1*distance);
+      std::vector<int> comparisons = compute_comparison_indices_length(accum_distances, distance, max_dist_diff);
+      assert(comparisons.size() == gt_poses.size());
+
+      // Loop through each relative comparison
+      for (size_t id_start = 0; id_start < comparisons.size(); id_start++) {
+
+        // Get the end id (skip if we couldn't find an end)
+        int id_end = comparisons[id_start];
+        if (id_end == -1)
+          continue;
+
+        //===============================================================================
+        // Get T I1 to world EST at beginning of subtrajectory (at state idx)
+        Eigen::Matrix4d T_c1 = Eigen::Matrix4d::Identity();
+        T_c1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_start).block(3, 0, 4, 1)).transpose();
+        T_c1.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_start).block(0, 0, 3, 1);
+
+        // Get T I2 to world EST at end of subtrajectory starting (at state comparisons[idx])
+        Eigen::Matrix4d T_c2 = Eigen::Matrix4d::Identity();
+        T_c2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(est_poses_aignedtoGT.at(id_end).block(3, 0, 4, 1)).transpose();
+        T_c2.block(0, 3, 3, 1) = est_poses_aignedtoGT.at(id_end).block(0, 0, 3, 1);
+
+        // Get T I2 to I1 EST
+        Eigen::Matrix4d T_c1_c2 = ov_core::Inv_se3(T_c1) * T_c2;
+
+        //===============================================================================
+        // Get T I1 to world GT at beginning of subtrajectory (at state idx)
+        Eigen::Matrix4d T_m1 = Eigen::Matrix4d::Identity();
+        T_m1.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_start).block(3, 0, 4, 1)).transpose();
+        T_m1.block(0, 3, 3, 1) = gt_poses.at(id_start).block(0, 0, 3, 1);
+
+        // Get T I2 to world GT at end of subtrajectory starting (at state comparisons[idx])
+        Eigen::Matrix4d T_m2 = Eigen::Matrix4d::Identity();
+        T_m2.block(0, 0, 3, 3) = ov_core::quat_2_Rot(gt_poses.at(id_end).block(3, 0, 4, 1)).transpose();
+        T_m2.block(0, 3, 3, 1) = gt_poses.at(id_end).block(0, 0, 3, 1);
+
+        // Get T I2 to I1 GT
+        Eigen::Matrix4d T_m1_m2 = ov_core::Inv_se3(T_m1) * T_m2;
+
+        //===============================================================================
+        // Compute error transform between EST and GT start-end transform
+        Eigen::Matrix4d T_error_in_c2 = ov_core::Inv_se3(T_m1_m2) * T_c1_c2;
+
+        Eigen::Matrix4d T_c2_rot = Eigen::Matrix4d::Identity();
+        T_c2_rot.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3);
+
+        Eigen::Matrix4d T_c2_rot_inv = Eigen::Matrix4d::Identity();
+        T_c2_rot_inv.block(0, 0, 3, 3) = T_c2.block(0, 0, 3, 3).transpose();
+
+        // Rotate rotation so that rotation error is in the global frame (allows us to look at yaw error)
+        Eigen::Matrix4d T_error_in_w = T_c2_rot * T_error_in_c2 * T_c2_rot_inv;
+
+        //===============================================================================
+        // Compute error for position
+        error_pos.timestamps.push_back(est_times.at(id_start));
+        error_pos.values.push_back(T_error_in_w.block(0, 3, 3, 1).norm());
+
+        // Calculate orientation error
+        double ori_err = 180.0 / M_PI * ov_core::log_so3(T_error_in_w.block(0, 0, 3, 3)).norm();
+        error_ori.timestamps.push_back(est_times.at(id_start));
+        error_ori.values.push_back(ori_err);
+      }
 
-    // Update stat information
-    error_ori.calculate();
-    error_pos.calculate();
-    error_rpe.insert({distance, {error_ori, error_pos}});
+      // Update stat information
+      error_ori.calculate();
+      error_pos.calculate();
+      errors.at(idx_length) = {error_ori, error_pos};
+    }
+  };
+  size_t num_threads = (max_threads > 0) ? (size_t)max_threads : (size_t)std::max(1U, std::thread::hardware_concurrency());
+  num_threads = std::min(segment_lengths.size(), num_threads);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++)
+    threads.emplace_back(compute_lengths);
+  compute_lengths();
+  for (auto &thread : threads)
+    thread.join();
+
+  // Finally record them in the order of the segment lengths
+  for (size_t i = 0; i < segment_lengths.size(); i++) {
+    error_rpe.insert({segment_lengths.at(i), errors.at(i)});
   }
 }
 
@@ -22,6 +22,7 @@
 #ifndef OV_EVAL_TRAJECTORY_H
 #define OV_EVAL_TRAJECTORY_H
 
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <random>
@@ -67,6 +68,27 @@ public:
    */
   ResultTrajectory(std::string path_est, std::string path_gt, std::string alignment_method);
 
+  /**
+   * @brief Constructor for an already loaded groundtruth, so it can be shared between many runs on the same dataset.
+   * @param path_est Path to the estimate text file
+   * @param times Groundtruth timestamps
+   * @param poses Groundtruth poses
+   * @param cov_ori Groundtruth orientation covariances (can be empty)
+   * @param cov_pos Groundtruth position covariances (can be empty)
+   * @param alignment_method The alignment method to use [sim3, se3, posyaw, none]
+   */
+  ResultTrajectory(std::string path_est, const std::vector<double> &times, const std::vector<Eigen::Matrix<double, 7, 1>> &poses,
+                   const std::vector<Eigen::Matrix3d> &cov_ori, const std::vector<Eigen::Matrix3d> &cov_pos, std::string alignment_method);
+
+  /**
+   * @brief Sets the max number of threads the RPE calculation will use (by default all cores).
+   *
+   * If many trajectories are evaluated in parallel this should be one, since each is already on its own thread.
+   *
+   * @param num_threads Max number of threads
+   */
+  void set_max_threads(int num_threads) { max_threads = std::max(1, num_threads); }
+
   /**
    * @brief Computes the Absolute Trajectory Error (ATE) for this trajectory.
    *
@@ -158,6 +180,16 @@ protected:
   std::vector<Eigen::Matrix<double, 7, 1>> est_poses_aignedtoGT;
   std::vector<Eigen::Matrix<double, 7, 1>> gt_poses_aignedtoEST;
 
+  // Max number of threads to compute the RPE with
+  int max_threads = -1;
+
+  /**
+   * @brief Intersects and aligns the loaded trajectories.
+   * @param path_est Path to the estimate text file (for debug prints)
+   * @param alignment_method The alignment method to use [sim3, se3, posyaw, none]
+   */
+  void associate_and_align(const std::string &path_est, const std::string &alignment_method);
+
   /**
    * @brief Gets the indices at the end of subtractories of a given length when starting at each index.
    * For each starting pose, find the end pose index which is the desired distance away.
@@ -171,20 +203,40 @@ protected:
     // Vector of end ids for our pose indexes
     std::vector<int> comparisons;
 
-    // Loop through each pose in our trajectory (i.e. our distance vector generated from the trajectory).
+    // The distances are accumulated (never decrease), so the error to the desired distance first decreases and then increases.
+    // Thus the best end pose is either the last pose that is short of the desired distance, or the first pose at / past it.
+    // The first pose at / past the desired distance only moves forward as our start pose does, so we just sweep it along.
+    // To select the same pose as a full search (first pose with the smallest error), we move the short pose back to the first pose with
+    // the same error (e.g. if the groundtruth is stationary, where we jump to the start of the run of equal distances).
+    std::vector<size_t> idx_first_equal(distances.size(), 0);
+    for (size_t i = 1; i < distances.size(); i++)
+      idx_first_equal.at(i) = (distances.at(i) == distances.at(i - 1)) ? idx_first_equal.at(i - 1) : i;
+    size_t idx_past = 0;
     for (size_t idx = 0; idx < distances.size(); idx++) {
 
-      // Loop through and find the pose that minimized the difference between
-      // The desired trajectory distance and our current trajectory distance
+      // Find the first pose at or past the desired distance
       double distance_startpose = distances.at(idx);
+      idx_past = std::max(idx_past, idx);
+      while (idx_past < distances.size() && distances.at(idx_past) < distance_startpose + distance)
+        idx_past++;
+
+      // Find the pose that minimized the difference between the desired trajectory distance and our current trajectory distance
       int best_idx = -1;
       double best_error = max_dist_diff;
-      for (size_t i = idx; i < distances.size(); i++) {
-        if (std::abs(distances.at(i) - (distance_startpose + distance)) < best_error) {
-          best_idx = i;
-          best_error = std::abs(distances.at(i) - (distance_startpose + distance));
+      if (idx_past > idx) {
+        size_t idx_short = std::max(idx, idx_first_equal.at(idx_past - 1));
+        while (idx_short > idx && std::abs(distances.at(idx_short - 1) - (distance_startpose + distance)) ==
+                                      std::abs(distances.at(idx_short) - (distance_startpose + distance)))
+          idx_short--;
+        if (std::abs(distances.at(idx_short) - (distance_startpose + distance)) < best_error) {
+          best_idx = (int)idx_short;
+          best_error = std::abs(distances.at(idx_short) - (distance_startpose + distance));
         }
       }
+      if (idx_past < distances.size() && std::abs(distances.at(idx_past) - (distance_startpose + distance)) < best_error) {
+        best_idx = (int)idx_past;
+        best_error = std::abs(distances.at(idx_past) - (distance_startpose + distance));
+      }
 
       // If we have an end id that reached this trajectory distance then add it!
       // Else this isn't a valid segment, thus we shouldn't add it (we will try again at the next pose)
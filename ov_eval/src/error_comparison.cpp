@@ -25,6 +25,7 @@
 #include <iostream>
 #include <string>
 
+#include "calc/ResultBatch.h"
 #include "calc/ResultTrajectory.h"
 #include "utils/Loader.h"
 #include "utils/colors.h"
@@ -47,11 +48,15 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 4) {
     PRINT_ERROR(RED "ERROR: Please specify a align mode, folder, and algorithms\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./error_comparison <align_mode> <folder_groundtruth> <folder_algorithms>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_comparison <align_mode> <folder_groundtruth> <folder_algorithms>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_comparison <align_mode> <folder_groundtruth> <folder_algorithms> [num_threads]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_comparison <align_mode> <folder_groundtruth> <folder_algorithms> [num_threads]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Our batch evaluator, the runs are evaluated in parallel (all cores by default)
+  int num_threads = (argc > 4) ? std::atoi(argv[4]) : -1;
+  ov_eval::ResultBatch batch(argv[1], num_threads);
+
   // List the groundtruth files in this folder
   std::string path_gts(argv[2]);
   std::vector<boost::filesystem::path> path_groundtruths;
@@ -63,14 +68,14 @@ int main(int argc, char **argv) {
   std::sort(path_groundtruths.begin(), path_groundtruths.end());
 
   // Try to load our paths
+  // These are kept in memory and shared between all the runs of each dataset
+  std::vector<size_t> id_groundtruths;
   for (size_t i = 0; i < path_groundtruths.size(); i++) {
     // Load it!
-    std::vector<double> times;
-    std::vector<Eigen::Matrix<double, 7, 1>> poses;
-    std::vector<Eigen::Matrix3d> cov_ori, cov_pos;
-    ov_eval::Loader::load_data(path_groundtruths.at(i).string(), times, poses, cov_ori, cov_pos);
+    id_groundtruths.push_back(batch.add_groundtruth(path_groundtruths.at(i).string()));
     // Print its length and stats
-    double length = ov_eval::Loader::get_total_length(poses);
+    const auto &times = batch.get_groundtruth_times(id_groundtruths.back());
+    double length = ov_eval::Loader::get_total_length(batch.get_groundtruth_poses(id_groundtruths.back()));
     PRINT_INFO("[COMP]: %d poses in %s => length of %.2f meters\n", (int)times.size(), path_groundtruths.at(i).filename().c_str(), length);
   }
 
@@ -122,13 +127,11 @@ int main(int argc, char **argv) {
   //===============================================================================
   //===============================================================================
 
-  // Loop through each algorithm type
+  // Find all the runs of each algorithm on each dataset and add them to our batch
+  // An empty list of runs means that the algorithm does not have this dataset
+  std::vector<std::vector<std::vector<size_t>>> id_runs(path_algorithms.size(), std::vector<std::vector<size_t>>(path_groundtruths.size()));
   for (size_t i = 0; i < path_algorithms.size(); i++) {
 
-    // Debug print
-    PRINT_DEBUG("======================================\n");
-    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
-
     // Get the list of datasets this algorithm records
     std::map<std::string, boost::filesystem::path> path_algo_datasets;
     for (auto &entry : boost::filesystem::directory_iterator(path_algorithms.at(i))) {
@@ -147,6 +150,45 @@ int main(int argc, char **argv) {
         continue;
       }
 
+      // Loop though the different runs for this dataset
+      std::vector<std::string> file_paths;
+      for (auto &entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_groundtruths.at(j).stem().string()))) {
+        if (entry.path().extension() != ".txt")
+          continue;
+        file_paths.push_back(entry.path().string());
+      }
+      std::sort(file_paths.begin(), file_paths.end());
+
+      // Now add the sorted runs
+      for (auto &path_esttxt : file_paths) {
+        id_runs.at(i).at(j).push_back(batch.add_run(id_groundtruths.at(j), path_esttxt));
+      }
+    }
+  }
+
+  // Evaluate all runs in parallel
+  PRINT_INFO("[COMP]: evaluating runs with %d threads\n", batch.get_num_threads());
+  batch.evaluate(segments);
+
+  //===============================================================================
+  //===============================================================================
+  //===============================================================================
+
+  // Loop through each algorithm type
+  for (size_t i = 0; i < path_algorithms.size(); i++) {
+
+    // Debug print
+    PRINT_DEBUG("======================================\n");
+    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
+
+    // Loop through our list of groundtruth datasets, and see if we have it
+    for (size_t j = 0; j < path_groundtruths.size(); j++) {
+
+      // Check if we have runs for this dataset
+      if (id_runs.at(i).at(j).empty()) {
+        continue;
+      }
+
       // Debug print
       PRINT_DEBUG("[COMP]: processing %s algorithm => %s dataset\n", path_algorithms.at(i).filename().c_str(),
                   path_groundtruths.at(j).stem().c_str());
@@ -159,40 +201,22 @@ int main(int argc, char **argv) {
         rpe_dataset.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
       }
 
-      // Loop though the different runs for this dataset
-      std::vector<std::string> file_paths;
-      for (auto &entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_groundtruths.at(j).stem().string()))) {
-        if (entry.path().extension() != ".txt")
-          continue;
-        file_paths.push_back(entry.path().string());
-      }
-      std::sort(file_paths.begin(), file_paths.end());
+      // Now loop through the runs in their sorted order
+      for (const size_t &id_run : id_runs.at(i).at(j)) {
 
-      // Now loop through the sorted vector
-      for (auto &path_esttxt : file_paths) {
-        // Our paths
-        std::string dataset = path_groundtruths.at(j).stem().string();
-        std::string path_gttxt = path_groundtruths.at(j).string();
-
-        // Create our trajectory object
-        ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
-
-        // Calculate ATE error for this dataset
-        ov_eval::Statistics error_ori, error_pos;
-        traj.calculate_ate(error_ori, error_pos);
-        ate_dataset_ori.values.push_back(error_ori.rmse);
-        ate_dataset_pos.values.push_back(error_pos.rmse);
-
-        // Calculate ATE 2D error for this dataset
-        ov_eval::Statistics error_ori_2d, error_pos_2d;
-        traj.calculate_ate_2d(error_ori_2d, error_pos_2d);
-        ate_2d_dataset_ori.values.push_back(error_ori_2d.rmse);
-        ate_2d_dataset_pos.values.push_back(error_pos_2d.rmse);
-
-        // Calculate RPE error for this dataset
-        std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> error_rpe;
-        traj.calculate_rpe(segments, error_rpe);
-        for (const auto &elm : error_rpe) {
+        // Get the errors of this run
+        const ov_eval::ResultBatch::RunErrors &errors = batch.get_errors(id_run);
+
+        // ATE error for this dataset
+        ate_dataset_ori.values.push_back(errors.ate_ori.rmse);
+        ate_dataset_pos.values.push_back(errors.ate_pos.rmse);
+
+        // ATE 2D error for this dataset
+        ate_2d_dataset_ori.values.push_back(errors.ate_2d_ori.rmse);
+        ate_2d_dataset_pos.values.push_back(errors.ate_2d_pos.rmse);
+
+        // RPE error for this dataset
+        for (const auto &elm : errors.rpe) {
           rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(), elm.second.first.values.begin(),
                                                         elm.second.first.values.end());
           rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),
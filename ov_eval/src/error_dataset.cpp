@@ -24,6 +24,7 @@
 #include <boost/filesystem.hpp>
 #include <string>
 
+#include "calc/ResultBatch.h"
 #include "calc/ResultTrajectory.h"
 #include "utils/Loader.h"
 #include "utils/colors.h"
@@ -46,20 +47,23 @@ int main(int argc, char **argv) {
   // Ensure we have a path
   if (argc < 4) {
     PRINT_ERROR(RED "ERROR: Please specify a align mode, folder, and algorithms\n" RESET);
-    PRINT_ERROR(RED "ERROR: ./error_dataset <align_mode> <file_gt.txt> <folder_algorithms>\n" RESET);
-    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_dataset <align_mode> <file_gt.txt> <folder_algorithms>\n" RESET);
+    PRINT_ERROR(RED "ERROR: ./error_dataset <align_mode> <file_gt.txt> <folder_algorithms> [num_threads]\n" RESET);
+    PRINT_ERROR(RED "ERROR: rosrun ov_eval error_dataset <align_mode> <file_gt.txt> <folder_algorithms> [num_threads]\n" RESET);
     std::exit(EXIT_FAILURE);
   }
 
+  // Our batch evaluator, the runs are evaluated in parallel (all cores by default)
+  int num_threads = (argc > 4) ? std::atoi(argv[4]) : -1;
+  ov_eval::ResultBatch batch(argv[1], num_threads);
+
   // Load it!
+  // This is kept in memory and shared between all the runs
   boost::filesystem::path path_gt(argv[2]);
-  std::vector<double> times;
-  std::vector<Eigen::Matrix<double, 7, 1>> poses;
-  std::vector<Eigen::Matrix3d> cov_ori, cov_pos;
-  ov_eval::Loader::load_data(argv[2], times, poses, cov_ori, cov_pos);
+  size_t id_gt = batch.add_groundtruth(argv[2]);
+  const std::vector<double> &times = batch.get_groundtruth_times(id_gt);
 
   // Print its length and stats
-  double length = ov_eval::Loader::get_total_length(poses);
+  double length = ov_eval::Loader::get_total_length(batch.get_groundtruth_poses(id_gt));
   PRINT_INFO("[COMP]: %d poses in %s => length of %.2f meters\n", (int)times.size(), path_gt.stem().string().c_str(), length);
 
   // Get the algorithms we will process
@@ -106,13 +110,11 @@ int main(int argc, char **argv) {
   //===============================================================================
   //===============================================================================
 
-  // Loop through each algorithm type
+  // Find all the runs of each algorithm and add them to our batch
+  // An empty list of runs means that the algorithm does not have this dataset
+  std::vector<std::vector<size_t>> id_runs(path_algorithms.size());
   for (size_t i = 0; i < path_algorithms.size(); i++) {
 
-    // Debug print
-    PRINT_DEBUG("======================================\n");
-    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
-
     // Get the list of datasets this algorithm records
     std::map<std::string, boost::filesystem::path> path_algo_datasets;
     for (auto &entry : boost::filesystem::directory_iterator(path_algorithms.at(i))) {
@@ -128,17 +130,6 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    // Errors for this specific dataset (i.e. our averages over the total runs)
-    ov_eval::Statistics ate_dataset_ori, ate_dataset_pos;
-    ov_eval::Statistics ate_2d_dataset_ori, ate_2d_dataset_pos;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rpe_dataset;
-    for (const auto &len : segments) {
-      rpe_dataset.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
-    }
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_dataset;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_2d_dataset;
-    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> nees_dataset;
-
     // Loop though the different runs for this dataset
     std::vector<std::string> file_paths;
     for (auto &entry : boost::filesystem::directory_iterator(path_algo_datasets.at(path_gt.stem().string()))) {
@@ -154,16 +145,51 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    // Loop though the different runs for this dataset
+    // Now add the sorted runs
     for (auto &path_esttxt : file_paths) {
+      id_runs.at(i).push_back(batch.add_run(id_gt, path_esttxt));
+    }
+  }
+
+  // Evaluate all runs in parallel
+  PRINT_INFO("[COMP]: evaluating runs with %d threads\n", batch.get_num_threads());
+  batch.evaluate(segments, true);
+
+  //===============================================================================
+  //===============================================================================
+  //===============================================================================
+
+  // Loop through each algorithm type
+  for (size_t i = 0; i < path_algorithms.size(); i++) {
+
+    // Debug print
+    PRINT_DEBUG("======================================\n");
+    PRINT_DEBUG("[COMP]: processing %s algorithm\n", path_algorithms.at(i).filename().c_str());
+
+    // Check if we have runs for our dataset
+    if (id_runs.at(i).empty()) {
+      continue;
+    }
+
+    // Errors for this specific dataset (i.e. our averages over the total runs)
+    ov_eval::Statistics ate_dataset_ori, ate_dataset_pos;
+    ov_eval::Statistics ate_2d_dataset_ori, ate_2d_dataset_pos;
+    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rpe_dataset;
+    for (const auto &len : segments) {
+      rpe_dataset.insert({len, {ov_eval::Statistics(), ov_eval::Statistics()}});
+    }
+    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_dataset;
+    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> rmse_2d_dataset;
+    std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> nees_dataset;
+
+    // Loop though the different runs for this dataset (in their sorted order)
+    for (const size_t &id_run : id_runs.at(i)) {
 
-      // Create our trajectory object
-      std::string path_gttxt = path_gt.string();
-      ov_eval::ResultTrajectory traj(path_esttxt, path_gttxt, argv[1]);
+      // Get the errors of this run
+      const ov_eval::ResultBatch::RunErrors &errors = batch.get_errors(id_run);
 
-      // Calculate ATE error for this dataset
-      ov_eval::Statistics error_ori, error_pos;
-      traj.calculate_ate(error_ori, error_pos);
+      // ATE error for this dataset
+      const ov_eval::Statistics &error_ori = errors.ate_ori, &error_pos = errors.ate_pos;
       ate_dataset_ori.values.push_back(error_ori.rmse);
       ate_dataset_pos.values.push_back(error_pos.rmse);
       for (size_t j = 0; j < error_ori.values.size(); j++) {
@@ -172,9 +198,8 @@ int main(int argc, char **argv) {
         assert(error_ori.timestamps.at(j) == error_pos.timestamps.at(j));
       }
 
-      // Calculate ATE 2D error for this dataset
-      ov_eval::Statistics error_ori_2d, error_pos_2d;
-      traj.calculate_ate_2d(error_ori_2d, error_pos_2d);
+      // ATE 2D error for this dataset
+      const ov_eval::Statistics &error_ori_2d = errors.ate_2d_ori, &error_pos_2d = errors.ate_2d_pos;
       ate_2d_dataset_ori.values.push_back(error_ori_2d.rmse);
       ate_2d_dataset_pos.values.push_back(error_pos_2d.rmse);
       for (size_t j = 0; j < error_ori_2d.values.size(); j++) {
@@ -184,18 +209,15 @@ int main(int argc, char **argv) {
       }
 
       // NEES error for this dataset
-      ov_eval::Statistics nees_ori, nees_pos;
-      traj.calculate_nees(nees_ori, nees_pos);
+      const ov_eval::Statistics &nees_ori = errors.nees_ori, &nees_pos = errors.nees_pos;
       for (size_t j = 0; j < nees_ori.values.size(); j++) {
         nees_dataset[nees_ori.timestamps.at(j)].first.values.push_back(nees_ori.values.at(j));
         nees_dataset[nees_ori.timestamps.at(j)].second.values.push_back(nees_pos.values.at(j));
         assert(nees_ori.timestamps.at(j) == nees_pos.timestamps.at(j));
       }
 
-      // Calculate RPE error for this dataset
-      std::map<double, std::pair<ov_eval::Statistics, ov_eval::Statistics>> error_rpe;
-      traj.calculate_rpe(segments, error_rpe);
-      for (const auto &elm : error_rpe) {
+      // RPE error for this dataset
+      for (const auto &elm : errors.rpe) {
         rpe_dataset.at(elm.first).first.values.insert(rpe_dataset.at(elm.first).first.values.end(), elm.second.first.values.begin(),
                                                       elm.second.first.values.end());
         rpe_dataset.at(elm.first).first.timestamps.insert(rpe_dataset.at(elm.first).first.timestamps.end(),
@@ -232,7 +254,7 @@ int main(int argc, char **argv) {
     // RMSE: Convert into the right format (only use times where all runs have an error)
     ov_eval::Statistics rmse_ori, rmse_pos;
     for (auto &elm : rmse_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
+      if (elm.second.first.values.size() == id_runs.at(i).size()) {
         elm.second.first.calculate();
         elm.second.second.calculate();
         rmse_ori.timestamps.push_back(elm.first);
@@ -248,7 +270,7 @@ int main(int argc, char **argv) {
     // RMSE: Convert into the right format (only use times where all runs have an error)
     ov_eval::Statistics rmse_2d_ori, rmse_2d_pos;
     for (auto &elm : rmse_2d_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
+      if (elm.second.first.values.size() == id_runs.at(i).size()) {
         elm.second.first.calculate();
         elm.second.second.calculate();
         rmse_2d_ori.timestamps.push_back(elm.first);
@@ -264,7 +286,7 @@ int main(int argc, char **argv) {
     // NEES: Convert into the right format (only use times where all runs have an error)
     ov_eval::Statistics nees_ori, nees_pos;
     for (auto &elm : nees_dataset) {
-      if (elm.second.first.values.size() == file_paths.size()) {
+      if (elm.second.first.values.size() == id_runs.at(i).size()) {
         elm.second.first.calculate();
         elm.second.second.calculate();
         nees_ori.timestamps.push_back(elm.first);
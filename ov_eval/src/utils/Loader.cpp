@@ -21,42 +21,64 @@
 
 #include "Loader.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
 using namespace ov_eval;
 
 void Loader::load_data(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
                        std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
 
+  // Use our cached values if we have them
+  std::vector<std::vector<double>> blocks;
+  CacheKey cache_key;
+  bool use_cache = (times.empty() && poses.empty() && cov_ori.empty() && cov_pos.empty());
+  if (use_cache && load_cache(path_traj, "traj", blocks, cache_key) && blocks.size() == 4 &&
+      blocks.at(1).size() == 7 * blocks.at(0).size() && blocks.at(2).size() == blocks.at(3).size() && blocks.at(2).size() % 9 == 0) {
+    times = blocks.at(0);
+    for (size_t i = 0; i < times.size(); i++)
+      poses.push_back(Eigen::Map<const Eigen::Matrix<double, 7, 1>>(blocks.at(1).data() + 7 * i));
+    for (size_t i = 0; i < blocks.at(2).size() / 9; i++) {
+      cov_ori.push_back(Eigen::Map<const Eigen::Matrix3d>(blocks.at(2).data() + 9 * i));
+      cov_pos.push_back(Eigen::Map<const Eigen::Matrix3d>(blocks.at(3).data() + 9 * i));
+    }
+    return;
+  }
+
   // Try to open our trajectory file
-  std::ifstream file(path_traj);
-  if (!file.is_open()) {
+  std::string contents;
+  if (!read_file(path_traj, contents)) {
     PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
     std::exit(EXIT_FAILURE);
   }
 
   // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  std::vector<double> fields;
+  const char *curr = contents.data();
+  const char *end = contents.data() + contents.size();
+  while (curr < end) {
+    const char *line = curr;
+    const char *line_end = static_cast<const char *>(std::memchr(curr, '\n', end - curr));
+    line_end = (line_end == nullptr) ? end : line_end;
+    curr = line_end + 1;
 
     // Skip if we start with a comment
-    if (!current_line.find("#"))
+    if (*line == '#')
       continue;
 
-    // Loop variables
-    int i = 0;
-    std::istringstream s(current_line);
-    std::string field;
-    Eigen::Matrix<double, 20, 1> data;
-
     // Loop through this line (timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33)
-    while (std::getline(s, field, ' ')) {
-      // Skip if empty
-      if (field.empty() || i >= data.rows())
-        continue;
-      // save the data to our vector
-      data(i) = std::atof(field.c_str());
-      i++;
-    }
+    parse_fields(line, line_end, ' ', fields);
+    Eigen::Matrix<double, 20, 1> data;
+    int i = (int)std::min(fields.size(), (size_t)data.rows());
+    for (int j = 0; j < i; j++)
+      data(j) = fields.at(j);
 
     // Only a valid line if we have all the parameters
     if (i >= 20) {
@@ -77,9 +99,6 @@ void Loader::load_data(std::string path_traj, std::vector<double> &times, std::v
     }
   }
 
-  // Finally close the file
-  file.close();
-
   // Error if we don't have any data
   if (times.empty()) {
     PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
@@ -101,6 +120,18 @@ void Loader::load_data(std::string path_traj, std::vector<double> &times, std::v
     std::exit(EXIT_FAILURE);
   }
 
+  // Save the parsed values so we can directly load them next time
+  if (use_cache) {
+    blocks = {times, {}, {}, {}};
+    for (size_t i = 0; i < poses.size(); i++)
+      blocks.at(1).insert(blocks.at(1).end(), poses.at(i).data(), poses.at(i).data() + 7);
+    for (size_t i = 0; i < cov_ori.size(); i++) {
+      blocks.at(2).insert(blocks.at(2).end(), cov_ori.at(i).data(), cov_ori.at(i).data() + 9);
+      blocks.at(3).insert(blocks.at(3).end(), cov_pos.at(i).data(), cov_pos.at(i).data() + 9);
+    }
+    save_cache(path_traj, "traj", blocks, cache_key);
+  }
+
   // Debug print amount
   // std::string base_filename = path_traj.substr(path_traj.find_last_of("/\\") + 1);
   // PRINT_DEBUG("[LOAD]: loaded %d poses from %s\n",(int)poses.size(),base_filename.c_str());
@@ -109,58 +140,60 @@ void Loader::load_data(std::string path_traj, std::vector<double> &times, std::v
 void Loader::load_data_csv(std::string path_traj, std::vector<double> &times, std::vector<Eigen::Matrix<double, 7, 1>> &poses,
                            std::vector<Eigen::Matrix3d> &cov_ori, std::vector<Eigen::Matrix3d> &cov_pos) {
 
+  // Use our cached values if we have them
+  std::vector<std::vector<double>> blocks;
+  CacheKey cache_key;
+  bool use_cache = (times.empty() && poses.empty());
+  if (use_cache && load_cache(path_traj, "csv", blocks, cache_key) && blocks.size() == 2 &&
+      blocks.at(1).size() == 7 * blocks.at(0).size()) {
+    times = blocks.at(0);
+    for (size_t i = 0; i < times.size(); i++)
+      poses.push_back(Eigen::Map<const Eigen::Matrix<double, 7, 1>>(blocks.at(1).data() + 7 * i));
+    return;
+  }
+
   // Try to open our trajectory file
-  std::ifstream file(path_traj);
-  if (!file.is_open()) {
+  std::string contents;
+  if (!read_file(path_traj, contents)) {
     PRINT_ERROR(RED "[LOAD]: Unable to open trajectory file...\n" RESET);
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
     std::exit(EXIT_FAILURE);
   }
 
   // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  std::vector<double> fields;
+  const char *curr = contents.data();
+  const char *end = contents.data() + contents.size();
+  while (curr < end) {
+    const char *line = curr;
+    const char *line_end = static_cast<const char *>(std::memchr(curr, '\n', end - curr));
+    line_end = (line_end == nullptr) ? end : line_end;
+    curr = line_end + 1;
 
     // Skip if we start with a comment
-    if (!current_line.find("#"))
+    if (*line == '#')
       continue;
 
-    // Loop variables
-    int i = 0;
-    std::istringstream s(current_line);
-    std::string field;
-    Eigen::Matrix<double, 20, 1> data;
-
     // Loop through this line (groundtruth state [time(sec),q_GtoI,p_IinG,v_IinG,b_gyro,b_accel])
-    while (std::getline(s, field, ',')) {
-      // Skip if empty
-      if (field.empty() || i >= data.rows())
-        continue;
-      // save the data to our vector
-      data(i) = std::atof(field.c_str());
-      i++;
-    }
+    parse_fields(line, line_end, ',', fields);
 
     // Only a valid line if we have all the parameters
     // Times are in nanoseconds -> convert to seconds
     // Our "fixed" state vector from the ETH GT format [q,p,v,bg,ba]
-    if (i >= 8) {
-      times.push_back(1e-9 * data(0));
+    if (fields.size() >= 8) {
+      times.push_back(1e-9 * fields.at(0));
       Eigen::Matrix<double, 7, 1> imustate;
-      imustate(0, 0) = data(1, 0); // pos
-      imustate(1, 0) = data(2, 0);
-      imustate(2, 0) = data(3, 0);
-      imustate(3, 0) = data(5, 0); // quat (xyzw)
-      imustate(4, 0) = data(6, 0);
-      imustate(5, 0) = data(7, 0);
-      imustate(6, 0) = data(4, 0);
+      imustate(0, 0) = fields.at(1); // pos
+      imustate(1, 0) = fields.at(2);
+      imustate(2, 0) = fields.at(3);
+      imustate(3, 0) = fields.at(5); // quat (xyzw)
+      imustate(4, 0) = fields.at(6);
+      imustate(5, 0) = fields.at(7);
+      imustate(6, 0) = fields.at(4);
       poses.push_back(imustate);
     }
   }
 
-  // Finally close the file
-  file.close();
-
   // Error if we don't have any data
   if (times.empty()) {
     PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
@@ -174,51 +207,57 @@ void Loader::load_data_csv(std::string path_traj, std::vector<double> &times, st
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path_traj.c_str());
     std::exit(EXIT_FAILURE);
   }
+
+  // Save the parsed values so we can directly load them next time
+  if (use_cache) {
+    blocks = {times, {}};
+    for (size_t i = 0; i < poses.size(); i++)
+      blocks.at(1).insert(blocks.at(1).end(), poses.at(i).data(), poses.at(i).data() + 7);
+    save_cache(path_traj, "csv", blocks, cache_key);
+  }
 }
 
 void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &values) {
 
+  // Use our cached values if we have them
+  std::vector<std::vector<double>> blocks;
+  CacheKey cache_key;
+  bool use_cache = values.empty();
+  if (use_cache && load_cache(path, "sim", blocks, cache_key) && blocks.size() == 2 && blocks.at(0).size() == 1 && blocks.at(0).at(0) > 0 &&
+      blocks.at(1).size() % (size_t)blocks.at(0).at(0) == 0) {
+    size_t rowsize = (size_t)blocks.at(0).at(0);
+    for (size_t i = 0; i < blocks.at(1).size() / rowsize; i++)
+      values.push_back(Eigen::Map<const Eigen::VectorXd>(blocks.at(1).data() + rowsize * i, (Eigen::Index)rowsize));
+    return;
+  }
+
   // Try to open our trajectory file
-  std::ifstream file(path);
-  if (!file.is_open()) {
+  std::string contents;
+  if (!read_file(path, contents)) {
     PRINT_ERROR(RED "[LOAD]: Unable to open file...\n" RESET);
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
     std::exit(EXIT_FAILURE);
   }
 
   // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  std::vector<double> fields;
+  const char *curr = contents.data();
+  const char *end = contents.data() + contents.size();
+  while (curr < end) {
+    const char *line = curr;
+    const char *line_end = static_cast<const char *>(std::memchr(curr, '\n', end - curr));
+    line_end = (line_end == nullptr) ? end : line_end;
+    curr = line_end + 1;
 
     // Skip if we start with a comment
-    if (!current_line.find("#"))
+    if (*line == '#')
       continue;
 
-    // Loop variables
-    std::istringstream s(current_line);
-    std::string field;
-    std::vector<double> vec;
-
     // Loop through this line (timestamp(s) values....)
-    while (std::getline(s, field, ' ')) {
-      // Skip if empty
-      if (field.empty())
-        continue;
-      // save the data to our vector
-      vec.push_back(std::atof(field.c_str()));
-    }
-
-    // Create eigen vector
-    Eigen::VectorXd temp(vec.size());
-    for (size_t i = 0; i < vec.size(); i++) {
-      temp(i) = vec.at(i);
-    }
-    values.push_back(temp);
+    parse_fields(line, line_end, ' ', fields);
+    values.push_back(Eigen::Map<const Eigen::VectorXd>(fields.data(), (Eigen::Index)fields.size()));
   }
 
-  // Finally close the file
-  file.close();
-
   // Error if we don't have any data
   if (values.empty()) {
     PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
@@ -235,28 +274,42 @@ void Loader::load_simulation(std::string path, std::vector<Eigen::VectorXd> &val
       std::exit(EXIT_FAILURE);
     }
   }
+
+  // Save the parsed values so we can directly load them next time
+  if (use_cache && rowsize > 0) {
+    blocks = {{(double)rowsize}, {}};
+    for (size_t i = 0; i < values.size(); i++)
+      blocks.at(1).insert(blocks.at(1).end(), values.at(i).data(), values.at(i).data() + rowsize);
+    save_cache(path, "sim", blocks, cache_key);
+  }
 }
 
 void Loader::load_timing_flamegraph(std::string path, std::vector<std::string> &names, std::vector<double> &times,
                                     std::vector<Eigen::VectorXd> &timing_values) {
 
   // Try to open our trajectory file
-  std::ifstream file(path);
-  if (!file.is_open()) {
+  std::string contents;
+  if (!read_file(path, contents)) {
     PRINT_ERROR(RED "[LOAD]: Unable to open file...\n" RESET);
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
     std::exit(EXIT_FAILURE);
   }
 
   // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  std::vector<double> fields;
+  const char *curr = contents.data();
+  const char *end = contents.data() + contents.size();
+  while (curr < end) {
+    const char *line = curr;
+    const char *line_end = static_cast<const char *>(std::memchr(curr, '\n', end - curr));
+    line_end = (line_end == nullptr) ? end : line_end;
+    curr = line_end + 1;
 
     // We should have a commented line of the names of the categories
     // Here we will process them (skip the first since it is just the timestamps)
-    if (!current_line.find("#")) {
+    if (*line == '#') {
       // Loop variables
-      std::istringstream s(current_line);
+      std::istringstream s(std::string(line, line_end));
       std::string field;
       names.clear();
       // Loop through this line
@@ -273,32 +326,18 @@ void Loader::load_timing_flamegraph(std::string path, std::vector<std::string> &
       continue;
     }
 
-    // Loop variables
-    std::istringstream s(current_line);
-    std::string field;
-    std::vector<double> vec;
-
     // Loop through this line (timestamp(s) values....)
-    while (std::getline(s, field, ',')) {
-      // Skip if empty
-      if (field.empty())
-        continue;
-      // save the data to our vector
-      vec.push_back(std::atof(field.c_str()));
-    }
+    parse_fields(line, line_end, ',', fields);
 
     // Create eigen vector
-    Eigen::VectorXd temp(vec.size() - 1);
-    for (size_t i = 1; i < vec.size(); i++) {
-      temp(i - 1) = vec.at(i);
+    Eigen::VectorXd temp(fields.size() - 1);
+    for (size_t i = 1; i < fields.size(); i++) {
+      temp(i - 1) = fields.at(i);
     }
-    times.push_back(vec.at(0));
+    times.push_back(fields.at(0));
     timing_values.push_back(temp);
   }
 
-  // Finally close the file
-  file.close();
-
   // Error if we don't have any data
   if (timing_values.empty()) {
     PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
@@ -322,40 +361,32 @@ void Loader::load_timing_percent(std::string path, std::vector<double> &times, s
                                  std::vector<Eigen::VectorXd> &node_values) {
 
   // Try to open our trajectory file
-  std::ifstream file(path);
-  if (!file.is_open()) {
+  std::string contents;
+  if (!read_file(path, contents)) {
     PRINT_ERROR(RED "[LOAD]: Unable to open timing file...\n" RESET);
     PRINT_ERROR(RED "[LOAD]: %s\n" RESET, path.c_str());
     std::exit(EXIT_FAILURE);
   }
 
   // Loop through each line of this file
-  std::string current_line;
-  while (std::getline(file, current_line)) {
+  std::vector<double> fields;
+  const char *curr = contents.data();
+  const char *end = contents.data() + contents.size();
+  while (curr < end) {
+    const char *line = curr;
+    const char *line_end = static_cast<const char *>(std::memchr(curr, '\n', end - curr));
+    line_end = (line_end == nullptr) ? end : line_end;
+    curr = line_end + 1;
 
     // Skip if we start with a comment
-    if (!current_line.find("#"))
+    if (*line == '#')
       continue;
 
-    // Loop variables
-    std::istringstream s(current_line);
-    std::string field;
-    std::vector<double> vec;
-
     // Loop through this line (timestamp(s) values....)
-    while (std::getline(s, field, ' ')) {
-      // Skip if empty
-      if (field.empty())
-        continue;
-      // save the data to our vector
-      vec.push_back(std::atof(field.c_str()));
-    }
+    parse_fields(line, line_end, ' ', fields);
 
     // Create eigen vector
-    Eigen::VectorXd temp(vec.size());
-    for (size_t i = 0; i < vec.size(); i++) {
-      temp(i) = vec.at(i);
-    }
+    Eigen::VectorXd temp = Eigen::Map<const Eigen::VectorXd>(fields.data(), (Eigen::Index)fields.size());
 
     // Skip if there where no threads
     if (temp(3) == 0.0)
@@ -367,9 +398,6 @@ void Loader::load_timing_percent(std::string path, std::vector<double> &times, s
     node_values.push_back(temp.block(4, 0, temp.rows() - 4, 1));
   }
 
-  // Finally close the file
-  file.close();
-
   // Error if we don't have any data
   if (times.empty()) {
     PRINT_ERROR(RED "[LOAD]: Could not parse any data from the file!!\n" RESET);
@@ -396,3 +424,191 @@ double Loader::get_total_length(const std::vector<Eigen::Matrix<double, 7, 1>> &
   // return the distance
   return distance;
 }
+
+bool Loader::read_file(const std::string &path, std::string &contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  file.seekg(0, std::ios::end);
+  std::streamoff size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  contents.resize((size > 0) ? (size_t)size : 0);
+  file.read(&contents[0], (std::streamsize)contents.size());
+  contents.resize((size_t)file.gcount());
+  return true;
+}
+
+void Loader::parse_fields(const char *begin, const char *end, char delim, std::vector<double> &fields) {
+  fields.clear();
+  char buffer[64];
+  while (begin < end) {
+
+    // Find the end of this field, and skip if empty
+    const char *field_end = static_cast<const char *>(std::memchr(begin, delim, end - begin));
+    field_end = (field_end == nullptr) ? end : field_end;
+    size_t length = field_end - begin;
+    if (length == 0) {
+      begin = field_end + 1;
+      continue;
+    }
+
+    // The field needs to be null terminated so we don't parse into the next one
+    // This is the same as std::atof() on each field (non-numeric gives zero)
+    if (length < sizeof(buffer)) {
+      std::memcpy(buffer, begin, length);
+      buffer[length] = '\0';
+      fields.push_back(std::strtod(buffer, nullptr));
+    } else {
+      fields.push_back(std::strtod(std::string(begin, field_end).c_str(), nullptr));
+    }
+    begin = field_end + 1;
+  }
+}
+
+std::string Loader::get_cache_path(const std::string &path, const std::string &kind) {
+
+  // Caching is only enabled if the user requests it
+  const char *cache_env = std::getenv("OV_EVAL_CACHE");
+  if (cache_env == nullptr || std::string(cache_env).empty())
+    return "";
+  std::string cache_setting(cache_env);
+  if (cache_setting == "sidecar")
+    return path + "." + kind + ".cache";
+
+  // Else we save into the folder, with the name from the absolute path of the text file
+  boost::system::error_code ec;
+  boost::filesystem::path path_abs = boost::filesystem::absolute(path);
+  boost::filesystem::create_directories(cache_setting, ec);
+  std::stringstream ss;
+  ss << std::hex << std::hash<std::string>()(path_abs.string()) << "_" << path_abs.filename().string() << "." << kind << ".cache";
+  return (boost::filesystem::path(cache_setting) / ss.str()).string();
+}
+
+Loader::CacheKey Loader::get_cache_key(const std::string &path) {
+
+  // Size and modification time (boost only gives us seconds, so we use stat directly)
+  CacheKey key;
+  struct stat file_stat;
+  if (::stat(path.c_str(), &file_stat) != 0)
+    return key;
+  key.file_size = (uint64_t)file_stat.st_size;
+#if defined(__APPLE__)
+  key.file_time = (int64_t)file_stat.st_mtimespec.tv_sec * 1000000000 + (int64_t)file_stat.st_mtimespec.tv_nsec;
+#else
+  key.file_time = (int64_t)file_stat.st_mtim.tv_sec * 1000000000 + (int64_t)file_stat.st_mtim.tv_nsec;
+#endif
+
+  // FNV-1a hash of the first and last blocks, which is cheap compared to parsing the whole file
+  const size_t block_size = 4096;
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return key;
+  std::vector<char> buffer(2 * block_size);
+  size_t head_size = (size_t)std::min<uint64_t>(key.file_size, block_size);
+  size_t tail_size = (size_t)std::min<uint64_t>(key.file_size - head_size, block_size);
+  file.read(buffer.data(), (std::streamsize)head_size);
+  file.seekg((std::streamoff)(key.file_size - tail_size));
+  file.read(buffer.data() + head_size, (std::streamsize)tail_size);
+  if (!file)
+    return key;
+  key.file_hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < head_size + tail_size; i++) {
+    key.file_hash ^= (uint64_t)(unsigned char)buffer[i];
+    key.file_hash *= 1099511628211ULL;
+  }
+  key.valid = true;
+  return key;
+}
+
+bool Loader::load_cache(const std::string &path, const std::string &kind, std::vector<std::vector<double>> &blocks, CacheKey &key) {
+
+  // Get the size, modification time and hash of the text file
+  std::string path_cache = get_cache_path(path, kind);
+  key = CacheKey();
+  if (path_cache.empty())
+    return false;
+  key = get_cache_key(path);
+  if (!key.valid)
+    return false;
+
+  // Open the cache and check it is for this exact text file
+  std::ifstream file(path_cache, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t cache_size = 0, cache_hash = 0, path_length = 0, num_blocks = 0;
+  int64_t cache_time = 0;
+  file.read(magic, 4);
+  file.read(reinterpret_cast<char *>(&version), sizeof(version));
+  file.read(reinterpret_cast<char *>(&cache_size), sizeof(cache_size));
+  file.read(reinterpret_cast<char *>(&cache_time), sizeof(cache_time));
+  file.read(reinterpret_cast<char *>(&cache_hash), sizeof(cache_hash));
+  file.read(reinterpret_cast<char *>(&path_length), sizeof(path_length));
+  if (!file || std::memcmp(magic, "OVEC", 4) != 0 || version != 2 || cache_size != key.file_size || cache_time != key.file_time ||
+      cache_hash != key.file_hash || path_length > 4096)
+    return false;
+  std::string cache_path(path_length, '\0');
+  file.read(&cache_path[0], (std::streamsize)path_length);
+  if (!file || cache_path != boost::filesystem::absolute(path).string())
+    return false;
+
+  // Finally read all our arrays
+  file.read(reinterpret_cast<char *>(&num_blocks), sizeof(num_blocks));
+  if (!file || num_blocks > 16)
+    return false;
+  blocks.resize(num_blocks);
+  for (auto &block : blocks) {
+    uint64_t num_values = 0;
+    file.read(reinterpret_cast<char *>(&num_values), sizeof(num_values));
+    if (!file || num_values * sizeof(double) > 8 * key.file_size + 64)
+      return false;
+    block.resize(num_values);
+    file.read(reinterpret_cast<char *>(block.data()), (std::streamsize)(num_values * sizeof(double)));
+  }
+  return (bool)file;
+}
+
+void Loader::save_cache(const std::string &path, const std::string &kind, const std::vector<std::vector<double>> &blocks,
+                        const CacheKey &key) {
+
+  // Our values are only for the text file as it was before we parsed it, so don't save them if it has changed since
+  std::string path_cache = get_cache_path(path, kind);
+  if (path_cache.empty() || !key.valid || !(get_cache_key(path) == key))
+    return;
+
+  // Write to a temporary file first and then move it, so other processes / threads never see a partial cache
+  std::stringstream ss;
+  ss << path_cache << ".tmp" << std::hex << std::hash<std::thread::id>()(std::this_thread::get_id()) << "_" << (uint64_t)::getpid();
+  std::string path_tmp = ss.str();
+  std::ofstream file(path_tmp, std::ios::binary);
+  if (!file.is_open()) {
+    PRINT_WARNING(YELLOW "[LOAD]: unable to write cache %s\n" RESET, path_cache.c_str());
+    return;
+  }
+  std::string path_abs = boost::filesystem::absolute(path).string();
+  uint32_t version = 2;
+  uint64_t path_length = path_abs.size(), num_blocks = blocks.size();
+  file.write("OVEC", 4);
+  file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  file.write(reinterpret_cast<const char *>(&key.file_size), sizeof(key.file_size));
+  file.write(reinterpret_cast<const char *>(&key.file_time), sizeof(key.file_time));
+  file.write(reinterpret_cast<const char *>(&key.file_hash), sizeof(key.file_hash));
+  file.write(reinterpret_cast<const char *>(&path_length), sizeof(path_length));
+  file.write(path_abs.data(), (std::streamsize)path_length);
+  file.write(reinterpret_cast<const char *>(&num_blocks), sizeof(num_blocks));
+  for (const auto &block : blocks) {
+    uint64_t num_values = block.size();
+    file.write(reinterpret_cast<const char *>(&num_values), sizeof(num_values));
+    file.write(reinterpret_cast<const char *>(block.data()), (std::streamsize)(num_values * sizeof(double)));
+  }
+  file.close();
+  boost::system::error_code ec;
+  if (!file) {
+    boost::filesystem::remove(path_tmp, ec);
+    return;
+  }
+  boost::filesystem::rename(path_tmp, path_cache, ec);
+  if (ec)
+    boost::filesystem::remove(path_tmp, ec);
+}
@@ -25,6 +25,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <Eigen/Eigen>
 #include <boost/filesystem.hpp>
@@ -36,6 +37,12 @@ namespace ov_eval {
 
 /**
  * @brief Has helper functions to load text files from disk and process them.
+ *
+ * The files are read into memory in one go and then split into lines and fields, which is much faster than going through streams.
+ * Since the same trajectories are often evaluated many times, the parsed trajectories and simulation files can also be cached in a binary
+ * format by setting the `OV_EVAL_CACHE` environment variable. If it is set to `sidecar` then the cache is saved next to the text file,
+ * otherwise it is the folder to save the caches into. A cache is only used if the size, modification time (to the nanosecond), and a hash
+ * of the first and last blocks of the text file are the same as when the cache was created.
  */
 class Loader {
 
@@ -97,6 +104,85 @@ public:
   static double get_total_length(const std::vector<Eigen::Matrix<double, 7, 1>> &poses);
 
 private:
+  /**
+   * @brief Reads the whole file into memory
+   * @param path Path to the file
+   * @param contents Contents of the file
+   * @return False if we could not open the file
+   */
+  static bool read_file(const std::string &path, std::string &contents);
+
+  /**
+   * @brief Parses the numbers of a single line, empty fields are skipped
+   * @param begin Start of the line
+   * @param end End of the line (exclusive)
+   * @param delim Character that separates the fields
+   * @param fields Values of each field (non-numeric ones are zero)
+   */
+  static void parse_fields(const char *begin, const char *end, char delim, std::vector<double> &fields);
+
+  /**
+   * @brief Gets where the binary cache of a file should be saved
+   * @param path Path to the text file
+   * @param kind Which loader the cache is for (the same file might be read in different ways)
+   * @return Path of the cache, empty if caching is disabled
+   */
+  static std::string get_cache_path(const std::string &path, const std::string &kind);
+
+  /// What we use to check that a cache is for the current version of a text file
+  struct CacheKey {
+    /// If we were able to read the file
+    bool valid = false;
+    /// Size of the file in bytes
+    uint64_t file_size = 0;
+    /// Modification time in nanoseconds
+    int64_t file_time = 0;
+    /// Hash of the first and last blocks of the file
+    uint64_t file_hash = 0;
+
+    bool operator==(const CacheKey &other) const {
+      return valid && other.valid && file_size == other.file_size && file_time == other.file_time && file_hash == other.file_hash;
+    }
+  };
+
+  /**
+   * @brief Gets what we use to check that a cache is for the current version of a text file
+   *
+   * Modification times can have a coarse resolution (e.g. one second on some file systems), so a file which is rewritten with the same size
+   * right after it was cached could otherwise be mistaken for the cached one. Thus we also hash the first and last blocks of the file.
+   *
+   * @param path Path to the text file
+   * @return Key of the file (not valid if we could not read the file)
+   */
+  static CacheKey get_cache_key(const std::string &path);
+
+  /**
+   * @brief Loads the cached values of a text file if the cache is still valid
+   *
+   * The key of the text file is returned even if there is no valid cache.
+   * It should be computed before the text file is parsed, so that if the file changes while we parse it, we don't save a stale cache.
+   *
+   * @param path Path to the text file
+   * @param kind Which loader the cache is for
+   * @param blocks Arrays of values which were saved
+   * @param key Key of the text file right now (not valid if caching is disabled)
+   * @return False if there is no valid cache
+   */
+  static bool load_cache(const std::string &path, const std::string &kind, std::vector<std::vector<double>> &blocks, CacheKey &key);
+
+  /**
+   * @brief Saves the parsed values of a text file into its cache
+   *
+   * Nothing is saved if the key of the text file is no longer the one it had before we parsed it.
+   *
+   * @param path Path to the text file
+   * @param kind Which loader the cache is for
+   * @param blocks Arrays of values to save
+   * @param key Key of the text file from before it was parsed (from load_cache())
+   */
+  static void save_cache(const std::string &path, const std::string &kind, const std::vector<std::vector<double>> &blocks,
+                         const CacheKey &key);
+
   /**
    * All function in this class should be static.
    * Thus an instance of this class cannot be created.
@@ -79,6 +79,11 @@ ament_target_dependencies(test_dynamic_init ${ament_libraries})
 target_link_libraries(test_dynamic_init ov_init_lib ${thirdparty_libraries})
 install(TARGETS test_dynamic_init DESTINATION lib/${PROJECT_NAME})
 
+add_executable(test_init_gate src/test_init_gate.cpp)
+ament_target_dependencies(test_init_gate ${ament_libraries})
+target_link_libraries(test_init_gate ov_init_lib ${thirdparty_libraries})
+install(TARGETS test_init_gate DESTINATION lib/${PROJECT_NAME})
+
 # Install launch and config directories
 install(DIRECTORY launch/ DESTINATION share/${PROJECT_NAME}/launch/)
 
@@ -238,7 +238,17 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   }
 
   // Now lets pre-integrate from the first time to the last
+  // The integration between two camera times does not change while they are in the window, so we keep it between attempts
+  // The integrations from I0 are then built up by continuing the one to the previous camera time with the readings in between
   assert(oldest_camera_time < newest_cam_time);
+  for (auto it = cache_cpi.begin(); it != cache_cpi.end();) {
+    if (it->first.first < oldest_time) {
+      it = cache_cpi.erase(it);
+    } else {
+      it++;
+    }
+  }
+  double newest_imu_time = imu_data->back().timestamp;
   double last_camera_timestamp = 0.0;
   std::map<double, std::shared_ptr<ov_core::CpiV1>> map_camera_cpi_I0toIi, map_camera_cpi_IitoIi1;
   for (auto const &timepair : map_camera_times) {
@@ -252,52 +262,55 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       continue;
     }
 
-    // Perform our preintegration from I0 to Ii (used in the linear system)
-    double cpiI0toIi1_time0_in_imu = oldest_camera_time + params.calib_camimu_dt;
-    double cpiI0toIi1_time1_in_imu = current_time + params.calib_camimu_dt;
-    auto cpiI0toIi1 = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
-    cpiI0toIi1->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
-    std::vector<ov_core::ImuData> cpiI0toIi1_readings =
-        InitializerHelper::select_imu_readings(*imu_data, cpiI0toIi1_time0_in_imu, cpiI0toIi1_time1_in_imu);
-    if (cpiI0toIi1_readings.size() < 2) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu),
-                  cpiI0toIi1_readings.size());
-      return false;
-    }
-    double cpiI0toIi1_dt_imu = cpiI0toIi1_readings.at(cpiI0toIi1_readings.size() - 1).timestamp - cpiI0toIi1_readings.at(0).timestamp;
-    if (std::abs(cpiI0toIi1_dt_imu - (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu)) > 0.01) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpiI0toIi1_dt_imu,
-                  (cpiI0toIi1_time1_in_imu - cpiI0toIi1_time0_in_imu));
-      return false;
-    }
-    for (size_t k = 0; k < cpiI0toIi1_readings.size() - 1; k++) {
-      auto imu0 = cpiI0toIi1_readings.at(k);
-      auto imu1 = cpiI0toIi1_readings.at(k + 1);
-      cpiI0toIi1->feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
+    // We only need the readings between the two camera times if we have not integrated them before
+    auto key_IitoIi1 = std::make_pair(last_camera_timestamp, current_time);
+    auto key_I0toIi1 = std::make_pair(oldest_camera_time, current_time);
+    bool have_IitoIi1 = (cache_cpi.find(key_IitoIi1) != cache_cpi.end());
+    bool have_I0toIi1 = (cache_cpi.find(key_I0toIi1) != cache_cpi.end());
+    std::vector<ov_core::ImuData> cpiIitoIi1_readings;
+    if (!have_IitoIi1 || !have_I0toIi1) {
+      double cpiIitoIi1_time0_in_imu = last_camera_timestamp + params.calib_camimu_dt;
+      double cpiIitoIi1_time1_in_imu = current_time + params.calib_camimu_dt;
+      cpiIitoIi1_readings = InitializerHelper::select_imu_readings(*imu_data, cpiIitoIi1_time0_in_imu, cpiIitoIi1_time1_in_imu);
+      if (cpiIitoIi1_readings.size() < 2) {
+        PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu),
+                    cpiIitoIi1_readings.size());
+        return false;
+      }
+      double cpiIitoIi1_dt_imu = cpiIitoIi1_readings.at(cpiIitoIi1_readings.size() - 1).timestamp - cpiIitoIi1_readings.at(0).timestamp;
+      if (std::abs(cpiIitoIi1_dt_imu - (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu)) > 0.01) {
+        PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpiIitoIi1_dt_imu,
+                    (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu));
+        return false;
+      }
     }
 
     // Perform our preintegration from Ii to Ii1 (used in the mle optimization)
-    double cpiIitoIi1_time0_in_imu = last_camera_timestamp + params.calib_camimu_dt;
-    double cpiIitoIi1_time1_in_imu = current_time + params.calib_camimu_dt;
-    auto cpiIitoIi1 = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
-    cpiIitoIi1->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
-    std::vector<ov_core::ImuData> cpiIitoIi1_readings =
-        InitializerHelper::select_imu_readings(*imu_data, cpiIitoIi1_time0_in_imu, cpiIitoIi1_time1_in_imu);
-    if (cpiIitoIi1_readings.size() < 2) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera %.2f in has %zu IMU readings!\n" RESET, (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu),
-                  cpiIitoIi1_readings.size());
-      return false;
+    std::shared_ptr<ov_core::CpiV1> cpiIitoIi1;
+    if (have_IitoIi1) {
+      cpiIitoIi1 = cache_cpi.at(key_IitoIi1);
+    } else {
+      cpiIitoIi1 = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, true);
+      cpiIitoIi1->setLinearizationPoints(gyroscope_bias, accelerometer_bias);
+      cpiIitoIi1->feed_IMU_batch(cpiIitoIi1_readings);
     }
-    double cpiIitoIi1_dt_imu = cpiIitoIi1_readings.at(cpiIitoIi1_readings.size() - 1).timestamp - cpiIitoIi1_readings.at(0).timestamp;
-    if (std::abs(cpiIitoIi1_dt_imu - (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu)) > 0.01) {
-      PRINT_DEBUG(YELLOW "[init-d]: camera IMU was only propagated %.3f of %.3f\n" RESET, cpiIitoIi1_dt_imu,
-                  (cpiIitoIi1_time1_in_imu - cpiIitoIi1_time0_in_imu));
-      return false;
+
+    // Perform our preintegration from I0 to Ii (used in the linear system)
+    // This continues the integration from I0 to the last camera time, so each reading is only integrated once
+    std::shared_ptr<ov_core::CpiV1> cpiI0toIi1;
+    if (have_I0toIi1) {
+      cpiI0toIi1 = cache_cpi.at(key_I0toIi1);
+    } else if (last_camera_timestamp == oldest_camera_time) {
+      cpiI0toIi1 = std::make_shared<ov_core::CpiV1>(*cpiIitoIi1);
+    } else {
+      cpiI0toIi1 = std::make_shared<ov_core::CpiV1>(*map_camera_cpi_I0toIi.at(last_camera_timestamp));
+      cpiI0toIi1->feed_IMU_batch(cpiIitoIi1_readings);
     }
-    for (size_t k = 0; k < cpiIitoIi1_readings.size() - 1; k++) {
-      auto imu0 = cpiIitoIi1_readings.at(k);
-      auto imu1 = cpiIitoIi1_readings.at(k + 1);
-      cpiIitoIi1->feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
+
+    // Keep them for the next attempt if we have all IMU readings up to this time (otherwise the end was extrapolated)
+    if (current_time + params.calib_camimu_dt < newest_imu_time) {
+      cache_cpi[key_IitoIi1] = cpiIitoIi1;
+      cache_cpi[key_I0toIi1] = cpiI0toIi1;
     }
 
     // Finally push back our integrations!
@@ -566,6 +579,46 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
     features_inG[feat.first] = R_GtoI0.transpose() * feat.second;
   }
 
+  // If the MLE of the last attempt failed, we start from its solution for the poses and features that are still in our window
+  // Its global frame has a different origin and yaw, so we align it to ours at the oldest pose we share with it
+  std::map<double, Eigen::VectorXd> biases_Ii;
+  if (params.init_dyn_mle_warm_start && !last_states.empty()) {
+    double time_anchor = -1;
+    for (auto const &timepair : map_camera_times) {
+      if (last_states.find(timepair.first) != last_states.end()) {
+        time_anchor = timepair.first;
+        break;
+      }
+    }
+    if (time_anchor != -1) {
+      Eigen::VectorXd state_anchor = last_states.at(time_anchor);
+      Eigen::Matrix3d R_GlasttoG = quat_2_Rot(ori_GtoIi.at(time_anchor)).transpose() * quat_2_Rot(state_anchor.block(0, 0, 4, 1));
+      Eigen::Vector4d q_GtoGlast = rot_2_quat(R_GlasttoG.transpose());
+      Eigen::Vector3d p_anchor_last = state_anchor.block(4, 0, 3, 1);
+      Eigen::Vector3d p_anchor = pos_IiinG.at(time_anchor);
+      int num_poses = 0;
+      for (auto const &timepair : map_camera_times) {
+        if (last_states.find(timepair.first) == last_states.end())
+          continue;
+        Eigen::VectorXd state_last = last_states.at(timepair.first);
+        ori_GtoIi[timepair.first] = quat_multiply(state_last.block(0, 0, 4, 1), q_GtoGlast);
+        pos_IiinG[timepair.first] = R_GlasttoG * (state_last.block(4, 0, 3, 1) - p_anchor_last) + p_anchor;
+        vel_IiinG[timepair.first] = R_GlasttoG * state_last.block(7, 0, 3, 1);
+        biases_Ii[timepair.first] = state_last.block(10, 0, 6, 1);
+        num_poses++;
+      }
+      int num_feats = 0;
+      for (auto &feat : features_inG) {
+        if (last_features.find(feat.first) == last_features.end())
+          continue;
+        feat.second = R_GlasttoG * (last_features.at(feat.first) - p_anchor_last) + p_anchor;
+        num_feats++;
+      }
+      PRINT_DEBUG("[init-d]: warm starting %d of %zu poses and %d of %zu features from the last attempt\n", num_poses,
+                  map_camera_times.size(), num_feats, features_inG.size());
+    }
+  }
+
   // ======================================================
   // ======================================================
 
@@ -618,9 +671,14 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
 
   // Set the optimization settings
   // NOTE: We use dense schur since after eliminating features we have a dense problem
+  // NOTE: With a lot of poses the features no longer span the whole window, so the reduced system becomes sparse
   // NOTE: http://ceres-solver.org/solving_faqs.html#solving
   ceres::Solver::Options options;
   options.linear_solver_type = ceres::DENSE_SCHUR;
+  if ((int)map_camera_times.size() > params.init_dyn_mle_sparse_poses &&
+      ceres::IsSparseLinearAlgebraLibraryTypeAvailable(options.sparse_linear_algebra_library_type)) {
+    options.linear_solver_type = ceres::SPARSE_SCHUR;
+  }
   options.trust_region_strategy_type = ceres::DOGLEG;
   // options.linear_solver_type = ceres::SPARSE_SCHUR;
   // options.trust_region_strategy_type = ceres::LEVENBERG_MARQUARDT;
@@ -647,6 +705,9 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
     state_k1.block(7, 0, 3, 1) = vel_IiinG.at(timestamp_k1);
     state_k1.block(10, 0, 3, 1) = gyroscope_bias;
     state_k1.block(13, 0, 3, 1) = accelerometer_bias;
+    if (biases_Ii.find(timestamp_k1) != biases_Ii.end()) {
+      state_k1.block(10, 0, 6, 1) = biases_Ii.at(timestamp_k1);
+    }
 
     // ================================================================
     //  ADDING GRAPH STATE / ESTIMATES!
@@ -689,8 +750,8 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
       }
       for (int j = 0; j < 3; j++) {
         x_lin(4 + j) = var_pos[j];
-        x_lin(7 + j) = var_bias_g[j];
-        x_lin(10 + j) = var_bias_a[j];
+        x_lin(7 + j) = gyroscope_bias(j);
+        x_lin(10 + j) = accelerometer_bias(j);
       }
       Eigen::MatrixXd prior_grad = Eigen::MatrixXd::Zero(10, 1);
       Eigen::MatrixXd prior_Info = Eigen::MatrixXd::Identity(10, 10);
@@ -897,18 +958,6 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
              summary.num_residuals, summary.initial_cost, summary.final_cost);
   auto rT6 = boost::posix_time::microsec_clock::local_time();
 
-  // Return if we have failed!
-  timestamp = newest_cam_time;
-  if (params.init_dyn_mle_max_iter != 0 && summary.termination_type != ceres::CONVERGENCE) {
-    PRINT_WARNING(YELLOW "[init-d]: opt failed: %s!\n" RESET, summary.message.c_str());
-    free_state_memory();
-    return false;
-  }
-  PRINT_DEBUG("[init-d]: %s\n", summary.message.c_str());
-
-  //======================================================
-  //======================================================
-
   // Helper function to get the IMU pose value from our ceres problem
   auto get_pose = [&](double timestamp) {
     Eigen::VectorXd state_imu = Eigen::VectorXd::Zero(16);
@@ -924,6 +973,35 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
     return state_imu;
   };
 
+  // Helper function which keeps our solution so the next attempt can start from it
+  // If it failed to even reduce the cost then it is not a good starting point, so we just start from the linear system next time
+  auto save_warm_start = [&]() {
+    last_states.clear();
+    last_features.clear();
+    if (!params.init_dyn_mle_warm_start || summary.final_cost > summary.initial_cost)
+      return;
+    for (auto const &statepair : map_states) {
+      last_states.insert({statepair.first, get_pose(statepair.first)});
+    }
+    for (auto const &featpair : map_features) {
+      double *var_feat = ceres_vars_feat[featpair.second];
+      last_features.insert({featpair.first, Eigen::Vector3d(var_feat[0], var_feat[1], var_feat[2])});
+    }
+  };
+
+  // Return if we have failed!
+  timestamp = newest_cam_time;
+  if (params.init_dyn_mle_max_iter != 0 && summary.termination_type != ceres::CONVERGENCE) {
+    PRINT_WARNING(YELLOW "[init-d]: opt failed: %s!\n" RESET, summary.message.c_str());
+    save_warm_start();
+    free_state_memory();
+    return false;
+  }
+  PRINT_DEBUG("[init-d]: %s\n", summary.message.c_str());
+
+  //======================================================
+  //======================================================
+
   // Our most recent state is the IMU state!
   assert(map_states.find(newest_cam_time) != map_states.end());
   if (_imu == nullptr) {
@@ -1012,6 +1090,7 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   bool success = problem_cov.Compute(covariance_blocks, &problem);
   if (!success) {
     PRINT_WARNING(YELLOW "[init-d]: covariance recovery failed...\n" RESET);
+    save_warm_start();
     free_state_memory();
     return false;
   }
@@ -1102,6 +1181,8 @@ bool DynamicInitializer::initialize(double &timestamp, Eigen::MatrixXd &covarian
   PRINT_DEBUG("[TIME]: %.4f sec for ceres opt\n", (rT6 - rT5).total_microseconds() * 1e-6);
   PRINT_DEBUG("[TIME]: %.4f sec for ceres covariance\n", (rT7 - rT6).total_microseconds() * 1e-6);
   PRINT_DEBUG("[TIME]: %.4f sec total for initialization\n", (rT7 - rT1).total_microseconds() * 1e-6);
+  last_states.clear();
+  last_features.clear();
   free_state_memory();
   return true;
 }
@@ -25,6 +25,7 @@
 #include "init/InertialInitializerOptions.h"
 
 namespace ov_core {
+class CpiV1;
 class FeatureDatabase;
 struct ImuData;
 } // namespace ov_core
@@ -48,6 +49,10 @@ namespace ov_init {
  * 2. Construct linear system with features to recover velocity (solve with |g| constraint)
  * 3. Perform a large MLE with all calibration and recover the covariance.
  *
+ * Attempts are normally made every frame until one succeeds, and the window only moves forward by a frame between them.
+ * Thus we keep the preintegration between camera times which are still in the window instead of integrating again,
+ * and if the MLE of an attempt fails, the next attempt starts its MLE from that solution instead of the linear one.
+ *
  * Method is based on this work (see this [tech report](https://pgeneva.com/downloads/reports/tr_init.pdf) for a high level walk through):
  *
  * > Dong-Si, Tue-Cuong, and Anastasios I. Mourikis.
@@ -95,6 +100,15 @@ private:
 
   /// Our history of IMU messages (time, angular, linear)
   std::shared_ptr<std::vector<ov_core::ImuData>> imu_data;
+
+  /// Preintegrations from previous attempts, between two camera times (camera clock) whose IMU readings have all been received
+  std::map<std::pair<double, double>, std::shared_ptr<ov_core::CpiV1>> cache_cpi;
+
+  /// IMU states (q_GtoI, p_IinG, v_IinG, bg, ba) of the last failed MLE at each camera time, empty if we should not warm start
+  std::map<double, Eigen::VectorXd> last_states;
+
+  /// Features (p_FinG) of the last failed MLE
+  std::map<size_t, Eigen::Vector3d> last_features;
 };
 
 } // namespace ov_init
@@ -51,6 +51,25 @@ void InertialInitializer::feed_imu(const ov_core::ImuData &message, double oldes
   // Append it to our vector
   imu_data->emplace_back(message);
 
+  // Update our running sums, the rotation uses the same average angular velocity as the dynamic initializer
+  // We remove the same readings as below, but keep the sums before them so the oldest readings can still be used in a window
+  {
+    std::lock_guard<std::mutex> lck(imu_sums_mtx);
+    ImuRunningSum sum = (imu_sums.empty()) ? imu_sums_before : imu_sums.back();
+    double dt = (imu_sums.empty()) ? 0.0 : message.timestamp - sum.timestamp;
+    sum.sum_theta += ((0.5 * (sum.wm + message.wm) - params.init_dyn_bias_g) * dt).norm();
+    sum.timestamp = message.timestamp;
+    sum.wm = message.wm;
+    sum.count += 1.0;
+    sum.sum_am += message.am;
+    sum.sum_am_squared += message.am.squaredNorm();
+    imu_sums.push_back(sum);
+    while (oldest_time != -1 && !imu_sums.empty() && imu_sums.front().timestamp < oldest_time) {
+      imu_sums_before = imu_sums.front();
+      imu_sums.pop_front();
+    }
+  }
+
   // Sort our imu data (handles any out of order measurements)
   // std::sort(imu_data->begin(), imu_data->end(), [](const IMUDATA i, const IMUDATA j) {
   //    return i.timestamp < j.timestamp;
@@ -74,22 +93,12 @@ bool InertialInitializer::initialize(double &timestamp, Eigen::MatrixXd &covaria
                                      std::shared_ptr<ov_type::IMU> t_imu, bool wait_for_jerk) {
 
   // Get the newest and oldest timestamps we will try to initialize between!
-  double newest_cam_time = -1;
-  for (auto const &feat : _db->get_internal_data()) {
-    for (auto const &camtimepair : feat.second->timestamps) {
-      for (auto const &time : camtimepair.second) {
-        newest_cam_time = std::max(newest_cam_time, time);
-      }
-    }
-  }
-  double oldest_time = newest_cam_time - params.init_window_time - 0.10;
-  if (newest_cam_time < 0 || oldest_time < 0) {
-    return false;
-  }
-
   // Remove all measurements that are older then our initialization window
   // Then we will try to use all features that are in the feature database!
-  _db->cleanup_measurements(oldest_time);
+  double newest_cam_time, oldest_time;
+  if (!cleanup_to_window(newest_cam_time, oldest_time)) {
+    return false;
+  }
   auto it_imu = imu_data->begin();
   while (it_imu != imu_data->end() && it_imu->timestamp < oldest_time + params.calib_camimu_dt) {
     it_imu = imu_data->erase(it_imu);
@@ -145,3 +154,94 @@ bool InertialInitializer::initialize(double &timestamp, Eigen::MatrixXd &covaria
   }
   return false;
 }
+
+bool InertialInitializer::can_initialize(bool wait_for_jerk) {
+
+  // Remove the feature measurements that have left our window (same as initialize() does)
+  // initialize() is skipped while this returns false, so the database would otherwise grow during long stationary periods
+  double newest_cam_time, oldest_time;
+  if (!cleanup_to_window(newest_cam_time, oldest_time)) {
+    return false;
+  }
+
+  // The disparity checks need this many features in both halves of our window
+  if (params.init_max_disparity > 0) {
+    double newest_time_allowed = newest_cam_time - 0.5 * params.init_window_time;
+    int num_features0 = 0;
+    int num_features1 = 0;
+    double avg_disp, var_disp;
+    FeatureHelper::compute_disparity(_db, avg_disp, var_disp, num_features0, newest_time_allowed);
+    FeatureHelper::compute_disparity(_db, avg_disp, var_disp, num_features1, newest_cam_time, newest_time_allowed);
+    int feat_thresh = 15;
+    if (num_features0 < feat_thresh || num_features1 < feat_thresh) {
+      PRINT_ALL("[init]: skipping attempt, not enough feats to compute disp: %d,%d < %d\n", num_features0, num_features1, feat_thresh);
+      return false;
+    }
+  }
+
+  // Get the sums over the two halves of our window (same windows as the static initializer)
+  std::lock_guard<std::mutex> lck(imu_sums_mtx);
+  if (imu_sums.empty() || imu_sums.back().timestamp - imu_sums.front().timestamp < params.init_window_time) {
+    return false;
+  }
+  double newest_time = imu_sums.back().timestamp;
+  ImuRunningSum sum0 = imu_sums.back();
+  ImuRunningSum sum1 = running_sum_at(newest_time - 0.5 * params.init_window_time);
+  ImuRunningSum sum2 = running_sum_at(newest_time - 1.0 * params.init_window_time);
+
+  // Sample standard deviation of the accelerometer from the sums
+  auto accel_std = [](const ImuRunningSum &sum_new, const ImuRunningSum &sum_old) {
+    double count = sum_new.count - sum_old.count;
+    if (count < 2)
+      return -1.0;
+    Eigen::Vector3d sum_am = sum_new.sum_am - sum_old.sum_am;
+    double var = (sum_new.sum_am_squared - sum_old.sum_am_squared - sum_am.squaredNorm() / count) / (count - 1);
+    return std::sqrt(std::max(0.0, var));
+  };
+  double a_std_1to0 = accel_std(sum0, sum1);
+  double a_std_2to1 = accel_std(sum1, sum2);
+
+  // The static initializer needs a jerk in the newest half (stationary before), or to be stationary in both if not waiting for one
+  // The dynamic initializer needs enough rotation, our window has at least all the readings it will integrate over
+  bool static_possible = false;
+  if (params.init_imu_thresh > 0.0 && a_std_1to0 >= 0.0 && a_std_2to1 >= 0.0) {
+    if (wait_for_jerk) {
+      static_possible = (a_std_1to0 >= params.init_imu_thresh && a_std_2to1 <= params.init_imu_thresh);
+    } else {
+      static_possible = (a_std_1to0 <= params.init_imu_thresh && a_std_2to1 <= params.init_imu_thresh);
+    }
+  }
+  double theta_deg = 180.0 / M_PI * (sum0.sum_theta - imu_sums_before.sum_theta);
+  bool dynamic_possible = (params.init_dyn_use && theta_deg >= params.init_dyn_min_deg);
+  if (!static_possible && !dynamic_possible) {
+    PRINT_ALL("[init]: skipping attempt, IMU excitation %.3f,%.3f and %.2f deg rotation\n", a_std_2to1, a_std_1to0, theta_deg);
+    return false;
+  }
+  return true;
+}
+
+InertialInitializer::ImuRunningSum InertialInitializer::running_sum_at(double timestamp) const {
+  auto it = std::upper_bound(imu_sums.begin(), imu_sums.end(), timestamp,
+                             [](double time, const ImuRunningSum &sum) { return time < sum.timestamp; });
+  if (it == imu_sums.begin()) {
+    return imu_sums_before;
+  }
+  return *(it - 1);
+}
+
+bool InertialInitializer::cleanup_to_window(double &newest_cam_time, double &oldest_time) {
+  newest_cam_time = -1;
+  for (auto const &feat : _db->get_internal_data()) {
+    for (auto const &camtimepair : feat.second->timestamps) {
+      for (auto const &time : camtimepair.second) {
+        newest_cam_time = std::max(newest_cam_time, time);
+      }
+    }
+  }
+  oldest_time = newest_cam_time - params.init_window_time - 0.10;
+  if (newest_cam_time < 0 || oldest_time < 0) {
+    return false;
+  }
+  _db->cleanup_measurements(oldest_time);
+  return true;
+}
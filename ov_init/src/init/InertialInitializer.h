@@ -22,6 +22,10 @@
 #ifndef OV_INIT_INERTIALINITIALIZER_H
 #define OV_INIT_INERTIALINITIALIZER_H
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
 #include "init/InertialInitializerOptions.h"
 
 namespace ov_core {
@@ -97,7 +101,45 @@ public:
   bool initialize(double &timestamp, Eigen::MatrixXd &covariance, std::vector<std::shared_ptr<ov_type::Type>> &order,
                   std::shared_ptr<ov_type::IMU> t_imu, bool wait_for_jerk = true);
 
+  /**
+   * @brief Cheap check if initialize() could succeed with our current window of measurements
+   *
+   * This only looks at the IMU excitation and number of tracked features, which are kept up to date as measurements come in.
+   * It also removes the feature measurements that have left our window, since initialize() is not called while this fails.
+   * If this returns false then initialize() would have also failed, so the (expensive) attempt can be skipped.
+   * It can still return true for windows that will fail (e.g. the disparity and linear system are only checked in initialize()).
+   *
+   * @param wait_for_jerk If true we will wait for a "jerk"
+   * @return False if we know that initialize() will fail
+   */
+  bool can_initialize(bool wait_for_jerk = true);
+
 protected:
+  /// Running sums of the IMU readings from the first one we got (sums over a window are the difference at its ends)
+  struct ImuRunningSum {
+    double timestamp = 0.0;
+    Eigen::Vector3d wm = Eigen::Vector3d::Zero();
+    double count = 0.0;
+    Eigen::Vector3d sum_am = Eigen::Vector3d::Zero();
+    double sum_am_squared = 0.0;
+    double sum_theta = 0.0;
+  };
+
+  /**
+   * @brief Gets the running sum at a time (from the newest reading at or before it)
+   * @param timestamp Time we want the sum at
+   * @return Running sum at that time
+   */
+  ImuRunningSum running_sum_at(double timestamp) const;
+
+  /**
+   * @brief Removes all feature measurements older than our initialization window (which ends at the newest camera time)
+   * @param[out] newest_cam_time Newest camera time in the feature database
+   * @param[out] oldest_time Start of our initialization window
+   * @return False if we do not have any camera measurements to define the window yet
+   */
+  bool cleanup_to_window(double &newest_cam_time, double &oldest_time);
+
   /// Initialization parameters
   InertialInitializerOptions params;
 
@@ -107,6 +149,11 @@ protected:
   /// Our history of IMU messages (time, angular, linear)
   std::shared_ptr<std::vector<ov_core::ImuData>> imu_data;
 
+  /// Running sums after each IMU reading in our window, and the one before the window (for the can_initialize() checks)
+  std::deque<ImuRunningSum> imu_sums;
+  ImuRunningSum imu_sums_before;
+  std::mutex imu_sums_mtx;
+
   /// Static initialization helper class
   std::shared_ptr<StaticInitializer> init_static;
 
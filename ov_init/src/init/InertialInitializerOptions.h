@@ -87,6 +87,12 @@ struct InertialInitializerOptions {
   /// Max time for MLE optimization (seconds)
   double init_dyn_mle_max_time = 5.0;
 
+  /// If the MLE should start from the solution of the last attempt if it failed (for the poses and features still in the window)
+  bool init_dyn_mle_warm_start = true;
+
+  /// Number of poses above which the MLE uses a sparse Schur solver (if ceres has a sparse library)
+  int init_dyn_mle_sparse_poses = 20;
+
   /// Number of poses to use during initialization (max should be cam freq * window)
   int init_dyn_num_pose = 5;
 
@@ -133,6 +139,8 @@ struct InertialInitializerOptions {
       parser->parse_config("init_dyn_mle_max_iter", init_dyn_mle_max_iter);
       parser->parse_config("init_dyn_mle_max_threads", init_dyn_mle_max_threads);
       parser->parse_config("init_dyn_mle_max_time", init_dyn_mle_max_time);
+      parser->parse_config("init_dyn_mle_warm_start", init_dyn_mle_warm_start, false);
+      parser->parse_config("init_dyn_mle_sparse_poses", init_dyn_mle_sparse_poses, false);
       parser->parse_config("init_dyn_num_pose", init_dyn_num_pose);
       parser->parse_config("init_dyn_min_deg", init_dyn_min_deg);
       parser->parse_config("init_dyn_inflation_ori", init_dyn_inflation_orientation);
@@ -173,6 +181,8 @@ struct InertialInitializerOptions {
     PRINT_DEBUG("  - init_dyn_mle_max_iter: %d\n", init_dyn_mle_max_iter);
     PRINT_DEBUG("  - init_dyn_mle_max_threads: %d\n", init_dyn_mle_max_threads);
     PRINT_DEBUG("  - init_dyn_mle_max_time: %.2f\n", init_dyn_mle_max_time);
+    PRINT_DEBUG("  - init_dyn_mle_warm_start: %d\n", init_dyn_mle_warm_start);
+    PRINT_DEBUG("  - init_dyn_mle_sparse_poses: %d\n", init_dyn_mle_sparse_poses);
     PRINT_DEBUG("  - init_dyn_num_pose: %d\n", init_dyn_num_pose);
     PRINT_DEBUG("  - init_dyn_min_deg: %.2f\n", init_dyn_min_deg);
     PRINT_DEBUG("  - init_dyn_inflation_ori: %.2e\n", init_dyn_inflation_orientation);
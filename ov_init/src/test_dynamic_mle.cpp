@@ -234,11 +234,7 @@ int main(int argc, char **argv) {
           auto readings = InitializerHelper::select_imu_readings(*imu_readings, time0, time1);
           cpi = std::make_shared<ov_core::CpiV1>(params.sigma_w, params.sigma_wb, params.sigma_a, params.sigma_ab, false);
           cpi->setLinearizationPoints(bias_g_k, bias_a_k, quat_k, gravity);
-          for (size_t k = 0; k < readings.size() - 1; k++) {
-            auto imu0 = readings.at(k);
-            auto imu1 = readings.at(k + 1);
-            cpi->feed_IMU(imu0.timestamp, imu1.timestamp, imu0.wm, imu0.am, imu1.wm, imu1.am);
-          }
+          cpi->feed_IMU_batch(readings);
           assert(timestamp_k1 > timestamp_k);
 
           // Compute the predicted state
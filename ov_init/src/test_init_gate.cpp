@@ -0,0 +1,140 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <memory>
+#include <random>
+
+#include "init/InertialInitializer.h"
+#include "init/InertialInitializerOptions.h"
+
+#include "feat/Feature.h"
+#include "feat/FeatureDatabase.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/sensor_data.h"
+
+using namespace ov_init;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+// Total number of feature measurements in the database
+size_t count_measurements(const std::shared_ptr<ov_core::FeatureDatabase> &db) {
+  size_t count = 0;
+  for (auto const &feat : db->get_internal_data()) {
+    for (auto const &camtimepair : feat.second->timestamps) {
+      count += camtimepair.second.size();
+    }
+  }
+  return count;
+}
+
+// Checks the initialization gate over a long stationary startup followed by the device being picked up.
+// The gate should skip every attempt while stationary, and keep the feature database bounded to the init window while it does.
+int main(int argc, char **argv) {
+
+  // Register failure handler
+  signal(SIGINT, signal_callback_handler);
+
+  // Verbosity setting
+  ov_core::Printer::setPrintLevel("INFO");
+
+  // Initializer settings (these are the same as the euroc config)
+  InertialInitializerOptions params;
+  params.init_window_time = 2.0;
+  params.init_imu_thresh = 1.5;
+  params.init_max_disparity = 10.0;
+  params.init_dyn_use = false;
+  auto db = std::make_shared<ov_core::FeatureDatabase>();
+  InertialInitializer initializer(params, db);
+
+  // Stationary for a long time, then shaken
+  // Features are seen the whole time with a small amount of pixel noise
+  double cam_hz = 20.0;
+  double imu_hz = 200.0;
+  double time_stationary = 120.0;
+  double time_total = time_stationary + 1.5;
+  int num_feats = 50;
+  std::mt19937 gen(0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<Eigen::Vector2d> uvs;
+  for (int i = 0; i < num_feats; i++) {
+    uvs.emplace_back(20.0 + 10.0 * i, 20.0 + 8.0 * i);
+  }
+
+  // Max number of measurements the window can hold (both window halves plus the margin, with some slack)
+  size_t max_window_meas = (size_t)(num_feats * cam_hz * (params.init_window_time + 0.5));
+  size_t max_meas = 0;
+  double time_imu = 1.0;
+  bool can_init_stationary = false;
+  bool can_init_shaken = false;
+  for (double time_cam = 1.0; time_cam < 1.0 + time_total; time_cam += 1.0 / cam_hz) {
+
+    // Feed the IMU readings up to this camera time
+    while (time_imu <= time_cam) {
+      ov_core::ImuData imu;
+      imu.timestamp = time_imu;
+      imu.wm << 0.001 * noise(gen), 0.001 * noise(gen), 0.001 * noise(gen);
+      imu.am << 0.02 * noise(gen), 0.02 * noise(gen), 9.81 + 0.02 * noise(gen);
+      if (time_imu > 1.0 + time_stationary) {
+        imu.am += 5.0 * Eigen::Vector3d(noise(gen), noise(gen), noise(gen));
+      }
+      initializer.feed_imu(imu, time_imu - 3.0 * params.init_window_time);
+      time_imu += 1.0 / imu_hz;
+    }
+
+    // Feed the feature tracks
+    for (int i = 0; i < num_feats; i++) {
+      float u = (float)(uvs.at(i)(0) + 0.1 * noise(gen));
+      float v = (float)(uvs.at(i)(1) + 0.1 * noise(gen));
+      db->update_feature(i, time_cam, 0, u, v, u, v);
+    }
+
+    // Check the gate like VioManager::try_to_initialize() does
+    bool can_init = initializer.can_initialize(true);
+    if (time_cam < 1.0 + time_stationary) {
+      can_init_stationary = can_init_stationary || can_init;
+      max_meas = std::max(max_meas, count_measurements(db));
+    } else {
+      can_init_shaken = can_init_shaken || can_init;
+    }
+  }
+
+  // Report and check the results
+  PRINT_INFO("max feature measurements while stationary: %zu (window holds at most %zu)\n", max_meas, max_window_meas);
+  PRINT_INFO("gate allowed an attempt while stationary: %d, after being shaken: %d\n", (int)can_init_stationary, (int)can_init_shaken);
+  if (can_init_stationary) {
+    PRINT_ERROR(RED "gate allowed an attempt while stationary (no jerk yet)\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  if (max_meas > max_window_meas) {
+    PRINT_ERROR(RED "feature database grew past the init window while stationary (%zu > %zu)\n" RESET, max_meas, max_window_meas);
+    std::exit(EXIT_FAILURE);
+  }
+  if (!can_init_shaken) {
+    PRINT_ERROR(RED "gate never allowed an attempt after the jerk\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  PRINT_INFO(GREEN "initialization gate test passed\n" RESET);
+  return EXIT_SUCCESS;
+}
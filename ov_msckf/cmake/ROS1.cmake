@@ -62,6 +62,7 @@ if (NOT catkin_FOUND OR NOT ENABLE_ROS)
 
     message(STATUS "MANUALLY LINKING TO OV_CORE LIBRARY....")
     file(GLOB_RECURSE OVCORE_LIBRARY_SOURCES "${CMAKE_SOURCE_DIR}/../ov_core/src/*.cpp")
+    list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_cpi\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_profile\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_webcam\\.cpp$")
     list(FILTER OVCORE_LIBRARY_SOURCES EXCLUDE REGEX ".*test_tracking\\.cpp$")
@@ -83,6 +84,7 @@ if (NOT catkin_FOUND OR NOT ENABLE_ROS)
     file(GLOB_RECURSE OVINIT_LIBRARY_SOURCES "${CMAKE_SOURCE_DIR}/../ov_init/src/*.cpp")
     list(FILTER OVINIT_LIBRARY_SOURCES EXCLUDE REGEX ".*test_dynamic_init\\.cpp$")
     list(FILTER OVINIT_LIBRARY_SOURCES EXCLUDE REGEX ".*test_dynamic_mle\\.cpp$")
+    list(FILTER OVINIT_LIBRARY_SOURCES EXCLUDE REGEX ".*test_init_gate\\.cpp$")
     list(FILTER OVINIT_LIBRARY_SOURCES EXCLUDE REGEX ".*test_simulation\\.cpp$")
     list(FILTER OVINIT_LIBRARY_SOURCES EXCLUDE REGEX ".*Simulator\\.cpp$")
     list(APPEND LIBRARY_SOURCES ${OVINIT_LIBRARY_SOURCES})
@@ -111,9 +113,14 @@ list(APPEND LIBRARY_SOURCES
         src/sim/Simulator.cpp
         src/state/State.cpp
         src/state/StateHelper.cpp
+        src/state/SchmidtCalibration.cpp
+        src/state/WarmStart.cpp
         src/state/Propagator.cpp
         src/core/VioManager.cpp
         src/core/VioManagerHelper.cpp
+        src/core/CameraBuffer.cpp
+        src/core/FrameGovernor.cpp
+        src/core/InputRecorder.cpp
         src/update/UpdaterHelper.cpp
         src/update/UpdaterMSCKF.cpp
         src/update/UpdaterSLAM.cpp
@@ -178,6 +185,12 @@ else()
     add_executable(run_illixr_msckf src/run_illixr_msckf.cpp)
     target_link_libraries(run_illixr_msckf ov_msckf_lib ${thirdparty_libraries})
     set_property(TARGET run_illixr_msckf PROPERTY CXX_STANDARD 17)
+
+    add_executable(run_replay_msckf src/run_replay_msckf.cpp)
+    target_link_libraries(run_replay_msckf ov_msckf_lib ${thirdparty_libraries})
+
+    add_executable(run_sim_montecarlo src/run_sim_montecarlo.cpp)
+    target_link_libraries(run_sim_montecarlo ov_msckf_lib ${thirdparty_libraries})
 endif()
 
 if (ENABLE_TESTS)
@@ -196,4 +209,28 @@ if (ENABLE_TESTS)
             LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
             RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
     )
+
+    add_executable(test_benchmark src/test_benchmark.cpp)
+    target_link_libraries(test_benchmark ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_benchmark
+            ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+    )
+
+    add_executable(test_keyframes src/test_keyframes.cpp)
+    target_link_libraries(test_keyframes ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_keyframes
+            ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+    )
+
+    add_executable(test_state_covariance src/test_state_covariance.cpp)
+    target_link_libraries(test_state_covariance ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_state_covariance
+            ARCHIVE DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            LIBRARY DESTINATION ${CATKIN_PACKAGE_LIB_DESTINATION}
+            RUNTIME DESTINATION ${CATKIN_PACKAGE_BIN_DESTINATION}
+    )
 endif()
@@ -69,9 +69,14 @@ list(APPEND LIBRARY_SOURCES
         src/sim/Simulator.cpp
         src/state/State.cpp
         src/state/StateHelper.cpp
+        src/state/SchmidtCalibration.cpp
+        src/state/WarmStart.cpp
         src/state/Propagator.cpp
         src/core/VioManager.cpp
         src/core/VioManagerHelper.cpp
+        src/core/CameraBuffer.cpp
+        src/core/FrameGovernor.cpp
+        src/core/InputRecorder.cpp
         src/update/UpdaterHelper.cpp
         src/update/UpdaterMSCKF.cpp
         src/update/UpdaterSLAM.cpp
@@ -124,6 +129,12 @@ else()
     add_executable(run_illixr_msckf src/run_illixr_msckf.cpp)
     target_link_libraries(run_illixr_msckf ov_msckf_lib ${thirdparty_libraries})
     set_property(TARGET run_illixr_msckf PROPERTY CXX_STANDARD 17)
+
+    add_executable(run_replay_msckf src/run_replay_msckf.cpp)
+    target_link_libraries(run_replay_msckf ov_msckf_lib ${thirdparty_libraries})
+
+    add_executable(run_sim_montecarlo src/run_sim_montecarlo.cpp)
+    target_link_libraries(run_sim_montecarlo ov_msckf_lib ${thirdparty_libraries})
 endif()
 
 if (ENABLE_TESTS)
@@ -136,6 +147,21 @@ if (ENABLE_TESTS)
     ament_target_dependencies(test_sim_repeat ${ament_libraries})
     target_link_libraries(test_sim_repeat ov_msckf_lib ${thirdparty_libraries})
     install(TARGETS test_sim_repeat DESTINATION lib/${PROJECT_NAME})
+
+    add_executable(test_benchmark src/test_benchmark.cpp)
+    ament_target_dependencies(test_benchmark ${ament_libraries})
+    target_link_libraries(test_benchmark ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_benchmark DESTINATION lib/${PROJECT_NAME})
+
+    add_executable(test_keyframes src/test_keyframes.cpp)
+    ament_target_dependencies(test_keyframes ${ament_libraries})
+    target_link_libraries(test_keyframes ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_keyframes DESTINATION lib/${PROJECT_NAME})
+
+    add_executable(test_state_covariance src/test_state_covariance.cpp)
+    ament_target_dependencies(test_state_covariance ${ament_libraries})
+    target_link_libraries(test_state_covariance ov_msckf_lib ${thirdparty_libraries})
+    install(TARGETS test_state_covariance DESTINATION lib/${PROJECT_NAME})
 endif()
 
 # Install launch and config directories
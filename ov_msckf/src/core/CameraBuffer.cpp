@@ -0,0 +1,130 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "CameraBuffer.h"
+
+#include <algorithm>
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+CameraBuffer::CameraBuffer(int num_cameras, double latency_window, size_t max_size)
+    : num_cameras(num_cameras), latency_window(latency_window), max_size(max_size) {
+  time_newest_cam.resize((size_t)std::max(num_cameras, 1), -1);
+}
+
+bool CameraBuffer::push_camera(const ov_core::CameraData &message) {
+
+  // Split into single camera images, so each camera can be merged with others at the same time
+  std::lock_guard<std::mutex> lck(mtx);
+  bool all_added = true;
+  for (size_t i = 0; i < message.sensor_ids.size(); i++) {
+
+    // Drop if we have already processed a measurement at or after this time
+    // If its time was already released without this camera (i.e. it arrived after the latency window), then we can't use it either
+    if (message.timestamp <= time_last_pop) {
+      PRINT_WARNING(YELLOW "[BUFFER]: cam%d image at %.3f is too late (already processed %.3f), dropping it!\n" RESET,
+                    message.sensor_ids.at(i), message.timestamp, time_last_pop)
+      count_dropped++;
+      all_added = false;
+      continue;
+    }
+
+    // Our single camera measurement
+    ov_core::CameraData single;
+    single.timestamp = message.timestamp;
+    single.sensor_ids.push_back(message.sensor_ids.at(i));
+    single.images.push_back(message.images.at(i));
+    if (i < message.masks.size()) {
+      single.masks.push_back(message.masks.at(i));
+    } else {
+      single.masks.push_back(cv::Mat::zeros(message.images.at(i).rows, message.images.at(i).cols, CV_8UC1));
+    }
+
+    // Insert it in time order (ties are ordered by the camera id)
+    // If we already have this image then there is nothing to do
+    auto range = std::equal_range(queue.begin(), queue.end(), single);
+    if (range.first != range.second) {
+      continue;
+    }
+    queue.insert(range.second, single);
+
+    // Record how far along in time this camera is
+    size_t cam_id = (size_t)std::max(0, message.sensor_ids.at(i));
+    if (cam_id >= time_newest_cam.size()) {
+      time_newest_cam.resize(cam_id + 1, -1);
+    }
+    time_newest_cam.at(cam_id) = std::max(time_newest_cam.at(cam_id), message.timestamp);
+    time_newest = std::max(time_newest, message.timestamp);
+  }
+
+  // Bound our size, dropping the oldest measurements
+  while (queue.size() > max_size) {
+    PRINT_WARNING(YELLOW "[BUFFER]: buffer is full (%zu images), dropping cam%d image at %.3f!\n" RESET, max_size,
+                  queue.front().sensor_ids.at(0), queue.front().timestamp)
+    time_last_pop = std::max(time_last_pop, queue.front().timestamp);
+    queue.pop_front();
+    count_dropped++;
+  }
+  return all_added;
+}
+
+void CameraBuffer::push_imu(double timestamp_inC) {
+  std::lock_guard<std::mutex> lck(mtx);
+  time_newest_imu = std::max(time_newest_imu, timestamp_inC);
+}
+
+bool CameraBuffer::pop(ov_core::CameraData &message) {
+
+  // Nothing to do if we do not have any images
+  std::lock_guard<std::mutex> lck(mtx);
+  if (queue.empty())
+    return false;
+
+  // We need IMU past this image to be able to propagate to it
+  double timestamp = queue.front().timestamp;
+  if (time_newest_imu <= timestamp)
+    return false;
+
+  // Every camera needs to have reached this time, unless we have waited longer than our latency window
+  bool all_cameras_reached = true;
+  for (const auto &time_cam : time_newest_cam) {
+    all_cameras_reached = all_cameras_reached && (time_cam >= timestamp);
+  }
+  if (!all_cameras_reached && time_newest - timestamp < latency_window)
+    return false;
+
+  // Merge all images that are at this same time
+  message = ov_core::CameraData();
+  message.timestamp = timestamp;
+  while (!queue.empty() && queue.front().timestamp == timestamp) {
+    message.sensor_ids.push_back(queue.front().sensor_ids.at(0));
+    message.images.push_back(queue.front().images.at(0));
+    message.masks.push_back(queue.front().masks.at(0));
+    queue.pop_front();
+  }
+  time_last_pop = timestamp;
+  return true;
+}
@@ -0,0 +1,125 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OV_MSCKF_CAMERABUFFER_H
+#define OV_MSCKF_CAMERABUFFER_H
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "utils/sensor_data.h"
+
+namespace ov_msckf {
+
+/**
+ * @brief Bounded time-ordered buffer of camera measurements which can be fed asynchronously from each camera.
+ *
+ * Each camera can push its images as soon as they are available, from its own thread, without being synchronized with the others.
+ * The only assumption is that each individual camera delivers its own images in order.
+ * Images are kept sorted by time, and we only release the oldest once it is safe to process:
+ * - we have IMU measurements past its timestamp (so we can propagate to it), and
+ * - every camera has delivered an image at or after its timestamp (so nothing older can still arrive), or
+ * - we have waited for longer than our latency window (measured in image time) for the cameras which are behind.
+ *
+ * Images of different cameras with the same timestamp are merged into a single measurement, so synchronized stereo is still tracked
+ * as a stereo pair. If an image arrives after we have already released a newer one, then it is too late and is dropped.
+ * If the buffer grows past its max size (e.g. no IMU is coming in) the oldest measurements are dropped.
+ */
+class CameraBuffer {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param num_cameras Number of cameras we expect images from
+   * @param latency_window How long (seconds) we will wait for a camera that is behind before we process without it
+   * @param max_size Max number of images we will buffer
+   */
+  CameraBuffer(int num_cameras, double latency_window, size_t max_size = 100);
+
+  /**
+   * @brief Adds camera images to the buffer (thread safe)
+   * @param message Camera measurement, can contain one or multiple cameras
+   * @return False if the measurement was too late (at or before the last released time) and has been dropped
+   */
+  bool push_camera(const ov_core::CameraData &message);
+
+  /**
+   * @brief Records the newest IMU timestamp we have (thread safe)
+   * @param timestamp_inC Timestamp of the IMU measurement in the camera clock
+   */
+  void push_imu(double timestamp_inC);
+
+  /**
+   * @brief Gets the oldest measurement which is safe to process (thread safe)
+   * @param message Measurement with all cameras which have an image at its timestamp
+   * @return True if we have a measurement to process
+   */
+  bool pop(ov_core::CameraData &message);
+
+  /// Number of images currently in the buffer
+  size_t size() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return queue.size();
+  }
+
+  /// Number of images which have been dropped since they were too late or the buffer was full
+  int num_dropped() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return count_dropped;
+  }
+
+protected:
+  /// Number of cameras
+  int num_cameras;
+
+  /// Time we will wait for cameras which are behind (seconds)
+  double latency_window;
+
+  /// Max number of images we will buffer
+  size_t max_size;
+
+  /// Mutex for our buffer
+  std::mutex mtx;
+
+  /// Single camera images sorted by their timestamp
+  std::deque<ov_core::CameraData> queue;
+
+  /// Newest timestamp each camera has delivered
+  std::vector<double> time_newest_cam;
+
+  /// Newest image timestamp of all cameras
+  double time_newest = -1;
+
+  /// Newest IMU timestamp (in the camera clock)
+  double time_newest_imu = -1;
+
+  /// Timestamp of the last measurement we have released
+  double time_last_pop = -1;
+
+  /// Number of dropped images
+  int count_dropped = 0;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_CAMERABUFFER_H
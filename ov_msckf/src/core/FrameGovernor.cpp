@@ -0,0 +1,74 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "FrameGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ov_msckf;
+
+FrameGovernor::FrameGovernor(double budget_ms, double min_scale, double relax_ratio, int relax_frames, double relax_step)
+    : _budget_ms(budget_ms), _min_scale(std::min(std::max(min_scale, 0.01), 1.0)), _relax_ratio(relax_ratio), _relax_frames(relax_frames),
+      _relax_step(relax_step) {}
+
+bool FrameGovernor::feed_frame_time(double time_track_ms, double time_filter_ms) {
+
+  // Nothing to do if we have no budget
+  double time_total_ms = time_track_ms + time_filter_ms;
+  if (_budget_ms <= 0.0 || time_total_ms <= 0.0)
+    return false;
+
+  // Over budget, shrink each stage by how much of the overshoot it is responsible for
+  // We never shrink by more than half in a single frame so one outlier doesn't throw everything away
+  double scale_tracking_old = _scale_tracking;
+  double scale_filter_old = _scale_filter;
+  if (time_total_ms > _budget_ms) {
+    _count_under = 0;
+    _num_frames_over++;
+    double overshoot = (time_total_ms - _budget_ms) / time_total_ms;
+    double share_tracking = time_track_ms / time_total_ms;
+    double share_filter = time_filter_ms / time_total_ms;
+    _scale_tracking *= std::max(0.5, 1.0 - overshoot * share_tracking);
+    _scale_filter *= std::max(0.5, 1.0 - overshoot * share_filter);
+    _scale_tracking = std::max(_scale_tracking, _min_scale);
+    _scale_filter = std::max(_scale_filter, _min_scale);
+  } else if (time_total_ms < _relax_ratio * _budget_ms && is_throttling()) {
+    // Under budget, slowly grow back after enough frames in a row
+    _count_under++;
+    if (_count_under >= _relax_frames) {
+      _count_under = 0;
+      _scale_tracking = std::min(1.0, _scale_tracking + _relax_step);
+      _scale_filter = std::min(1.0, _scale_filter + _relax_step);
+    }
+  } else {
+    // Inside the hysteresis band, hold our current scales
+    _count_under = 0;
+  }
+  return (_scale_tracking != scale_tracking_old || _scale_filter != scale_filter_old);
+}
+
+int FrameGovernor::scale_value(int value, double scale, int min_value) {
+  if (value <= min_value)
+    return value;
+  return std::max(min_value, (int)std::ceil(scale * (double)value));
+}
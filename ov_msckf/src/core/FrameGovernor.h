@@ -0,0 +1,110 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OV_MSCKF_FRAMEGOVERNOR_H
+#define OV_MSCKF_FRAMEGOVERNOR_H
+
+namespace ov_msckf {
+
+/**
+ * @brief Keeps the per-frame processing time under a budget by scaling down our compute knobs.
+ *
+ * After each frame we are given the time spent in tracking and in the filter (propagation, updates, and marginalization).
+ * If the frame went over budget, we shrink the scale of both stages (multiplicative decrease), shrinking the stage which took the larger
+ * share of the frame time more. Once we have been comfortably under budget for a number of frames in a row, we slowly grow the scales back
+ * (additive increase). The hysteresis between the two prevents us from oscillating around the budget.
+ *
+ * The scales are then used by the VioManager to reduce the number of tracked features and the number of features in each update.
+ * A scale of one means we are running with the configured values and are not throttling.
+ */
+class FrameGovernor {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param budget_ms Time budget for each frame in milliseconds
+   * @param min_scale Smallest scale we will shrink our knobs to (in the range (0,1])
+   * @param relax_ratio We are considered under budget if below this fraction of the budget
+   * @param relax_frames Number of frames in a row we need to be under budget before increasing the scales
+   * @param relax_step How much we increase the scales by once we have been under budget
+   */
+  FrameGovernor(double budget_ms, double min_scale, double relax_ratio = 0.8, int relax_frames = 10, double relax_step = 0.05);
+
+  /**
+   * @brief Given the timing of the last frame, will update our scales
+   * @param time_track_ms Time spent in tracking (milliseconds)
+   * @param time_filter_ms Time spent in the filter (milliseconds)
+   * @return True if the scales have changed and should be applied
+   */
+  bool feed_frame_time(double time_track_ms, double time_filter_ms);
+
+  /// Scale of the tracking knobs (i.e. number of tracked features)
+  double scale_tracking() const { return _scale_tracking; }
+
+  /// Scale of the filter knobs (i.e. number of features in each update)
+  double scale_filter() const { return _scale_filter; }
+
+  /// If we are currently running with less than the configured compute
+  bool is_throttling() const { return _scale_tracking < 1.0 || _scale_filter < 1.0; }
+
+  /// Number of frames which have gone over the budget
+  int num_frames_over() const { return _num_frames_over; }
+
+  /**
+   * @brief Helper which will scale a configured value
+   * @param value The configured value
+   * @param scale Scale we want to apply
+   * @param min_value We will never go below this (unless the configured value is smaller)
+   * @return Scaled value
+   */
+  static int scale_value(int value, double scale, int min_value);
+
+protected:
+  /// Frame time budget (ms)
+  double _budget_ms;
+
+  /// Smallest scale we will allow
+  double _min_scale;
+
+  /// Fraction of the budget we need to be under before we start to relax
+  double _relax_ratio;
+
+  /// Frames under budget before we relax
+  int _relax_frames;
+
+  /// Amount we increase the scales by each time we relax
+  double _relax_step;
+
+  /// Current scale of the tracking and filter
+  double _scale_tracking = 1.0;
+  double _scale_filter = 1.0;
+
+  /// Number of frames in a row we have been under the relax threshold
+  int _count_under = 0;
+
+  /// Total number of frames that went over budget
+  int _num_frames_over = 0;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_FRAMEGOVERNOR_H
@@ -0,0 +1,240 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "InputRecorder.h"
+
+#include <boost/filesystem.hpp>
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+using namespace ov_core;
+using namespace ov_msckf;
+
+namespace {
+
+/// Identifier at the start of our file, and version of the file layout
+const char INPUT_LOG_MAGIC[4] = {'O', 'V', 'I', 'R'};
+const uint32_t INPUT_LOG_VERSION = 1;
+
+template <typename T> void write_pod(std::ofstream &file, const T &value) { file.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+
+template <typename T> bool read_pod(std::ifstream &file, T &value) {
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return (bool)file;
+}
+
+/// Writes the size and type of the image, followed by its raw pixels
+void write_mat(std::ofstream &file, const cv::Mat &mat) {
+  write_pod(file, (int32_t)mat.rows);
+  write_pod(file, (int32_t)mat.cols);
+  write_pod(file, (int32_t)mat.type());
+  size_t row_bytes = (size_t)mat.cols * mat.elemSize();
+  for (int r = 0; r < mat.rows; r++)
+    file.write(reinterpret_cast<const char *>(mat.ptr(r)), (std::streamsize)row_bytes);
+}
+
+bool read_mat(std::ifstream &file, cv::Mat &mat) {
+  int32_t rows, cols, type;
+  if (!read_pod(file, rows) || !read_pod(file, cols) || !read_pod(file, type) || rows < 0 || cols < 0)
+    return false;
+  mat = cv::Mat(rows, cols, type);
+  if (mat.total() > 0)
+    file.read(reinterpret_cast<char *>(mat.data), (std::streamsize)(mat.total() * mat.elemSize()));
+  return (bool)file;
+}
+
+} // namespace
+
+InputRecorder::InputRecorder(const std::string &filepath, bool features_only) : _features_only(features_only) {
+
+  // Open our file
+  boost::filesystem::path p(filepath);
+  if (p.has_parent_path())
+    boost::filesystem::create_directories(p.parent_path());
+  _file.open(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!_file.is_open()) {
+    PRINT_ERROR(RED "[RECORD]: unable to open %s for writing\n" RESET, filepath.c_str())
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Header
+  _file.write(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC));
+  write_pod(_file, INPUT_LOG_VERSION);
+  _file.flush();
+  PRINT_INFO("[RECORD]: recording imu and %s to %s\n", (_features_only) ? "feature observations" : "camera images", filepath.c_str())
+}
+
+InputRecorder::~InputRecorder() {
+  std::lock_guard<std::mutex> lck(_mtx);
+  _file.close();
+}
+
+void InputRecorder::record_imu(const ov_core::ImuData &message) {
+  std::lock_guard<std::mutex> lck(_mtx);
+  write_pod(_file, (uint8_t)InputRecord::IMU);
+  write_pod(_file, message.timestamp);
+  for (int i = 0; i < 3; i++)
+    write_pod(_file, message.wm(i));
+  for (int i = 0; i < 3; i++)
+    write_pod(_file, message.am(i));
+}
+
+void InputRecorder::record_camera(const ov_core::CameraData &message) {
+  std::lock_guard<std::mutex> lck(_mtx);
+  write_pod(_file, (uint8_t)InputRecord::CAMERA);
+  write_pod(_file, message.timestamp);
+  write_pod(_file, (uint32_t)message.sensor_ids.size());
+  for (size_t i = 0; i < message.sensor_ids.size(); i++) {
+    write_pod(_file, (int32_t)message.sensor_ids.at(i));
+    write_mat(_file, message.images.at(i));
+    // Masks are almost always empty, so only store them if something is masked
+    bool has_mask = (i < message.masks.size() && !message.masks.at(i).empty() && cv::countNonZero(message.masks.at(i)) > 0);
+    write_pod(_file, (uint8_t)has_mask);
+    if (has_mask)
+      write_mat(_file, message.masks.at(i));
+  }
+  // Flush on each image so that a killed process still leaves us a usable log
+  _file.flush();
+}
+
+void InputRecorder::record_features(double timestamp, const std::vector<int> &camids,
+                                    const std::unordered_map<size_t, std::vector<cv::KeyPoint>> &obs,
+                                    const std::unordered_map<size_t, std::vector<size_t>> &ids) {
+  std::lock_guard<std::mutex> lck(_mtx);
+  write_pod(_file, (uint8_t)InputRecord::FEATURES);
+  write_pod(_file, timestamp);
+  write_pod(_file, (uint32_t)camids.size());
+  for (auto const &camid : camids) {
+    write_pod(_file, (int32_t)camid);
+    if (obs.find((size_t)camid) == obs.end() || ids.find((size_t)camid) == ids.end()) {
+      write_pod(_file, (uint32_t)0);
+      continue;
+    }
+    const std::vector<cv::KeyPoint> &pts = obs.at((size_t)camid);
+    const std::vector<size_t> &pts_ids = ids.at((size_t)camid);
+    assert(pts.size() == pts_ids.size());
+    write_pod(_file, (uint32_t)pts.size());
+    for (size_t i = 0; i < pts.size(); i++) {
+      write_pod(_file, (uint64_t)pts_ids.at(i));
+      write_pod(_file, (float)pts.at(i).pt.x);
+      write_pod(_file, (float)pts.at(i).pt.y);
+    }
+  }
+  _file.flush();
+}
+
+InputReader::InputReader(const std::string &filepath) {
+
+  // Open our file
+  _file.open(filepath, std::ios::in | std::ios::binary);
+  if (!_file.is_open()) {
+    PRINT_ERROR(RED "[REPLAY]: unable to open %s\n" RESET, filepath.c_str())
+    return;
+  }
+
+  // Header
+  char magic[4];
+  uint32_t version;
+  _file.read(magic, sizeof(magic));
+  if (!_file || std::string(magic, 4) != std::string(INPUT_LOG_MAGIC, 4) || !read_pod(_file, version) || version != INPUT_LOG_VERSION) {
+    PRINT_ERROR(RED "[REPLAY]: %s is not a valid input log\n" RESET, filepath.c_str())
+    return;
+  }
+  _valid = true;
+}
+
+bool InputReader::next(InputRecord &record) {
+
+  // Type of the next record
+  uint8_t type;
+  if (!_valid || !read_pod(_file, type))
+    return false;
+
+  // IMU
+  if (type == InputRecord::IMU) {
+    record.type = InputRecord::IMU;
+    if (!read_pod(_file, record.imu.timestamp))
+      return false;
+    for (int i = 0; i < 3; i++)
+      read_pod(_file, record.imu.wm(i));
+    for (int i = 0; i < 3; i++)
+      read_pod(_file, record.imu.am(i));
+    return (bool)_file;
+  }
+
+  // Camera images and masks
+  if (type == InputRecord::CAMERA) {
+    record.type = InputRecord::CAMERA;
+    record.camera = ov_core::CameraData();
+    uint32_t num_cam;
+    if (!read_pod(_file, record.camera.timestamp) || !read_pod(_file, num_cam))
+      return false;
+    for (uint32_t i = 0; i < num_cam; i++) {
+      int32_t camid;
+      uint8_t has_mask;
+      cv::Mat image, mask;
+      if (!read_pod(_file, camid) || !read_mat(_file, image) || !read_pod(_file, has_mask))
+        return false;
+      if (has_mask && !read_mat(_file, mask))
+        return false;
+      if (!has_mask)
+        mask = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
+      record.camera.sensor_ids.push_back(camid);
+      record.camera.images.push_back(image);
+      record.camera.masks.push_back(mask);
+    }
+    return true;
+  }
+
+  // Feature observations
+  if (type == InputRecord::FEATURES) {
+    record.type = InputRecord::FEATURES;
+    record.feats_camids.clear();
+    record.feats.clear();
+    uint32_t num_cam;
+    if (!read_pod(_file, record.feats_timestamp) || !read_pod(_file, num_cam))
+      return false;
+    for (uint32_t i = 0; i < num_cam; i++) {
+      int32_t camid;
+      uint32_t num_feats;
+      if (!read_pod(_file, camid) || !read_pod(_file, num_feats))
+        return false;
+      std::vector<std::pair<size_t, Eigen::VectorXf>> feats;
+      feats.reserve(num_feats);
+      for (uint32_t f = 0; f < num_feats; f++) {
+        uint64_t id;
+        Eigen::VectorXf uv = Eigen::VectorXf::Zero(2);
+        if (!read_pod(_file, id) || !read_pod(_file, uv(0)) || !read_pod(_file, uv(1)))
+          return false;
+        feats.emplace_back((size_t)id, uv);
+      }
+      record.feats_camids.push_back(camid);
+      record.feats.push_back(feats);
+    }
+    return true;
+  }
+
+  // Unknown record, we can not know how large it is so we need to stop
+  PRINT_ERROR(RED "[REPLAY]: unknown record type %d in the input log, stopping\n" RESET, (int)type)
+  _valid = false;
+  return false;
+}
@@ -0,0 +1,153 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_INPUTRECORDER_H
+#define OV_MSCKF_INPUTRECORDER_H
+
+#include <Eigen/Eigen>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/sensor_data.h"
+
+namespace ov_msckf {
+
+/**
+ * @brief Single record of an input log written by InputRecorder.
+ *
+ * Depending on the type only one of the measurement is valid.
+ * Feature observations are the raw (distorted) pixel coordinates of each tracked feature, in the same format which
+ * VioManager::feed_measurement_simulation() takes.
+ */
+struct InputRecord {
+
+  /// What type of measurement this record is
+  enum Type { IMU = 0, CAMERA = 1, FEATURES = 2 };
+
+  /// Type of this record
+  Type type = IMU;
+
+  /// IMU measurement (if IMU)
+  ov_core::ImuData imu;
+
+  /// Camera images and masks (if CAMERA)
+  ov_core::CameraData camera;
+
+  /// Timestamp of the feature observations (if FEATURES)
+  double feats_timestamp = -1;
+
+  /// Camera ids of the feature observations (if FEATURES)
+  std::vector<int> feats_camids;
+
+  /// Feature id and raw uv observation for each camera (if FEATURES)
+  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> feats;
+};
+
+/**
+ * @brief Records the measurements given to VioManager into an append-only binary log.
+ *
+ * This captures exactly what the estimator was fed, in the order it was fed, so that a run can be replayed later
+ * without the original dataset (see run_replay_msckf). We can either record the full camera images (and masks),
+ * or only the feature observations the tracker extracted from them, which is orders of magnitude smaller and allows
+ * replaying logs from devices where we did not want to save the raw video.
+ *
+ * The log starts with a small header, followed by records which are a one byte type and their payload.
+ * Images are stored raw (masks only if they have any masked pixel), features as their id and raw uv pixel.
+ * Since we only append, a log which was cut short (e.g. the process was killed) is still valid up to its last full record.
+ */
+class InputRecorder {
+
+public:
+  /**
+   * @brief Opens the log for writing
+   * @param filepath File we will write into (overwritten if it exists)
+   * @param features_only If we should record the tracked features instead of the camera images
+   */
+  InputRecorder(const std::string &filepath, bool features_only);
+
+  ~InputRecorder();
+
+  /// If we are recording feature observations instead of the camera images
+  bool features_only() const { return _features_only; }
+
+  /// Records an IMU measurement (thread safe)
+  void record_imu(const ov_core::ImuData &message);
+
+  /// Records a camera measurement, images and masks (thread safe)
+  void record_camera(const ov_core::CameraData &message);
+
+  /**
+   * @brief Records the feature observations the tracker has in the last image of each camera (thread safe)
+   * @param timestamp Timestamp of the camera measurement which was tracked
+   * @param camids Cameras which were in the measurement
+   * @param obs Last raw observations of each camera (from TrackBase::get_last_obs())
+   * @param ids Last feature ids of each camera (from TrackBase::get_last_ids())
+   */
+  void record_features(double timestamp, const std::vector<int> &camids, const std::unordered_map<size_t, std::vector<cv::KeyPoint>> &obs,
+                       const std::unordered_map<size_t, std::vector<size_t>> &ids);
+
+protected:
+  /// If we are recording feature observations instead of the camera images
+  bool _features_only;
+
+  /// Our output file
+  std::ofstream _file;
+
+  /// Mutex since IMU and cameras can be fed from different threads
+  std::mutex _mtx;
+};
+
+/**
+ * @brief Reads an input log written by InputRecorder, one record at a time.
+ */
+class InputReader {
+
+public:
+  /**
+   * @brief Opens the log for reading
+   * @param filepath File we will read
+   */
+  explicit InputReader(const std::string &filepath);
+
+  /// If the log was opened and has a valid header
+  bool is_open() const { return _valid; }
+
+  /**
+   * @brief Reads the next record of the log
+   * @param record Record we will read into
+   * @return False if we have reached the end of the log (or a record which was cut short)
+   */
+  bool next(InputRecord &record);
+
+protected:
+  /// Our input file
+  std::ifstream _file;
+
+  /// If the header was valid
+  bool _valid = false;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_INPUTRECORDER_H
@@ -33,16 +33,23 @@
 #include "utils/opencv_lambda_body.h"
 #include "utils/print.h"
 #include "utils/sensor_data.h"
+#include "utils/trace.h"
 
 #include "init/InertialInitializer.h"
 
 #include "state/Propagator.h"
+#include "state/SchmidtCalibration.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
+#include "state/WarmStart.h"
 #include "update/UpdaterMSCKF.h"
 #include "update/UpdaterSLAM.h"
 #include "update/UpdaterZeroVelocity.h"
 
+#include "CameraBuffer.h"
+#include "FrameGovernor.h"
+#include "InputRecorder.h"
+
 using namespace ov_core;
 using namespace ov_type;
 using namespace ov_msckf;
@@ -97,6 +104,25 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
     state->_calib_IMUtoCAM.at(i)->set_fej(params.camera_extrinsics.at(i));
   }
 
+  // If we have a saved calibration from a previous run, then start from it
+  // Its biases are a better initial guess for our initializer than zero
+  // The initializer has its own copy of the camera calibration, so it also needs to be given the saved one
+  if (!params.warm_start_load_filepath.empty()) {
+    warmstart = WarmStart::load(params.warm_start_load_filepath);
+    if (warmstart != nullptr && warmstart->apply_calibration(state)) {
+      params.init_options.init_dyn_bias_g = warmstart->bias_g;
+      params.init_options.init_dyn_bias_a = warmstart->bias_a;
+      params.init_options.calib_camimu_dt = state->_calib_dt_CAMtoIMU->value()(0);
+      for (int i = 0; i < state->_options.num_cameras; i++) {
+        if (params.init_options.camera_intrinsics.find(i) != params.init_options.camera_intrinsics.end())
+          params.init_options.camera_intrinsics.at(i)->set_value(state->_cam_intrinsics.at(i)->value());
+        params.init_options.camera_extrinsics[i] = state->_calib_IMUtoCAM.at(i)->value();
+      }
+    } else {
+      warmstart = nullptr;
+    }
+  }
+
   //===================================================================================
   //===================================================================================
   //===================================================================================
@@ -121,6 +147,12 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
     of_statistics << "re-tri & marg,total" << std::endl;
   }
 
+  // If we are recording a trace, then start it
+  if (!params.record_trace_filepath.empty()) {
+    is_tracing = Tracer::start(params.record_trace_filepath);
+    Tracer::set_thread_name("estimator");
+  }
+
   //===================================================================================
   //===================================================================================
   //===================================================================================
@@ -136,13 +168,26 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
   } else {
     trackFEATS = std::shared_ptr<TrackBase>(new TrackDescriptor(
         state->_cam_intrinsics_cameras, init_max_features, state->_options.max_aruco_features, params.use_stereo, params.histogram_method,
-        params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist, params.knn_ratio));
+        params.fast_threshold, params.grid_x, params.grid_y, params.min_px_dist, params.knn_ratio, params.desc_search_radius));
+  }
+
+  // Set which cameras are stereo pairs, and how the features should be split between cameras
+  std::vector<std::pair<size_t, size_t>> stereo_pairs;
+  for (size_t i = 0; i + 1 < params.stereo_pairs.size(); i += 2) {
+    stereo_pairs.emplace_back((size_t)params.stereo_pairs.at(i), (size_t)params.stereo_pairs.at(i + 1));
+  }
+  trackFEATS->set_stereo_pairs(stereo_pairs);
+  std::map<size_t, double> feature_weights;
+  for (size_t i = 0; i < params.cam_feat_weights.size() && (int)i < params.state_options.num_cameras; i++) {
+    feature_weights.insert({i, params.cam_feat_weights.at(i)});
   }
+  trackFEATS->set_feature_weights(feature_weights);
 
   // Initialize our aruco tag extractor
   if (params.use_aruco) {
     trackARUCO = std::shared_ptr<TrackBase>(new TrackAruco(state->_cam_intrinsics_cameras, state->_options.max_aruco_features,
-                                                           params.use_stereo, params.histogram_method, params.downsize_aruco));
+                                                           params.use_stereo, params.histogram_method, params.downsize_aruco,
+                                                           params.aruco_full_scan_period));
   }
 
   // Initialize our state propagator
@@ -161,6 +206,28 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
                                                         propagator, params.gravity_mag, params.zupt_max_velocity,
                                                         params.zupt_noise_multiplier, params.zupt_max_disparity);
   }
+
+  // If we have a frame budget, then create our governor
+  if (params.frame_budget_ms > 0.0) {
+    governor = std::make_shared<FrameGovernor>(params.frame_budget_ms, params.frame_budget_min_scale);
+  }
+
+  // If we want to accept images from each camera asynchronously, then create our buffer
+  if (params.camera_latency_window > 0.0) {
+    camera_buffer = std::make_shared<CameraBuffer>(state->_options.num_cameras, params.camera_latency_window,
+                                                   (size_t)std::max(params.camera_buffer_size, 1));
+  }
+
+  // If we want to record our input, then open our log
+  if (!params.record_input_filepath.empty()) {
+    recorder = std::make_shared<InputRecorder>(params.record_input_filepath, params.record_input_features_only);
+  }
+
+  // If we want to stop correcting calibration once it has converged
+  if (state->_options.use_schmidt_calib) {
+    schmidt = std::make_shared<SchmidtCalibration>(state->_options.schmidt_calib_window, state->_options.schmidt_calib_std_ratio,
+                                                   state->_options.schmidt_calib_nis_thresh);
+  }
     // Init timing info
     total_images = 0;
     total_tracking_time = 0.0;
@@ -168,11 +235,41 @@ VioManager::VioManager(VioManagerOptions &params_) : thread_init_running(false),
     total_frame_time = 0.0;
 }
 
+VioManager::~VioManager() {
+  {
+    std::lock_guard<std::mutex> lck(thread_init_mtx);
+    thread_init_exit = true;
+  }
+  thread_init_cv.notify_all();
+  if (thread_init.joinable()) {
+    thread_init.join();
+  }
+  if (!params.warm_start_save_filepath.empty()) {
+    save_warm_start(params.warm_start_save_filepath);
+  }
+  if (is_tracing) {
+    Tracer::stop();
+  }
+}
+
+bool VioManager::save_warm_start(const std::string &filepath) {
+  if (!is_initialized_vio) {
+    PRINT_WARNING(YELLOW "[WARM-START]: not initialized, not saving our calibration\n" RESET)
+    return false;
+  }
+  return WarmStart::save(state, filepath);
+}
+
 void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
 
+  // Record it before we do anything, so the log has exactly what we were fed
+  if (recorder != nullptr) {
+    recorder->record_imu(message);
+  }
+
   // The oldest time we need IMU with is the last clone
   // We shouldn't really need the whole window, but if we go backwards in time we will
-  double oldest_time = state->margtimestep();
+  double oldest_time = state->oldesttimestep();
   if (oldest_time > state->_timestamp) {
     oldest_time = -1;
   }
@@ -191,6 +288,53 @@ void VioManager::feed_measurement_imu(const ov_core::ImuData &message) {
   if (is_initialized_vio && updaterZUPT != nullptr && (!params.zupt_only_at_beginning || !has_moved_since_zupt)) {
     updaterZUPT->feed_imu(message, oldest_time);
   }
+
+  // Images up to this time can now be propagated to, so process any that are waiting in our buffer
+  if (camera_buffer != nullptr) {
+    camera_buffer->push_imu(message.timestamp - state->_calib_dt_CAMtoIMU->value()(0));
+    process_camera_buffer();
+  }
+}
+
+void VioManager::feed_measurement_camera(const ov_core::CameraData &message) {
+
+  // Record the images (if we are recording features, then we record them after tracking)
+  if (recorder != nullptr && !recorder->features_only()) {
+    recorder->record_camera(message);
+  }
+
+  // Directly process it if we are not buffering
+  if (camera_buffer == nullptr) {
+    track_image_and_update(message);
+    return;
+  }
+
+  // Else add it to our buffer, and process what is ready
+  camera_buffer->push_camera(message);
+  process_camera_buffer();
+}
+
+void VioManager::process_camera_buffer() {
+
+  // If another thread is processing the buffer, then we just flag that there might be more to do and it will process it
+  // We check this flag after unlocking, so a frame which became ready while we were processing is never left waiting
+  camera_buffer_pending = true;
+  while (camera_buffer_pending) {
+    std::unique_lock<std::mutex> lck(camera_buffer_process_mtx, std::try_to_lock);
+    if (!lck.owns_lock())
+      return;
+    camera_buffer_pending = false;
+    ov_core::CameraData message;
+    while (camera_buffer->pop(message)) {
+      // The buffer merges all images at the same time, so one at our state time is a late image we have already processed
+      if (is_initialized_vio && message.timestamp <= state->_timestamp) {
+        PRINT_WARNING(YELLOW "[BUFFER]: image at %.3f is not after our state time %.3f, dropping it!\n" RESET, message.timestamp,
+                      state->_timestamp)
+        continue;
+      }
+      track_image_and_update(message);
+    }
+  }
 }
 
 void VioManager::feed_measurement_simulation(double timestamp, const std::vector<int> &camids,
@@ -198,6 +342,7 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
 
   // Start timing
   rT1 = boost::posix_time::microsec_clock::local_time();
+  Tracer::set_frame(++trace_frame_id);
 
   // Check if we actually have a simulated tracker
   // If not, recreate and re-cast the tracker to our simulation tracker
@@ -233,18 +378,11 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
       propagator->clean_old_imu_measurements(timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
       updaterZUPT->clean_old_imu_measurements(timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
       propagator->invalidate_cache();
+      apply_frame_governor();
       return;
     }
   }
 
-  // If we do not have VIO initialization, then return an error
-  if (!is_initialized_vio) {
-    PRINT_ERROR(RED "[SIM]: your vio system should already be initialized before simulating features!!!\n" RESET)
-    PRINT_ERROR(RED "[SIM]: initialize your system first before calling feed_measurement_simulation()!!!!\n" RESET)
-    std::exit(EXIT_FAILURE);
-  }
-
-  // Call on our propagate and update function
   // Simulation is either all sync, or single camera...
   ov_core::CameraData message;
   message.timestamp = timestamp;
@@ -255,13 +393,27 @@ void VioManager::feed_measurement_simulation(double timestamp, const std::vector
     message.images.push_back(cv::Mat::zeros(cv::Size(width, height), CV_8UC1));
     message.masks.push_back(cv::Mat::zeros(cv::Size(width, height), CV_8UC1));
   }
+
+  // If we do not have VIO initialization, then try to initialize from the features
+  // The simulator initializes from groundtruth, so this only happens when replaying recorded feature observations
+  if (!is_initialized_vio) {
+    is_initialized_vio = try_to_initialize(message);
+    if (!is_initialized_vio) {
+      return;
+    }
+  }
+
+  // Call on our propagate and update function
+  // Then adjust how much work we will do next frame (also if the update returned early)
   do_feature_propagate_update(message);
+  apply_frame_governor();
 }
 
 void VioManager::track_image_and_update(const ov_core::CameraData &message_const) {
 
   // Start timing
   rT1 = boost::posix_time::microsec_clock::local_time();
+  Tracer::set_frame(++trace_frame_id);
 
   // Assert we have valid measurement data and ids
   assert(!message_const.sensor_ids.empty());
@@ -282,8 +434,26 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
     message.masks.at(i) = mask_temp;
   }
 
+  // If our descriptor tracker is doing guided matching, give it the rotation since the last image
+  // This is predicted from the current state estimate and the gyroscope readings up to this image
+  std::shared_ptr<TrackDescriptor> trackDESC = std::dynamic_pointer_cast<TrackDescriptor>(trackFEATS);
+  if (is_initialized_vio && trackDESC != nullptr && params.desc_search_radius > 0 && state->_timestamp < message.timestamp) {
+    Eigen::Matrix<double, 13, 1> state_plus = Eigen::Matrix<double, 13, 1>::Zero();
+    Eigen::Matrix<double, 12, 12> cov_plus = Eigen::Matrix<double, 12, 12>::Zero();
+    if (propagator->fast_state_propagate(state, message.timestamp, state_plus, cov_plus)) {
+      Eigen::Matrix3d R_I0toI1 = quat_2_Rot(state_plus.block(0, 0, 4, 1)) * state->_imu->Rot().transpose();
+      for (auto const &cam_id : message.sensor_ids) {
+        Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(cam_id)->Rot();
+        trackDESC->set_rotation_prior(cam_id, R_ItoC * R_I0toI1 * R_ItoC.transpose());
+      }
+    }
+  }
+
   // Perform our feature tracking!
   trackFEATS->feed_new_camera(message);
+  if (recorder != nullptr && recorder->features_only()) {
+    recorder->record_features(message.timestamp, message.sensor_ids, trackFEATS->get_last_obs(), trackFEATS->get_last_ids());
+  }
 
   // If the aruco tracker is available, the also pass to it
   // NOTE: binocular tracking for aruco doesn't make sense as we by default have the ids
@@ -306,6 +476,7 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
       propagator->clean_old_imu_measurements(message.timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
       updaterZUPT->clean_old_imu_measurements(message.timestamp + state->_calib_dt_CAMtoIMU->value()(0) - 0.10);
       propagator->invalidate_cache();
+      apply_frame_governor();
       return;
     }
   }
@@ -313,6 +484,9 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
   // If we do not have VIO initialization, then try to initialize
   // TODO: Or if we are trying to reset the system, then do that here!
   if (!is_initialized_vio) {
+    if (Tracer::enabled()) {
+      Tracer::record_stages("vio", nullptr, {"tracking"}, {rT1, rT2});
+    }
     is_initialized_vio = try_to_initialize(message);
     if (!is_initialized_vio) {
       double time_track = (rT2 - rT1).total_microseconds() * 1e-6;
@@ -322,7 +496,9 @@ void VioManager::track_image_and_update(const ov_core::CameraData &message_const
   }
 
   // Call on our propagate and update function
+  // Then adjust how much work we will do next frame (also if the update returned early)
   do_feature_propagate_update(message);
+  apply_frame_governor();
 }
 
 void VioManager::do_feature_propagate_update(const ov_core::CameraData &message) {
@@ -364,6 +540,9 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   }
   has_moved_since_zupt = true;
 
+  // If we are using keyframes, see if the clone before the newest is redundant and should be marginalized instead of the oldest
+  select_marg_clone();
+
   //===================================================================================
   // MSCKF features and KLT tracks that are SLAM features
   //===================================================================================
@@ -374,7 +553,9 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   feats_lost = trackFEATS->get_feature_database()->features_not_containing_newer(state->_timestamp, false, true);
 
   // Don't need to get the oldest features until we reach our max number of clones
-  if ((int)state->_clones_IMU.size() > state->_options.max_clone_size || (int)state->_clones_IMU.size() > 5) {
+  // If we are marginalizing a redundant (non-keyframe) clone, then its measurements are just dropped and we keep the oldest clone
+  bool marg_oldest = (state->margtimestep() == state->oldesttimestep());
+  if (marg_oldest && ((int)state->_clones_IMU.size() > state->_options.max_clone_size || (int)state->_clones_IMU.size() > 5)) {
     feats_marg = trackFEATS->get_feature_database()->features_containing(state->margtimestep(), false, true);
     if (trackARUCO != nullptr && message.timestamp - startup_time >= params.dt_slam_delay) {
       feats_slam = trackARUCO->get_feature_database()->features_containing(state->margtimestep(), false, true);
@@ -509,7 +690,6 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   //===================================================================================
 
   // Sort based on track length
-  // TODO: we should have better selection logic here (i.e. even feature distribution in the FOV etc..)
   // TODO: right now features that are "lost" are at the front of this vector, while ones at the end are long-tracks
   auto compare_feat = [](const std::shared_ptr<Feature> &a, const std::shared_ptr<Feature> &b) -> bool {
     size_t asize = 0;
@@ -523,10 +703,10 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   std::sort(featsup_MSCKF.begin(), featsup_MSCKF.end(), compare_feat);
 
   // Pass them to our MSCKF updater
-  // NOTE: if we have more then the max, we select the "best" ones (i.e. max tracks) for this update
+  // NOTE: if we have more then the max, we select the "best" ones (i.e. long, high parallax, and spread out tracks) for this update
   // NOTE: this should only really be used if you want to track a lot of features, or have limited computational resources
   if ((int)featsup_MSCKF.size() > state->_options.max_msckf_in_update)
-    featsup_MSCKF.erase(featsup_MSCKF.begin(), featsup_MSCKF.end() - state->_options.max_msckf_in_update);
+    select_features_msckf(featsup_MSCKF, state->_options.max_msckf_in_update);
   updaterMSCKF->update(state, featsup_MSCKF);
   propagator->invalidate_cache();
   rT4 = boost::posix_time::microsec_clock::local_time();
@@ -550,6 +730,9 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   feats_slam_UPDATE = feats_slam_UPDATE_TEMP;
   rT5 = boost::posix_time::microsec_clock::local_time();
   updaterSLAM->delayed_init(state, feats_slam_DELAYED);
+  if (schmidt != nullptr) {
+    schmidt->feed_update(state);
+  }
   rT6 = boost::posix_time::microsec_clock::local_time();
 
   //===================================================================================
@@ -590,11 +773,17 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   updaterSLAM->change_anchors(state);
 
   // Cleanup any features older than the marginalization time
-  if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
+  // If this is a redundant clone in the middle of our window, then only its measurements are removed
+  if ((int)state->_clones_IMU.size() > state->_options.max_clone_size && marg_oldest) {
     trackFEATS->get_feature_database()->cleanup_measurements(state->margtimestep());
     if (trackARUCO != nullptr) {
       trackARUCO->get_feature_database()->cleanup_measurements(state->margtimestep());
     }
+  } else if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
+    trackFEATS->get_feature_database()->cleanup_measurements_exact(state->margtimestep());
+    if (trackARUCO != nullptr) {
+      trackARUCO->get_feature_database()->cleanup_measurements_exact(state->margtimestep());
+    }
   }
 
   // Finally marginalize the oldest clone if needed
@@ -613,6 +802,21 @@ void VioManager::do_feature_propagate_update(const ov_core::CameraData &message)
   double time_slam_delay = (rT6 - rT5).total_microseconds() * 1e-3;
   double time_marg = (rT7 - rT6).total_microseconds() * 1e-3;
   double time_total = (rT7 - rT1).total_microseconds() * 1e-3;
+  if (Tracer::enabled()) {
+    std::pair<const char *, double> args[3] = {{"msckf_features", (double)featsup_MSCKF.size()},
+                                               {"slam_features", (double)state->_features_SLAM.size()},
+                                               {"clones", (double)state->_clones_IMU.size()}};
+    Tracer::record_stages("vio", "frame", {"tracking", "propagation", "msckf_update", "slam_update", "slam_delayed", "marginalization"},
+                          {rT1, rT2, rT3, rT4, rT5, rT6, rT7}, args, 3);
+  }
+  last_stage_times.timestamp = message.timestamp;
+  last_stage_times.tracking = time_track;
+  last_stage_times.propagation = time_prop;
+  last_stage_times.msckf_update = time_msckf;
+  last_stage_times.slam_update = time_slam_update;
+  last_stage_times.slam_delayed = time_slam_delay;
+  last_stage_times.marginalization = time_marg;
+  last_stage_times.total = time_total;
 
   // Timing information
   PRINT_DEBUG(BLUE "[TIME]: %.4f ms for tracking\n" RESET, time_track)
@@ -26,16 +26,19 @@
 #include <algorithm>
 #include <atomic>
 #include <boost/filesystem.hpp>
+#include <condition_variable>
 #include <fstream>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 
 #include "VioManagerOptions.h"
 
 namespace ov_core {
 struct ImuData;
 struct CameraData;
+class Feature;
 class TrackBase;
 class FeatureInitializer;
 } // namespace ov_core
@@ -51,6 +54,11 @@ class UpdaterMSCKF;
 class UpdaterSLAM;
 class UpdaterZeroVelocity;
 class Propagator;
+class FrameGovernor;
+class CameraBuffer;
+class SchmidtCalibration;
+class WarmStart;
+class InputRecorder;
 
 /**
  * @brief Core class that manages the entire system
@@ -68,6 +76,11 @@ public:
    */
   VioManager(VioManagerOptions &params_);
 
+  /**
+   * @brief Destructor, will save our calibration and biases if we have a warm start save path
+   */
+  ~VioManager();
+
   /**
    * @brief Feed function for inertial data
    * @param message Contains our timestamp and inertial information
@@ -77,8 +90,11 @@ public:
   /**
    * @brief Feed function for camera measurements
    * @param message Contains our timestamp, images, and camera ids
+   *
+   * If we have a camera latency window, then the images are buffered and processed in time order once it is safe to do so.
+   * In this case each camera can feed its images separately (and from its own thread) without being synchronized.
    */
-  void feed_measurement_camera(const ov_core::CameraData &message) { track_image_and_update(message); }
+  void feed_measurement_camera(const ov_core::CameraData &message);
   //!!!!! stereo/monocular
 
   /**
@@ -86,6 +102,8 @@ public:
    * @param timestamp Time that this image was collected
    * @param camids Camera ids that we have simulated measurements for
    * @param feats Raw uv simulated measurements
+   *
+   * If we have not been initialized yet (e.g. replaying recorded feature observations) we will try to initialize from them.
    */
   void feed_measurement_simulation(double timestamp, const std::vector<int> &camids,
                                    const std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> &feats);
@@ -96,12 +114,37 @@ public:
    */
   void initialize_with_gt(Eigen::Matrix<double, 17, 1> imustate);
 
+  /**
+   * @brief Saves the current calibration, its covariance, and the IMU biases so a later run can start from them
+   *
+   * This should be called from the thread which feeds our measurements (the state should not be updated while we save it).
+   *
+   * @param filepath File we will write into
+   * @return False if we are not initialized or could not write the file
+   */
+  bool save_warm_start(const std::string &filepath);
+
   /// If we are initialized or not
   bool initialized() { return is_initialized_vio && timelastupdate != -1; }
 
   /// Timestamp that the system was initialized at
   double initialized_time() { return startup_time; }
 
+  /// Time (milliseconds) each stage took to process a camera measurement
+  struct StageTimes {
+    double timestamp = -1;
+    double tracking = 0.0;
+    double propagation = 0.0;
+    double msckf_update = 0.0;
+    double slam_update = 0.0;
+    double slam_delayed = 0.0;
+    double marginalization = 0.0;
+    double total = 0.0;
+  };
+
+  /// Stage times of the last camera measurement we propagated and updated with (should be called from the thread feeding us)
+  StageTimes get_last_stage_times() { return last_stage_times; }
+
   /// Accessor for current system parameters
   VioManagerOptions get_params() { return params; }
 
@@ -166,6 +209,13 @@ protected:
    */
   bool try_to_initialize(const ov_core::CameraData &message);
 
+  /**
+   * @brief Runs a single attempt of our initializer, and sets up the state if it succeeded.
+   *
+   * This is run by our initialization thread (or directly if we are single threaded) and sets thread_init_running to false when done.
+   */
+  void run_initializer();
+
   /**
    * @brief This function will will re-triangulate all features in the current frame
    *
@@ -177,6 +227,48 @@ protected:
    */
   void retriangulate_active_tracks(const ov_core::CameraData &message);
 
+  /**
+   * @brief Selects the subset of MSCKF features which we expect to be the most informative.
+   *
+   * We use a cheap proxy of the information each feature will give: its track length scaled by the (rotation compensated) parallax between
+   * its first and last bearing. Features are then bucketed by their newest measurement into the same grid we use for extraction.
+   * We greedily take the best feature from each bucket, then the second best from each bucket, etc., until we have reached the max.
+   * This gives us the longest, highest parallax tracks while keeping an even distribution of features in the field of view.
+   * The selected features keep the same relative order they were given in.
+   *
+   * @param feats Features we could use in the update, will be reduced to the selected subset
+   * @param max_feats Max number of features we want to select
+   */
+  void select_features_msckf(std::vector<std::shared_ptr<ov_core::Feature>> &feats, int max_feats);
+
+  /**
+   * @brief Selects which clone should be marginalized when our window is full (if we are using keyframes).
+   *
+   * This gets the features seen in the clone before the newest and passes them to StateHelper::select_marg_clone().
+   * A redundant clone will be marginalized instead of the oldest one, and its feature measurements are dropped.
+   * Otherwise it is a keyframe and we will marginalize the oldest clone as normal.
+   */
+  void select_marg_clone();
+
+  /**
+   * @brief Feeds the timing of the frame which just finished to our governor, and applies its scales to our tracker and state options.
+   *
+   * This should be called on every path out of the frame once initialized (e.g. after a zero velocity update, or before we have enough
+   * clones), so that the governor sees every frame. Tracking is timed from rT1 to rT2, and the filter from rT2 until now.
+   * Nothing is done before we have initialized, as the initializer sets the number of features the tracker extracts.
+   * When throttling, the number of features we track and use in the MSCKF / SLAM updates is reduced from what was configured.
+   * Once we are back under budget these will be slowly restored to their configured values.
+   */
+  void apply_frame_governor();
+
+  /**
+   * @brief Processes all camera measurements in our buffer which are safe to process.
+   *
+   * Only one thread will process at a time, if another thread is already processing this returns right away.
+   * That thread (or the next call) will then process anything we have just added.
+   */
+  void process_camera_buffer();
+
   /// Manager parameters
   VioManagerOptions params;
 
@@ -207,6 +299,28 @@ protected:
   /// Our zero velocity tracker
   std::shared_ptr<UpdaterZeroVelocity> updaterZUPT;
 
+  /// Adjusts our feature counts and update sizes to stay under the frame budget (null if no budget)
+  std::shared_ptr<FrameGovernor> governor;
+
+  /// If the governor was throttling the last time its scales changed (so we only warn when it starts)
+  bool governor_throttling = false;
+
+  /// Switches converged calibration to Schmidt consider states (null if disabled)
+  std::shared_ptr<SchmidtCalibration> schmidt;
+
+  /// Calibration and biases from a previous run (null if we did a cold start)
+  std::shared_ptr<WarmStart> warmstart;
+
+  /// Records all measurements we are fed so they can be replayed (null if not recording)
+  std::shared_ptr<InputRecorder> recorder;
+
+  /// Time ordered buffer of camera measurements (null if we process images directly)
+  std::shared_ptr<CameraBuffer> camera_buffer;
+  std::mutex camera_buffer_process_mtx;
+
+  /// If the camera buffer might have images which are ready (set by every thread which feeds it)
+  std::atomic<bool> camera_buffer_pending{false};
+
   /// This is the queue of measurement times that have come in since we starting doing initialization
   /// After we initialize, we will want to prop & update to the latest timestamp quickly
   std::vector<double> camera_queue_init;
@@ -215,6 +329,11 @@ protected:
   // Timing statistic file and variables
   std::ofstream of_statistics;
   boost::posix_time::ptime rT1, rT2, rT3, rT4, rT5, rT6, rT7;
+  StageTimes last_stage_times;
+
+  // If we started the trace recording (so we should stop it) and the id of the current frame in the trace
+  bool is_tracing = false;
+  int64_t trace_frame_id = 0;
   unsigned total_images;
   double total_tracking_time;
   double total_filter_time;
@@ -230,6 +349,13 @@ protected:
   // Threads and their atomics
   std::atomic<bool> thread_init_running, thread_init_success;
 
+  // Thread which runs our initialization attempts, it waits until we request the next one (only used if we are multi-threaded)
+  std::thread thread_init;
+  std::mutex thread_init_mtx;
+  std::condition_variable thread_init_cv;
+  bool thread_init_requested = false;
+  bool thread_init_exit = false;
+
   // If we did a zero velocity update
   bool did_zupt_update = false;
   bool has_moved_since_zupt = false;
@@ -21,17 +21,21 @@
 
 #include "VioManager.h"
 
+#include "FrameGovernor.h"
+
 #include "feat/Feature.h"
 #include "feat/FeatureDatabase.h"
 #include "feat/FeatureInitializer.h"
 #include "types/LandmarkRepresentation.h"
 #include "utils/print.h"
+#include "utils/trace.h"
 
 #include "init/InertialInitializer.h"
 
 #include "state/Propagator.h"
 #include "state/State.h"
 #include "state/StateHelper.h"
+#include "state/WarmStart.h"
 
 using namespace ov_core;
 using namespace ov_type;
@@ -91,100 +95,135 @@ bool VioManager::try_to_initialize(const ov_core::CameraData &message) {
     return true;
   }
 
-  // Run the initialization in a second thread so it can go as slow as it desires
-  thread_init_running = true;
-  std::thread thread([&] {
-    // Returns from our initializer
-    double timestamp;
-    Eigen::MatrixXd covariance;
-    std::vector<std::shared_ptr<ov_type::Type>> order;
-    auto init_rT1 = boost::posix_time::microsec_clock::local_time();
-
-    // Try to initialize the system
-    // We will wait for a jerk if we do not have the zero velocity update enabled
-    // Otherwise we can initialize right away as the zero velocity will handle the stationary case
-    bool wait_for_jerk = (updaterZUPT == nullptr);
-    bool success = initializer->initialize(timestamp, covariance, order, state->_imu, wait_for_jerk);
-
-    // If we have initialized successfully we will set the covariance and state elements as needed
-    // TODO: set the clones and SLAM features here so we can start updating right away...
-    if (success) {
-
-      // Set our covariance (state should already be set in the initializer)
-      StateHelper::set_initial_covariance(state, covariance, order);
-
-      // Set the state time
-      state->_timestamp = timestamp;
-      startup_time = timestamp;
-
-      // Cleanup any features older than the initialization time
-      // Also increase the number of features to the desired amount during estimation
-      // NOTE: we will split the total number of features over all cameras uniformly
-      trackFEATS->get_feature_database()->cleanup_measurements(state->_timestamp);
-      trackFEATS->set_num_features(std::floor((double)params.num_pts / (double)params.state_options.num_cameras));
-      if (trackARUCO != nullptr) {
-        trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
-      }
+  // Skip the attempt if the initializer can already tell it will fail (e.g. no jerk yet or not enough rotation)
+  // This check is cheap while an attempt can take a long time, so we do not waste computation during long startup periods
+  bool wait_for_jerk = (updaterZUPT == nullptr);
+  if (!initializer->can_initialize(wait_for_jerk)) {
+    return false;
+  }
 
-      // If we are moving then don't do zero velocity update4
-      if (state->_imu->vel().norm() > params.zupt_max_velocity) {
-        has_moved_since_zupt = true;
-      }
+  // If we are single threaded, then run it directly
+  thread_init_running = true;
+  if (!params.use_multi_threading_subs) {
+    run_initializer();
+    return false;
+  }
 
-      // Else we are good to go, print out our stats
-      auto init_rT2 = boost::posix_time::microsec_clock::local_time();
-      PRINT_INFO(GREEN "[init]: successful initialization in %.4f seconds\n" RESET, (init_rT2 - init_rT1).total_microseconds() * 1e-6);
-      PRINT_INFO(GREEN "[init]: orientation = %.4f, %.4f, %.4f, %.4f\n" RESET, state->_imu->quat()(0), state->_imu->quat()(1),
-                 state->_imu->quat()(2), state->_imu->quat()(3));
-      PRINT_INFO(GREEN "[init]: bias gyro = %.4f, %.4f, %.4f\n" RESET, state->_imu->bias_g()(0), state->_imu->bias_g()(1),
-                 state->_imu->bias_g()(2));
-      PRINT_INFO(GREEN "[init]: velocity = %.4f, %.4f, %.4f\n" RESET, state->_imu->vel()(0), state->_imu->vel()(1), state->_imu->vel()(2));
-      PRINT_INFO(GREEN "[init]: bias accel = %.4f, %.4f, %.4f\n" RESET, state->_imu->bias_a()(0), state->_imu->bias_a()(1),
-                 state->_imu->bias_a()(2));
-      PRINT_INFO(GREEN "[init]: position = %.4f, %.4f, %.4f\n" RESET, state->_imu->pos()(0), state->_imu->pos()(1), state->_imu->pos()(2));
-
-      // Remove any camera times that are order then the initialized time
-      // This can happen if the initialization has taken a while to perform
-      std::lock_guard<std::mutex> lck(camera_queue_init_mtx);
-      std::vector<double> camera_timestamps_to_init;
-      for (size_t i = 0; i < camera_queue_init.size(); i++) {
-        if (camera_queue_init.at(i) > timestamp) {
-          camera_timestamps_to_init.push_back(camera_queue_init.at(i));
+  // Otherwise wake up our initialization thread so it runs in the background and can go as slow as it desires
+  // It is started on our first attempt and waits for the next request after each attempt
+  {
+    std::lock_guard<std::mutex> lck(thread_init_mtx);
+    thread_init_requested = true;
+    if (!thread_init.joinable()) {
+      thread_init = std::thread([this] {
+        Tracer::set_thread_name("initializer");
+        while (true) {
+          std::unique_lock<std::mutex> lck_thread(thread_init_mtx);
+          thread_init_cv.wait(lck_thread, [this] { return thread_init_requested || thread_init_exit; });
+          if (thread_init_exit) {
+            return;
+          }
+          thread_init_requested = false;
+          lck_thread.unlock();
+          run_initializer();
         }
-      }
+      });
+    }
+  }
+  thread_init_cv.notify_one();
+  return false;
+}
 
-      // Now we have initialized we will propagate the state to the current timestep
-      // In general this should be ok as long as the initialization didn't take too long to perform
-      // Propagating over multiple seconds will become an issue if the initial biases are bad
-      size_t clone_rate = (size_t)((double)camera_timestamps_to_init.size() / (double)params.state_options.max_clone_size) + 1;
-      for (size_t i = 0; i < camera_timestamps_to_init.size(); i += clone_rate) {
-        propagator->propagate_and_clone(state, camera_timestamps_to_init.at(i));
-        StateHelper::marginalize_old_clone(state);
-      }
-      PRINT_DEBUG(YELLOW "[init]: moved the state forward %.2f seconds\n" RESET, state->_timestamp - timestamp);
-      thread_init_success = true;
-      camera_queue_init.clear();
+void VioManager::run_initializer() {
+
+  // Returns from our initializer
+  double timestamp;
+  Eigen::MatrixXd covariance;
+  std::vector<std::shared_ptr<ov_type::Type>> order;
+  auto init_rT1 = boost::posix_time::microsec_clock::local_time();
+  TraceScope trace("init", "initialize");
+
+  // Try to initialize the system
+  // We will wait for a jerk if we do not have the zero velocity update enabled
+  // Otherwise we can initialize right away as the zero velocity will handle the stationary case
+  bool wait_for_jerk = (updaterZUPT == nullptr);
+  bool success = initializer->initialize(timestamp, covariance, order, state->_imu, wait_for_jerk);
+  trace.arg("success", success);
+  trace.end();
+
+  // If we have initialized successfully we will set the covariance and state elements as needed
+  // TODO: set the clones and SLAM features here so we can start updating right away...
+  if (success) {
+
+    // Set our covariance (state should already be set in the initializer)
+    // If we have a calibration from a previous run, then it also has a covariance we should start from
+    StateHelper::set_initial_covariance(state, covariance, order);
+    if (warmstart != nullptr) {
+      warmstart->apply_covariance(state);
+    }
 
-    } else {
-      auto init_rT2 = boost::posix_time::microsec_clock::local_time();
-      PRINT_DEBUG(YELLOW "[init]: failed initialization in %.4f seconds\n" RESET, (init_rT2 - init_rT1).total_microseconds() * 1e-6);
-      thread_init_success = false;
-      std::lock_guard<std::mutex> lck(camera_queue_init_mtx);
-      camera_queue_init.clear();
+    // Set the state time
+    state->_timestamp = timestamp;
+    startup_time = timestamp;
+
+    // Cleanup any features older than the initialization time
+    // Also increase the number of features to the desired amount during estimation
+    // NOTE: we will split the total number of features over all cameras uniformly
+    trackFEATS->get_feature_database()->cleanup_measurements(state->_timestamp);
+    trackFEATS->set_num_features(std::floor((double)params.num_pts / (double)params.state_options.num_cameras));
+    if (trackARUCO != nullptr) {
+      trackARUCO->get_feature_database()->cleanup_measurements(state->_timestamp);
     }
 
-    // Finally, mark that the thread has finished running
-    thread_init_running = false;
-  });
+    // If we are moving then don't do zero velocity update4
+    if (state->_imu->vel().norm() > params.zupt_max_velocity) {
+      has_moved_since_zupt = true;
+    }
+
+    // Else we are good to go, print out our stats
+    auto init_rT2 = boost::posix_time::microsec_clock::local_time();
+    PRINT_INFO(GREEN "[init]: successful initialization in %.4f seconds\n" RESET, (init_rT2 - init_rT1).total_microseconds() * 1e-6);
+    PRINT_INFO(GREEN "[init]: orientation = %.4f, %.4f, %.4f, %.4f\n" RESET, state->_imu->quat()(0), state->_imu->quat()(1),
+               state->_imu->quat()(2), state->_imu->quat()(3));
+    PRINT_INFO(GREEN "[init]: bias gyro = %.4f, %.4f, %.4f\n" RESET, state->_imu->bias_g()(0), state->_imu->bias_g()(1),
+               state->_imu->bias_g()(2));
+    PRINT_INFO(GREEN "[init]: velocity = %.4f, %.4f, %.4f\n" RESET, state->_imu->vel()(0), state->_imu->vel()(1), state->_imu->vel()(2));
+    PRINT_INFO(GREEN "[init]: bias accel = %.4f, %.4f, %.4f\n" RESET, state->_imu->bias_a()(0), state->_imu->bias_a()(1),
+               state->_imu->bias_a()(2));
+    PRINT_INFO(GREEN "[init]: position = %.4f, %.4f, %.4f\n" RESET, state->_imu->pos()(0), state->_imu->pos()(1), state->_imu->pos()(2));
+
+    // Remove any camera times that are order then the initialized time
+    // This can happen if the initialization has taken a while to perform
+    std::lock_guard<std::mutex> lck(camera_queue_init_mtx);
+    std::vector<double> camera_timestamps_to_init;
+    for (size_t i = 0; i < camera_queue_init.size(); i++) {
+      if (camera_queue_init.at(i) > timestamp) {
+        camera_timestamps_to_init.push_back(camera_queue_init.at(i));
+      }
+    }
+
+    // Now we have initialized we will propagate the state to the current timestep
+    // In general this should be ok as long as the initialization didn't take too long to perform
+    // Propagating over multiple seconds will become an issue if the initial biases are bad
+    size_t clone_rate = (size_t)((double)camera_timestamps_to_init.size() / (double)params.state_options.max_clone_size) + 1;
+    for (size_t i = 0; i < camera_timestamps_to_init.size(); i += clone_rate) {
+      propagator->propagate_and_clone(state, camera_timestamps_to_init.at(i));
+      StateHelper::marginalize_old_clone(state);
+    }
+    PRINT_DEBUG(YELLOW "[init]: moved the state forward %.2f seconds\n" RESET, state->_timestamp - timestamp);
+    thread_init_success = true;
+    camera_queue_init.clear();
 
-  // If we are single threaded, then run single threaded
-  // Otherwise detach this thread so it runs in the background!
-  if (!params.use_multi_threading_subs) {
-    thread.join();
   } else {
-    thread.detach();
+    auto init_rT2 = boost::posix_time::microsec_clock::local_time();
+    PRINT_DEBUG(YELLOW "[init]: failed initialization in %.4f seconds\n" RESET, (init_rT2 - init_rT1).total_microseconds() * 1e-6);
+    thread_init_success = false;
+    std::lock_guard<std::mutex> lck(camera_queue_init_mtx);
+    camera_queue_init.clear();
   }
-  return false;
+
+  // Finally, mark that the attempt has finished running
+  thread_init_running = false;
 }
 
 void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message) {
@@ -386,6 +425,166 @@ void VioManager::retriangulate_active_tracks(const ov_core::CameraData &message)
   PRINT_ALL(CYAN "[RETRI-TIME]: %.4f seconds total\n" RESET, (retri_rT3 - retri_rT1).total_microseconds() * 1e-6);
 }
 
+void VioManager::select_features_msckf(std::vector<std::shared_ptr<Feature>> &feats, int max_feats) {
+
+  // Return if we already have few enough features
+  if ((int)feats.size() <= max_feats)
+    return;
+  if (max_feats <= 0) {
+    feats.clear();
+    return;
+  }
+
+  // Parallax (in radians) after which we consider a feature to be fully constrained in depth
+  const double parallax_full = 2.0 * M_PI / 180.0;
+
+  // Compute the score of each feature and the bucket of its newest measurement
+  std::vector<double> scores(feats.size(), 0.0);
+  std::vector<size_t> buckets(feats.size(), 0);
+  size_t num_cells = (size_t)std::max(1, params.grid_x) * (size_t)std::max(1, params.grid_y);
+  for (size_t i = 0; i < feats.size(); i++) {
+    std::shared_ptr<Feature> feat = feats.at(i);
+    size_t num_meas = 0;
+    double parallax = 0.0;
+    double time_newest = -1;
+    for (const auto &pair : feat->timestamps) {
+      size_t cam_id = pair.first;
+      const std::vector<double> &times = pair.second;
+      num_meas += times.size();
+      if (times.empty())
+        continue;
+
+      // Bearing of the first and last measurement in this camera
+      const Eigen::VectorXf &uv0 = feat->uvs_norm.at(cam_id).front();
+      const Eigen::VectorXf &uv1 = feat->uvs_norm.at(cam_id).back();
+      Eigen::Vector3d b0((double)uv0(0), (double)uv0(1), 1.0);
+      Eigen::Vector3d b1((double)uv1(0), (double)uv1(1), 1.0);
+
+      // Compensate for the rotation between the two if we have the clones
+      // Parallax from pure rotation does not constrain the depth of the feature
+      if (state->_clones_IMU.find(times.front()) != state->_clones_IMU.end() &&
+          state->_clones_IMU.find(times.back()) != state->_clones_IMU.end()) {
+        Eigen::Matrix3d R_ItoC = state->_calib_IMUtoCAM.at(cam_id)->Rot();
+        Eigen::Matrix3d R_GtoC0 = R_ItoC * state->_clones_IMU.at(times.front())->Rot();
+        Eigen::Matrix3d R_GtoC1 = R_ItoC * state->_clones_IMU.at(times.back())->Rot();
+        b0 = R_GtoC1 * R_GtoC0.transpose() * b0;
+      }
+      double cos_angle = b0.normalized().dot(b1.normalized());
+      parallax = std::max(parallax, std::acos(std::min(1.0, std::max(-1.0, cos_angle))));
+
+      // Bucket the feature using the newest measurement in the grid of its camera
+      if (times.back() > time_newest) {
+        time_newest = times.back();
+        const Eigen::VectorXf &uv = feat->uvs.at(cam_id).back();
+        double width = (double)state->_cam_intrinsics_cameras.at(cam_id)->w();
+        double height = (double)state->_cam_intrinsics_cameras.at(cam_id)->h();
+        int x_grid = std::min(params.grid_x - 1, std::max(0, (int)((double)uv(0) / width * params.grid_x)));
+        int y_grid = std::min(params.grid_y - 1, std::max(0, (int)((double)uv(1) / height * params.grid_y)));
+        buckets.at(i) = cam_id * num_cells + (size_t)std::max(0, y_grid * params.grid_x + x_grid);
+      }
+    }
+    scores.at(i) = (double)num_meas * (0.5 + 0.5 * std::min(1.0, parallax / parallax_full));
+  }
+
+  // Sort the features in each bucket from best to worst
+  std::map<size_t, std::vector<size_t>> bucket_to_feats;
+  for (size_t i = 0; i < feats.size(); i++) {
+    bucket_to_feats[buckets.at(i)].push_back(i);
+  }
+  for (auto &pair : bucket_to_feats) {
+    std::stable_sort(pair.second.begin(), pair.second.end(), [&](size_t a, size_t b) { return scores.at(a) > scores.at(b); });
+  }
+
+  // Take the best remaining feature from each bucket in turn until we have enough
+  // Each round goes through the buckets from best to worst so that if we run out, we have the better features
+  std::vector<bool> selected(feats.size(), false);
+  int num_selected = 0;
+  size_t round = 0;
+  while (num_selected < max_feats) {
+    std::vector<size_t> candidates;
+    for (const auto &pair : bucket_to_feats) {
+      if (round < pair.second.size())
+        candidates.push_back(pair.second.at(round));
+    }
+    if (candidates.empty())
+      break;
+    std::stable_sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return scores.at(a) > scores.at(b); });
+    for (size_t k = 0; k < candidates.size() && num_selected < max_feats; k++) {
+      selected.at(candidates.at(k)) = true;
+      num_selected++;
+    }
+    round++;
+  }
+
+  // Keep the selected features in the order they were given to us
+  std::vector<std::shared_ptr<Feature>> feats_selected;
+  for (size_t i = 0; i < feats.size(); i++) {
+    if (selected.at(i))
+      feats_selected.push_back(feats.at(i));
+  }
+  feats = feats_selected;
+}
+
+void VioManager::select_marg_clone() {
+
+  // Get the features seen in the candidate clone (the one before the newest), the selection itself is done by the state helper
+  std::vector<std::shared_ptr<Feature>> feats;
+  if (state->_options.use_keyframe_clones && (int)state->_clones_IMU.size() > state->_options.max_clone_size &&
+      state->_clones_IMU.size() >= 3) {
+    double time_cand = std::next(state->_clones_IMU.rbegin())->first;
+    feats = trackFEATS->get_feature_database()->features_containing(time_cand, false, false);
+  }
+  StateHelper::select_marg_clone(state, feats);
+}
+
+void VioManager::apply_frame_governor() {
+
+  // Return if we do not have a budget, or have not initialized
+  // Before initialization the frame time includes the initializer, and it owns the number of features our tracker extracts
+  if (governor == nullptr || !is_initialized_vio)
+    return;
+
+  // Return if nothing has changed
+  boost::posix_time::ptime rT_end = boost::posix_time::microsec_clock::local_time();
+  double time_track = (rT2 - rT1).total_microseconds() * 1e-3;
+  double time_filter = (rT_end - rT2).total_microseconds() * 1e-3;
+  if (!governor->feed_frame_time(time_track, time_filter))
+    return;
+
+  // Restore our configured values if we are no longer throttling
+  bool was_throttling = governor_throttling;
+  governor_throttling = governor->is_throttling();
+  if (!governor_throttling) {
+    trackFEATS->set_num_features(std::floor((double)params.num_pts / (double)params.state_options.num_cameras));
+    state->_options.max_msckf_in_update = params.state_options.max_msckf_in_update;
+    state->_options.max_slam_features = params.state_options.max_slam_features;
+    state->_options.max_slam_in_update = params.state_options.max_slam_in_update;
+    PRINT_INFO(GREEN "[GOVERNOR]: back under the %.2f ms frame budget, no longer throttling\n" RESET, params.frame_budget_ms)
+    return;
+  }
+
+  // Scale the number of features we track in each camera
+  int num_pts_cam = (int)std::floor((double)params.num_pts / (double)params.state_options.num_cameras);
+  trackFEATS->set_num_features(FrameGovernor::scale_value(num_pts_cam, governor->scale_tracking(), 20));
+
+  // Scale how many features we will update with
+  // NOTE: the max in update is normally set really large, thus we scale from the number of features we could possibly have
+  int max_msckf = std::min(params.state_options.max_msckf_in_update, params.num_pts);
+  int max_slam_in_update = std::min(params.state_options.max_slam_in_update, std::max(1, params.state_options.max_slam_features));
+  state->_options.max_msckf_in_update = FrameGovernor::scale_value(max_msckf, governor->scale_filter(), 10);
+  state->_options.max_slam_features = FrameGovernor::scale_value(params.state_options.max_slam_features, governor->scale_filter(), 0);
+  state->_options.max_slam_in_update = FrameGovernor::scale_value(max_slam_in_update, governor->scale_filter(), 1);
+  // Only warn when we start throttling, as the scales can change every few frames after that
+  if (!was_throttling) {
+    PRINT_WARNING(YELLOW "[GOVERNOR]: over the %.2f ms frame budget, throttling our features and update sizes\n" RESET,
+                  params.frame_budget_ms)
+  }
+  PRINT_DEBUG("[GOVERNOR]: throttling to %d feats per cam, %d msckf, %d slam (%d per update)\n", trackFEATS->get_num_features(),
+              state->_options.max_msckf_in_update, state->_options.max_slam_features, state->_options.max_slam_in_update)
+  PRINT_DEBUG("[GOVERNOR]: tracking scale %.2f | filter scale %.2f | %d frames over budget\n", governor->scale_tracking(),
+              governor->scale_filter(), governor->num_frames_over())
+}
+
 cv::Mat VioManager::get_historical_viz_image() {
 
   // Return if not ready yet
@@ -105,6 +105,33 @@ struct VioManagerOptions {
   /// The path to the file we will record the timing information into
   std::string record_timing_filepath = "ov_msckf_timing.txt";
 
+  /// Time budget for processing each frame in milliseconds, we will reduce tracked and updated features to stay under it (0 disables)
+  double frame_budget_ms = 0.0;
+
+  /// Smallest fraction of the configured features / update sizes that the frame budget governor will reduce to
+  double frame_budget_min_scale = 0.3;
+
+  /// How long (seconds) we will wait for a camera that is behind the others before processing without it (0 processes images directly)
+  double camera_latency_window = 0.0;
+
+  /// Max number of camera images we will buffer while waiting on the other cameras and IMU
+  int camera_buffer_size = 100;
+
+  /// Calibration and biases saved by a previous run that we will start from (empty to always start from the config calibration)
+  std::string warm_start_load_filepath = "";
+
+  /// File we will save the calibration and biases into when the estimator is destroyed (empty to not save)
+  std::string warm_start_save_filepath = "";
+
+  /// File we will record all measurements we are fed into, so the run can be replayed with run_replay_msckf (empty to not record)
+  std::string record_input_filepath = "";
+
+  /// If we should only record the tracked feature observations instead of the full camera images
+  bool record_input_features_only = false;
+
+  /// File we will record a trace of when each estimator stage ran on which thread into, open it in Perfetto (empty to not record)
+  std::string record_trace_filepath = "";
+
   /**
    * @brief This function will load print out all estimator settings loaded.
    * This allows for visual checking that everything was loaded properly from ROS/CMD parsers.
@@ -124,6 +151,15 @@ struct VioManagerOptions {
       parser->parse_config("zupt_only_at_beginning", zupt_only_at_beginning);
       parser->parse_config("record_timing_information", record_timing_information);
       parser->parse_config("record_timing_filepath", record_timing_filepath);
+      parser->parse_config("frame_budget_ms", frame_budget_ms, false);
+      parser->parse_config("frame_budget_min_scale", frame_budget_min_scale, false);
+      parser->parse_config("camera_latency_window", camera_latency_window, false);
+      parser->parse_config("camera_buffer_size", camera_buffer_size, false);
+      parser->parse_config("warm_start_load_filepath", warm_start_load_filepath, false);
+      parser->parse_config("warm_start_save_filepath", warm_start_save_filepath, false);
+      parser->parse_config("record_input_filepath", record_input_filepath, false);
+      parser->parse_config("record_input_features_only", record_input_features_only, false);
+      parser->parse_config("record_trace_filepath", record_trace_filepath, false);
     }
     PRINT_DEBUG("  - dt_slam_delay: %.1f\n", dt_slam_delay)
     PRINT_DEBUG("  - zero_velocity_update: %d\n", try_zupt)
@@ -135,6 +171,12 @@ struct VioManagerOptions {
     PRINT_DEBUG("\t- init_imu_thresh: %.2f\n", init_imu_thresh)
     PRINT_DEBUG("  - record timing?: %d\n", (int)record_timing_information)
     PRINT_DEBUG("  - record timing filepath: %s\n", record_timing_filepath.c_str())
+    PRINT_DEBUG("  - frame budget: %.2f ms (min scale %.2f)\n", frame_budget_ms, frame_budget_min_scale)
+    PRINT_DEBUG("  - camera latency window: %.3f s (buffer size %d)\n", camera_latency_window, camera_buffer_size)
+    PRINT_DEBUG("  - warm start load filepath: %s\n", warm_start_load_filepath.c_str())
+    PRINT_DEBUG("  - warm start save filepath: %s\n", warm_start_save_filepath.c_str())
+    PRINT_DEBUG("  - record input filepath: %s (features only %d)\n", record_input_filepath.c_str(), (int)record_input_features_only)
+    PRINT_DEBUG("  - record trace filepath: %s\n", record_trace_filepath.c_str())
   }
 
   // NOISE / CHI2 ============================
@@ -403,6 +445,13 @@ struct VioManagerOptions {
   /// If we should process two cameras are being stereo or binocular. If binocular, we do monocular feature tracking on each image.
   bool use_stereo = true;
 
+  /// Camera ids which should be tracked as stereo pairs, flattened (i.e. [0, 1, 2, 3] pairs cam0-cam1 and cam2-cam3).
+  /// If empty, consecutive cameras are paired. Cameras which are not in a pair are tracked monocular.
+  std::vector<int> stereo_pairs;
+
+  /// Relative share of the features each camera should track (if empty, all cameras track the same number).
+  std::vector<double> cam_feat_weights;
+
   /// If we should use KLT tracking, or descriptor matcher
   bool use_klt = true;
 
@@ -412,6 +461,9 @@ struct VioManagerOptions {
   /// Will half the resolution of the aruco tag image (will be faster)
   bool downsize_aruco = true;
 
+  /// Number of frames between full image aruco scans, in between we only search around the last tags (1 will scan every frame)
+  int aruco_full_scan_period = 1;
+
   /// Will half the resolution all tracking image (aruco will be 1/4 instead of halved if dowsize_aruoc also enabled)
   bool downsample_cameras = false;
 
@@ -445,6 +497,9 @@ struct VioManagerOptions {
   /// KNN ration between top two descriptor matcher which is required to be a good match
   double knn_ratio = 0.85;
 
+  /// Pixel radius around the (gyro predicted) last location to search for descriptor matches (0 will match against all descriptors)
+  int desc_search_radius = 0;
+
   /// Frequency we want to track images at (higher freq ones will be dropped)
   double track_frequency = 20.0;
 
@@ -460,9 +515,16 @@ struct VioManagerOptions {
   void print_and_load_trackers(const std::shared_ptr<ov_core::YamlParser> &parser = nullptr) {
     if (parser != nullptr) {
       parser->parse_config("use_stereo", use_stereo);
+      parser->parse_config("stereo_pairs", stereo_pairs, false);
+      parser->parse_config("cam_feat_weights", cam_feat_weights, false);
+      if (stereo_pairs.size() % 2 != 0) {
+        PRINT_ERROR(RED "VioManager(): stereo_pairs needs to be pairs of camera ids (got %zu ids)\n" RESET, stereo_pairs.size());
+        std::exit(EXIT_FAILURE);
+      }
       parser->parse_config("use_klt", use_klt);
       parser->parse_config("use_aruco", use_aruco);
       parser->parse_config("downsize_aruco", downsize_aruco);
+      parser->parse_config("aruco_full_scan_period", aruco_full_scan_period, false);
       parser->parse_config("downsample_cameras", downsample_cameras);
       parser->parse_config("num_opencv_threads", num_opencv_threads);
       parser->parse_config("multi_threading_pubs", use_multi_threading_pubs, false);
@@ -488,13 +550,21 @@ struct VioManagerOptions {
         std::exit(EXIT_FAILURE);
       }
       parser->parse_config("knn_ratio", knn_ratio);
+      parser->parse_config("desc_search_radius", desc_search_radius, false);
       parser->parse_config("track_frequency", track_frequency);
     }
     PRINT_DEBUG("FEATURE TRACKING PARAMETERS:\n")
     PRINT_DEBUG("  - use_stereo: %d\n", use_stereo)
+    for (size_t i = 0; i + 1 < stereo_pairs.size(); i += 2) {
+      PRINT_DEBUG("  - stereo pair: cam%d + cam%d\n", stereo_pairs.at(i), stereo_pairs.at(i + 1))
+    }
+    for (size_t i = 0; i < cam_feat_weights.size(); i++) {
+      PRINT_DEBUG("  - cam%zu feature weight: %.3f\n", i, cam_feat_weights.at(i))
+    }
     PRINT_DEBUG("  - use_klt: %d\n", use_klt)
     PRINT_DEBUG("  - use_aruco: %d\n", use_aruco)
     PRINT_DEBUG("  - downsize aruco: %d\n", downsize_aruco)
+    PRINT_DEBUG("  - aruco full scan period: %d\n", aruco_full_scan_period)
     PRINT_DEBUG("  - downsize cameras: %d\n", downsample_cameras)
     PRINT_DEBUG("  - num opencv threads: %d\n", num_opencv_threads)
     PRINT_DEBUG("  - use multi-threading pubs: %d\n", use_multi_threading_pubs)
@@ -505,6 +575,7 @@ struct VioManagerOptions {
     PRINT_DEBUG("  - min px dist: %d\n", min_px_dist)
     PRINT_DEBUG("  - hist method: %d\n", (int)histogram_method)
     PRINT_DEBUG("  - knn ratio: %.3f\n", knn_ratio)
+    PRINT_DEBUG("  - desc search radius: %d\n", desc_search_radius)
     PRINT_DEBUG("  - track frequency: %.1f\n", track_frequency)
     featinit_options.print(parser);
   }
@@ -19,353 +19,350 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <opencv2/core.hpp>
-#include <opencv2/highgui/highgui.hpp>
+#include <algorithm>
+#include <atomic>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <csignal>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-#include "core/VioManager.h"
-#include "utils/dataset_reader.h"
+#include <opencv2/opencv.hpp>
 
-#include <fstream>
-#include <iostream>
-#include <algorithm>
+#include "core/VioManager.h"
+#include "state/State.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/sensor_data.h"
 
 using namespace ov_msckf;
 
-VioManager* sys;
+std::shared_ptr<VioManager> sys;
 
-struct vel_acc_vector {
-    double x, y, z;
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/// All images recorded at the same time (nanoseconds), one file per camera
+struct DatasetFrame {
+  int64_t timestamp_ns;
+  std::vector<int> sensor_ids;
+  std::vector<std::string> paths;
+};
+
+/// Decoded images of a frame and how long decoding took
+struct DecodedFrame {
+  std::vector<cv::Mat> images;
+  double time_decode_ms = 0.0;
 };
 
-struct imu_data {
-    vel_acc_vector angular_velocity;
-    vel_acc_vector linear_acceleration;
+/**
+ * Decodes the images of our frames ahead of time on a pool of threads.
+ * Frames are returned in order, and we decode at most a fixed number of frames ahead so memory stays bounded.
+ * Images are decoded straight to grayscale, which is what the tracker needs.
+ */
+class ImagePrefetcher {
+
+public:
+  ImagePrefetcher(const std::vector<DatasetFrame> &frames, int num_threads, size_t max_ahead) : frames(frames), max_ahead(max_ahead) {
+    for (int i = 0; i < std::max(num_threads, 1); i++)
+      threads.emplace_back(&ImagePrefetcher::worker, this);
+  }
+
+  ~ImagePrefetcher() {
+    {
+      std::lock_guard<std::mutex> lck(mtx);
+      stop = true;
+    }
+    cv_worker.notify_all();
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  /// Gets the next frame in order, blocks until it has been decoded (false if we have returned all frames)
+  bool next(DecodedFrame &frame) {
+    std::unique_lock<std::mutex> lck(mtx);
+    if (next_consume >= frames.size())
+      return false;
+    cv_consumer.wait(lck, [&] { return ready.find(next_consume) != ready.end(); });
+    frame = std::move(ready.at(next_consume));
+    ready.erase(next_consume);
+    next_consume++;
+    lck.unlock();
+    cv_worker.notify_all();
+    return true;
+  }
+
+private:
+  void worker() {
+    while (true) {
+      size_t idx;
+      {
+        std::unique_lock<std::mutex> lck(mtx);
+        cv_worker.wait(lck, [&] { return stop || next_decode >= frames.size() || next_decode < next_consume + max_ahead; });
+        if (stop || next_decode >= frames.size())
+          return;
+        idx = next_decode++;
+      }
+      DecodedFrame decoded;
+      auto rT1 = boost::posix_time::microsec_clock::local_time();
+      for (const auto &path : frames.at(idx).paths)
+        decoded.images.push_back(cv::imread(path, cv::IMREAD_GRAYSCALE));
+      auto rT2 = boost::posix_time::microsec_clock::local_time();
+      decoded.time_decode_ms = (rT2 - rT1).total_microseconds() * 1e-3;
+      {
+        std::lock_guard<std::mutex> lck(mtx);
+        ready.insert({idx, std::move(decoded)});
+      }
+      cv_consumer.notify_all();
+    }
+  }
+
+  const std::vector<DatasetFrame> &frames;
+  size_t max_ahead;
+  size_t next_decode = 0;
+  size_t next_consume = 0;
+  bool stop = false;
+  std::map<size_t, DecodedFrame> ready;
+  std::mutex mtx;
+  std::condition_variable cv_worker, cv_consumer;
+  std::vector<std::thread> threads;
 };
 
-VioManagerOptions create_params()
-{
-    VioManagerOptions params;
-
-    // Camera #0
-    Eigen::Matrix<double, 8, 1> intrinsics_0;
-    intrinsics_0 << 458.654, 457.296, 367.215, 248.375, -0.28340811, 0.07395907, 0.00019359, 1.76187114e-05;
-    std::vector<double> matrix_TCtoI_0 = {0.0148655429818, -0.999880929698, 0.00414029679422, -0.0216401454975,
-        0.999557249008, 0.0149672133247, 0.025715529948, -0.064676986768,
-        -0.0257744366974, 0.00375618835797, 0.999660727178, 0.00981073058949,
-        0.0, 0.0, 0.0, 1.0};
-
-    Eigen::Matrix4d T_CtoI_0;
-    T_CtoI_0 << matrix_TCtoI_0.at(0), matrix_TCtoI_0.at(1), matrix_TCtoI_0.at(2), matrix_TCtoI_0.at(3),
-        matrix_TCtoI_0.at(4), matrix_TCtoI_0.at(5), matrix_TCtoI_0.at(6), matrix_TCtoI_0.at(7),
-        matrix_TCtoI_0.at(8), matrix_TCtoI_0.at(9), matrix_TCtoI_0.at(10), matrix_TCtoI_0.at(11),
-        matrix_TCtoI_0.at(12), matrix_TCtoI_0.at(13), matrix_TCtoI_0.at(14), matrix_TCtoI_0.at(15);
-
-    // Load these into our state
-    Eigen::Matrix<double, 7, 1> extrinsics_0;
-    extrinsics_0.block(0, 0, 4, 1) = rot_2_quat(T_CtoI_0.block(0, 0, 3, 3).transpose());
-    extrinsics_0.block(4, 0, 3, 1) = -T_CtoI_0.block(0, 0, 3, 3).transpose() * T_CtoI_0.block(0, 3, 3, 1);
-
-    params.camera_fisheye.insert({0, false});
-    params.camera_intrinsics.insert({0, intrinsics_0});
-    params.camera_extrinsics.insert({0, extrinsics_0});
-
-    params.camera_wh.insert({0, {752, 480}});
-
-    // Camera #1
-    Eigen::Matrix<double, 8, 1> intrinsics_1;
-    intrinsics_1 << 457.587, 456.134, 379.999, 255.238, -0.28368365, 0.07451284, -0.00010473, -3.55590700e-05;
-    std::vector<double> matrix_TCtoI_1 = {0.0125552670891, -0.999755099723, 0.0182237714554, -0.0198435579556,
-        0.999598781151, 0.0130119051815, 0.0251588363115, 0.0453689425024,
-        -0.0253898008918, 0.0179005838253, 0.999517347078, 0.00786212447038,
-        0.0, 0.0, 0.0, 1.0};
-
-    Eigen::Matrix4d T_CtoI_1;
-    T_CtoI_1 << matrix_TCtoI_1.at(0), matrix_TCtoI_1.at(1), matrix_TCtoI_1.at(2), matrix_TCtoI_1.at(3),
-        matrix_TCtoI_1.at(4), matrix_TCtoI_1.at(5), matrix_TCtoI_1.at(6), matrix_TCtoI_1.at(7),
-        matrix_TCtoI_1.at(8), matrix_TCtoI_1.at(9), matrix_TCtoI_1.at(10), matrix_TCtoI_1.at(11),
-        matrix_TCtoI_1.at(12), matrix_TCtoI_1.at(13), matrix_TCtoI_1.at(14), matrix_TCtoI_1.at(15);
-
-    // Load these into our state
-    Eigen::Matrix<double, 7, 1> extrinsics_1;
-    extrinsics_1.block(0, 0, 4, 1) = rot_2_quat(T_CtoI_1.block(0, 0, 3, 3).transpose());
-    extrinsics_1.block(4, 0, 3, 1) = -T_CtoI_1.block(0, 0, 3, 3).transpose() * T_CtoI_1.block(0, 3, 3, 1);
-
-    params.camera_fisheye.insert({1, false});
-    params.camera_intrinsics.insert({1, intrinsics_1});
-    params.camera_extrinsics.insert({1, extrinsics_1});
-
-    params.camera_wh.insert({1, {752, 480}});
-
-    // params.state_options.max_slam_features = 0;
-    params.state_options.num_cameras = 2;
-    params.init_window_time = 0.75;
-    params.init_imu_thresh = 1.5;
-    params.fast_threshold = 15;
-    params.grid_x = 5;
-    params.grid_y = 3;
-    params.num_pts = 150;
-    params.msckf_options.chi2_multipler = 1;
-    params.knn_ratio = .7;
-
-    params.state_options.imu_avg = true;
-    params.state_options.do_fej = true;
-    params.state_options.use_rk4_integration = true;
-    params.use_stereo = true;
-    params.state_options.do_calib_camera_pose = true;
-    params.state_options.do_calib_camera_intrinsics = true;
-    params.state_options.do_calib_camera_timeoffset = true;
-
-    params.dt_slam_delay = 3.0;
-    params.state_options.max_slam_features = 50;
-    params.state_options.max_slam_in_update = 25;
-    params.state_options.max_msckf_in_update = 999;
-
-    params.use_aruco = false;
-
-    params.state_options.feat_rep_slam = LandmarkRepresentation::from_string("ANCHORED_FULL_INVERSE_DEPTH");
-    params.state_options.feat_rep_aruco = LandmarkRepresentation::from_string("ANCHORED_FULL_INVERSE_DEPTH");
-
-#ifndef NDEBUG
-    params.record_timing_information = true;
-#endif /// NDEBUG
-
-    return params;
+/// Splits a line of an ASL csv file into its values (skips the header and empty lines)
+bool parse_csv_line(std::string &line, std::vector<std::string> &values) {
+  values.clear();
+  line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+  if (line.empty() || line.at(0) == '#')
+    return false;
+  size_t start = 0;
+  while (start <= line.size()) {
+    size_t end = line.find(',', start);
+    if (end == std::string::npos)
+      end = line.size();
+    std::string value = line.substr(start, end - start);
+    value.erase(0, value.find_first_not_of(' '));
+    values.push_back(value);
+    start = end + 1;
+  }
+  return true;
 }
 
-void load_images(const string &file_name, unordered_map<double, string> &rgb_images,
-                 vector<double> &timestamps) {
-    ifstream file_in;
-    file_in.open(file_name.c_str());
-
-    // skip first line
-    string s;
-    getline(file_in, s);
-    while (!file_in.eof()) {
-        getline(file_in, s);
-        if (!s.empty()) {
-            stringstream ss;
-            ss << s;
-            double t;
-            string rgb_image;
-            ss >> t;
-            timestamps.push_back(t);
-            ss >> rgb_image;
-            rgb_image.erase(std::remove(rgb_image.begin(), rgb_image.end(), ','), rgb_image.end());
-            rgb_images[t] = rgb_image;
-        }
-    }
+/// Reads the timestamps and image files of a camera, and merges them into the frames (sorted by time)
+void load_camera_csv(const std::string &path_cam, int cam_id, std::map<int64_t, DatasetFrame> &frames) {
+  std::ifstream file(path_cam + "/data.csv");
+  if (!file.is_open()) {
+    PRINT_ERROR(RED "[EUROC]: unable to open %s/data.csv\n" RESET, path_cam.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  std::string line;
+  std::vector<std::string> values;
+  while (std::getline(file, line)) {
+    if (!parse_csv_line(line, values) || values.size() < 2)
+      continue;
+    int64_t timestamp_ns = std::stoll(values.at(0));
+    DatasetFrame &frame = frames[timestamp_ns];
+    frame.timestamp_ns = timestamp_ns;
+    frame.sensor_ids.push_back(cam_id);
+    frame.paths.push_back(path_cam + "/data/" + values.at(1));
+  }
 }
 
-void load_imu_data(const string &file_name, unordered_map<double, imu_data> &imu_data_vals,
-                   vector<double> &timestamps) {
-    ifstream file_in;
-    file_in.open(file_name.c_str());
-
-    // skip first line
-    string s;
-    getline(file_in, s);
-    while (!file_in.eof()) {
-        getline(file_in, s);
-        if (!s.empty()) {
-            stringstream ss(s);
-            string word;
-            vector<double> line;
-            while (getline(ss, word, ',')) {
-                line.push_back(stod(word));
-            }
-
-            imu_data imu_vals;
-            double t = line[0];
-            timestamps.push_back(t);
-            imu_vals.angular_velocity.x = line[1];
-            imu_vals.angular_velocity.y = line[2];
-            imu_vals.angular_velocity.z = line[3];
-            imu_vals.linear_acceleration.x = line[4];
-            imu_vals.linear_acceleration.y = line[5];
-            imu_vals.linear_acceleration.z = line[6];
-            imu_data_vals[t] = imu_vals;
-        }
-    }
+/// Mean, percentiles and max of a list of times
+void print_latency(const std::string &name, std::vector<double> times) {
+  if (times.empty())
+    return;
+  std::sort(times.begin(), times.end());
+  double mean = 0.0;
+  for (const auto &time : times)
+    mean += time;
+  mean /= (double)times.size();
+  auto percentile = [&](double p) { return times.at(std::min((size_t)(p * (double)times.size()), times.size() - 1)); };
+  PRINT_INFO("%-16s %9.3f %9.3f %9.3f %9.3f %9.3f\n", name.c_str(), mean, percentile(0.50), percentile(0.95), percentile(0.99),
+             times.back());
 }
 
 // Main function
-int main(int argc, char** argv) {
-
-    if (argc != 6) {
-        cerr << "Usage: ./run_serial_msckf path_to_cam0 path_to_cam1 path_to_imu0 path_to_cam0_images path_to_cam1_images" << endl;
-        return 1;
+int main(int argc, char **argv) {
+
+  // Ensure we have a config and dataset folder (the mav0 folder of the EuRoC ASL format)
+  if (argc < 3) {
+    PRINT_ERROR(RED "usage: %s <config.yaml> <path_to_mav0> [num_decode_threads] [trajectory_out.txt]\n" RESET, argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+  std::string config_path = argv[1];
+  std::string dataset_path = argv[2];
+  int num_decode_threads = (argc > 3) ? std::max(1, std::stoi(argv[3])) : 2;
+  std::string traj_path = (argc > 4) ? argv[4] : "";
+
+  // Load the config
+  auto parser = std::make_shared<ov_core::YamlParser>(config_path);
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  parser->parse_config("verbosity", verbosity);
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Create our VIO system
+  VioManagerOptions params;
+  params.print_and_load(parser);
+  sys = std::make_shared<VioManager>(params);
+
+  // Ensure we read in all parameters required
+  if (!parser->successful()) {
+    PRINT_ERROR(RED "unable to parse all parameters, please fix\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Index all camera images, the images are only decoded right before we need them
+  std::map<int64_t, DatasetFrame> frames_map;
+  for (int i = 0; i < params.state_options.num_cameras; i++) {
+    load_camera_csv(dataset_path + "/cam" + std::to_string(i), i, frames_map);
+  }
+  std::vector<DatasetFrame> frames;
+  frames.reserve(frames_map.size());
+  for (auto &frame : frames_map)
+    frames.push_back(std::move(frame.second));
+  frames_map.clear();
+  PRINT_INFO("[EUROC]: %zu frames from %d cameras, decoding with %d threads\n", frames.size(), params.state_options.num_cameras,
+             num_decode_threads);
+
+  // The IMU is streamed from its file as we go
+  std::ifstream file_imu(dataset_path + "/imu0/data.csv");
+  if (!file_imu.is_open()) {
+    PRINT_ERROR(RED "[EUROC]: unable to open %s/imu0/data.csv\n" RESET, dataset_path.c_str());
+    std::exit(EXIT_FAILURE);
+  }
+  auto read_imu = [&](ov_core::ImuData &message) {
+    std::string line;
+    std::vector<std::string> values;
+    while (std::getline(file_imu, line)) {
+      if (!parse_csv_line(line, values) || values.size() < 7)
+        continue;
+      message.timestamp = 1e-9 * (double)std::stoll(values.at(0));
+      message.wm << std::stod(values.at(1)), std::stod(values.at(2)), std::stod(values.at(3));
+      message.am << std::stod(values.at(4)), std::stod(values.at(5)), std::stod(values.at(6));
+      return true;
     }
-
-    unordered_map<double, string> cam0_images;
-    unordered_map<double, string> cam1_images;
-    unordered_map<double, imu_data> imu0_vals;
-    vector<double> cam0_timestamps;
-    vector<double> cam1_timestamps;
-    vector<double> imu0_timestamps;
-    string cam0_filename = string(argv[1]);
-    string cam1_filename = string(argv[2]);
-    string imu0_filename = string(argv[3]);
-    string cam0_images_path = string(argv[4]);
-    string cam1_images_path = string(argv[5]);
-
-    load_images(cam0_filename, cam0_images, cam0_timestamps);
-    load_images(cam1_filename, cam1_images, cam1_timestamps);
-    load_imu_data(imu0_filename, imu0_vals, imu0_timestamps);
-
-    cout << "cam0 images: " << cam0_images.size() << "  cam1 images: " << cam1_images.size() << "  imu0 data: " << imu0_vals.size() << endl;
-    if (cam0_images.size() != cam1_images.size()) {
-        cerr << "Mismatched number of cam0 and cam1 images!" << endl;
-        return 1;
+    return false;
+  };
+
+  // Open the trajectory file if we are saving it
+  std::ofstream of_traj;
+  if (!traj_path.empty()) {
+    boost::filesystem::path p(traj_path);
+    if (p.has_parent_path())
+      boost::filesystem::create_directories(p.parent_path());
+    of_traj.open(traj_path, std::ofstream::out | std::ofstream::trunc);
+    of_traj << "# timestamp(s) tx ty tz qx qy qz qw" << std::endl;
+  }
+
+  //===================================================================================
+  //===================================================================================
+  //===================================================================================
+
+  // Per frame latencies (ms)
+  std::vector<double> times_decode, times_wait, times_feed;
+  std::map<std::string, std::vector<double>> times_stages;
+  std::vector<std::string> stage_names = {"tracking", "propagation", "msckf update", "slam update", "slam delayed", "marginalization"};
+
+  // Start decoding, we keep a few frames per decode thread in flight
+  ImagePrefetcher prefetcher(frames, num_decode_threads, 4 * (size_t)num_decode_threads);
+  signal(SIGINT, signal_callback_handler);
+
+  // Loop through all frames
+  // Before each frame we feed the IMU up to (and including the first one past) its time so we can propagate to it
+  ov_core::ImuData message_imu;
+  bool has_imu = read_imu(message_imu);
+  double time_imu_fed = -1;
+  size_t num_imu = 0;
+  auto rT0 = boost::posix_time::microsec_clock::local_time();
+  for (const auto &frame : frames) {
+
+    // IMU
+    double timestamp = 1e-9 * (double)frame.timestamp_ns;
+    while (has_imu && time_imu_fed < timestamp) {
+      sys->feed_measurement_imu(message_imu);
+      time_imu_fed = message_imu.timestamp;
+      num_imu++;
+      has_imu = read_imu(message_imu);
     }
 
-    cout << "Finished Loading Data!!!!" << endl;
-
-    // Create our VIO system
-    auto params = create_params();
-    sys = new VioManager(params);
-
-    // Disabling OpenCV threading is faster on x86 desktop but slower on
-    // jetson. Keeping this here for manual disabling.
-    // cv::setNumThreads(0);
-
-    // Read in what mode we should be processing in (1=mono, 2=stereo)
-    int max_cameras;
-    max_cameras = 2; // max_cameras
-
-    // Buffer variables for our system (so we always have imu to use)
-    bool has_left = false;
-    bool has_right = false;
-    cv::Mat img0, img1;
-    cv::Mat img0_buffer, img1_buffer;
-    double time = 0.0;
-    double time_buffer = 0.0;
-
-    // Load groundtruth if we have it
-    std::map<double, Eigen::Matrix<double, 17, 1>> gt_states;
-
-    // Loop through data files (camera and imu)
-    unsigned num_images = 0;
-    for (auto timem : imu0_timestamps) {
-        // Handle IMU measurement
-        if (imu0_vals.find(timem) != imu0_vals.end()) {
-            // convert into correct format
-            imu_data m = imu0_vals.at(timem);
-            Eigen::Matrix<double, 3, 1> wm, am;
-            wm << m.angular_velocity.x, m.angular_velocity.y, m.angular_velocity.z;
-            am << m.linear_acceleration.x, m.linear_acceleration.y, m.linear_acceleration.z;
-            // send it to our VIO system
-            sys->feed_measurement_imu(timem/1000000000.0, wm, am);
-        }
-
-        // Handle LEFT camera
-        if (cam0_images.find(timem) != cam0_images.end()) {
-            // Get the image
-            img0 = cv::imread(cam0_images_path+ "/" +cam0_images.at(timem), cv::IMREAD_COLOR);
-            cv::cvtColor(img0, img0, cv::COLOR_BGR2GRAY);
-            if (img0.empty()) {
-                cerr << endl << "Failed to load image at: "
-                     << cam0_images_path << "/" << cam0_images.at(timem) << endl;
-                return 1;
-            }
-
-            // Save to our temp variable
-            has_left = true;
-            time = timem/1000000000.0;
-        }
-
-        // Handle RIGHT camera
-        if (cam1_images.find(timem) != cam1_images.end()) {
-            // Get the image
-            img1 = cv::imread(cam1_images_path+ "/" +cam1_images.at(timem), cv::IMREAD_COLOR);
-            cv::cvtColor(img1, img1, cv::COLOR_BGR2GRAY);
-            if (img1.empty()) {
-                cerr << endl << "Failed to load image at: "
-                     << cam1_images_path << "/" << cam1_images.at(timem) << endl;
-                return 1;
-            }
-
-            has_right = true;
-        }
-
-        // Fill our buffer if we have not
-        if(has_left && img0_buffer.rows == 0) {
-            has_left = false;
-            time_buffer = time;
-            img0_buffer = img0.clone();
-        }
-
-        // Fill our buffer if we have not
-        if(has_right && img1_buffer.rows == 0) {
-            has_right = false;
-            img1_buffer = img1.clone();
-        }
-
-        // If we are in monocular mode, then we should process the left if we have it
-        if(max_cameras==1 && has_left) {
-            // process once we have initialized with the GT
-            Eigen::Matrix<double, 17, 1> imustate;
-            if(!gt_states.empty() && !sys->initialized() && DatasetReader::get_gt_state(time_buffer,imustate,gt_states)) {
-                //biases are pretty bad normally, so zero them
-                //imustate.block(11,0,6,1).setZero();
-                sys->initialize_with_gt(imustate);
-            } else if(gt_states.empty() || sys->initialized()) {
-                sys->feed_measurement_monocular(time_buffer, img0_buffer, 0);
-            }
-            // reset bools
-            has_left = false;
-            // move buffer forward
-            time_buffer = time;
-            img0_buffer = img0.clone();
-        }
-
-        // If we are in stereo mode and have both left and right, then process
-        if(max_cameras==2 && has_left && has_right) {
-            // process once we have initialized with the GT
-            Eigen::Matrix<double, 17, 1> imustate;
-            if(!gt_states.empty() && !sys->initialized() && DatasetReader::get_gt_state(time_buffer,imustate,gt_states)) {
-                //biases are pretty bad normally, so zero them
-                //imustate.block(11,0,6,1).setZero();
-                sys->initialize_with_gt(imustate);
-            } else if(gt_states.empty() || sys->initialized()) {
-                sys->feed_measurement_stereo(time_buffer, img0_buffer, img1_buffer, 0, 1);
-            }
-            // reset bools
-            has_left = false;
-            has_right = false;
-            // move buffer forward
-            time_buffer = time;
-            img0_buffer = img0.clone();
-            img1_buffer = img1.clone();
-
-            num_images++;
-        }
-
-        //if (num_images == 500)
-        //    break;
+    // Get our decoded images, this only blocks if decoding can not keep up
+    auto rT1 = boost::posix_time::microsec_clock::local_time();
+    DecodedFrame decoded;
+    prefetcher.next(decoded);
+    auto rT2 = boost::posix_time::microsec_clock::local_time();
+    times_decode.push_back(decoded.time_decode_ms);
+    times_wait.push_back((rT2 - rT1).total_microseconds() * 1e-3);
+
+    // Camera measurement
+    ov_core::CameraData message;
+    message.timestamp = timestamp;
+    for (size_t i = 0; i < frame.sensor_ids.size(); i++) {
+      const cv::Mat &image = decoded.images.at(i);
+      if (image.empty()) {
+        PRINT_ERROR(RED "[EUROC]: failed to load image %s\n" RESET, frame.paths.at(i).c_str());
+        std::exit(EXIT_FAILURE);
+      }
+      int cam_id = frame.sensor_ids.at(i);
+      message.sensor_ids.push_back(cam_id);
+      message.images.push_back(image);
+      if (params.use_mask) {
+        message.masks.push_back(params.masks.at(cam_id));
+      } else {
+        message.masks.push_back(cv::Mat::zeros(image.rows, image.cols, CV_8UC1));
+      }
+    }
+    sys->feed_measurement_camera(message);
+    auto rT3 = boost::posix_time::microsec_clock::local_time();
+    times_feed.push_back((rT3 - rT2).total_microseconds() * 1e-3);
+
+    // Record the stages if this frame was used to update
+    VioManager::StageTimes stages = sys->get_last_stage_times();
+    if (stages.timestamp == timestamp) {
+      times_stages["tracking"].push_back(stages.tracking);
+      times_stages["propagation"].push_back(stages.propagation);
+      times_stages["msckf update"].push_back(stages.msckf_update);
+      times_stages["slam update"].push_back(stages.slam_update);
+      times_stages["slam delayed"].push_back(stages.slam_delayed);
+      times_stages["marginalization"].push_back(stages.marginalization);
     }
 
-    // Dump frame times
-    /*{
-        ofstream output_file;
-        output_file.open("times.csv", std::ios::out);
-
-        auto tracker_times = sys->get_tracker_times();
-        auto filter_times = sys->get_filter_times();
-        auto total_times = sys->get_total_times();
-
-        output_file << "# Frame Tracker Filter Total\n";
-
-        for (unsigned i = 0; i < total_times.size(); i++) {
-            output_file << i << " " << tracker_times[i] << " " << filter_times[i] << " " << total_times[i] << endl;
-        }
-
-        output_file.close();
-    }*/
-
-    // Finally delete our system
-    delete sys;
-
-    // // Done!
-    cout << "DONE!" << endl;
-    return EXIT_SUCCESS;
+    // Save the estimate
+    std::shared_ptr<State> state = sys->get_state();
+    if (of_traj.is_open() && stages.timestamp == timestamp) {
+      of_traj.precision(5);
+      of_traj.setf(std::ios::fixed, std::ios::floatfield);
+      of_traj << state->_timestamp << " ";
+      of_traj.precision(6);
+      of_traj << state->_imu->pos()(0) << " " << state->_imu->pos()(1) << " " << state->_imu->pos()(2) << " ";
+      of_traj << state->_imu->quat()(0) << " " << state->_imu->quat()(1) << " " << state->_imu->quat()(2) << " "
+              << state->_imu->quat()(3) << std::endl;
+    }
+  }
+  auto rT4 = boost::posix_time::microsec_clock::local_time();
+  double time_total = (rT4 - rT0).total_microseconds() * 1e-3;
+  double time_dataset = (frames.empty()) ? 0.0 : 1e-9 * (double)(frames.back().timestamp_ns - frames.front().timestamp_ns);
+
+  // Print our throughput and latency of each stage
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+  PRINT_INFO(REDPURPLE "[EUROC]: %zu frames and %zu imu in %.3f seconds (%.2f seconds of data)\n" RESET, frames.size(), num_imu,
+             1e-3 * time_total, time_dataset);
+  PRINT_INFO(REDPURPLE "[EUROC]: %.2f frames/sec, %.2fx realtime\n" RESET, 1e3 * (double)frames.size() / std::max(time_total, 1e-9),
+             1e3 * time_dataset / std::max(time_total, 1e-9));
+  PRINT_INFO("%-16s %9s %9s %9s %9s %9s\n", "latency (ms)", "mean", "p50", "p95", "p99", "max");
+  print_latency("decode", times_decode);
+  print_latency("decode wait", times_wait);
+  for (const auto &name : stage_names)
+    print_latency(name, times_stages[name]);
+  print_latency("vio total", times_feed);
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+
+  // Done!
+  return EXIT_SUCCESS;
 }
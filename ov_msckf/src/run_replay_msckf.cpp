@@ -0,0 +1,163 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <csignal>
+#include <fstream>
+#include <memory>
+
+#include "core/InputRecorder.h"
+#include "core/VioManager.h"
+#include "state/State.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/sensor_data.h"
+
+using namespace ov_msckf;
+
+std::shared_ptr<VioManager> sys;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Ensure we have a config and log, the estimated trajectory is optionally saved
+  if (argc < 3) {
+    PRINT_ERROR(RED "usage: %s <config.yaml> <input_log.bin> [trajectory_out.txt]\n" RESET, argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+  std::string config_path = argv[1];
+  std::string log_path = argv[2];
+  std::string traj_path = (argc > 3) ? argv[3] : "";
+
+  // Load the config
+  auto parser = std::make_shared<ov_core::YamlParser>(config_path);
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  parser->parse_config("verbosity", verbosity);
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Create our VIO system
+  // Everything which depends on thread timing is turned off so two replays of the same log give the same result
+  VioManagerOptions params;
+  params.print_and_load(parser);
+  params.num_opencv_threads = 0; // for repeatability
+  params.use_multi_threading_pubs = false;
+  params.use_multi_threading_subs = false;
+  params.init_options.init_dyn_mle_max_threads = 1;
+  params.init_options.init_dyn_mle_max_time = 1e6;
+  params.frame_budget_ms = 0.0;
+  params.record_input_filepath = "";
+  params.warm_start_save_filepath = "";
+  sys = std::make_shared<VioManager>(params);
+
+  // Ensure we read in all parameters required
+  if (!parser->successful()) {
+    PRINT_ERROR(RED "unable to parse all parameters, please fix\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Open our log
+  InputReader reader(log_path);
+  if (!reader.is_open()) {
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Open the trajectory file if we are saving it
+  std::ofstream of_traj;
+  if (!traj_path.empty()) {
+    boost::filesystem::path p(traj_path);
+    if (p.has_parent_path())
+      boost::filesystem::create_directories(p.parent_path());
+    of_traj.open(traj_path, std::ofstream::out | std::ofstream::trunc);
+    of_traj << "# timestamp(s) tx ty tz qx qy qz qw" << std::endl;
+  }
+
+  //===================================================================================
+  //===================================================================================
+  //===================================================================================
+
+  // Feed all records as fast as we can
+  // We only time the estimator, not reading from disk
+  signal(SIGINT, signal_callback_handler);
+  InputRecord record;
+  size_t num_imu = 0, num_frames = 0;
+  double time_first = -1, time_last = -1, time_estimator = 0.0, time_last_saved = -1;
+  auto rT0 = boost::posix_time::microsec_clock::local_time();
+  while (reader.next(record)) {
+
+    // Pass it to the estimator
+    double timestamp;
+    auto rT1 = boost::posix_time::microsec_clock::local_time();
+    if (record.type == InputRecord::IMU) {
+      sys->feed_measurement_imu(record.imu);
+      timestamp = record.imu.timestamp;
+      num_imu++;
+    } else if (record.type == InputRecord::CAMERA) {
+      sys->feed_measurement_camera(record.camera);
+      timestamp = record.camera.timestamp;
+      num_frames++;
+    } else {
+      sys->feed_measurement_simulation(record.feats_timestamp, record.feats_camids, record.feats);
+      timestamp = record.feats_timestamp;
+      num_frames++;
+    }
+    auto rT2 = boost::posix_time::microsec_clock::local_time();
+    time_estimator += (rT2 - rT1).total_microseconds() * 1e-6;
+    if (time_first < 0)
+      time_first = timestamp;
+    time_last = std::max(time_last, timestamp);
+
+    // Save the estimate after each update
+    std::shared_ptr<State> state = sys->get_state();
+    if (of_traj.is_open() && record.type != InputRecord::IMU && sys->initialized() && state->_timestamp != time_last_saved) {
+      time_last_saved = state->_timestamp;
+      of_traj.precision(5);
+      of_traj.setf(std::ios::fixed, std::ios::floatfield);
+      of_traj << state->_timestamp << " ";
+      of_traj.precision(6);
+      of_traj << state->_imu->pos()(0) << " " << state->_imu->pos()(1) << " " << state->_imu->pos()(2) << " ";
+      of_traj << state->_imu->quat()(0) << " " << state->_imu->quat()(1) << " " << state->_imu->quat()(2) << " "
+              << state->_imu->quat()(3) << std::endl;
+    }
+  }
+  auto rT3 = boost::posix_time::microsec_clock::local_time();
+  double time_total = (rT3 - rT0).total_microseconds() * 1e-6;
+  double time_dataset = std::max(time_last - time_first, 0.0);
+
+  // Print our throughput
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+  PRINT_INFO(REDPURPLE "[REPLAY]: %zu imu and %zu camera measurements (%.2f seconds of data)\n" RESET, num_imu, num_frames, time_dataset);
+  PRINT_INFO(REDPURPLE "[REPLAY]: %.3f seconds in the estimator, %.3f seconds total (with reading the log)\n" RESET, time_estimator,
+             time_total);
+  if (time_estimator > 0) {
+    PRINT_INFO(REDPURPLE "[REPLAY]: %.2f frames/sec, %.2f ms/frame, %.2fx realtime\n" RESET, num_frames / time_estimator,
+               1e3 * time_estimator / std::max(num_frames, (size_t)1), time_dataset / time_estimator);
+  }
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+
+  // Done!
+  return EXIT_SUCCESS;
+}
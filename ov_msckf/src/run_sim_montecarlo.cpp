@@ -0,0 +1,315 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <cmath>
+#include <csignal>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "cam/CamEqui.h"
+#include "cam/CamRadtan.h"
+#include "core/VioManager.h"
+#include "sim/Simulator.h"
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+#include "utils/sensor_data.h"
+
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/// Accuracy, consistency and timing of a single Monte-Carlo run
+struct RunResult {
+  int run = -1;
+  bool valid = false;
+  size_t num_updates = 0;
+  double rmse_ori = 0.0;
+  double rmse_pos = 0.0;
+  double nees_ori = 0.0;
+  double nees_pos = 0.0;
+  double time_frame_ms = 0.0;
+  double time_wall = 0.0;
+};
+
+/**
+ * Creates the parameters of a run, each run needs its own camera objects since the simulator perturbs them and the estimator
+ * updates them with its online calibration.
+ */
+VioManagerOptions create_run_params(const VioManagerOptions &params_base, int run) {
+  VioManagerOptions params = params_base;
+  params.camera_intrinsics.clear();
+  for (auto const &tmp : params_base.camera_intrinsics) {
+    std::shared_ptr<ov_core::CamBase> camera;
+    if (std::dynamic_pointer_cast<ov_core::CamEqui>(tmp.second) != nullptr) {
+      camera = std::make_shared<ov_core::CamEqui>(tmp.second->w(), tmp.second->h());
+    } else {
+      camera = std::make_shared<ov_core::CamRadtan>(tmp.second->w(), tmp.second->h());
+    }
+    camera->set_value(tmp.second->get_value());
+    params.camera_intrinsics.insert({tmp.first, camera});
+  }
+  params.sim_seed_measurements = params_base.sim_seed_measurements + run;
+  params.sim_seed_preturb = params_base.sim_seed_preturb + run;
+  params.num_opencv_threads = 0; // for repeatability
+  params.use_multi_threading_pubs = false;
+  params.use_multi_threading_subs = false;
+  params.record_timing_information = false;
+  params.record_input_filepath = "";
+  params.warm_start_load_filepath = "";
+  params.warm_start_save_filepath = "";
+  return params;
+}
+
+/// Runs a simulator and estimator pair to the end of the trajectory, saving its estimate, groundtruth and timing into the folder
+RunResult run_simulation(const VioManagerOptions &params_base, int run, const std::string &path_run) {
+
+  // Create the simulator and estimator (the simulator perturbs the parameters the estimator starts with)
+  RunResult result;
+  result.run = run;
+  auto rT1 = boost::posix_time::microsec_clock::local_time();
+  VioManagerOptions params = create_run_params(params_base, run);
+  auto sim = std::make_shared<Simulator>(params);
+  auto sys = std::make_shared<VioManager>(params);
+  double true_dt = sim->get_true_parameters().calib_camimu_dt;
+
+  // Initialize our filter with the groundtruth
+  // NOTE: we are getting it at the *next* timestep so we get the first IMU message
+  Eigen::Matrix<double, 17, 1> imustate;
+  if (!sim->get_state(sim->current_timestamp() + 1.0 / params.sim_freq_imu, imustate)) {
+    PRINT_ERROR(RED "[MC]: run %d could not initialize the filter to the first state\n" RESET, run);
+    return result;
+  }
+  imustate(0, 0) -= true_dt;
+  sys->initialize_with_gt(imustate);
+
+  // Our output files
+  boost::filesystem::create_directories(path_run);
+  std::ofstream of_est(path_run + "/estimate.txt"), of_gt(path_run + "/groundtruth.txt"), of_time(path_run + "/timing.txt");
+  of_est << "# timestamp(s) tx ty tz qx qy qz qw Pr11 Pr12 Pr13 Pr22 Pr23 Pr33 Pt11 Pt12 Pt13 Pt22 Pt23 Pt33" << std::endl;
+  of_gt << "# timestamp(s) tx ty tz qx qy qz qw" << std::endl;
+  of_time << "# timestamp(s) total(ms)" << std::endl;
+
+  // Step through the simulation
+  double buffer_timecam = -1;
+  std::vector<int> buffer_camids;
+  std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> buffer_feats;
+  double sum_ori_sq = 0.0, sum_pos_sq = 0.0, sum_nees_ori = 0.0, sum_nees_pos = 0.0, sum_time = 0.0;
+  while (sim->ok()) {
+
+    // IMU: get the next simulated IMU measurement if we have it
+    ov_core::ImuData message_imu;
+    if (sim->get_next_imu(message_imu.timestamp, message_imu.wm, message_imu.am)) {
+      sys->feed_measurement_imu(message_imu);
+    }
+
+    // CAM: get the next simulated camera uv measurements if we have them
+    double time_cam;
+    std::vector<int> camids;
+    std::vector<std::vector<std::pair<size_t, Eigen::VectorXf>>> feats;
+    if (!sim->get_next_cam(time_cam, camids, feats))
+      continue;
+    if (buffer_timecam != -1) {
+      sys->feed_measurement_simulation(buffer_timecam, buffer_camids, buffer_feats);
+
+      // Compare to the groundtruth if we have updated with this image
+      VioManager::StageTimes stages = sys->get_last_stage_times();
+      std::shared_ptr<State> state = sys->get_state();
+      Eigen::Matrix<double, 17, 1> state_gt;
+      if (sys->initialized() && stages.timestamp == buffer_timecam && sim->get_state(state->_timestamp + true_dt, state_gt)) {
+
+        // Error of the orientation and position, we define our orientation error as e_R = -Log(R*Rhat^T)
+        std::vector<std::shared_ptr<ov_type::Type>> vars = {state->_imu->q(), state->_imu->p()};
+        Eigen::MatrixXd cov = StateHelper::get_marginal_covariance(state, vars);
+        Eigen::Matrix3d e_R = ov_core::quat_2_Rot(state_gt.block(1, 0, 4, 1)) * state->_imu->Rot().transpose();
+        Eigen::Vector3d err_ori = -ov_core::log_so3(e_R);
+        Eigen::Vector3d err_pos = state_gt.block(5, 0, 3, 1) - state->_imu->pos();
+        sum_ori_sq += err_ori.squaredNorm();
+        sum_pos_sq += err_pos.squaredNorm();
+        sum_nees_ori += err_ori.transpose() * cov.block(0, 0, 3, 3).inverse() * err_ori;
+        sum_nees_pos += err_pos.transpose() * cov.block(3, 3, 3, 3).inverse() * err_pos;
+        sum_time += stages.total;
+        result.num_updates++;
+
+        // Save to file
+        of_est.precision(5);
+        of_est.setf(std::ios::fixed, std::ios::floatfield);
+        of_est << state->_timestamp + true_dt << " ";
+        of_est.precision(6);
+        of_est << state->_imu->pos().transpose() << " " << state->_imu->quat().transpose() << " ";
+        of_est << cov(0, 0) << " " << cov(0, 1) << " " << cov(0, 2) << " " << cov(1, 1) << " " << cov(1, 2) << " " << cov(2, 2) << " ";
+        of_est << cov(3, 3) << " " << cov(3, 4) << " " << cov(3, 5) << " " << cov(4, 4) << " " << cov(4, 5) << " " << cov(5, 5);
+        of_est << std::endl;
+        of_gt.precision(5);
+        of_gt.setf(std::ios::fixed, std::ios::floatfield);
+        of_gt << state_gt(0) << " ";
+        of_gt.precision(6);
+        of_gt << state_gt.block(5, 0, 3, 1).transpose() << " " << state_gt.block(1, 0, 4, 1).transpose() << std::endl;
+        of_time.precision(5);
+        of_time.setf(std::ios::fixed, std::ios::floatfield);
+        of_time << state->_timestamp + true_dt << " " << stages.total << std::endl;
+      }
+    }
+    buffer_timecam = time_cam;
+    buffer_camids = camids;
+    buffer_feats = feats;
+  }
+
+  // Final statistics of this run
+  auto rT2 = boost::posix_time::microsec_clock::local_time();
+  result.time_wall = (rT2 - rT1).total_microseconds() * 1e-6;
+  if (result.num_updates > 0) {
+    double n = (double)result.num_updates;
+    result.rmse_ori = 180.0 / M_PI * std::sqrt(sum_ori_sq / n);
+    result.rmse_pos = std::sqrt(sum_pos_sq / n);
+    result.nees_ori = sum_nees_ori / n;
+    result.nees_pos = sum_nees_pos / n;
+    result.time_frame_ms = sum_time / n;
+    result.valid = std::isfinite(result.rmse_ori) && std::isfinite(result.rmse_pos) && std::isfinite(result.nees_ori) &&
+                   std::isfinite(result.nees_pos);
+  }
+  return result;
+}
+
+/// Mean and standard deviation of the valid runs
+void print_stats(const std::string &name, const std::vector<RunResult> &results, std::function<double(const RunResult &)> get) {
+  std::vector<double> values;
+  for (const auto &result : results) {
+    if (result.valid)
+      values.push_back(get(result));
+  }
+  if (values.empty())
+    return;
+  double mean = 0.0, std = 0.0;
+  for (const auto &value : values)
+    mean += value;
+  mean /= (double)values.size();
+  for (const auto &value : values)
+    std += std::pow(value - mean, 2);
+  std = (values.size() > 1) ? std::sqrt(std / (double)(values.size() - 1)) : 0.0;
+  PRINT_INFO(REDPURPLE "[MC]: %-22s %10.4f +- %.4f\n" RESET, name.c_str(), mean, std);
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Ensure we have a config and number of runs
+  if (argc < 3) {
+    PRINT_ERROR(RED "usage: %s <config.yaml> <num_runs> [num_threads] [output_folder]\n" RESET, argv[0]);
+    std::exit(EXIT_FAILURE);
+  }
+  std::string config_path = argv[1];
+  int num_runs = std::max(1, std::stoi(argv[2]));
+  int num_threads = (argc > 3) ? std::stoi(argv[3]) : (int)std::thread::hardware_concurrency();
+  num_threads = std::max(1, std::min(num_threads, num_runs));
+  std::string path_output = (argc > 4) ? argv[4] : "/tmp/ov_montecarlo";
+
+  // Load the config
+  auto parser = std::make_shared<ov_core::YamlParser>(config_path);
+
+  // Verbosity, we do not want the debug output of all runs mixed together
+  std::string verbosity = "INFO";
+  parser->parse_config("verbosity", verbosity);
+  if (verbosity == "ALL" || verbosity == "DEBUG" || verbosity == "INFO")
+    verbosity = "WARNING";
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Load the parameters every run will be created from
+  VioManagerOptions params;
+  params.print_and_load(parser);
+  params.print_and_load_simulation(parser);
+  if (!parser->successful()) {
+    PRINT_ERROR(RED "unable to parse all parameters, please fix\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  signal(SIGINT, signal_callback_handler);
+  ov_core::Printer::setPrintLevel("INFO");
+  PRINT_INFO("[MC]: running %d runs on %d threads (measurement seeds %d to %d), saving to %s\n", num_runs, num_threads,
+             params.sim_seed_measurements, params.sim_seed_measurements + num_runs - 1, path_output.c_str());
+  ov_core::Printer::setPrintLevel(verbosity);
+
+  // Each thread takes the next run which has not been started
+  // Every run has its own simulator and estimator, so the runs are independent of each other and of the thread they ran on
+  std::vector<RunResult> results((size_t)num_runs);
+  std::atomic<int> next_run(0);
+  std::mutex mtx_print;
+  std::vector<std::thread> threads;
+  auto rT1 = boost::posix_time::microsec_clock::local_time();
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&] {
+      int run;
+      while ((run = next_run++) < num_runs) {
+        std::stringstream ss;
+        ss << path_output << "/run_" << std::setfill('0') << std::setw(3) << run;
+        results.at(run) = run_simulation(params, run, ss.str());
+        std::lock_guard<std::mutex> lck(mtx_print);
+        const RunResult &r = results.at(run);
+        printf("[MC]: run %3d %s | %5zu updates | rmse %7.3f deg %7.3f m | nees %7.3f %7.3f | %6.2f ms/frame | %6.1f s\n", run,
+               (r.valid) ? "done  " : "FAILED", r.num_updates, r.rmse_ori, r.rmse_pos, r.nees_ori, r.nees_pos, r.time_frame_ms,
+               r.time_wall);
+        fflush(stdout);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  auto rT2 = boost::posix_time::microsec_clock::local_time();
+  double time_total = (rT2 - rT1).total_microseconds() * 1e-6;
+
+  // Save the results of each run
+  std::ofstream of_summary(path_output + "/summary.csv");
+  of_summary << "run,valid,updates,rmse_ori_deg,rmse_pos_m,nees_ori,nees_pos,ms_per_frame,wall_sec" << std::endl;
+  int num_valid = 0;
+  double time_runs = 0.0;
+  for (const auto &r : results) {
+    of_summary << r.run << "," << (int)r.valid << "," << r.num_updates << "," << r.rmse_ori << "," << r.rmse_pos << "," << r.nees_ori << ","
+               << r.nees_pos << "," << r.time_frame_ms << "," << r.time_wall << std::endl;
+    num_valid += (int)r.valid;
+    time_runs += r.time_wall;
+  }
+
+  // Aggregate over all runs
+  ov_core::Printer::setPrintLevel("INFO");
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+  PRINT_INFO(REDPURPLE "[MC]: %d of %d runs finished in %.1f seconds (%.1f seconds of runs, %.1fx speedup)\n" RESET, num_valid, num_runs,
+             time_total, time_runs, time_runs / std::max(time_total, 1e-9));
+  print_stats("rmse ori (deg)", results, [](const RunResult &r) { return r.rmse_ori; });
+  print_stats("rmse pos (m)", results, [](const RunResult &r) { return r.rmse_pos; });
+  print_stats("nees ori (expect 3)", results, [](const RunResult &r) { return r.nees_ori; });
+  print_stats("nees pos (expect 3)", results, [](const RunResult &r) { return r.nees_pos; });
+  print_stats("time (ms/frame)", results, [](const RunResult &r) { return r.time_frame_ms; });
+  PRINT_INFO(REDPURPLE "======================================\n" RESET);
+
+  // Done!
+  return (num_valid == num_runs) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -163,42 +163,53 @@ Simulator::Simulator(VioManagerOptions &params_) {
   // double dt = 0.25/freq_cam;
   double dt = 0.25;
   size_t mapsize = featmap.size();
+  featgrid = ov_core::LandmarkGrid(std::max(0.5, 0.25 * params.sim_max_feature_gen_distance));
+  for (int i = 0; i < params.state_options.num_cameras; i++) {
+    cam_fov_bounds.push_back(ov_core::LandmarkGrid::compute_fov_bounds(params.camera_intrinsics.at(i)));
+  }
   PRINT_DEBUG("[SIM]: Generating map features at %d rate\n", (int)(1.0 / dt));
 
+  // Get the pose of each frame we will generate features in (until we reach the end of the spline)
+  // These are the same for every camera, so we evaluate the spline in batches once
+  std::vector<ov_core::BsplineSE3::Sample> frames, samples;
+  std::vector<double> timestamps;
+  double time_synth = spline->get_start_time();
+  bool reached_end = false;
+  while (!reached_end) {
+    timestamps.clear();
+    for (int k = 0; k < 100; k++) {
+      timestamps.push_back(time_synth);
+      time_synth += dt;
+    }
+    spline->get_samples(timestamps, samples, 0);
+    for (const auto &sample : samples) {
+      if (!sample.valid) {
+        reached_end = true;
+        break;
+      }
+      frames.push_back(sample);
+    }
+  }
+
   // Loop through each camera
   // NOTE: we loop through cameras here so that the feature map for camera 1 will always be the same
   // NOTE: thus when we add more cameras the first camera should get the same measurements
   for (int i = 0; i < params.state_options.num_cameras; i++) {
 
-    // Reset the start time
-    double time_synth = spline->get_start_time();
-
     // Loop through each pose and generate our feature map in them!!!!
-    while (true) {
-
-      // Get the pose at the current timestep
-      Eigen::Matrix3d R_GtoI;
-      Eigen::Vector3d p_IinG;
-      bool success_pose = spline->get_pose(time_synth, R_GtoI, p_IinG);
-
-      // We have finished generating features
-      if (!success_pose)
-        break;
+    for (const auto &frame : frames) {
 
       // Get the uv features for this frame
-      std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+      std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(frame.R_GtoI, frame.p_IinG, i, featgrid);
       // If we do not have enough, generate more
       if ((int)uvs.size() < params.num_pts) {
-        generate_points(R_GtoI, p_IinG, i, featmap, params.num_pts - (int)uvs.size());
+        generate_points(frame.R_GtoI, frame.p_IinG, i, featmap, params.num_pts - (int)uvs.size());
       }
-
-      // Move forward in time
-      time_synth += dt;
     }
 
     // Debug print
     PRINT_DEBUG("[SIM]: Generated %d map features in total over %d frames (camera %d)\n", (int)(featmap.size() - mapsize),
-                (int)((time_synth - spline->get_start_time()) / dt), i);
+                (int)frames.size(), i);
     mapsize = featmap.size();
   }
 
@@ -415,7 +426,7 @@ bool Simulator::get_next_cam(double &time_cam, std::vector<int> &camids,
   for (int i = 0; i < params.state_options.num_cameras; i++) {
 
     // Get the uv features for this frame
-    std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featmap);
+    std::vector<std::pair<size_t, Eigen::VectorXf>> uvs = project_pointcloud(R_GtoI, p_IinG, i, featgrid);
 
     // If we do not have enough, generate more
     if ((int)uvs.size() < params.num_pts) {
@@ -452,7 +463,7 @@ bool Simulator::get_next_cam(double &time_cam, std::vector<int> &camids,
 
 std::vector<std::pair<size_t, Eigen::VectorXf>> Simulator::project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG,
                                                                               int camid,
-                                                                              const std::unordered_map<size_t, Eigen::Vector3d> &feats) {
+                                                                              const ov_core::LandmarkGrid &feats) {
 
   // Assert we have good camera
   assert(camid < params.state_options.num_cameras);
@@ -464,37 +475,46 @@ std::vector<std::pair<size_t, Eigen::VectorXf>> Simulator::project_pointcloud(co
   Eigen::Matrix<double, 3, 1> p_IinC = params.camera_extrinsics.at(camid).block(4, 0, 3, 1);
   std::shared_ptr<ov_core::CamBase> camera = params.camera_intrinsics.at(camid);
 
-  // Our projected uv true measurements
-  std::vector<std::pair<size_t, Eigen::VectorXf>> uvs;
-
-  // Loop through our map
-  for (const auto &feat : feats) {
-
-    // Transform feature into current camera frame
-    Eigen::Vector3d p_FinI = R_GtoI * (feat.second - p_IinG);
-    Eigen::Vector3d p_FinC = R_ItoC * p_FinI + p_IinC;
-
-    // Skip cloud if too far away
+  // Only get the features which are close to the frustum of this camera
+  Eigen::Matrix3d R_GtoC = R_ItoC * R_GtoI;
+  Eigen::Vector3d p_CinG = p_IinG - R_GtoC.transpose() * p_IinC;
+  std::vector<size_t> ids;
+  std::vector<Eigen::Vector3d> points;
+  feats.query_frustum(R_GtoC, p_CinG, cam_fov_bounds.at(camid), 0.1, params.sim_max_feature_gen_distance, ids, points);
+
+  // Transform features into current camera frame and project to normalized coordinates
+  // Skip cloud if too far away
+  std::vector<size_t> ids_front;
+  Eigen::Matrix2Xf uvs_norm(2, points.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    Eigen::Vector3d p_FinC = R_GtoC * (points.at(i) - p_CinG);
     if (p_FinC(2) > params.sim_max_feature_gen_distance || p_FinC(2) < 0.1)
       continue;
+    uvs_norm.col((Eigen::Index)ids_front.size()) << (float)(p_FinC(0) / p_FinC(2)), (float)(p_FinC(1) / p_FinC(2));
+    ids_front.push_back(ids.at(i));
+  }
+  uvs_norm.conservativeResize(2, (Eigen::Index)ids_front.size());
 
-    // Project to normalized coordinates
-    Eigen::Vector2f uv_norm;
-    uv_norm << (float)(p_FinC(0) / p_FinC(2)), (float)(p_FinC(1) / p_FinC(2));
+  // Distort the normalized coordinates
+  Eigen::Matrix2Xf uvs_dist;
+  camera->distort_batch(uvs_norm, uvs_dist);
 
-    // Distort the normalized coordinates
-    Eigen::Vector2f uv_dist = camera->distort_f(uv_norm);
+  // Our projected uv true measurements
+  std::vector<std::pair<size_t, Eigen::VectorXf>> uvs;
+  for (size_t i = 0; i < ids_front.size(); i++) {
 
     // Check that it is inside our bounds
+    Eigen::Vector2f uv_dist = uvs_dist.col((Eigen::Index)i);
     if (uv_dist(0) < 0 || uv_dist(0) > camera->w() || uv_dist(1) < 0 || uv_dist(1) > camera->h()) {
       continue;
     }
 
     // Else we can add this as a good projection
-    uvs.push_back({feat.first, uv_dist});
+    uvs.push_back({ids_front.at(i), uv_dist});
   }
 
-  // Return our projections
+  // Sort by id so the order does not depend on how the map is stored
+  std::sort(uvs.begin(), uvs.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
   return uvs;
 }
 
@@ -542,6 +562,7 @@ void Simulator::generate_points(const Eigen::Matrix3d &R_GtoI, const Eigen::Vect
 
     // Append this as a new feature
     featmap.insert({id_map, p_FinG});
+    featgrid.insert(id_map, p_FinG);
     id_map++;
   }
 }
@@ -31,6 +31,7 @@
 #include <unordered_map>
 
 #include "core/VioManagerOptions.h"
+#include "sim/LandmarkGrid.h"
 
 namespace ov_core {
 class BsplineSE3;
@@ -124,10 +125,10 @@ protected:
    * @param p_IinG Position of the IMU pose
    * @param camid Camera id of the camera sensor we want to project into
    * @param feats Our set of 3d features
-   * @return True distorted raw image measurements and their ids for the specified camera
+   * @return True distorted raw image measurements and their ids for the specified camera (sorted by id)
    */
   std::vector<std::pair<size_t, Eigen::VectorXf>> project_pointcloud(const Eigen::Matrix3d &R_GtoI, const Eigen::Vector3d &p_IinG,
-                                                                     int camid, const std::unordered_map<size_t, Eigen::Vector3d> &feats);
+                                                                     int camid, const ov_core::LandmarkGrid &feats);
 
   /**
    * @brief Will generate points in the fov of the specified camera
@@ -161,6 +162,12 @@ protected:
   size_t id_map = 0;
   std::unordered_map<size_t, Eigen::Vector3d> featmap;
 
+  /// Spatial index of our map, so we only need to project the features near each camera frustum
+  ov_core::LandmarkGrid featgrid;
+
+  /// Extent of the normalized image plane of each camera (x_min, x_max, y_min, y_max)
+  std::vector<Eigen::Vector4d> cam_fov_bounds;
+
   /// Mersenne twister PRNG for measurements (IMU)
   std::mt19937 gen_meas_imu;
 
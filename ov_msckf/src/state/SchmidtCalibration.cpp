@@ -0,0 +1,116 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "SchmidtCalibration.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "State.h"
+#include "StateHelper.h"
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+SchmidtCalibration::SchmidtCalibration(int window, double std_ratio, double nis_thresh, double nis_alpha)
+    : _window(std::max(window, 1)), _std_ratio(std_ratio), _nis_thresh(nis_thresh), _nis_alpha(nis_alpha) {}
+
+void SchmidtCalibration::feed_update(std::shared_ptr<State> state) {
+
+  // Update our running average of the innovation
+  double nis;
+  if (StateHelper::get_update_nis(state, nis)) {
+    _nis_avg = (_nis_avg < 0.0) ? nis : _nis_alpha * nis + (1.0 - _nis_alpha) * _nis_avg;
+  }
+
+  // Get the calibration we are estimating
+  std::vector<std::shared_ptr<Type>> vars;
+  std::vector<std::string> names;
+  get_calibration(state, vars, names);
+
+  // If our innovation has degraded, then all calibration should be corrected again
+  // We clear the history so they need a full window to be considered converged again
+  if (_num_consider > 0 && _nis_avg > _nis_thresh) {
+    PRINT_WARNING(YELLOW "[SCHMIDT]: innovation %.2f > %.2f, re-activating %d calibration states\n" RESET, _nis_avg, _nis_thresh,
+                  _num_consider);
+    for (const auto &var : vars) {
+      StateHelper::set_consider(state, var, false);
+    }
+    _std_history.clear();
+    _num_consider = 0;
+    return;
+  }
+
+  // Only switch to consider states when the innovation is comfortably below our threshold (hysteresis)
+  bool innovation_good = (_nis_avg < 0.0 || _nis_avg < 0.5 * (1.0 + _nis_thresh));
+
+  // Record the standard deviation of each active variable and check if it has converged
+  for (size_t i = 0; i < vars.size(); i++) {
+    if (StateHelper::is_consider(state, vars.at(i)))
+      continue;
+    Eigen::MatrixXd cov = StateHelper::get_marginal_covariance(state, {vars.at(i)});
+    std::deque<Eigen::VectorXd> &history = _std_history[vars.at(i)];
+    history.push_back(cov.diagonal().cwiseMax(0.0).cwiseSqrt());
+    if ((int)history.size() <= _window)
+      continue;
+    history.pop_front();
+
+    // Relative change of each dimension over the window
+    const Eigen::VectorXd &std_old = history.front();
+    const Eigen::VectorXd &std_new = history.back();
+    double max_ratio = 0.0;
+    for (int k = 0; k < std_new.rows(); k++) {
+      max_ratio = std::max(max_ratio, std::abs(std_old(k) - std_new(k)) / std::max(std_old(k), 1e-12));
+    }
+    if (!innovation_good || max_ratio > _std_ratio)
+      continue;
+
+    // Converged, so we no longer need to correct it
+    StateHelper::set_consider(state, vars.at(i), true);
+    _std_history.erase(vars.at(i));
+    _num_consider++;
+    PRINT_DEBUG("[SCHMIDT]: %s converged (std change %.3f over %d updates), now a consider state\n", names.at(i).c_str(), max_ratio,
+                _window);
+  }
+}
+
+void SchmidtCalibration::get_calibration(std::shared_ptr<State> state, std::vector<std::shared_ptr<Type>> &vars,
+                                         std::vector<std::string> &names) {
+  if (state->_options.do_calib_camera_timeoffset) {
+    vars.push_back(state->_calib_dt_CAMtoIMU);
+    names.push_back("time offset");
+  }
+  for (int i = 0; i < state->_options.num_cameras; i++) {
+    if (state->_options.do_calib_camera_pose) {
+      vars.push_back(state->_calib_IMUtoCAM.at(i));
+      names.push_back("cam" + std::to_string(i) + " extrinsics");
+    }
+    if (state->_options.do_calib_camera_intrinsics) {
+      vars.push_back(state->_cam_intrinsics.at(i));
+      names.push_back("cam" + std::to_string(i) + " intrinsics");
+    }
+  }
+}
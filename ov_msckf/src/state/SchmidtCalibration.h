@@ -0,0 +1,110 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OV_MSCKF_SCHMIDTCALIBRATION_H
+#define OV_MSCKF_SCHMIDTCALIBRATION_H
+
+#include <Eigen/Eigen>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ov_type {
+class Type;
+} // namespace ov_type
+
+namespace ov_msckf {
+
+class State;
+
+/**
+ * @brief Switches converged calibration parameters to Schmidt "consider" states.
+ *
+ * After each update we record the marginal standard deviation of the online camera calibration (time offset, extrinsics, and intrinsics).
+ * Once this has stopped shrinking (relative change over a window of updates is below a threshold) we consider the calibration converged.
+ * It is then turned into a consider state with StateHelper::set_consider(): its covariance is still propagated and accounted for in the
+ * updates, but no correction is computed for it. This saves computing the gain and covariance update rows of the calibration.
+ *
+ * To detect a calibration which has changed (or converged to a wrong value), we monitor the normalized innovation squared of the updates.
+ * If its running average goes over a threshold, all calibration is made active again and needs to re-converge before it is switched back.
+ */
+class SchmidtCalibration {
+
+public:
+  /**
+   * @brief Default constructor
+   * @param window Number of updates the standard deviation needs to have been flat for
+   * @param std_ratio Largest relative change in standard deviation over the window to be converged
+   * @param nis_thresh Average normalized innovation squared (per dimension) above which we re-activate the calibration
+   * @param nis_alpha Smoothing factor of the running average of the normalized innovation squared
+   */
+  SchmidtCalibration(int window, double std_ratio, double nis_thresh, double nis_alpha = 0.1);
+
+  /**
+   * @brief Should be called after all updates of a timestep have been performed
+   * @param state Pointer to state
+   */
+  void feed_update(std::shared_ptr<State> state);
+
+  /// Number of calibration variables which are currently consider states
+  int num_consider() const { return _num_consider; }
+
+  /// Running average of the normalized innovation squared (negative if we have not seen an update yet)
+  double nis_average() const { return _nis_avg; }
+
+protected:
+  /**
+   * @brief Gets all calibration variables which are being estimated online
+   * @param state Pointer to state
+   * @param vars Calibration variables
+   * @param names Human readable name of each variable
+   */
+  static void get_calibration(std::shared_ptr<State> state, std::vector<std::shared_ptr<ov_type::Type>> &vars,
+                             std::vector<std::string> &names);
+
+  /// Number of updates in our window
+  int _window;
+
+  /// Largest relative change in standard deviation to be converged
+  double _std_ratio;
+
+  /// Innovation threshold to re-activate the calibration
+  double _nis_thresh;
+
+  /// Smoothing of our innovation average
+  double _nis_alpha;
+
+  /// Running average of the normalized innovation squared
+  double _nis_avg = -1.0;
+
+  /// History of the marginal standard deviation of each active calibration variable
+  std::map<std::shared_ptr<ov_type::Type>, std::deque<Eigen::VectorXd>> _std_history;
+
+  /// Number of consider states
+  int _num_consider = 0;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_SCHMIDTCALIBRATION_H
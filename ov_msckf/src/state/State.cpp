@@ -163,4 +163,11 @@ State::State(StateOptions &options) {
           std::pow(0.005, 2) * Eigen::MatrixXd::Identity(4, 4);
     }
   }
+
+  // If we are using the square-root form, then only store the factor
+  if (_options.use_sqrt_covariance) {
+    Eigen::MatrixXd L = _Cov.llt().matrixL();
+    _Cov_sqrt = L.cast<float>();
+    _Cov.resize(0, 0);
+  }
 }
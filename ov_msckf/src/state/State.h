@@ -25,6 +25,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <unordered_map>
 #include <vector>
 
@@ -59,12 +60,15 @@ public:
 
   /**
    * @brief Will return the timestep that we will marginalize next.
-   * As of right now, since we are using a sliding window, this is the oldest clone.
-   * But if you wanted to do a keyframe system, you could selectively marginalize clones.
+   * Normally, since we are using a sliding window, this is the oldest clone.
+   * If we are using keyframes (StateOptions::use_keyframe_clones) and the VioManager has found a redundant clone, then this is returned.
    * @return timestep of clone we will marginalize
    */
   double margtimestep() {
     std::lock_guard<std::mutex> lock(_mutex_state);
+    if (_options.use_keyframe_clones && _clones_IMU.find(_marg_redundant_timestep) != _clones_IMU.end()) {
+      return _marg_redundant_timestep;
+    }
     double time = INFINITY;
     for (const auto &clone_imu : _clones_IMU) {
       if (clone_imu.first < time) {
@@ -74,11 +78,20 @@ public:
     return time;
   }
 
+  /**
+   * @brief Will return the timestep of the oldest clone in our window.
+   * @return timestep of the oldest clone (infinity if we have no clones)
+   */
+  double oldesttimestep() {
+    std::lock_guard<std::mutex> lock(_mutex_state);
+    return (_clones_IMU.empty()) ? INFINITY : _clones_IMU.begin()->first;
+  }
+
   /**
    * @brief Calculates the current max size of the covariance
    * @return Size of the current covariance matrix
    */
-  int max_covariance_size() { return (int)_Cov.rows(); }
+  int max_covariance_size() { return (_options.use_sqrt_covariance) ? (int)_Cov_sqrt.rows() : (int)_Cov.rows(); }
 
   /**
    * @brief Gyroscope and accelerometer intrinsic matrix (scale imperfection and axis misalignment)
@@ -149,6 +162,9 @@ public:
   /// Map between imaging times and clone poses (q_GtoIi, p_IiinG)
   std::map<double, std::shared_ptr<ov_type::PoseJPL>> _clones_IMU;
 
+  /// Timestamp of a redundant (non-keyframe) clone which should be marginalized instead of the oldest (-1 if none)
+  double _marg_redundant_timestep = -1;
+
   /// Our current set of SLAM features (3d positions)
   std::unordered_map<size_t, std::shared_ptr<ov_type::Landmark>> _features_SLAM;
 
@@ -188,8 +204,32 @@ private:
   /// Covariance of all active variables
   Eigen::MatrixXd _Cov;
 
+  /// Square-root factor of the covariance of all active variables (P = S*S^T), only used if StateOptions::use_sqrt_covariance is set.
+  /// Each row corresponds to a state element, and the number of columns can grow until the StateHelper re-triangulates it.
+  Eigen::MatrixXf _Cov_sqrt;
+
   /// Vector of variables
   std::vector<std::shared_ptr<ov_type::Type>> _variables;
+
+  /// Variables which are Schmidt "consider" states (in the covariance, but have a zero Kalman gain)
+  std::set<std::shared_ptr<ov_type::Type>> _variables_consider;
+
+  /// Covariance indices whose cross-covariance with the rest of the state has not been propagated yet
+  /// See StateOptions::use_deferred_propagation and StateHelper::apply_deferred_propagation()
+  std::vector<int> _deferred_ids;
+
+  /// Location of each covariance index in _deferred_ids (-1 if it is not deferred), so we don't need to search for it
+  std::vector<int> _deferred_locs;
+
+  /// Covariance indices of the rows (at the time propagation was deferred) that the deferred cross-covariances are a function of
+  std::vector<int> _deferred_base_ids;
+
+  /// Accumulated transition of the deferred rows, their cross-covariance with the rest is _deferred_Phi * P(_deferred_base_ids, rest)
+  Eigen::MatrixXd _deferred_Phi;
+
+  /// Sum of the normalized innovation squared and its degrees of freedom since it was last queried
+  double _update_nis_sum = 0.0;
+  int _update_nis_dof = 0;
 };
 
 } // namespace ov_msckf
@@ -21,6 +21,7 @@
 
 #include "StateHelper.h"
 
+#include "feat/Feature.h"
 #include "state/State.h"
 
 #include "types/Landmark.h"
@@ -75,6 +76,98 @@ void StateHelper::EKFPropagation(std::shared_ptr<State> state, const std::vector
     current_it += var->size();
   }
 
+  // If we are in square-root form, then the new rows are just the state transition times the old rows
+  // The propagation noise is then appended as new columns of the factor (which are zero for all other variables)
+  if (state->_options.use_sqrt_covariance) {
+    Eigen::MatrixXf S_new = Phi.cast<float>() * get_sqrt_rows(state, order_OLD);
+    Eigen::MatrixXf Q_sqrt = sqrt_psd(Q.selfadjointView<Eigen::Upper>()).cast<float>();
+    int start_id = order_NEW.at(0)->id();
+    int old_cols = (int)state->_Cov_sqrt.cols();
+    state->_Cov_sqrt.conservativeResize(Eigen::NoChange, old_cols + Q_sqrt.cols());
+    state->_Cov_sqrt.rightCols(Q_sqrt.cols()).setZero();
+    state->_Cov_sqrt.block(start_id, 0, S_new.rows(), old_cols) = S_new;
+    state->_Cov_sqrt.block(start_id, old_cols, Q_sqrt.rows(), Q_sqrt.cols()) = Q_sqrt;
+    sqrt_compress(state);
+    if (!state->_Cov_sqrt.allFinite()) {
+      PRINT_ERROR(RED "StateHelper::EKFPropagation() - square-root covariance is not finite\n" RESET)
+      std::exit(EXIT_FAILURE);
+    }
+    return;
+  }
+
+  // If we are deferring propagation, then we only propagate the deferred rows (normally the IMU and its new clones)
+  // Their cross-covariance with the rest of the state is just the accumulated state transition times their old rows
+  // We need to apply it before we can propagate any variable that is not deferred (or have a transition between variables)
+  if (state->_options.use_deferred_propagation && order_NEW == order_OLD) {
+
+    // Location of each propagated element in our deferred rows
+    std::vector<int> Phi_loc;
+    for (const auto &var : order_OLD) {
+      for (int i = 0; i < var->size(); i++) {
+        Phi_loc.push_back(deferred_index(state, var->id() + i));
+      }
+    }
+    if (std::find(Phi_loc.begin(), Phi_loc.end(), -1) != Phi_loc.end()) {
+      apply_deferred_propagation(state);
+    }
+
+    // Start deferring these variables if we are not already
+    // If we are calibrating the time offset, then our clones will also be a function of it
+    if (state->_deferred_ids.empty()) {
+      state->_deferred_locs.assign((size_t)state->_Cov.rows(), -1);
+      for (const auto &var : order_OLD) {
+        for (int i = 0; i < var->size(); i++) {
+          state->_deferred_locs.at(var->id() + i) = (int)state->_deferred_ids.size();
+          state->_deferred_ids.push_back(var->id() + i);
+        }
+      }
+      state->_deferred_base_ids = state->_deferred_ids;
+      if (state->_options.do_calib_camera_timeoffset) {
+        state->_deferred_base_ids.push_back(state->_calib_dt_CAMtoIMU->id());
+      }
+      state->_deferred_Phi = Eigen::MatrixXd::Identity(state->_deferred_ids.size(), state->_deferred_base_ids.size());
+      for (size_t i = 0; i < Phi_loc.size(); i++) {
+        Phi_loc.at(i) = (int)i;
+      }
+    }
+
+    // State transition and noise of all deferred rows (identity for the ones not being propagated)
+    int deferred_size = (int)state->_deferred_ids.size();
+    Eigen::MatrixXd Q_full = Q.selfadjointView<Eigen::Upper>();
+    Eigen::MatrixXd Phi_deferred = Eigen::MatrixXd::Identity(deferred_size, deferred_size);
+    Eigen::MatrixXd Q_deferred = Eigen::MatrixXd::Zero(deferred_size, deferred_size);
+    for (int r = 0; r < Phi.rows(); r++) {
+      for (int c = 0; c < Phi.cols(); c++) {
+        Phi_deferred(Phi_loc.at(r), Phi_loc.at(c)) = Phi(r, c);
+        Q_deferred(Phi_loc.at(r), Phi_loc.at(c)) = Q_full(r, c);
+      }
+    }
+
+    // Propagate the covariance of the deferred rows, and accumulate the transition for their cross-covariance
+    Eigen::MatrixXd P_deferred(deferred_size, deferred_size);
+    for (int r = 0; r < deferred_size; r++) {
+      for (int c = 0; c < deferred_size; c++) {
+        P_deferred(r, c) = state->_Cov(state->_deferred_ids.at(r), state->_deferred_ids.at(c));
+      }
+    }
+    P_deferred = Phi_deferred * P_deferred * Phi_deferred.transpose() + Q_deferred;
+    for (int r = 0; r < deferred_size; r++) {
+      for (int c = 0; c < deferred_size; c++) {
+        state->_Cov(state->_deferred_ids.at(r), state->_deferred_ids.at(c)) = P_deferred(r, c);
+      }
+      if (P_deferred(r, r) < 0.0) {
+        PRINT_WARNING(RED "StateHelper::EKFPropagation() - diagonal at %d is %.2f\n" RESET, state->_deferred_ids.at(r), P_deferred(r, r))
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    state->_deferred_Phi = Phi_deferred * state->_deferred_Phi;
+    return;
+  }
+
+  // We read the cross-covariance of every old variable with the whole state, so any deferred propagation needs to be applied first
+  // For example an anchor change propagates a landmark from the clones, which can still have deferred rows
+  apply_deferred_propagation(state);
+
   // Loop through all our old states and get the state transition times it
   // Cov_PhiT = [ Pxx ] [ Phi' ]'
   Eigen::MatrixXd Cov_PhiT = Eigen::MatrixXd::Zero(state->_Cov.rows(), Phi.rows());
@@ -116,6 +209,15 @@ void StateHelper::EKFPropagation(std::shared_ptr<State> state, const std::vector
 void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &H_order, const Eigen::MatrixXd &H,
                             const Eigen::VectorXd &res, const Eigen::MatrixXd &R) {
 
+  // If we are in square-root form, then we do the update with a QR of the pre-array
+  if (state->_options.use_sqrt_covariance) {
+    EKFUpdateSqrt(state, H_order, H, res, R);
+    return;
+  }
+
+  // The update changes all cross-covariances, so we need the propagated ones
+  apply_deferred_propagation(state);
+
   //==========================================================
   //==========================================================
   // Part of the Kalman Gain K = (P*H^T)*S^{-1} = M*S^{-1}
@@ -159,14 +261,47 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
   // Invert our S (should we use a more stable method here??)
   Eigen::MatrixXd Sinv = Eigen::MatrixXd::Identity(R.rows(), R.rows());
   S.selfadjointView<Eigen::Upper>().llt().solveInPlace(Sinv);
-  Eigen::MatrixXd K = M_a * Sinv.selfadjointView<Eigen::Upper>();
-  // Eigen::MatrixXd K = M_a * S.inverse();
 
-  // Update Covariance
-  state->_Cov.triangularView<Eigen::Upper>() -= K * M_a.transpose();
-  state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
-  // Cov -= K * M_a.transpose();
-  // Cov = 0.5*(Cov+Cov.transpose());
+  // Record the normalized innovation squared, used to detect if our consider states should be re-activated
+  if (state->_options.use_schmidt_calib) {
+    state->_update_nis_sum += res.dot(Sinv.selfadjointView<Eigen::Upper>() * res);
+    state->_update_nis_dof += (int)res.rows();
+  }
+
+  Eigen::MatrixXd K;
+  if (state->_variables_consider.empty()) {
+
+    // Normal update of all variables
+    K = M_a * Sinv.selfadjointView<Eigen::Upper>();
+    // Eigen::MatrixXd K = M_a * S.inverse();
+
+    // Update Covariance
+    state->_Cov.triangularView<Eigen::Upper>() -= K * M_a.transpose();
+    state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
+    // Cov -= K * M_a.transpose();
+    // Cov = 0.5*(Cov+Cov.transpose());
+
+  } else {
+
+    // Schmidt update, the consider variables have a zero gain (K_c = 0)
+    // Thus P_aa -= K_a*M_a^T and P_ac -= K_a*M_c^T, while P_cc does not change
+    K = Eigen::MatrixXd::Zero(M_a.rows(), M_a.cols());
+    for (const auto &var : state->_variables) {
+      if (is_consider(state, var))
+        continue;
+      K.block(var->id(), 0, var->size(), K.cols()).noalias() =
+          M_a.block(var->id(), 0, var->size(), M_a.cols()) * Sinv.selfadjointView<Eigen::Upper>();
+      state->_Cov.block(var->id(), 0, var->size(), state->_Cov.cols()).noalias() -=
+          K.block(var->id(), 0, var->size(), K.cols()) * M_a.transpose();
+    }
+
+    // The consider rows were not touched, so copy the updated cross-terms from their columns
+    for (const auto &var : state->_variables_consider) {
+      Eigen::MatrixXd P_xc = state->_Cov.block(0, var->id(), state->_Cov.rows(), var->size());
+      state->_Cov.block(var->id(), 0, var->size(), state->_Cov.cols()) = P_xc.transpose();
+    }
+    state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
+  }
 
   // We should check if we are not positive semi-definitate (i.e. negative diagionals is not s.p.d)
   Eigen::VectorXd diags = state->_Cov.diagonal();
@@ -184,6 +319,8 @@ void StateHelper::EKFUpdate(std::shared_ptr<State> state, const std::vector<std:
   // Calculate our delta and update all our active states
   Eigen::VectorXd dx = K * res;
   for (size_t i = 0; i < state->_variables.size(); i++) {
+    if (is_consider(state, state->_variables.at(i)))
+      continue;
     state->_variables.at(i)->update(dx.block(state->_variables.at(i)->id(), 0, state->_variables.at(i)->size(), 1));
   }
 
@@ -208,6 +345,13 @@ void StateHelper::set_initial_covariance(std::shared_ptr<State> state, const Eig
   // The key assumption here is that the covariance is block diagonal (cross-terms zero with P* can be dense)
   // This is normally the care on startup (for example between calibration and the initial state
 
+  // If we are in square-root form, we recover the full covariance, overwrite it, and re-factor it
+  // This only happens on initialization so it is fine that it is slow
+  if (state->_options.use_sqrt_covariance) {
+    state->_Cov = get_full_covariance(state);
+  }
+  apply_deferred_propagation(state);
+
   // For each variable, lets copy over all other variable cross terms
   // Note: this copies over itself to when i_index=k_index
   int i_index = 0;
@@ -221,6 +365,12 @@ void StateHelper::set_initial_covariance(std::shared_ptr<State> state, const Eig
     i_index += order[i]->size();
   }
   state->_Cov = state->_Cov.selfadjointView<Eigen::Upper>();
+
+  // Convert back into the square-root form
+  if (state->_options.use_sqrt_covariance) {
+    state->_Cov_sqrt = sqrt_psd(state->_Cov).cast<float>();
+    state->_Cov.resize(0, 0);
+  }
 }
 
 Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> state,
@@ -232,6 +382,14 @@ Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> stat
     cov_size += small_variables[i]->size();
   }
 
+  // If we are in square-root form, then just multiply the rows of our variables
+  if (state->_options.use_sqrt_covariance) {
+    Eigen::MatrixXf S_small = get_sqrt_rows(state, small_variables);
+    Eigen::MatrixXf Small_cov_f = Eigen::MatrixXf::Zero(cov_size, cov_size);
+    Small_cov_f.selfadjointView<Eigen::Lower>().rankUpdate(S_small);
+    return Small_cov_f.selfadjointView<Eigen::Lower>().toDenseMatrix().cast<double>();
+  }
+
   // Construct our return covariance
   Eigen::MatrixXd Small_cov = Eigen::MatrixXd::Zero(cov_size, cov_size);
 
@@ -248,6 +406,30 @@ Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> stat
     i_index += small_variables[i]->size();
   }
 
+  // If we have deferred propagation, then the cross-covariance between deferred and non-deferred variables still needs to be propagated
+  // We compute just these elements here (instead of applying the deferred propagation to the whole covariance)
+  if (!state->_deferred_ids.empty()) {
+    std::vector<int> small_ids, small_locs;
+    for (const auto &var : small_variables) {
+      for (int i = 0; i < var->size(); i++) {
+        small_ids.push_back(var->id() + i);
+        small_locs.push_back(deferred_index(state, var->id() + i));
+      }
+    }
+    for (int r = 0; r < cov_size; r++) {
+      for (int c = 0; c < cov_size; c++) {
+        if (small_locs.at(r) == -1 || small_locs.at(c) != -1)
+          continue;
+        double cross = 0.0;
+        for (size_t k = 0; k < state->_deferred_base_ids.size(); k++) {
+          cross += state->_deferred_Phi(small_locs.at(r), k) * state->_Cov(state->_deferred_base_ids.at(k), small_ids.at(c));
+        }
+        Small_cov(r, c) = cross;
+        Small_cov(c, r) = cross;
+      }
+    }
+  }
+
   // Return the covariance
   // Small_cov = 0.5*(Small_cov+Small_cov.transpose());
   return Small_cov;
@@ -255,6 +437,14 @@ Eigen::MatrixXd StateHelper::get_marginal_covariance(std::shared_ptr<State> stat
 
 Eigen::MatrixXd StateHelper::get_full_covariance(std::shared_ptr<State> state) {
 
+  // If we are in square-root form, then recover it from the factor
+  if (state->_options.use_sqrt_covariance) {
+    int sqrt_size = (int)state->_Cov_sqrt.rows();
+    Eigen::MatrixXf full_cov_f = Eigen::MatrixXf::Zero(sqrt_size, sqrt_size);
+    full_cov_f.selfadjointView<Eigen::Lower>().rankUpdate(state->_Cov_sqrt);
+    return full_cov_f.selfadjointView<Eigen::Lower>().toDenseMatrix().cast<double>();
+  }
+
   // Size of the covariance is the active
   int cov_size = (int)state->_Cov.rows();
 
@@ -263,6 +453,7 @@ Eigen::MatrixXd StateHelper::get_full_covariance(std::shared_ptr<State> state) {
 
   // Copy in the active state elements
   full_cov.block(0, 0, state->_Cov.rows(), state->_Cov.rows()) = state->_Cov;
+  get_deferred_cross_covariance(state, full_cov);
 
   // Return the covariance
   return full_cov;
@@ -290,29 +481,46 @@ void StateHelper::marginalize(std::shared_ptr<State> state, std::shared_ptr<Type
   //
   // i.e. x_1 goes from 0 to marg_id, x_2 goes from marg_id+marg_size to Cov.rows() in the original covariance
 
+  // Our deferred rows are stored by index, so we need to apply them before the covariance is re-ordered
+  apply_deferred_propagation(state);
+
   int marg_size = marg->size();
   int marg_id = marg->id();
-  int x2_size = (int)state->_Cov.rows() - marg_id - marg_size;
 
-  Eigen::MatrixXd Cov_new(state->_Cov.rows() - marg_size, state->_Cov.rows() - marg_size);
+  // In the square-root form, we just need to remove the rows of this variable
+  if (state->_options.use_sqrt_covariance) {
+    int x2_size_sqrt = (int)state->_Cov_sqrt.rows() - marg_id - marg_size;
+    Eigen::MatrixXf S_new(state->_Cov_sqrt.rows() - marg_size, state->_Cov_sqrt.cols());
+    S_new.topRows(marg_id) = state->_Cov_sqrt.topRows(marg_id);
+    S_new.bottomRows(x2_size_sqrt) = state->_Cov_sqrt.bottomRows(x2_size_sqrt);
+    state->_Cov_sqrt = S_new;
+    sqrt_compress(state);
+  } else {
+    int x2_size = (int)state->_Cov.rows() - marg_id - marg_size;
+
+    Eigen::MatrixXd Cov_new(state->_Cov.rows() - marg_size, state->_Cov.rows() - marg_size);
 
-  // P_(x_1,x_1)
-  Cov_new.block(0, 0, marg_id, marg_id) = state->_Cov.block(0, 0, marg_id, marg_id);
+    // P_(x_1,x_1)
+    Cov_new.block(0, 0, marg_id, marg_id) = state->_Cov.block(0, 0, marg_id, marg_id);
 
-  // P_(x_1,x_2)
-  Cov_new.block(0, marg_id, marg_id, x2_size) = state->_Cov.block(0, marg_id + marg_size, marg_id, x2_size);
+    // P_(x_1,x_2)
+    Cov_new.block(0, marg_id, marg_id, x2_size) = state->_Cov.block(0, marg_id + marg_size, marg_id, x2_size);
 
-  // P_(x_2,x_1)
-  Cov_new.block(marg_id, 0, x2_size, marg_id) = Cov_new.block(0, marg_id, marg_id, x2_size).transpose();
+    // P_(x_2,x_1)
+    Cov_new.block(marg_id, 0, x2_size, marg_id) = Cov_new.block(0, marg_id, marg_id, x2_size).transpose();
 
-  // P(x_2,x_2)
-  Cov_new.block(marg_id, marg_id, x2_size, x2_size) = state->_Cov.block(marg_id + marg_size, marg_id + marg_size, x2_size, x2_size);
+    // P(x_2,x_2)
+    Cov_new.block(marg_id, marg_id, x2_size, x2_size) = state->_Cov.block(marg_id + marg_size, marg_id + marg_size, x2_size, x2_size);
+
+    // Now set new covariance
+    // state->_Cov.resize(Cov_new.rows(),Cov_new.cols());
+    state->_Cov = Cov_new;
+    // state->Cov() = 0.5*(Cov_new+Cov_new.transpose());
+    assert(state->_Cov.rows() == Cov_new.rows());
+  }
 
-  // Now set new covariance
-  // state->_Cov.resize(Cov_new.rows(),Cov_new.cols());
-  state->_Cov = Cov_new;
-  // state->Cov() = 0.5*(Cov_new+Cov_new.transpose());
-  assert(state->_Cov.rows() == Cov_new.rows());
+  // A marginalized variable can no longer be a consider state
+  state->_variables_consider.erase(marg);
 
   // Now we keep the remaining variables and update their ordering
   // Note: DOES NOT SUPPORT MARGINALIZING SUBVARIABLES YET!!!!!!!
@@ -342,11 +550,27 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
 
   // Get total size of new cloned variables, and the old covariance size
   int total_size = variable_to_clone->size();
-  int old_size = (int)state->_Cov.rows();
-  int new_loc = (int)state->_Cov.rows();
+  int old_size = state->max_covariance_size();
+  int new_loc = state->max_covariance_size();
+
+  // If the variable we clone has deferred propagation, then the clone does also (its cross-covariance is a copy of the deferred one)
+  // Otherwise we need the propagated cross-covariances to copy
+  std::vector<int> clone_locs;
+  for (int i = 0; i < total_size && !state->_deferred_ids.empty(); i++) {
+    clone_locs.push_back(deferred_index(state, variable_to_clone->id() + i));
+  }
+  if (std::find(clone_locs.begin(), clone_locs.end(), -1) != clone_locs.end()) {
+    apply_deferred_propagation(state);
+    clone_locs.clear();
+  }
 
   // Resize both our covariance to the new size
-  state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + total_size, old_size + total_size));
+  // In the square-root form the clone is perfectly correlated, thus only needs new rows (no new columns)
+  if (state->_options.use_sqrt_covariance) {
+    state->_Cov_sqrt.conservativeResize(old_size + total_size, Eigen::NoChange);
+  } else {
+    state->_Cov.conservativeResizeLike(Eigen::MatrixXd::Zero(old_size + total_size, old_size + total_size));
+  }
 
   // What is the new state, and variable we inserted
   const std::vector<std::shared_ptr<Type>> new_variables = state->_variables;
@@ -368,9 +592,14 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
     int old_loc = type_check->id();
 
     // Copy the covariance elements
-    state->_Cov.block(new_loc, new_loc, total_size, total_size) = state->_Cov.block(old_loc, old_loc, total_size, total_size);
-    state->_Cov.block(0, new_loc, old_size, total_size) = state->_Cov.block(0, old_loc, old_size, total_size);
-    state->_Cov.block(new_loc, 0, total_size, old_size) = state->_Cov.block(old_loc, 0, total_size, old_size);
+    if (state->_options.use_sqrt_covariance) {
+      int sqrt_cols = (int)state->_Cov_sqrt.cols();
+      state->_Cov_sqrt.block(new_loc, 0, total_size, sqrt_cols) = state->_Cov_sqrt.block(old_loc, 0, total_size, sqrt_cols);
+    } else {
+      state->_Cov.block(new_loc, new_loc, total_size, total_size) = state->_Cov.block(old_loc, old_loc, total_size, total_size);
+      state->_Cov.block(0, new_loc, old_size, total_size) = state->_Cov.block(0, old_loc, old_size, total_size);
+      state->_Cov.block(new_loc, 0, total_size, old_size) = state->_Cov.block(old_loc, 0, total_size, old_size);
+    }
 
     // Create clone from the type being cloned
     new_clone = type_check->clone();
@@ -385,6 +614,18 @@ std::shared_ptr<Type> StateHelper::clone(std::shared_ptr<State> state, std::shar
     std::exit(EXIT_FAILURE);
   }
 
+  // Append the clone to our deferred rows
+  if (!clone_locs.empty()) {
+    int deferred_size = (int)state->_deferred_ids.size();
+    state->_deferred_Phi.conservativeResize(deferred_size + total_size, Eigen::NoChange);
+    state->_deferred_locs.resize((size_t)(new_loc + total_size), -1);
+    for (int i = 0; i < total_size; i++) {
+      state->_deferred_locs.at(new_loc + i) = deferred_size + i;
+      state->_deferred_ids.push_back(new_loc + i);
+      state->_deferred_Phi.row(deferred_size + i) = state->_deferred_Phi.row(clone_locs.at(i));
+    }
+  }
+
   // Add to variable list and return
   state->_variables.push_back(new_clone);
   return new_clone;
@@ -401,6 +642,9 @@ bool StateHelper::initialize(std::shared_ptr<State> state, std::shared_ptr<Type>
     std::exit(EXIT_FAILURE);
   }
 
+  // The new variable is a function of the cross-covariances, so we need the propagated ones
+  apply_deferred_propagation(state);
+
   // Check that we have isotropic noise (i.e. is diagonal and all the same value)
   // TODO: can we simplify this so it doesn't take as much time?
   assert(R.rows() == R.cols());
@@ -492,6 +736,9 @@ void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::share
     std::exit(EXIT_FAILURE);
   }
 
+  // The new variable is a function of the cross-covariances, so we need the propagated ones
+  apply_deferred_propagation(state);
+
   // Check that we have isotropic noise (i.e. is diagonal and all the same value)
   // TODO: can we simplify this so it doesn't take as much time?
   assert(R.rows() == R.cols());
@@ -510,6 +757,29 @@ void StateHelper::initialize_invertible(std::shared_ptr<State> state, std::share
     }
   }
 
+  // In the square-root form, the new variable is a linear function of the old variables and the measurement noise
+  // Thus its rows are -H_L^-1*H_R times the rows of the old variables, and its noise is appended as new columns
+  if (state->_options.use_sqrt_covariance) {
+    assert(H_L.rows() == H_L.cols());
+    assert(H_L.rows() == new_variable->size());
+    assert(H_L.rows() == H_R.rows());
+    Eigen::MatrixXd H_Linv = H_L.inverse();
+    Eigen::MatrixXf S_new = (-H_Linv * H_R).cast<float>() * get_sqrt_rows(state, H_order);
+    Eigen::MatrixXf N_new = (-H_Linv * sqrt_psd(R)).cast<float>();
+    int old_rows = (int)state->_Cov_sqrt.rows();
+    int old_cols = (int)state->_Cov_sqrt.cols();
+    state->_Cov_sqrt.conservativeResize(old_rows + new_variable->size(), old_cols + N_new.cols());
+    state->_Cov_sqrt.bottomRows(new_variable->size()).setZero();
+    state->_Cov_sqrt.rightCols(N_new.cols()).setZero();
+    state->_Cov_sqrt.block(old_rows, 0, S_new.rows(), old_cols) = S_new;
+    state->_Cov_sqrt.block(old_rows, old_cols, N_new.rows(), N_new.cols()) = N_new;
+    sqrt_compress(state);
+    new_variable->update(H_Linv * res);
+    new_variable->set_local_id(old_rows);
+    state->_variables.push_back(new_variable);
+    return;
+  }
+
   //==========================================================
   //==========================================================
   // Part of the Kalman Gain K = (P*H^T)*S^{-1} = M*S^{-1}
@@ -607,6 +877,38 @@ void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<doub
     dnc_dt.block(0, 0, 3, 1) = last_w;
     dnc_dt.block(3, 0, 3, 1) = state->_imu->vel();
     // Augment covariance with time offset Jacobian
+    // In the square-root form this is just adding the time offset row to the clone rows
+    if (state->_options.use_sqrt_covariance) {
+      state->_Cov_sqrt.block(pose->id(), 0, 6, state->_Cov_sqrt.cols()) +=
+          dnc_dt.cast<float>() * state->_Cov_sqrt.row(state->_calib_dt_CAMtoIMU->id());
+      return;
+    }
+    // If the clone is deferred, then only its deferred rows are changed now
+    // Its cross-covariance with the rest of the state also becomes a function of the time offset rows
+    auto it_dt = std::find(state->_deferred_base_ids.begin(), state->_deferred_base_ids.end(), state->_calib_dt_CAMtoIMU->id());
+    if (deferred_index(state, pose->id()) != -1 && it_dt != state->_deferred_base_ids.end()) {
+      int dt_loc = (int)(it_dt - state->_deferred_base_ids.begin());
+      int deferred_size = (int)state->_deferred_ids.size();
+      Eigen::VectorXd J = Eigen::VectorXd::Zero(deferred_size);
+      Eigen::VectorXd P_base_dt = Eigen::VectorXd::Zero(state->_deferred_base_ids.size());
+      for (int i = 0; i < 6; i++) {
+        J(deferred_index(state, pose->id() + i)) = dnc_dt(i);
+      }
+      for (size_t k = 0; k < state->_deferred_base_ids.size(); k++) {
+        P_base_dt(k) = state->_Cov(state->_deferred_base_ids.at(k), state->_calib_dt_CAMtoIMU->id());
+      }
+      Eigen::VectorXd P_deferred_dt = state->_deferred_Phi * P_base_dt;
+      double P_dt = state->_Cov(state->_calib_dt_CAMtoIMU->id(), state->_calib_dt_CAMtoIMU->id());
+      Eigen::MatrixXd P_add = J * P_deferred_dt.transpose() + P_deferred_dt * J.transpose() + P_dt * J * J.transpose();
+      for (int r = 0; r < deferred_size; r++) {
+        for (int c = 0; c < deferred_size; c++) {
+          state->_Cov(state->_deferred_ids.at(r), state->_deferred_ids.at(c)) += P_add(r, c);
+        }
+      }
+      state->_deferred_Phi.col(dt_loc) += J;
+      return;
+    }
+    apply_deferred_propagation(state);
     // TODO: replace this with a call to the EKFPropagate function instead....
     state->_Cov.block(0, pose->id(), state->_Cov.rows(), 6) +=
         state->_Cov.block(0, state->_calib_dt_CAMtoIMU->id(), state->_Cov.rows(), 1) * dnc_dt.transpose();
@@ -615,6 +917,89 @@ void StateHelper::augment_clone(std::shared_ptr<State> state, Eigen::Matrix<doub
   }
 }
 
+void StateHelper::EKFUpdateSqrt(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &H_order,
+                                const Eigen::MatrixXd &H, const Eigen::VectorXd &res, const Eigen::MatrixXd &R) {
+
+  // Our pre-array, if we triangulate it with an orthogonal transform we get the post-array
+  // [ R^1/2  H*S ]        [ S_y^1/2   0  ]
+  // [   0     S  ] * Q =  [ Kbar     S+  ]
+  // where S_y is the residual covariance, the Kalman gain is K = Kbar*S_y^-1/2, and S+ is our updated square-root factor
+  assert(res.rows() == R.rows());
+  assert(H.rows() == res.rows());
+  int num_meas = (int)res.rows();
+  int num_state = (int)state->_Cov_sqrt.rows();
+  int num_cols = (int)state->_Cov_sqrt.cols();
+  Eigen::MatrixXf pre_array_T = Eigen::MatrixXf::Zero(num_meas + num_cols, num_meas + num_state);
+  pre_array_T.block(0, 0, num_meas, num_meas) = sqrt_psd(R).transpose().cast<float>();
+  pre_array_T.block(num_meas, 0, num_cols, num_meas) = (H.cast<float>() * get_sqrt_rows(state, H_order)).transpose();
+  pre_array_T.block(num_meas, num_meas, num_cols, num_state) = state->_Cov_sqrt.transpose();
+
+  // Triangulate with a QR (of the transpose since Eigen only has a QR and not a LQ)
+  Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXf>> qr(pre_array_T);
+  Eigen::MatrixXf post_array = pre_array_T.triangularView<Eigen::Upper>().transpose();
+
+  // Get our gain and updated factor
+  // Note that if the QR gave us negative diagonals, the signs will cancel out in the gain
+  // The post-array is lower triangular, so any factor columns past the number of states are zero and can be dropped
+  Eigen::MatrixXf Sy_sqrt = post_array.block(0, 0, num_meas, num_meas);
+  Eigen::MatrixXf Kbar = post_array.block(num_meas, 0, num_state, num_meas);
+  state->_Cov_sqrt = post_array.block(num_meas, num_meas, num_state, std::min(num_cols, num_state));
+  if (!state->_Cov_sqrt.allFinite()) {
+    PRINT_ERROR(RED "StateHelper::EKFUpdate() - square-root covariance is not finite\n" RESET)
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Calculate our delta and update all our active states
+  Eigen::VectorXf res_white = Sy_sqrt.triangularView<Eigen::Lower>().solve(res.cast<float>());
+  Eigen::VectorXd dx = (Kbar * res_white).cast<double>();
+  for (size_t i = 0; i < state->_variables.size(); i++) {
+    state->_variables.at(i)->update(dx.block(state->_variables.at(i)->id(), 0, state->_variables.at(i)->size(), 1));
+  }
+
+  // If we are doing online intrinsic calibration we should update our camera objects
+  if (state->_options.do_calib_camera_intrinsics) {
+    for (auto const &calib : state->_cam_intrinsics) {
+      state->_cam_intrinsics_cameras.at(calib.first)->set_value(calib.second->value());
+    }
+  }
+}
+
+Eigen::MatrixXf StateHelper::get_sqrt_rows(std::shared_ptr<State> state, const std::vector<std::shared_ptr<Type>> &order) {
+  int total_size = 0;
+  for (const auto &var : order) {
+    total_size += var->size();
+  }
+  Eigen::MatrixXf rows(total_size, state->_Cov_sqrt.cols());
+  int current_it = 0;
+  for (const auto &var : order) {
+    rows.block(current_it, 0, var->size(), rows.cols()) = state->_Cov_sqrt.block(var->id(), 0, var->size(), rows.cols());
+    current_it += var->size();
+  }
+  return rows;
+}
+
+Eigen::MatrixXd StateHelper::sqrt_psd(const Eigen::MatrixXd &A) {
+  // Try a cholesky first, otherwise fall back to the eigen decomposition (for semi-definite)
+  Eigen::LLT<Eigen::MatrixXd> llt(A);
+  if (llt.info() == Eigen::Success) {
+    return llt.matrixL();
+  }
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(A);
+  Eigen::VectorXd eigvals = eig.eigenvalues().cwiseMax(0.0).cwiseSqrt();
+  return eig.eigenvectors() * eigvals.asDiagonal();
+}
+
+void StateHelper::sqrt_compress(std::shared_ptr<State> state) {
+  // Nothing to do until the factor is twice as wide as it is tall (we allow extra columns to build up between compressions)
+  int rows = (int)state->_Cov_sqrt.rows();
+  if (state->_Cov_sqrt.cols() <= 2 * rows)
+    return;
+  // S*S^T = S*Q*Q^T*S^T, thus if S^T = Q*R, then R^T is a square-root factor with only as many columns as rows
+  Eigen::MatrixXf S_T = state->_Cov_sqrt.transpose();
+  Eigen::HouseholderQR<Eigen::Ref<Eigen::MatrixXf>> qr(S_T);
+  state->_Cov_sqrt = S_T.topRows(rows).triangularView<Eigen::Upper>().transpose();
+}
+
 void StateHelper::marginalize_old_clone(std::shared_ptr<State> state) {
   if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
     double marginal_time = state->margtimestep();
@@ -625,7 +1010,63 @@ void StateHelper::marginalize_old_clone(std::shared_ptr<State> state) {
     // Note that the marginalizer should have already deleted the clone
     // Thus we just need to remove the pointer to it from our state
     state->_clones_IMU.erase(marginal_time);
+    state->_marg_redundant_timestep = -1;
+  }
+}
+
+bool StateHelper::select_marg_clone(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_core::Feature>> &feats) {
+
+  // By default we will marginalize the oldest clone
+  state->_marg_redundant_timestep = -1;
+  if (!state->_options.use_keyframe_clones || (int)state->_clones_IMU.size() <= state->_options.max_clone_size ||
+      state->_clones_IMU.size() < 3)
+    return false;
+
+  // The candidate is the clone before the newest, which we compare to the clone before it
+  // If the candidate is redundant it will be removed, and the next one will then be compared to the same previous clone
+  // Thus the motion between the kept clones will grow until it is large enough for a keyframe
+  auto it_clone = state->_clones_IMU.rbegin();
+  it_clone++;
+  double time_cand = it_clone->first;
+  Eigen::Matrix3d R_GtoIcand = it_clone->second->Rot();
+  it_clone++;
+  double time_prev = it_clone->first;
+  Eigen::Matrix3d R_GtoIprev = it_clone->second->Rot();
+
+  // Keyframe if we have rotated enough
+  double rotation = Eigen::AngleAxisd(R_GtoIcand * R_GtoIprev.transpose()).angle() * 180.0 / M_PI;
+  if (rotation > state->_options.keyframe_min_rotation)
+    return false;
+
+  // Average pixel parallax of features seen in both clones
+  int num_tracked = 0;
+  double parallax_sum = 0.0;
+  for (const auto &feat : feats) {
+    for (const auto &pair : feat->timestamps) {
+      const std::vector<double> &times = pair.second;
+      auto it_cand = std::find(times.begin(), times.end(), time_cand);
+      auto it_prev = std::find(times.begin(), times.end(), time_prev);
+      if (it_cand == times.end() || it_prev == times.end())
+        continue;
+      const Eigen::VectorXf &uv_cand = feat->uvs.at(pair.first).at(it_cand - times.begin());
+      const Eigen::VectorXf &uv_prev = feat->uvs.at(pair.first).at(it_prev - times.begin());
+      parallax_sum += (double)(uv_cand - uv_prev).norm();
+      num_tracked++;
+    }
   }
+
+  // Keyframe if we lost too many tracks or if the features moved enough
+  // If nothing is tracked then we have no parallax to check, so always keep it
+  if (num_tracked == 0 || num_tracked < state->_options.keyframe_min_tracked)
+    return false;
+  double parallax = parallax_sum / num_tracked;
+  if (parallax > state->_options.keyframe_min_parallax)
+    return false;
+
+  // Otherwise this clone is redundant, so marginalize it instead of the oldest
+  state->_marg_redundant_timestep = time_cand;
+  PRINT_DEBUG("[KEYFRAME]: clone %.3f is redundant (%.2f deg, %.2f px, %d tracks)\n", time_cand, rotation, parallax, num_tracked);
+  return true;
 }
 
 void StateHelper::marginalize_slam(std::shared_ptr<State> state) {
@@ -643,3 +1084,83 @@ void StateHelper::marginalize_slam(std::shared_ptr<State> state) {
     }
   }
 }
+
+void StateHelper::set_consider(std::shared_ptr<State> state, std::shared_ptr<Type> variable, bool consider) {
+
+  // Schmidt updates are only implemented for the dense covariance
+  if (state->_options.use_sqrt_covariance) {
+    PRINT_WARNING(YELLOW "StateHelper::set_consider() - consider states are not supported with the square-root covariance\n" RESET)
+    return;
+  }
+
+  // Check that this variable is in the state
+  if (std::find(state->_variables.begin(), state->_variables.end(), variable) == state->_variables.end()) {
+    PRINT_ERROR(RED "StateHelper::set_consider() - Called on variable that is not in the state\n" RESET)
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Add or remove it from our consider set
+  if (consider) {
+    state->_variables_consider.insert(variable);
+  } else {
+    state->_variables_consider.erase(variable);
+  }
+}
+
+bool StateHelper::is_consider(std::shared_ptr<State> state, std::shared_ptr<Type> variable) {
+  return state->_variables_consider.find(variable) != state->_variables_consider.end();
+}
+
+bool StateHelper::get_update_nis(std::shared_ptr<State> state, double &nis) {
+  if (state->_update_nis_dof < 1)
+    return false;
+  nis = state->_update_nis_sum / (double)state->_update_nis_dof;
+  state->_update_nis_sum = 0.0;
+  state->_update_nis_dof = 0;
+  return true;
+}
+
+void StateHelper::apply_deferred_propagation(std::shared_ptr<State> state) {
+  if (state->_deferred_ids.empty())
+    return;
+  get_deferred_cross_covariance(state, state->_Cov);
+  state->_deferred_ids.clear();
+  state->_deferred_locs.clear();
+  state->_deferred_base_ids.clear();
+  state->_deferred_Phi.resize(0, 0);
+}
+
+int StateHelper::deferred_index(std::shared_ptr<State> state, int id) {
+  return (id >= 0 && id < (int)state->_deferred_locs.size()) ? state->_deferred_locs.at(id) : -1;
+}
+
+void StateHelper::get_deferred_cross_covariance(std::shared_ptr<State> state, Eigen::MatrixXd &Cov) {
+  if (state->_deferred_ids.empty())
+    return;
+
+  // All other covariance elements which have not been propagated
+  std::vector<bool> is_deferred((size_t)Cov.rows(), false);
+  for (const auto &id : state->_deferred_ids) {
+    is_deferred.at(id) = true;
+  }
+  std::vector<int> rest_ids;
+  for (int i = 0; i < (int)Cov.rows(); i++) {
+    if (!is_deferred.at(i))
+      rest_ids.push_back(i);
+  }
+
+  // Cross-covariance is the accumulated state transition times the old rows
+  Eigen::MatrixXd P_base_rest((int)state->_deferred_base_ids.size(), (int)rest_ids.size());
+  for (size_t r = 0; r < state->_deferred_base_ids.size(); r++) {
+    for (size_t c = 0; c < rest_ids.size(); c++) {
+      P_base_rest(r, c) = Cov(state->_deferred_base_ids.at(r), rest_ids.at(c));
+    }
+  }
+  Eigen::MatrixXd P_cross = state->_deferred_Phi * P_base_rest;
+  for (size_t r = 0; r < state->_deferred_ids.size(); r++) {
+    for (size_t c = 0; c < rest_ids.size(); c++) {
+      Cov(state->_deferred_ids.at(r), rest_ids.at(c)) = P_cross(r, c);
+      Cov(rest_ids.at(c), state->_deferred_ids.at(r)) = P_cross(r, c);
+    }
+  }
+}
@@ -25,6 +25,10 @@
 #include <Eigen/Eigen>
 #include <memory>
 
+namespace ov_core {
+class Feature;
+} // namespace ov_core
+
 namespace ov_type {
 class Type;
 } // namespace ov_type
@@ -41,6 +45,12 @@ class State;
  * All functions here are static, and thus are self-contained so that in the future multiple states could be tracked and updated.
  * We recommend you look directly at the code for this class for clarity on what exactly we are doing in each and the matching documentation
  * pages.
+ *
+ * If StateOptions::use_sqrt_covariance is set, then we instead store a single precision square-root factor S of the covariance (P = S*S^T).
+ * Every operation then becomes an operation on the rows of S: propagation and cloning are linear maps of the rows, new noise is appended as
+ * new columns, and marginalization just removes rows. Updates are done with a QR of the pre-array (array square-root form) and thus the
+ * covariance can never lose positive semi-definiteness. Whenever S has more columns than rows, we re-triangulate it with a QR so the factor
+ * stays square. Since the factor has half the dynamic range of the covariance, float32 is enough which halves the memory footprint.
  */
 class StateHelper {
 
@@ -72,6 +82,9 @@ public:
    * @param order_OLD Variable ordering used in the state transition
    * @param Phi State transition matrix (size order_NEW by size order_OLD)
    * @param Q Additive state propagation noise matrix (size order_NEW by size order_NEW)
+   *
+   * If StateOptions::use_deferred_propagation is set and order_NEW is the same as order_OLD, we only propagate the covariance of these
+   * variables. Their cross-covariance with the rest of the state is propagated once it is needed (see apply_deferred_propagation()).
    */
   static void EKFPropagation(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_type::Type>> &order_NEW,
                              const std::vector<std::shared_ptr<ov_type::Type>> &order_OLD, const Eigen::MatrixXd &Phi,
@@ -84,6 +97,9 @@ public:
    * @param H Condensed Jacobian of updating measurement
    * @param res Residual of updating measurement
    * @param R Updating measurement covariance
+   *
+   * Variables marked with set_consider() are handled as Schmidt "consider" states.
+   * Their Kalman gain is zero, thus they are not corrected and only their cross-covariance with the active variables changes.
    */
   static void EKFUpdate(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_type::Type>> &H_order, const Eigen::MatrixXd &H,
                         const Eigen::VectorXd &res, const Eigen::MatrixXd &R);
@@ -218,18 +234,130 @@ public:
    * This will marginalize the clone from our covariance, and remove it from our state.
    * This is mainly a helper function that we can call after each update.
    * It will marginalize the clone specified by State::margtimestep() which should return a clone timestamp.
+   * When using keyframes, this can be a redundant clone in the middle of our window instead of the oldest.
    *
    * @param state Pointer to state
    */
   static void marginalize_old_clone(std::shared_ptr<State> state);
 
+  /**
+   * @brief Selects which clone should be marginalized when our window is full (if we are using keyframes).
+   *
+   * The clone before the newest is checked against the clone before it.
+   * If we have not rotated enough, and the features have not moved enough in the image (average pixel parallax), then it is redundant
+   * and State::margtimestep() will return it instead of the oldest clone.
+   * If no features are tracked between the two clones we can't say anything about the parallax, so it is kept as a keyframe.
+   *
+   * @param state Pointer to state
+   * @param feats Features which have a measurement at the candidate clone time
+   * @return True if the candidate clone is redundant and will be marginalized
+   */
+  static bool select_marg_clone(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_core::Feature>> &feats);
+
   /**
    * @brief Marginalize bad SLAM features
    * @param state Pointer to state
    */
   static void marginalize_slam(std::shared_ptr<State> state);
 
+  /**
+   * @brief Marks a variable as a Schmidt "consider" state or as a normal active state
+   *
+   * A consider state stays in the covariance and its uncertainty is still accounted for in each update.
+   * But we do not compute a correction for it, and its own covariance block is not reduced by the update.
+   * This is not supported when the covariance is in square-root form.
+   *
+   * @param state Pointer to state
+   * @param variable Variable we want to change (should already be in the covariance)
+   * @param consider True if it should be a consider state, false to make it active again
+   */
+  static void set_consider(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> variable, bool consider);
+
+  /**
+   * @brief If the variable is currently a Schmidt "consider" state
+   * @param state Pointer to state
+   * @param variable Variable to check
+   * @return True if it is a consider state
+   */
+  static bool is_consider(std::shared_ptr<State> state, std::shared_ptr<ov_type::Type> variable);
+
+  /**
+   * @brief Average normalized innovation squared (per measurement dimension) of the updates since the last call.
+   *
+   * This is only recorded if StateOptions::use_schmidt_calib is enabled.
+   * For a consistent filter this should be around one.
+   *
+   * @param state Pointer to state
+   * @param nis Average normalized innovation squared
+   * @return False if there have been no updates since the last call
+   */
+  static bool get_update_nis(std::shared_ptr<State> state, double &nis);
+
+  /**
+   * @brief Applies the deferred propagation to the cross-covariance of the propagated variables with the rest of the state
+   *
+   * If StateOptions::use_deferred_propagation is set, EKFPropagation() only propagates the covariance of the propagated variables
+   * (and clones of them) and accumulates their state transition.
+   * This is called by any function which needs the cross-covariances, thus it should not need to be called directly.
+   *
+   * @param state Pointer to state
+   */
+  static void apply_deferred_propagation(std::shared_ptr<State> state);
+
 private:
+  /**
+   * @brief Location of a covariance index in the deferred rows
+   * @param state Pointer to state
+   * @param id Covariance index
+   * @return Location in the deferred rows (-1 if it is not deferred)
+   */
+  static int deferred_index(std::shared_ptr<State> state, int id);
+
+  /**
+   * @brief Writes the propagated cross-covariance of the deferred rows into the given covariance
+   * @param state Pointer to state
+   * @param Cov Covariance to write into (the state covariance or a copy of it)
+   */
+  static void get_deferred_cross_covariance(std::shared_ptr<State> state, Eigen::MatrixXd &Cov);
+
+  /**
+   * @brief Square-root form of EKFUpdate() which triangulates the pre-array of the update with a QR.
+   * @param state Pointer to state
+   * @param H_order Variable ordering used in the compressed Jacobian
+   * @param H Condensed Jacobian of updating measurement
+   * @param res Residual of updating measurement
+   * @param R Updating measurement covariance
+   */
+  static void EKFUpdateSqrt(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_type::Type>> &H_order,
+                            const Eigen::MatrixXd &H, const Eigen::VectorXd &res, const Eigen::MatrixXd &R);
+
+  /**
+   * @brief Gets the rows of the square-root covariance factor for the given variables (stacked in order)
+   * @param state Pointer to state
+   * @param order Variables whose rows we want
+   * @return Rows of the factor (size of all variables by number of factor columns)
+   */
+  static Eigen::MatrixXf get_sqrt_rows(std::shared_ptr<State> state, const std::vector<std::shared_ptr<ov_type::Type>> &order);
+
+  /**
+   * @brief Computes a square-root (A = L*L^T) of a positive semi-definite matrix (e.g. noise covariances)
+   * @param A Symmetric positive semi-definite matrix
+   * @return Square-root of the matrix (lower triangular if A is positive definite)
+   */
+  static Eigen::MatrixXd sqrt_psd(const Eigen::MatrixXd &A);
+
+  /**
+   * @brief Re-triangulates the square-root covariance factor once it has too many extra columns
+   *
+   * Propagation, marginalization and initialization all leave extra columns in the factor which we don't need to remove right away.
+   * The factor is only compressed back to a square one once it is twice as wide as it is tall, which bounds
+   * the cost of multiplying its rows while not doing a full QR after each of these operations.
+   * Updates also compress the factor for free as part of their QR.
+   *
+   * @param state Pointer to state
+   */
+  static void sqrt_compress(std::shared_ptr<State> state);
+
   /**
    * All function in this class should be static.
    * Thus an instance of this class cannot be created.
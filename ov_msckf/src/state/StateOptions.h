@@ -64,9 +64,39 @@ struct StateOptions {
   /// What model our IMU intrinsics are
   ImuModel imu_model = ImuModel::KALIBR;
 
+  /// If we should store the covariance as a single precision square-root factor (P = S*S^T) instead of a dense double matrix
+  bool use_sqrt_covariance = false;
+
+  /// If we should defer propagating the cross-covariance of the IMU with the rest of the state until it is needed (e.g. by an update)
+  bool use_deferred_propagation = false;
+
+  /// If converged camera calibration should be switched to Schmidt "consider" states (covariance tracked, but never corrected)
+  bool use_schmidt_calib = false;
+
+  /// Number of updates the calibration standard deviation needs to have been flat for before we consider it converged
+  int schmidt_calib_window = 20;
+
+  /// Largest relative change of the calibration standard deviation over the window for it to be converged
+  double schmidt_calib_std_ratio = 0.02;
+
+  /// If the average normalized innovation squared (per measurement dimension) goes above this, calibration is re-activated
+  double schmidt_calib_nis_thresh = 2.0;
+
   /// Max clone size of sliding window
   int max_clone_size = 11;
 
+  /// If we should only keep keyframe clones, marginalizing redundant intermediate clones instead of the oldest
+  bool use_keyframe_clones = false;
+
+  /// Average feature parallax (pixels) to the previous clone needed for a clone to be a keyframe
+  double keyframe_min_parallax = 10.0;
+
+  /// Rotation (degrees) from the previous clone needed for a clone to be a keyframe
+  double keyframe_min_rotation = 5.0;
+
+  /// If fewer features than this are tracked from the previous clone, then a clone is always a keyframe
+  int keyframe_min_tracked = 20;
+
   /// Max number of estimated SLAM features
   int max_slam_features = 25;
 
@@ -95,6 +125,20 @@ struct StateOptions {
   void print(const std::shared_ptr<ov_core::YamlParser> &parser = nullptr) {
     if (parser != nullptr) {
       parser->parse_config("use_fej", do_fej);
+      parser->parse_config("use_sqrt_covariance", use_sqrt_covariance, false);
+      parser->parse_config("use_deferred_propagation", use_deferred_propagation, false);
+      parser->parse_config("use_schmidt_calib", use_schmidt_calib, false);
+      parser->parse_config("schmidt_calib_window", schmidt_calib_window, false);
+      parser->parse_config("schmidt_calib_std_ratio", schmidt_calib_std_ratio, false);
+      parser->parse_config("schmidt_calib_nis_thresh", schmidt_calib_nis_thresh, false);
+      if (use_schmidt_calib && use_sqrt_covariance) {
+        PRINT_WARNING(YELLOW "schmidt calibration states are not supported with the square-root covariance, disabling them!\n" RESET);
+        use_schmidt_calib = false;
+      }
+      if (use_deferred_propagation && use_sqrt_covariance) {
+        PRINT_WARNING(YELLOW "deferred propagation is not needed with the square-root covariance, disabling it!\n" RESET);
+        use_deferred_propagation = false;
+      }
 
       // Integration method
       std::string integration_str = "rk4";
@@ -120,6 +164,10 @@ struct StateOptions {
 
       // State parameters
       parser->parse_config("max_clones", max_clone_size);
+      parser->parse_config("use_keyframe_clones", use_keyframe_clones, false);
+      parser->parse_config("keyframe_min_parallax", keyframe_min_parallax, false);
+      parser->parse_config("keyframe_min_rotation", keyframe_min_rotation, false);
+      parser->parse_config("keyframe_min_tracked", keyframe_min_tracked, false);
       parser->parse_config("max_slam", max_slam_features);
       parser->parse_config("max_slam_in_update", max_slam_in_update);
       parser->parse_config("max_msckf_in_update", max_msckf_in_update);
@@ -156,6 +204,12 @@ struct StateOptions {
       }
     }
     PRINT_DEBUG("  - use_fej: %d\n", do_fej);
+    PRINT_DEBUG("  - use_sqrt_covariance: %d\n", use_sqrt_covariance);
+    PRINT_DEBUG("  - use_deferred_propagation: %d\n", use_deferred_propagation);
+    PRINT_DEBUG("  - use_schmidt_calib: %d\n", use_schmidt_calib);
+    PRINT_DEBUG("  - schmidt_calib_window: %d\n", schmidt_calib_window);
+    PRINT_DEBUG("  - schmidt_calib_std_ratio: %.3f\n", schmidt_calib_std_ratio);
+    PRINT_DEBUG("  - schmidt_calib_nis_thresh: %.2f\n", schmidt_calib_nis_thresh);
     PRINT_DEBUG("  - integration: %d\n", integration_method);
     PRINT_DEBUG("  - calib_cam_extrinsics: %d\n", do_calib_camera_pose);
     PRINT_DEBUG("  - calib_cam_intrinsics: %d\n", do_calib_camera_intrinsics);
@@ -164,6 +218,10 @@ struct StateOptions {
     PRINT_DEBUG("  - calib_imu_g_sensitivity: %d\n", do_calib_imu_g_sensitivity);
     PRINT_DEBUG("  - imu_model: %d\n", imu_model);
     PRINT_DEBUG("  - max_clones: %d\n", max_clone_size);
+    PRINT_DEBUG("  - use_keyframe_clones: %d\n", use_keyframe_clones);
+    PRINT_DEBUG("  - keyframe_min_parallax: %.2f\n", keyframe_min_parallax);
+    PRINT_DEBUG("  - keyframe_min_rotation: %.2f\n", keyframe_min_rotation);
+    PRINT_DEBUG("  - keyframe_min_tracked: %d\n", keyframe_min_tracked);
     PRINT_DEBUG("  - max_slam: %d\n", max_slam_features);
     PRINT_DEBUG("  - max_slam_in_update: %d\n", max_slam_in_update);
     PRINT_DEBUG("  - max_msckf_in_update: %d\n", max_msckf_in_update);
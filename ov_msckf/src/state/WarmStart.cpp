@@ -0,0 +1,240 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WarmStart.h"
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "State.h"
+#include "StateHelper.h"
+
+#include "utils/colors.h"
+#include "utils/print.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+namespace {
+
+/// Identifier at the start of our file, and version of the file layout
+const char WARM_START_MAGIC[4] = {'O', 'V', 'W', 'S'};
+const uint32_t WARM_START_VERSION = 1;
+
+template <typename T> void write_pod(std::ofstream &file, const T &value) { file.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+
+template <typename T> bool read_pod(std::ifstream &file, T &value) {
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return (bool)file;
+}
+
+} // namespace
+
+bool WarmStart::save(std::shared_ptr<State> state, const std::string &filepath) {
+
+  // Get all our calibration, and the covariance of the ones being estimated
+  std::vector<std::shared_ptr<Type>> vars, vars_cov;
+  get_calibration(state, vars);
+  for (const auto &var : vars) {
+    if (var->id() >= 0)
+      vars_cov.push_back(var);
+  }
+  Eigen::MatrixXd cov = (vars_cov.empty()) ? Eigen::MatrixXd() : StateHelper::get_marginal_covariance(state, vars_cov);
+
+  // Open our file
+  boost::filesystem::path p(filepath);
+  if (p.has_parent_path())
+    boost::filesystem::create_directories(p.parent_path());
+  std::ofstream file(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    PRINT_ERROR(RED "[WARM-START]: unable to open %s for writing\n" RESET, filepath.c_str())
+    return false;
+  }
+
+  // Header
+  file.write(WARM_START_MAGIC, sizeof(WARM_START_MAGIC));
+  write_pod(file, WARM_START_VERSION);
+  write_pod(file, (uint32_t)state->_options.num_cameras);
+  write_pod(file, (uint32_t)state->_options.imu_model);
+
+  // Value of each variable, and if it is in the covariance
+  write_pod(file, (uint32_t)vars.size());
+  for (const auto &var : vars) {
+    write_pod(file, (uint32_t)var->value().rows());
+    write_pod(file, (uint8_t)(var->id() >= 0));
+    for (int i = 0; i < var->value().rows(); i++)
+      write_pod(file, var->value()(i, 0));
+  }
+
+  // Biases
+  for (int i = 0; i < 3; i++)
+    write_pod(file, state->_imu->bias_g()(i));
+  for (int i = 0; i < 3; i++)
+    write_pod(file, state->_imu->bias_a()(i));
+
+  // Upper triangular of the covariance
+  write_pod(file, (uint32_t)cov.rows());
+  for (int r = 0; r < cov.rows(); r++) {
+    for (int c = r; c < cov.cols(); c++)
+      write_pod(file, cov(r, c));
+  }
+  file.close();
+  if (!file) {
+    PRINT_ERROR(RED "[WARM-START]: failed writing %s\n" RESET, filepath.c_str())
+    return false;
+  }
+  PRINT_INFO("[WARM-START]: saved %zu calibration variables (%d estimated online) to %s\n", vars.size(), (int)cov.rows(),
+             filepath.c_str());
+  return true;
+}
+
+std::shared_ptr<WarmStart> WarmStart::load(const std::string &filepath) {
+
+  // Open our file
+  std::ifstream file(filepath, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    PRINT_WARNING(YELLOW "[WARM-START]: unable to open %s, doing a cold start\n" RESET, filepath.c_str())
+    return nullptr;
+  }
+
+  // Header
+  char magic[4];
+  uint32_t version, num_cameras, imu_model, num_vars;
+  file.read(magic, sizeof(magic));
+  if (!file || std::string(magic, 4) != std::string(WARM_START_MAGIC, 4) || !read_pod(file, version) || version != WARM_START_VERSION ||
+      !read_pod(file, num_cameras) || !read_pod(file, imu_model) || !read_pod(file, num_vars)) {
+    PRINT_WARNING(YELLOW "[WARM-START]: %s is not a valid warm start file, doing a cold start\n" RESET, filepath.c_str())
+    return nullptr;
+  }
+  auto warm = std::make_shared<WarmStart>();
+  warm->_num_cameras = (int)num_cameras;
+  warm->_imu_model = (int)imu_model;
+
+  // Value of each variable
+  bool valid = true;
+  for (uint32_t v = 0; v < num_vars && valid; v++) {
+    uint32_t size;
+    uint8_t in_cov;
+    valid = read_pod(file, size) && read_pod(file, in_cov) && size < 64;
+    Eigen::VectorXd value = Eigen::VectorXd::Zero(valid ? size : 0);
+    for (int i = 0; i < value.rows() && valid; i++)
+      valid = read_pod(file, value(i));
+    warm->_values.push_back(value);
+    warm->_in_cov.push_back(in_cov != 0);
+  }
+
+  // Biases
+  for (int i = 0; i < 3 && valid; i++)
+    valid = read_pod(file, warm->bias_g(i));
+  for (int i = 0; i < 3 && valid; i++)
+    valid = read_pod(file, warm->bias_a(i));
+
+  // Covariance
+  uint32_t cov_size = 0;
+  valid = valid && read_pod(file, cov_size) && cov_size < 1024;
+  warm->_cov = Eigen::MatrixXd::Zero(valid ? cov_size : 0, valid ? cov_size : 0);
+  for (int r = 0; r < warm->_cov.rows() && valid; r++) {
+    for (int c = r; c < warm->_cov.cols() && valid; c++) {
+      valid = read_pod(file, warm->_cov(r, c));
+      warm->_cov(c, r) = warm->_cov(r, c);
+    }
+  }
+  if (!valid) {
+    PRINT_WARNING(YELLOW "[WARM-START]: %s is truncated, doing a cold start\n" RESET, filepath.c_str())
+    return nullptr;
+  }
+  PRINT_INFO("[WARM-START]: loaded %zu calibration variables from %s\n", warm->_values.size(), filepath.c_str());
+  return warm;
+}
+
+bool WarmStart::apply_calibration(std::shared_ptr<State> state) const {
+
+  // Our calibration needs to be of the same system
+  std::vector<std::shared_ptr<Type>> vars;
+  get_calibration(state, vars);
+  if (_num_cameras != state->_options.num_cameras || _imu_model != (int)state->_options.imu_model || vars.size() != _values.size()) {
+    PRINT_WARNING(YELLOW "[WARM-START]: saved calibration is for %d cameras (imu model %d), we have %d cameras (imu model %d)\n" RESET,
+                  _num_cameras, _imu_model, state->_options.num_cameras, (int)state->_options.imu_model)
+    return false;
+  }
+  for (size_t i = 0; i < vars.size(); i++) {
+    if (vars.at(i)->value().rows() != _values.at(i).rows()) {
+      PRINT_WARNING(YELLOW "[WARM-START]: saved calibration variable %zu has the wrong size\n" RESET, i)
+      return false;
+    }
+  }
+
+  // Set all values, and the camera models which are used by our trackers
+  for (size_t i = 0; i < vars.size(); i++) {
+    vars.at(i)->set_value(_values.at(i));
+    vars.at(i)->set_fej(_values.at(i));
+  }
+  for (int i = 0; i < state->_options.num_cameras; i++) {
+    state->_cam_intrinsics_cameras.at(i)->set_value(state->_cam_intrinsics.at(i)->value());
+  }
+  return true;
+}
+
+void WarmStart::apply_covariance(std::shared_ptr<State> state) const {
+
+  // Find the variables which are estimated now and were estimated when saved
+  // Also record where each is in our saved covariance
+  std::vector<std::shared_ptr<Type>> vars, order;
+  std::vector<int> saved_ids;
+  get_calibration(state, vars);
+  int saved_id = 0;
+  for (size_t i = 0; i < vars.size() && i < _values.size(); i++) {
+    if (!_in_cov.at(i))
+      continue;
+    if (vars.at(i)->id() >= 0) {
+      order.push_back(vars.at(i));
+      for (int k = 0; k < vars.at(i)->size(); k++)
+        saved_ids.push_back(saved_id + k);
+    }
+    saved_id += vars.at(i)->size();
+  }
+  if (order.empty() || saved_id != _cov.rows())
+    return;
+
+  // Set our covariance (with the cross-terms between the calibration)
+  Eigen::MatrixXd cov((int)saved_ids.size(), (int)saved_ids.size());
+  for (size_t r = 0; r < saved_ids.size(); r++) {
+    for (size_t c = 0; c < saved_ids.size(); c++)
+      cov(r, c) = _cov(saved_ids.at(r), saved_ids.at(c));
+  }
+  StateHelper::set_initial_covariance(state, cov, order);
+  PRINT_INFO("[WARM-START]: set the covariance of %zu calibration variables\n", order.size());
+}
+
+void WarmStart::get_calibration(std::shared_ptr<State> state, std::vector<std::shared_ptr<Type>> &vars) {
+  vars.push_back(state->_calib_dt_CAMtoIMU);
+  for (int i = 0; i < state->_options.num_cameras; i++) {
+    vars.push_back(state->_calib_IMUtoCAM.at(i));
+    vars.push_back(state->_cam_intrinsics.at(i));
+  }
+  vars.push_back(state->_calib_imu_dw);
+  vars.push_back(state->_calib_imu_da);
+  vars.push_back(state->_calib_imu_tg);
+  vars.push_back(state->_calib_imu_GYROtoIMU);
+  vars.push_back(state->_calib_imu_ACCtoIMU);
+}
@@ -0,0 +1,113 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OV_MSCKF_WARMSTART_H
+#define OV_MSCKF_WARMSTART_H
+
+#include <Eigen/Eigen>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ov_type {
+class Type;
+} // namespace ov_type
+
+namespace ov_msckf {
+
+class State;
+
+/**
+ * @brief Persists the online calibration and IMU biases so the next start of the estimator can be seeded with them.
+ *
+ * We save the values of the calibration (camera-IMU time offset, camera extrinsics and intrinsics, IMU intrinsics) and IMU biases.
+ * The marginal covariance (with cross-terms) of the calibration which was being estimated online is also saved.
+ * On startup the calibration values are loaded before the initializer is created (and also given to it, so it triangulates with them),
+ * and its covariance after it has initialized.
+ * The biases are used as the initial guess of the dynamic initializer, since the turn-on bias can change between runs.
+ *
+ * The file is a small binary file: a header with the number of cameras and IMU model (which need to match the current state),
+ * the value of each variable, the biases, and the upper triangular of the marginal covariance.
+ */
+class WarmStart {
+
+public:
+  /**
+   * @brief Saves the calibration and biases of the state
+   * @param state Pointer to state
+   * @param filepath File we will write into (overwritten if it exists)
+   * @return False if we could not write the file
+   */
+  static bool save(std::shared_ptr<State> state, const std::string &filepath);
+
+  /**
+   * @brief Loads a file written by save()
+   * @param filepath File we will read
+   * @return Loaded warm start (null if it does not exist or is not valid)
+   */
+  static std::shared_ptr<WarmStart> load(const std::string &filepath);
+
+  /**
+   * @brief Sets the calibration values (and first estimates) of the state
+   * @param state Pointer to state (should not be initialized yet)
+   * @return False if the saved calibration does not match this state (different number of cameras or IMU model)
+   */
+  bool apply_calibration(std::shared_ptr<State> state) const;
+
+  /**
+   * @brief Sets the covariance of the calibration which was estimated online in both the saved and current state
+   * @param state Pointer to state (should be called right after the initializer has set the initial covariance)
+   */
+  void apply_covariance(std::shared_ptr<State> state) const;
+
+  /// Saved gyroscope bias
+  Eigen::Vector3d bias_g = Eigen::Vector3d::Zero();
+
+  /// Saved accelerometer bias
+  Eigen::Vector3d bias_a = Eigen::Vector3d::Zero();
+
+protected:
+  /**
+   * @brief Gets all calibration variables of the state (in the order they are saved)
+   * @param state Pointer to state
+   * @param vars Calibration variables
+   */
+  static void get_calibration(std::shared_ptr<State> state, std::vector<std::shared_ptr<ov_type::Type>> &vars);
+
+  /// Number of cameras the calibration was saved for
+  int _num_cameras = 0;
+
+  /// IMU intrinsic model the calibration was saved for
+  int _imu_model = 0;
+
+  /// Value of each calibration variable
+  std::vector<Eigen::VectorXd> _values;
+
+  /// If each calibration variable was estimated online (thus is in the saved covariance)
+  std::vector<bool> _in_cov;
+
+  /// Marginal covariance of all variables which were estimated online
+  Eigen::MatrixXd _cov;
+};
+
+} // namespace ov_msckf
+
+#endif // OV_MSCKF_WARMSTART_H
@@ -0,0 +1,590 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <opencv2/opencv.hpp>
+
+#include "cam/CamEqui.h"
+#include "cam/CamRadtan.h"
+#include "feat/Feature.h"
+#include "feat/FeatureInitializer.h"
+#include "track/Grider_FAST.h"
+#include "track/TrackKLT.h"
+#include "types/Landmark.h"
+#include "utils/print.h"
+#include "utils/sensor_data.h"
+
+#include "state/Propagator.h"
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "update/UpdaterHelper.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/**
+ * Minimal benchmark runner in the style of Google Benchmark.
+ * Each benchmark loops on keep_running() until it has run for the min time, and can pause the timer for any per-iteration setup.
+ * We record both the wall and cpu time per iteration, along with any user counters (e.g. number of features found).
+ */
+class BenchmarkState {
+
+public:
+  explicit BenchmarkState(double min_time) : min_time(min_time) {}
+
+  /// Returns true while we should do another iteration, the first call starts the timer
+  bool keep_running() {
+    if (iterations == 0 && !running) {
+      resume();
+    } else {
+      iterations++;
+    }
+    if (iterations > 0 && get_real_time() >= min_time) {
+      pause();
+      return false;
+    }
+    return true;
+  }
+
+  /// Stops timing (e.g. to reset the inputs of an in-place kernel)
+  void pause() {
+    if (!running)
+      return;
+    real_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+    cpu_time += (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    running = false;
+  }
+
+  /// Starts timing again
+  void resume() {
+    if (running)
+      return;
+    real_start = std::chrono::steady_clock::now();
+    cpu_start = std::clock();
+    running = true;
+  }
+
+  /// Total timed wall time so far (seconds)
+  double get_real_time() const {
+    if (!running)
+      return real_time;
+    return real_time + std::chrono::duration<double>(std::chrono::steady_clock::now() - real_start).count();
+  }
+
+  /// Number of finished iterations
+  size_t iterations = 0;
+
+  /// Total timed wall and cpu time (seconds)
+  double real_time = 0.0;
+  double cpu_time = 0.0;
+
+  /// User counters which will be averaged over the iterations
+  std::map<std::string, double> counters;
+
+private:
+  double min_time;
+  bool running = false;
+  std::chrono::steady_clock::time_point real_start;
+  std::clock_t cpu_start = 0;
+};
+
+/// Result of a single benchmark
+struct BenchmarkResult {
+  std::string name;
+  size_t iterations;
+  double real_time_us;
+  double cpu_time_us;
+  std::map<std::string, double> counters;
+};
+
+/// Exposes the protected propagation kernel of the propagator
+class BenchPropagator : public Propagator {
+public:
+  BenchPropagator(NoiseManager noises, double gravity_mag) : Propagator(noises, gravity_mag) {}
+  using Propagator::predict_and_compute;
+};
+
+/// Exposes the protected matching kernel of the KLT tracker
+class BenchTrackKLT : public TrackKLT {
+public:
+  using TrackKLT::TrackKLT;
+  using TrackKLT::perform_matching;
+  int get_pyr_levels() const { return pyr_levels; }
+  cv::Size get_win_size() const { return win_size; }
+};
+
+/**
+ * Creates a state which is the size we normally run at: stereo with online calibration, a full window of clones and SLAM features.
+ * The clones and features are added through the state helper, so the covariance is a valid (dense) covariance.
+ */
+std::shared_ptr<State> create_state(int num_clones, int num_slam, StateOptions::IntegrationMethod method = StateOptions::RK4) {
+  StateOptions options;
+  options.num_cameras = 2;
+  options.do_calib_camera_pose = true;
+  options.do_calib_camera_intrinsics = true;
+  options.do_calib_camera_timeoffset = true;
+  options.max_clone_size = num_clones;
+  options.max_slam_features = num_slam;
+  options.integration_method = method;
+  auto state = std::make_shared<State>(options);
+  for (int i = 0; i < options.num_cameras; i++) {
+    Eigen::Matrix<double, 8, 1> calib;
+    calib << 458.654, 457.296, 367.215, 248.375, -0.28340811, 0.07395907, 0.00019359, 1.76187114e-05;
+    state->_cam_intrinsics.at(i)->set_value(calib);
+    state->_cam_intrinsics.at(i)->set_fej(calib);
+    state->_cam_intrinsics_cameras.insert({i, std::make_shared<CamRadtan>(752, 480)});
+    state->_cam_intrinsics_cameras.at(i)->set_value(calib);
+  }
+
+  // Clones along a small motion
+  for (int i = 0; i < num_clones; i++) {
+    state->_timestamp = 0.05 * i;
+    state->_imu->set_value(state->_imu->value() + 0.01 * Eigen::VectorXd::Random(state->_imu->size() + 1).cwiseAbs());
+    Eigen::Matrix<double, 16, 1> imu = state->_imu->value();
+    imu.block(0, 0, 4, 1) /= imu.block(0, 0, 4, 1).norm();
+    state->_imu->set_value(imu);
+    StateHelper::augment_clone(state, Eigen::Vector3d::Random());
+  }
+
+  // SLAM features, initialized from the current pose
+  for (int i = 0; i < num_slam; i++) {
+    auto landmark = std::make_shared<Landmark>(3);
+    landmark->_featid = (size_t)i;
+    landmark->_feat_representation = LandmarkRepresentation::Representation::GLOBAL_3D;
+    landmark->set_from_xyz(Eigen::Vector3d::Random() * 5.0 + Eigen::Vector3d(0, 0, 10), false);
+    landmark->set_from_xyz(landmark->get_xyz(false), true);
+    std::vector<std::shared_ptr<Type>> H_order = {state->_imu->pose()};
+    Eigen::MatrixXd H_R = Eigen::MatrixXd::Random(3, 6);
+    Eigen::MatrixXd H_L = Eigen::MatrixXd::Identity(3, 3) + 0.1 * Eigen::MatrixXd::Random(3, 3);
+    Eigen::MatrixXd R = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(3, 3);
+    Eigen::VectorXd res = Eigen::VectorXd::Zero(3);
+    StateHelper::initialize_invertible(state, landmark, H_order, H_R, H_L, R, res);
+    state->_features_SLAM.insert({(size_t)i, landmark});
+  }
+  return state;
+}
+
+/// Creates a synthetic textured image (smoothed noise) which has plenty of corners for FAST and KLT
+cv::Mat create_image(int width, int height, int seed) {
+  cv::RNG rng(seed);
+  cv::Mat noise(height / 4, width / 4, CV_8UC1);
+  rng.fill(noise, cv::RNG::UNIFORM, 0, 255);
+  cv::Mat img;
+  cv::resize(noise, img, cv::Size(width, height), 0, 0, cv::INTER_LINEAR);
+  cv::GaussianBlur(img, img, cv::Size(3, 3), 0);
+  return img;
+}
+
+/// Writes the results in the same JSON layout as Google Benchmark, so the same compare tooling can be used
+void write_json(std::ostream &out, const std::vector<BenchmarkResult> &results, double min_time) {
+  char hostname[256] = "unknown";
+  gethostname(hostname, sizeof(hostname) - 1);
+  std::time_t now = std::time(nullptr);
+  char date[64];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+#ifdef NDEBUG
+  std::string build_type = "release";
+#else
+  std::string build_type = "debug";
+#endif
+  out << "{\n";
+  out << "  \"context\": {\n";
+  out << "    \"date\": \"" << date << "\",\n";
+  out << "    \"host_name\": \"" << hostname << "\",\n";
+  out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+  out << "    \"library_build_type\": \"" << build_type << "\",\n";
+  out << "    \"eigen_version\": \"" << EIGEN_WORLD_VERSION << "." << EIGEN_MAJOR_VERSION << "." << EIGEN_MINOR_VERSION << "\",\n";
+  out << "    \"opencv_version\": \"" << CV_VERSION << "\",\n";
+  out << "    \"opencv_threads\": " << cv::getNumThreads() << ",\n";
+  out << "    \"min_time\": " << min_time << "\n";
+  out << "  },\n";
+  out << "  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchmarkResult &r = results.at(i);
+    out << "    {\n";
+    out << "      \"name\": \"" << r.name << "\",\n";
+    out << "      \"run_name\": \"" << r.name << "\",\n";
+    out << "      \"run_type\": \"iteration\",\n";
+    out << "      \"iterations\": " << r.iterations << ",\n";
+    out << "      \"real_time\": " << r.real_time_us << ",\n";
+    out << "      \"cpu_time\": " << r.cpu_time_us << ",\n";
+    for (const auto &counter : r.counters)
+      out << "      \"" << counter.first << "\": " << counter.second << ",\n";
+    out << "      \"time_unit\": \"us\"\n";
+    out << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+  }
+  out << "  ]\n";
+  out << "}\n";
+}
+
+// Main function
+int main(int argc, char **argv) {
+
+  // Parse our arguments (--filter=<regex> --min_time=<sec> --out=<file.json> --threads=<opencv threads>)
+  std::string filter = ".*";
+  std::string out_path;
+  double min_time = 0.5;
+  int num_threads = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0) {
+      filter = arg.substr(9);
+    } else if (arg.rfind("--min_time=", 0) == 0) {
+      min_time = std::stod(arg.substr(11));
+    } else if (arg.rfind("--out=", 0) == 0) {
+      out_path = arg.substr(6);
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      num_threads = std::stoi(arg.substr(10));
+    } else {
+      PRINT_ERROR(RED "usage: %s [--filter=<regex>] [--min_time=<sec>] [--out=<file.json>] [--threads=<opencv threads>]\n" RESET, argv[0]);
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  signal(SIGINT, signal_callback_handler);
+
+  // If we are not saving to a file then the JSON is printed, and it should be the only thing on stdout (so it can be parsed or diffed)
+  // Thus we send everything else (our results table and any prints from the library) to stderr
+  int json_fd = STDOUT_FILENO;
+  if (out_path.empty()) {
+    fflush(stdout);
+    json_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+  }
+  ov_core::Printer::setPrintLevel("WARNING");
+  cv::setNumThreads(num_threads);
+  std::regex filter_regex(filter);
+
+  // All our benchmarks, in the order they will be run
+  std::vector<std::pair<std::string, std::function<void(BenchmarkState &)>>> benchmarks;
+
+  //=====================================================================================
+  // PROPAGATION
+  //=====================================================================================
+
+  std::vector<std::pair<std::string, StateOptions::IntegrationMethod>> methods = {
+      {"discrete", StateOptions::DISCRETE}, {"rk4", StateOptions::RK4}, {"analytical", StateOptions::ANALYTICAL}};
+  for (const auto &method : methods) {
+    benchmarks.emplace_back("Propagator::predict_and_compute/" + method.first, [method](BenchmarkState &bench) {
+      NoiseManager noises;
+      BenchPropagator propagator(noises, 9.81);
+      std::shared_ptr<State> state = create_state(0, 0, method.second);
+      ImuData data_minus, data_plus;
+      data_minus.timestamp = 0.0;
+      data_minus.wm << 0.1, -0.2, 0.3;
+      data_minus.am << 0.2, 0.1, 9.81;
+      data_plus = data_minus;
+      data_plus.timestamp = 0.005;
+      data_plus.wm(0) += 0.01;
+      Eigen::MatrixXd F, Qd;
+      while (bench.keep_running()) {
+        propagator.predict_and_compute(state, data_minus, data_plus, F, Qd);
+      }
+    });
+  }
+
+  //=====================================================================================
+  // COVARIANCE OPERATIONS
+  //=====================================================================================
+
+  std::vector<std::pair<int, int>> sizes = {{11, 0}, {11, 50}};
+  for (const auto &size : sizes) {
+    std::string suffix = "/clones:" + std::to_string(size.first) + "/slam:" + std::to_string(size.second);
+
+    benchmarks.emplace_back("StateHelper::EKFPropagation" + suffix, [size](BenchmarkState &bench) {
+      std::shared_ptr<State> state = create_state(size.first, size.second);
+      // We apply the same transition every iteration, so it is orthogonal (like a rotation) so the covariance does not blow up
+      Eigen::MatrixXd Phi_rand = Eigen::MatrixXd::Identity(15, 15) + 0.01 * Eigen::MatrixXd::Random(15, 15);
+      Eigen::MatrixXd Phi = Phi_rand.householderQr().householderQ();
+      Eigen::MatrixXd Q = 1e-6 * Eigen::MatrixXd::Identity(15, 15);
+      std::vector<std::shared_ptr<Type>> order = {state->_imu};
+      bench.counters["state_size"] = state->max_covariance_size();
+      while (bench.keep_running()) {
+        StateHelper::EKFPropagation(state, order, order, Phi, Q);
+      }
+      if (!StateHelper::get_full_covariance(state).allFinite()) {
+        PRINT_ERROR(RED "StateHelper::EKFPropagation benchmark - covariance is not finite after %zu iterations\n" RESET, bench.iterations);
+        std::exit(EXIT_FAILURE);
+      }
+    });
+
+    benchmarks.emplace_back("StateHelper::EKFUpdate" + suffix, [size](BenchmarkState &bench) {
+      std::shared_ptr<State> state = create_state(size.first, size.second);
+      // A compressed MSCKF update, which involves all clones and the calibration of one camera
+      std::vector<std::shared_ptr<Type>> H_order;
+      int H_cols = 0;
+      for (const auto &clone : state->_clones_IMU) {
+        H_order.push_back(clone.second);
+        H_cols += clone.second->size();
+      }
+      H_order.push_back(state->_calib_IMUtoCAM.at(0));
+      H_order.push_back(state->_cam_intrinsics.at(0));
+      H_cols += state->_calib_IMUtoCAM.at(0)->size() + state->_cam_intrinsics.at(0)->size();
+      Eigen::MatrixXd H = Eigen::MatrixXd::Random(H_cols, H_cols);
+      Eigen::VectorXd res = Eigen::VectorXd::Zero(H_cols);
+      Eigen::MatrixXd R = Eigen::MatrixXd::Identity(H_cols, H_cols);
+      bench.counters["state_size"] = state->max_covariance_size();
+      bench.counters["update_rows"] = H_cols;
+      while (bench.keep_running()) {
+        StateHelper::EKFUpdate(state, H_order, H, res, R);
+      }
+    });
+
+    benchmarks.emplace_back("StateHelper::marginalize" + suffix, [size](BenchmarkState &bench) {
+      std::shared_ptr<State> state = create_state(size.first, size.second);
+      bench.counters["state_size"] = state->max_covariance_size();
+      while (bench.keep_running()) {
+        // Marginalize the oldest clone, and add a new one (untimed) to keep the same state size
+        StateHelper::marginalize(state, state->_clones_IMU.begin()->second);
+        bench.pause();
+        state->_clones_IMU.erase(state->_clones_IMU.begin());
+        state->_timestamp += 0.05;
+        StateHelper::augment_clone(state, Eigen::Vector3d::Random());
+        bench.resume();
+      }
+    });
+  }
+
+  //=====================================================================================
+  // MSCKF UPDATE HELPERS
+  //=====================================================================================
+
+  benchmarks.emplace_back("UpdaterHelper::nullspace_project_inplace/obs:22", [](BenchmarkState &bench) {
+    // A feature seen in both cameras of the full window, with the clones and calibration in its jacobian
+    int rows = 2 * 22;
+    int cols = 6 * 11 + 2 * (6 + 8) + 1;
+    Eigen::MatrixXd H_f0 = Eigen::MatrixXd::Random(rows, 3);
+    Eigen::MatrixXd H_x0 = Eigen::MatrixXd::Random(rows, cols);
+    Eigen::VectorXd res0 = Eigen::VectorXd::Random(rows);
+    Eigen::MatrixXd H_f, H_x;
+    Eigen::VectorXd res;
+    while (bench.keep_running()) {
+      bench.pause();
+      H_f = H_f0;
+      H_x = H_x0;
+      res = res0;
+      bench.resume();
+      UpdaterHelper::nullspace_project_inplace(H_f, H_x, res);
+    }
+  });
+
+  benchmarks.emplace_back("UpdaterHelper::measurement_compress_inplace/feats:40", [](BenchmarkState &bench) {
+    // Stacked nullspace projected jacobians of a full MSCKF update
+    int rows = 40 * (2 * 22 - 3);
+    int cols = 6 * 11 + 2 * (6 + 8) + 1;
+    Eigen::MatrixXd H_x0 = Eigen::MatrixXd::Random(rows, cols);
+    Eigen::VectorXd res0 = Eigen::VectorXd::Random(rows);
+    Eigen::MatrixXd H_x;
+    Eigen::VectorXd res;
+    while (bench.keep_running()) {
+      bench.pause();
+      H_x = H_x0;
+      res = res0;
+      bench.resume();
+      UpdaterHelper::measurement_compress_inplace(H_x, res);
+    }
+  });
+
+  //=====================================================================================
+  // FEATURE TRIANGULATION
+  //=====================================================================================
+
+  for (bool refine : {false, true}) {
+    std::string name = std::string("FeatureInitializer::") + (refine ? "single_gaussnewton" : "single_triangulation") + "/clones:11";
+    benchmarks.emplace_back(name, [refine](BenchmarkState &bench) {
+      // Feature seen from a window of clones moving sideways
+      FeatureInitializerOptions options;
+      FeatureInitializer initializer(options);
+      std::unordered_map<size_t, std::unordered_map<double, FeatureInitializer::ClonePose>> clones_cam;
+      auto feat0 = std::make_shared<Feature>();
+      feat0->featid = 0;
+      Eigen::Vector3d p_FinG(0.5, -0.3, 5.0);
+      for (int i = 0; i < 11; i++) {
+        double timestamp = 0.05 * i;
+        Eigen::Matrix3d R_GtoC = Eigen::Matrix3d::Identity();
+        Eigen::Vector3d p_CinG(0.05 * i, 0.01 * i, 0.0);
+        clones_cam[0].insert({timestamp, FeatureInitializer::ClonePose(R_GtoC, p_CinG)});
+        Eigen::Vector3d p_FinC = R_GtoC * (p_FinG - p_CinG);
+        Eigen::VectorXf uv_norm(2);
+        uv_norm << (float)(p_FinC(0) / p_FinC(2) + 1e-3 * (i % 3)), (float)(p_FinC(1) / p_FinC(2));
+        feat0->timestamps[0].push_back(timestamp);
+        feat0->uvs_norm[0].push_back(uv_norm);
+        feat0->uvs[0].push_back(uv_norm);
+      }
+      auto feat = std::make_shared<Feature>();
+      while (bench.keep_running()) {
+        bench.pause();
+        *feat = *feat0;
+        bench.resume();
+        initializer.single_triangulation(feat, clones_cam);
+        if (refine)
+          initializer.single_gaussnewton(feat, clones_cam);
+      }
+    });
+  }
+
+  //=====================================================================================
+  // CAMERA MODELS
+  //=====================================================================================
+
+  for (bool equi : {false, true}) {
+    benchmarks.emplace_back(std::string(equi ? "CamEqui" : "CamRadtan") + "::undistort_f/points:200", [equi](BenchmarkState &bench) {
+      std::shared_ptr<CamBase> camera;
+      Eigen::Matrix<double, 8, 1> calib;
+      if (equi) {
+        camera = std::make_shared<CamEqui>(752, 480);
+        calib << 458.654, 457.296, 367.215, 248.375, -0.00696, -0.00225, 0.00140, -0.00034;
+      } else {
+        camera = std::make_shared<CamRadtan>(752, 480);
+        calib << 458.654, 457.296, 367.215, 248.375, -0.28340811, 0.07395907, 0.00019359, 1.76187114e-05;
+      }
+      camera->set_value(calib);
+      std::vector<Eigen::Vector2f> pts;
+      cv::RNG rng(0);
+      for (int i = 0; i < 200; i++)
+        pts.emplace_back(rng.uniform(0.f, 752.f), rng.uniform(0.f, 480.f));
+      Eigen::Vector2f sum = Eigen::Vector2f::Zero();
+      while (bench.keep_running()) {
+        for (const auto &pt : pts)
+          sum += camera->undistort_f(pt);
+      }
+      bench.counters["checksum"] = sum.norm();
+    });
+  }
+
+  //=====================================================================================
+  // FEATURE TRACKING
+  //=====================================================================================
+
+  benchmarks.emplace_back("Grider_FAST::perform_griding/752x480/feats:200", [](BenchmarkState &bench) {
+    cv::Mat img = create_image(752, 480, 0);
+    cv::Mat mask = cv::Mat::zeros(img.rows, img.cols, CV_8UC1);
+    std::vector<cv::KeyPoint> pts;
+    double num_pts = 0;
+    while (bench.keep_running()) {
+      pts.clear();
+      Grider_FAST::perform_griding(img, mask, pts, 200, 5, 5, 20, true);
+      num_pts += pts.size();
+    }
+    bench.counters["feats"] = num_pts / std::max(bench.iterations, (size_t)1);
+  });
+
+  benchmarks.emplace_back("TrackKLT::perform_matching/752x480/feats:200", [](BenchmarkState &bench) {
+    // Second image is the first shifted by a few pixels
+    std::unordered_map<size_t, std::shared_ptr<CamBase>> cameras;
+    Eigen::Matrix<double, 8, 1> calib;
+    calib << 458.654, 457.296, 367.215, 248.375, -0.28340811, 0.07395907, 0.00019359, 1.76187114e-05;
+    cameras.insert({0, std::make_shared<CamRadtan>(752, 480)});
+    cameras.at(0)->set_value(calib);
+    BenchTrackKLT tracker(cameras, 200, 0, false, TrackBase::NONE, 20, 5, 5, 10);
+    cv::Mat img0 = create_image(752, 480, 1);
+    cv::Mat img1;
+    cv::Mat shift = (cv::Mat_<double>(2, 3) << 1, 0, 2.5, 0, 1, -1.5);
+    cv::warpAffine(img0, img1, shift, img0.size());
+    std::vector<cv::Mat> pyr0, pyr1;
+    cv::buildOpticalFlowPyramid(img0, pyr0, tracker.get_win_size(), tracker.get_pyr_levels());
+    cv::buildOpticalFlowPyramid(img1, pyr1, tracker.get_win_size(), tracker.get_pyr_levels());
+    std::vector<cv::KeyPoint> pts0_init;
+    Grider_FAST::perform_griding(img0, cv::Mat::zeros(img0.rows, img0.cols, CV_8UC1), pts0_init, 200, 5, 5, 20, true);
+    std::vector<cv::KeyPoint> pts0, pts1;
+    std::vector<uchar> mask;
+    double num_good = 0;
+    while (bench.keep_running()) {
+      bench.pause();
+      pts0 = pts0_init;
+      pts1.clear();
+      cv::setRNGSeed(0);
+      bench.resume();
+      tracker.perform_matching(pyr0, pyr1, pts0, pts1, 0, 0, mask);
+      num_good += std::count(mask.begin(), mask.end(), 1);
+    }
+    bench.counters["feats"] = pts0_init.size();
+    bench.counters["tracked"] = num_good / std::max(bench.iterations, (size_t)1);
+  });
+
+  //=====================================================================================
+  //=====================================================================================
+  //=====================================================================================
+
+  // Run all which match our filter
+  std::vector<BenchmarkResult> results;
+  printf("%-60s %14s %14s %12s\n", "Benchmark", "Time (us)", "CPU (us)", "Iterations");
+  printf("%s\n", std::string(103, '-').c_str());
+  for (const auto &benchmark : benchmarks) {
+    if (!std::regex_search(benchmark.first, filter_regex))
+      continue;
+    srand(0);
+    BenchmarkState bench(min_time);
+    benchmark.second(bench);
+    BenchmarkResult result;
+    result.name = benchmark.first;
+    result.iterations = std::max(bench.iterations, (size_t)1);
+    result.real_time_us = 1e6 * bench.real_time / result.iterations;
+    result.cpu_time_us = 1e6 * bench.cpu_time / result.iterations;
+    result.counters = bench.counters;
+    results.push_back(result);
+    std::stringstream ss;
+    for (const auto &counter : result.counters)
+      ss << " " << counter.first << "=" << counter.second;
+    printf("%-60s %14.3f %14.3f %12zu%s\n", result.name.c_str(), result.real_time_us, result.cpu_time_us, result.iterations,
+           ss.str().c_str());
+  }
+
+  // Save to file if we have one, otherwise print it
+  if (!out_path.empty()) {
+    std::ofstream out(out_path);
+    if (!out.is_open()) {
+      PRINT_ERROR(RED "unable to open %s for writing\n" RESET, out_path.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    write_json(out, results, min_time);
+    PRINT_WARNING("saved %zu results to %s\n", results.size(), out_path.c_str());
+  } else {
+    std::stringstream json;
+    write_json(json, results, min_time);
+    std::cout.flush();
+    fflush(stdout);
+    std::string json_str = json.str();
+    if (write(json_fd, json_str.data(), json_str.size()) != (ssize_t)json_str.size()) {
+      PRINT_ERROR(RED "unable to print the results\n" RESET);
+      std::exit(EXIT_FAILURE);
+    }
+    close(json_fd);
+  }
+
+  // Done!
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "feat/Feature.h"
+#include "feat/FeatureInitializerOptions.h"
+#include "types/Landmark.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+#include "utils/quat_ops.h"
+
+#include "state/State.h"
+#include "state/StateHelper.h"
+#include "update/UpdaterOptions.h"
+#include "update/UpdaterSLAM.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/**
+ * Creates a state with a full window (one more clone than the max) which rotates by the given amount between each clone.
+ * Clones are at times 0, 1, ..., max_clones and the newest is the current state time.
+ */
+std::shared_ptr<State> create_state(bool use_keyframes, double deg_per_clone) {
+  StateOptions options;
+  options.num_cameras = 1;
+  options.max_clone_size = 4;
+  options.use_keyframe_clones = use_keyframes;
+  options.keyframe_min_parallax = 10.0;
+  options.keyframe_min_rotation = 5.0;
+  options.keyframe_min_tracked = 5;
+  auto state = std::make_shared<State>(options);
+  for (int i = 0; i <= options.max_clone_size; i++) {
+    state->_timestamp = (double)i;
+    Eigen::Matrix<double, 16, 1> imu = state->_imu->value();
+    imu.block(0, 0, 4, 1) = rot_2_quat(exp_so3(Eigen::Vector3d(0, 0, i * deg_per_clone * M_PI / 180.0)));
+    imu.block(4, 0, 3, 1) << 0.1 * i, 0.0, 0.0;
+    state->_imu->set_value(imu);
+    state->_imu->set_fej(imu);
+    StateHelper::augment_clone(state, Eigen::Vector3d::Zero());
+  }
+  return state;
+}
+
+/**
+ * Creates features seen in clone 2 and 3 (the candidate clone is 3, the one before the newest).
+ * Each feature moves by the given number of pixels between the two clones.
+ */
+std::vector<std::shared_ptr<Feature>> create_features(int num_feats, double parallax_px) {
+  std::vector<std::shared_ptr<Feature>> feats;
+  for (int i = 0; i < num_feats; i++) {
+    auto feat = std::make_shared<Feature>();
+    feat->featid = (size_t)i;
+    Eigen::Vector2f uv(100.0f + 10.0f * i, 200.0f);
+    for (int t = 2; t <= 3; t++) {
+      feat->timestamps[0].push_back((double)t);
+      feat->uvs[0].push_back(uv + Eigen::Vector2f((float)(parallax_px * (t - 2)), 0.0f));
+      feat->uvs_norm[0].push_back(Eigen::Vector2f::Zero());
+    }
+    feats.push_back(feat);
+  }
+  return feats;
+}
+
+/// Adds an anchored SLAM feature in the given clone
+std::shared_ptr<Landmark> add_anchored_feature(std::shared_ptr<State> state, size_t featid, double anchor_time) {
+  auto landmark = std::make_shared<Landmark>(3);
+  landmark->_featid = featid;
+  landmark->_feat_representation = LandmarkRepresentation::Representation::ANCHORED_3D;
+  landmark->_anchor_cam_id = 0;
+  landmark->_anchor_clone_timestamp = anchor_time;
+  landmark->set_from_xyz(Eigen::Vector3d(0.5, -0.2, 4.0), false);
+  landmark->set_from_xyz(Eigen::Vector3d(0.5, -0.2, 4.0), true);
+  std::vector<std::shared_ptr<Type>> H_order = {state->_clones_IMU.at(anchor_time)};
+  Eigen::MatrixXd H_R = Eigen::MatrixXd::Identity(3, 6);
+  Eigen::MatrixXd H_L = Eigen::MatrixXd::Identity(3, 3);
+  Eigen::MatrixXd R = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(3, 3);
+  Eigen::VectorXd res = Eigen::VectorXd::Zero(3);
+  StateHelper::initialize_invertible(state, landmark, H_order, H_R, H_L, R, res);
+  state->_features_SLAM.insert({featid, landmark});
+  return landmark;
+}
+
+/// Exits if the selection does not match what we expect
+void check_selection(const std::string &name, std::shared_ptr<State> state, const std::vector<std::shared_ptr<Feature>> &feats,
+                     bool expect_redundant) {
+  bool redundant = StateHelper::select_marg_clone(state, feats);
+  double expected_time = (expect_redundant) ? 3.0 : 0.0;
+  if (redundant != expect_redundant || state->margtimestep() != expected_time || state->oldesttimestep() != 0.0) {
+    PRINT_ERROR(RED "[KEYFRAME]: %s - got redundant %d (marg %.1f, oldest %.1f) but expected %d\n" RESET, name.c_str(), (int)redundant,
+                state->margtimestep(), state->oldesttimestep(), (int)expect_redundant);
+    std::exit(EXIT_FAILURE);
+  }
+  PRINT_INFO("[KEYFRAME]: %s - %s\n", name.c_str(), (redundant) ? "redundant" : "keyframe");
+}
+
+int main(int argc, char **argv) {
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  if (argc > 1) {
+    verbosity = argv[1];
+  }
+  ov_core::Printer::setPrintLevel(verbosity);
+  signal(SIGINT, signal_callback_handler);
+
+  // Check which clone is selected for the different types of motion
+  check_selection("disabled", create_state(false, 1.0), create_features(20, 1.0), false);
+  check_selection("small motion", create_state(true, 1.0), create_features(20, 1.0), true);
+  check_selection("large rotation", create_state(true, 10.0), create_features(20, 1.0), false);
+  check_selection("large parallax", create_state(true, 1.0), create_features(20, 20.0), false);
+  check_selection("few tracks", create_state(true, 1.0), create_features(3, 1.0), false);
+  check_selection("no tracks", create_state(true, 1.0), {}, false);
+
+  // Without a minimum number of tracks, no tracks should still be a keyframe (there is no parallax to compute)
+  std::shared_ptr<State> state = create_state(true, 1.0);
+  state->_options.keyframe_min_tracked = 0;
+  check_selection("no tracks (no minimum)", state, {}, false);
+
+  // Now marginalize a redundant clone with SLAM features anchored in it and in the (older) oldest clone
+  // The one in the redundant clone should be moved to the newest, while the other should be left alone
+  state = create_state(true, 1.0);
+  std::shared_ptr<Landmark> landmark_old = add_anchored_feature(state, 100, 0.0);
+  std::shared_ptr<Landmark> landmark_cand = add_anchored_feature(state, 101, 3.0);
+  check_selection("redundant with slam", state, create_features(20, 1.0), true);
+  UpdaterOptions options_slam, options_aruco;
+  FeatureInitializerOptions options_init;
+  UpdaterSLAM updater(options_slam, options_aruco, options_init);
+  updater.change_anchors(state);
+  StateHelper::marginalize_old_clone(state);
+  std::vector<double> times_expected = {0.0, 1.0, 2.0, 4.0};
+  std::vector<double> times;
+  for (const auto &clone : state->_clones_IMU)
+    times.push_back(clone.first);
+  if (times != times_expected || state->_marg_redundant_timestep != -1 || state->margtimestep() != 0.0) {
+    PRINT_ERROR(RED "[KEYFRAME]: redundant clone was not removed from the middle of the window\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  if (landmark_old->_anchor_clone_timestamp != 0.0 || landmark_cand->_anchor_clone_timestamp != 4.0) {
+    PRINT_ERROR(RED "[KEYFRAME]: anchors are %.1f and %.1f but expected 0.0 and 4.0\n" RESET, landmark_old->_anchor_clone_timestamp,
+                landmark_cand->_anchor_clone_timestamp);
+    std::exit(EXIT_FAILURE);
+  }
+  if (!StateHelper::get_full_covariance(state).allFinite()) {
+    PRINT_ERROR(RED "[KEYFRAME]: covariance is not finite after marginalizing the redundant clone\n" RESET);
+    std::exit(EXIT_FAILURE);
+  }
+  PRINT_INFO(GREEN "[KEYFRAME]: all keyframe selection tests passed\n" RESET);
+  return EXIT_SUCCESS;
+}
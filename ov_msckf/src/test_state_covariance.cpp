@@ -0,0 +1,190 @@
+/*
+ * OpenVINS: An Open Platform for Visual-Inertial Research
+ * Copyright (C) 2018-2023 Patrick Geneva
+ * Copyright (C) 2018-2023 Guoquan Huang
+ * Copyright (C) 2018-2023 OpenVINS Contributors
+ * Copyright (C) 2018-2019 Kevin Eckenhoff
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "types/Landmark.h"
+#include "utils/colors.h"
+#include "utils/print.h"
+
+#include "state/State.h"
+#include "state/StateHelper.h"
+
+using namespace ov_core;
+using namespace ov_type;
+using namespace ov_msckf;
+
+// Define the function to be called when ctrl-c (SIGINT) is sent to process
+void signal_callback_handler(int signum) { std::exit(signum); }
+
+/// Covariance of the state after one of the steps in our sequence
+struct CovarianceStep {
+  std::string name;
+  Eigen::MatrixXd cov;
+};
+
+/**
+ * Runs the same sequence of propagations, clones, updates, SLAM initializations and marginalizations on a state with the given options.
+ * The random numbers are re-seeded, so each call will see the exact same inputs.
+ * We return the full covariance after each step so different covariance representations can be compared.
+ */
+std::vector<CovarianceStep> run_sequence(StateOptions options) {
+
+  // Stereo-like state with online calibration so there are variables which are not propagated
+  std::srand(0);
+  options.num_cameras = 1;
+  options.do_calib_camera_pose = true;
+  options.do_calib_camera_timeoffset = true;
+  options.max_clone_size = 5;
+  auto state = std::make_shared<State>(options);
+  std::vector<std::shared_ptr<Type>> order = {state->_imu, state->_calib_dt_CAMtoIMU, state->_calib_IMUtoCAM.at(0)};
+  int size = state->_imu->size() + state->_calib_dt_CAMtoIMU->size() + state->_calib_IMUtoCAM.at(0)->size();
+  Eigen::MatrixXd P_rand = Eigen::MatrixXd::Random(size, size);
+  Eigen::MatrixXd P0 = 1e-2 * P_rand * P_rand.transpose() + 1e-2 * Eigen::MatrixXd::Identity(size, size);
+  StateHelper::set_initial_covariance(state, P0, order);
+
+  // Now go through our frames
+  std::vector<CovarianceStep> steps;
+  for (int frame = 0; frame < 20; frame++) {
+
+    // Propagate the IMU (a few times like we would between camera frames)
+    for (int k = 0; k < 3; k++) {
+      Eigen::MatrixXd Phi = Eigen::MatrixXd::Identity(15, 15) + 0.05 * Eigen::MatrixXd::Random(15, 15);
+      Eigen::MatrixXd Q_rand = 1e-2 * Eigen::MatrixXd::Random(15, 15);
+      Eigen::MatrixXd Q = Q_rand * Q_rand.transpose();
+      StateHelper::EKFPropagation(state, {state->_imu}, {state->_imu}, Phi, Q);
+    }
+    steps.push_back({"propagate " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+
+    // Clone the current pose
+    state->_timestamp = 0.1 * frame;
+    StateHelper::augment_clone(state, Eigen::Vector3d::Random());
+    steps.push_back({"clone " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+
+    // Change the anchor of a SLAM feature to the newest clone (like UpdaterSLAM::perform_anchor_change)
+    // This happens right after propagation, so the landmark is propagated from clones which can still have deferred rows
+    if (!state->_features_SLAM.empty() && frame % 2 == 1) {
+      std::shared_ptr<Landmark> landmark = state->_features_SLAM.begin()->second;
+      std::vector<std::shared_ptr<Type>> phi_order_OLD = {state->_clones_IMU.begin()->second, state->_clones_IMU.rbegin()->second,
+                                                          state->_calib_IMUtoCAM.at(0), landmark};
+      Eigen::MatrixXd Phi = 0.1 * Eigen::MatrixXd::Random(3, 21);
+      Phi.block(0, 18, 3, 3) += Eigen::MatrixXd::Identity(3, 3);
+      StateHelper::EKFPropagation(state, {landmark}, phi_order_OLD, Phi, Eigen::MatrixXd::Zero(3, 3));
+      steps.push_back({"anchor change " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+    }
+
+    // Update with a measurement of the newest and oldest clone, and the calibration
+    std::vector<std::shared_ptr<Type>> H_order = {state->_clones_IMU.rbegin()->second, state->_clones_IMU.begin()->second,
+                                                  state->_calib_IMUtoCAM.at(0)};
+    Eigen::MatrixXd H = Eigen::MatrixXd::Random(6, 18);
+    Eigen::VectorXd res = 1e-2 * Eigen::VectorXd::Random(6);
+    Eigen::MatrixXd R = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(6, 6);
+    StateHelper::EKFUpdate(state, H_order, H, res, R);
+    steps.push_back({"update " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+
+    // Every few frames we add a SLAM feature seen from the newest clone
+    if (frame % 3 == 0) {
+      auto landmark = std::make_shared<Landmark>(3);
+      landmark->_featid = (size_t)(4 * state->_options.max_aruco_features + 1 + frame);
+      landmark->_feat_representation = LandmarkRepresentation::Representation::GLOBAL_3D;
+      landmark->set_from_xyz(Eigen::Vector3d(0.0, 0.0, 5.0), false);
+      landmark->set_from_xyz(Eigen::Vector3d(0.0, 0.0, 5.0), true);
+      Eigen::MatrixXd H_R = Eigen::MatrixXd::Random(3, 6);
+      Eigen::MatrixXd H_L = Eigen::MatrixXd::Identity(3, 3) + 0.1 * Eigen::MatrixXd::Random(3, 3);
+      Eigen::MatrixXd R_L = std::pow(0.1, 2) * Eigen::MatrixXd::Identity(3, 3);
+      Eigen::VectorXd res_L = Eigen::VectorXd::Zero(3);
+      StateHelper::initialize_invertible(state, landmark, {state->_clones_IMU.rbegin()->second}, H_R, H_L, R_L, res_L);
+      state->_features_SLAM.insert({landmark->_featid, landmark});
+      steps.push_back({"initialize " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+    }
+
+    // Finally marginalize the oldest clone if our window is full, and a SLAM feature every so often
+    if ((int)state->_clones_IMU.size() > state->_options.max_clone_size) {
+      StateHelper::marginalize_old_clone(state);
+      steps.push_back({"marginalize clone " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+    }
+    if (frame % 7 == 6) {
+      state->_features_SLAM.begin()->second->should_marg = true;
+      StateHelper::marginalize_slam(state);
+      steps.push_back({"marginalize slam " + std::to_string(frame), StateHelper::get_full_covariance(state)});
+    }
+  }
+  return steps;
+}
+
+/// Checks that the covariance after each step matches the reference (relative to the size of the reference covariance)
+void compare_sequence(const std::string &name, const std::vector<CovarianceStep> &reference, const std::vector<CovarianceStep> &steps,
+                      double max_error) {
+  if (reference.size() != steps.size()) {
+    PRINT_ERROR(RED "[COV]: %s ran %d steps but the reference ran %d\n" RESET, name.c_str(), (int)steps.size(), (int)reference.size());
+    std::exit(EXIT_FAILURE);
+  }
+  double worst = 0.0;
+  for (size_t i = 0; i < steps.size(); i++) {
+    if (reference.at(i).cov.rows() != steps.at(i).cov.rows() || !steps.at(i).cov.allFinite()) {
+      PRINT_ERROR(RED "[COV]: %s has an invalid covariance after %s\n" RESET, name.c_str(), steps.at(i).name.c_str());
+      std::exit(EXIT_FAILURE);
+    }
+    double error = (reference.at(i).cov - steps.at(i).cov).norm() / reference.at(i).cov.norm();
+    if (error > max_error) {
+      PRINT_ERROR(RED "[COV]: %s has a relative error of %.3e after %s (max %.1e)\n" RESET, name.c_str(), error, steps.at(i).name.c_str(),
+                  max_error);
+      std::exit(EXIT_FAILURE);
+    }
+    worst = std::max(worst, error);
+  }
+  PRINT_INFO("[COV]: %s matches the dense covariance over %d steps (max relative error %.3e)\n", name.c_str(), (int)steps.size(), worst);
+}
+
+int main(int argc, char **argv) {
+
+  // Verbosity
+  std::string verbosity = "INFO";
+  if (argc > 1) {
+    verbosity = argv[1];
+  }
+  ov_core::Printer::setPrintLevel(verbosity);
+  signal(SIGINT, signal_callback_handler);
+
+  // Our reference is the dense double covariance
+  StateOptions options_dense;
+  std::vector<CovarianceStep> reference = run_sequence(options_dense);
+
+  // The square-root factor S*S^T should match it (up to single precision)
+  StateOptions options_sqrt;
+  options_sqrt.use_sqrt_covariance = true;
+  compare_sequence("square-root covariance", reference, run_sequence(options_sqrt), 1e-4);
+
+  // Deferring the cross-covariance propagation until it is needed should give the same covariance as doing it eagerly
+  StateOptions options_deferred;
+  options_deferred.use_deferred_propagation = true;
+  compare_sequence("deferred propagation", reference, run_sequence(options_deferred), 1e-10);
+
+  PRINT_INFO(GREEN "[COV]: all covariance tests passed\n" RESET);
+  return EXIT_SUCCESS;
+}
@@ -31,6 +31,7 @@
 #include "utils/colors.h"
 #include "utils/print.h"
 #include "utils/quat_ops.h"
+#include "utils/trace.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/math/distributions/chi_squared.hpp>
@@ -285,6 +286,13 @@ void UpdaterMSCKF::update(std::shared_ptr<State> state, std::vector<std::shared_
   StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
   rT5 = boost::posix_time::microsec_clock::local_time();
 
+  // Record the stages into the trace
+  if (Tracer::enabled()) {
+    std::pair<const char *, double> args[2] = {{"features", (double)feature_vec.size()}, {"rows", (double)res_big.rows()}};
+    Tracer::record_stages("update", "msckf_update", {"msckf_clean", "msckf_triangulate", "msckf_system", "msckf_compress", "msckf_ekf"},
+                          {rT0, rT1, rT2, rT3, rT4, rT5}, args, 2);
+  }
+
   // Debug print timing information
   PRINT_ALL("[MSCKF-UP]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
   PRINT_ALL("[MSCKF-UP]: %.4f seconds to triangulate\n", (rT2 - rT1).total_microseconds() * 1e-6);
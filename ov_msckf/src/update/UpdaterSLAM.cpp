@@ -32,6 +32,7 @@
 #include "utils/colors.h"
 #include "utils/print.h"
 #include "utils/quat_ops.h"
+#include "utils/trace.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/math/distributions/chi_squared.hpp>
@@ -241,6 +242,13 @@ void UpdaterSLAM::delayed_init(std::shared_ptr<State> state, std::vector<std::sh
   }
   rT3 = boost::posix_time::microsec_clock::local_time();
 
+  // Record the stages into the trace
+  if (Tracer::enabled() && !feature_vec.empty()) {
+    std::pair<const char *, double> args[1] = {{"features", (double)feature_vec.size()}};
+    Tracer::record_stages("update", "slam_delayed_init", {"slam_delayed_clean", "slam_delayed_triangulate", "slam_delayed_initialize"},
+                          {rT0, rT1, rT2, rT3}, args, 1);
+  }
+
   // Debug print timing information
   if (!feature_vec.empty()) {
     PRINT_ALL("[SLAM-DELAY]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
@@ -470,6 +478,12 @@ void UpdaterSLAM::update(std::shared_ptr<State> state, std::vector<std::shared_p
   StateHelper::EKFUpdate(state, Hx_order_big, Hx_big, res_big, R_big);
   rT3 = boost::posix_time::microsec_clock::local_time();
 
+  // Record the stages into the trace
+  if (Tracer::enabled()) {
+    std::pair<const char *, double> args[2] = {{"features", (double)feature_vec.size()}, {"rows", (double)Hx_big.rows()}};
+    Tracer::record_stages("update", "slam_update", {"slam_clean", "slam_system", "slam_ekf"}, {rT0, rT1, rT2, rT3}, args, 2);
+  }
+
   // Debug print timing information
   PRINT_ALL("[SLAM-UP]: %.4f seconds to clean\n", (rT1 - rT0).total_microseconds() * 1e-6);
   PRINT_ALL("[SLAM-UP]: %.4f seconds creating linear system\n", (rT2 - rT1).total_microseconds() * 1e-6);
@@ -495,7 +509,8 @@ void UpdaterSLAM::change_anchors(std::shared_ptr<State> state) {
         f.second->_feat_representation == LandmarkRepresentation::Representation::GLOBAL_FULL_INVERSE_DEPTH)
       continue;
     // Else lets see if it is anchored in the clone that will be marginalized
-    assert(marg_timestep <= f.second->_anchor_clone_timestamp);
+    // NOTE: with keyframes the marginalized clone can be newer than the anchor
+    assert(state->_options.use_keyframe_clones || marg_timestep <= f.second->_anchor_clone_timestamp);
     if (f.second->_anchor_clone_timestamp == marg_timestep) {
       perform_anchor_change(state, f.second, state->_timestamp, f.second->_anchor_cam_id);
     }